@@ -0,0 +1,575 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Branch Predictor
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 branch predictor. Without a predictor, the FD stage uses the hint bit of a conditional branch
+// and simply continues with the next instruction for all other branches. The MA stage then redirects the
+// instruction fetch, which costs a bubble for every unconditional branch and two bubbles for every wrongly
+// hinted conditional branch. The branch predictor lets the FD stage fetch from the predicted target right
+// away, the MA and EX stage only redirect the fetch when the prediction was wrong.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Branch Predictor
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. The TAGE tagged tables have a quarter of the pattern history table entries each. Their history
+// lengths double from table to table, the last table uses the full global history.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const uint32_t  MIN_PHT_BITS        = 4;
+const uint32_t  TAGE_TAG_BITS       = 9;
+const uint16_t  TAGE_TAG_INVALID    = 0xFFFF;
+const int8_t    TAGE_CTR_MAX        = 3;
+const int8_t    TAGE_CTR_MIN        = -4;
+const uint8_t   TAGE_USEFUL_MAX     = 3;
+
+uint32_t log2Floor( uint32_t val ) {
+    
+    uint32_t bits = 0;
+    
+    while (( bits < 31 ) && (( 1U << ( bits + 1 )) <= val )) bits++;
+    return( bits );
+}
+
+uint32_t foldHist( uint32_t hist, uint32_t len, uint32_t bits ) {
+    
+    uint32_t res = 0;
+    
+    if ( len < 32 ) hist &= ( 1U << len ) - 1;
+    
+    while ( hist != 0 ) {
+        
+        res  ^= hist & (( 1U << bits ) - 1 );
+        hist >>= bits;
+    }
+    
+    return( res );
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor object constructor. The table sizes are limited to what we support and rounded down
+// to a power of two. The TAGE tables are only allocated for the TAGE policy.
+//
+//------------------------------------------------------------------------------------------------------------
+BranchPredictor::BranchPredictor( CpuCore *core, BranchPredDesc *bDesc ) {
+    
+    this -> core = core;
+    memcpy( &bpDesc, bDesc, sizeof( BranchPredDesc ));
+    
+    if ( bpDesc.phtEntries > MAX_PHT_ENTRIES )          bpDesc.phtEntries   = MAX_PHT_ENTRIES;
+    if ( bpDesc.phtEntries < ( 1U << MIN_PHT_BITS ))    bpDesc.phtEntries   = 1U << MIN_PHT_BITS;
+    if ( bpDesc.btbEntries > MAX_BTB_ENTRIES )          bpDesc.btbEntries   = MAX_BTB_ENTRIES;
+    if ( bpDesc.rasEntries > MAX_RAS_ENTRIES )          bpDesc.rasEntries   = MAX_RAS_ENTRIES;
+    if ( bpDesc.historyBits > MAX_BRANCH_HIST_BITS )    bpDesc.historyBits  = MAX_BRANCH_HIST_BITS;
+    if ( bpDesc.historyBits == 0 )                      bpDesc.historyBits  = 1;
+    
+    phtBits             = log2Floor( bpDesc.phtEntries );
+    tageBits            = phtBits - 2;
+    bpDesc.phtEntries   = 1U << phtBits;
+    histMask            = ( bpDesc.historyBits < 32 ) ? (( 1U << bpDesc.historyBits ) - 1 ) : UINT32_MAX;
+    
+    if ( bpDesc.btbEntries > 0 ) bpDesc.btbEntries = 1U << log2Floor( bpDesc.btbEntries );
+    
+    pht = new uint8_t[ bpDesc.phtEntries ];
+    
+    if ( bpDesc.policy == BP_TAGE ) {
+        
+        for ( uint32_t i = 0; i < MAX_TAGE_TABLES; i++ ) tage[ i ] = new TageEntry[ 1U << tageBits ];
+    }
+    
+    if ( bpDesc.btbEntries > 0 ) btb = new BtbEntry[ bpDesc.btbEntries ];
+    
+    reset( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "reset" clears all tables and histories, "clearStats" resets the statistic counters. The counters of the
+// pattern history table start as weakly not taken.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::reset( ) {
+    
+    memset( pht, 1, bpDesc.phtEntries );
+    
+    for ( uint32_t i = 0; i < MAX_TAGE_TABLES; i++ ) {
+        
+        if ( tage[ i ] == nullptr ) continue;
+        
+        for ( uint32_t j = 0; j < ( 1U << tageBits ); j++ ) {
+            
+            tage[ i ][ j ].tag      = TAGE_TAG_INVALID;
+            tage[ i ][ j ].ctr      = 0;
+            tage[ i ][ j ].useful   = 0;
+        }
+    }
+    
+    for ( uint32_t i = 0; i < bpDesc.btbEntries; i++ ) {
+        
+        btb[ i ].valid  = false;
+        btb[ i ].adr    = 0;
+        btb[ i ].target = 0;
+    }
+    
+    memset( specRas, 0, sizeof( specRas ));
+    memset( commitRas, 0, sizeof( commitRas ));
+    memset( pendAdr, 0, sizeof( pendAdr ));
+    memset( pendSrc, 0, sizeof( pendSrc ));
+    
+    specHist        = 0;
+    commitHist      = 0;
+    specRasTop      = 0;
+    specRasCnt      = 0;
+    commitRasTop    = 0;
+    commitRasCnt    = 0;
+    pendHead        = 0;
+    pendCnt         = 0;
+    undoValid       = false;
+}
+
+void BranchPredictor::clearStats( ) {
+    
+    condPredictCnt      = 0;
+    condMispredictCnt   = 0;
+    targetPredictCnt    = 0;
+    targetMispredictCnt = 0;
+    btbHitCnt           = 0;
+    rasHitCnt           = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "tick" is called by the FD stage at the end of each clock cycle. The FD stage work of the cycle can no
+// longer be undone.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::tick( ) {
+    
+    undoValid = false;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// With the static policy, there is no predictor. The FD stage uses the hint bit of the conditional branches.
+//
+//------------------------------------------------------------------------------------------------------------
+bool BranchPredictor::isEnabled( ) {
+    
+    return( bpDesc.policy != BP_STATIC );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Table index computation. The bimodal predictor and the TAGE base predictor are indexed by the instruction
+// address, gshare adds the global history. A TAGE tagged table uses the history length of the table for the
+// index and the tag, folded to the respective number of bits.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t BranchPredictor::phtIndex( uint32_t adr, uint32_t hist ) {
+    
+    uint32_t idx = adr >> 2;
+    
+    if ( bpDesc.policy == BP_GSHARE ) idx ^= foldHist( hist, bpDesc.historyBits, phtBits );
+    
+    return( idx & ( bpDesc.phtEntries - 1 ));
+}
+
+uint32_t BranchPredictor::tageIndex( uint32_t adr, uint32_t hist, uint32_t table ) {
+    
+    uint32_t len = bpDesc.historyBits >> ( MAX_TAGE_TABLES - 1 - table );
+    
+    if ( len == 0 ) len = 1;
+    
+    return((( adr >> 2 ) ^ foldHist( hist, len, tageBits )) & (( 1U << tageBits ) - 1 ));
+}
+
+uint32_t BranchPredictor::tageTag( uint32_t adr, uint32_t hist, uint32_t table ) {
+    
+    uint32_t len = bpDesc.historyBits >> ( MAX_TAGE_TABLES - 1 - table );
+    
+    if ( len == 0 ) len = 1;
+    
+    return((( adr >> 2 ) ^
+            foldHist( hist, len, TAGE_TAG_BITS ) ^
+            ( foldHist( hist, len, TAGE_TAG_BITS - 1 ) << 1 )) & (( 1U << TAGE_TAG_BITS ) - 1 ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "tageProvider" returns the table with the longest history that has a matching entry, or -1 when no table
+// matches and the base predictor provides the prediction. The next matching table is the alternate provider.
+//
+//------------------------------------------------------------------------------------------------------------
+int BranchPredictor::tageProvider( uint32_t adr, uint32_t hist, int *altProvider ) {
+    
+    int provider = -1;
+    
+    *altProvider = -1;
+    
+    for ( int i = MAX_TAGE_TABLES - 1; i >= 0; i-- ) {
+        
+        if ( tage[ i ][ tageIndex( adr, hist, i ) ].tag == tageTag( adr, hist, i )) {
+            
+            if ( provider < 0 ) provider = i;
+            else {
+                
+                *altProvider = i;
+                break;
+            }
+        }
+    }
+    
+    return( provider );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "lookupDirection" returns the predicted direction for a conditional branch at the instruction address
+// with the global history passed.
+//
+//------------------------------------------------------------------------------------------------------------
+bool BranchPredictor::lookupDirection( uint32_t adr, uint32_t hist ) {
+    
+    if ( bpDesc.policy == BP_TAGE ) {
+        
+        int altProvider = -1;
+        int provider    = tageProvider( adr, hist, &altProvider );
+        
+        if ( provider >= 0 ) return( tage[ provider ][ tageIndex( adr, hist, provider ) ].ctr >= 0 );
+    }
+    
+    return( pht[ phtIndex( adr, hist ) ] >= 2 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "updateDirection" trains the direction predictor with the outcome of a conditional branch. The bimodal
+// and gshare predictor just move the two bit counter. For TAGE, the provider counter is updated. When the
+// provider and the alternate prediction differ, the provider entry is marked more or less useful. On a
+// misprediction, an entry is allocated in a table with a longer history. If all candidate entries are still
+// useful, they age instead.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::updateDirection( uint32_t adr, uint32_t hist, bool taken ) {
+    
+    uint8_t *ctrPtr = &pht[ phtIndex( adr, hist ) ];
+    
+    if ( bpDesc.policy != BP_TAGE ) {
+        
+        if      (( taken ) && ( *ctrPtr < 3 ))      ( *ctrPtr ) ++;
+        else if (( ! taken ) && ( *ctrPtr > 0 ))    ( *ctrPtr ) --;
+        return;
+    }
+    
+    int  altProvider    = -1;
+    int  provider       = tageProvider( adr, hist, &altProvider );
+    bool altPredict     = ( altProvider >= 0 ) ?
+                          ( tage[ altProvider ][ tageIndex( adr, hist, altProvider ) ].ctr >= 0 ) :
+                          ( *ctrPtr >= 2 );
+    bool predict        = altPredict;
+    
+    if ( provider >= 0 ) {
+        
+        TageEntry *ePtr = &tage[ provider ][ tageIndex( adr, hist, provider ) ];
+        
+        predict = ( ePtr -> ctr >= 0 );
+        
+        if ( predict != altPredict ) {
+            
+            if (( predict == taken ) && ( ePtr -> useful < TAGE_USEFUL_MAX ))   ePtr -> useful ++;
+            else if (( predict != taken ) && ( ePtr -> useful > 0 ))            ePtr -> useful --;
+        }
+        
+        if      (( taken ) && ( ePtr -> ctr < TAGE_CTR_MAX ))       ePtr -> ctr ++;
+        else if (( ! taken ) && ( ePtr -> ctr > TAGE_CTR_MIN ))     ePtr -> ctr --;
+    }
+    else {
+        
+        if      (( taken ) && ( *ctrPtr < 3 ))      ( *ctrPtr ) ++;
+        else if (( ! taken ) && ( *ctrPtr > 0 ))    ( *ctrPtr ) --;
+    }
+    
+    if (( predict != taken ) && ( provider < (int) MAX_TAGE_TABLES - 1 )) {
+        
+        bool allocated = false;
+        
+        for ( uint32_t i = provider + 1; i < MAX_TAGE_TABLES; i++ ) {
+            
+            TageEntry *ePtr = &tage[ i ][ tageIndex( adr, hist, i ) ];
+            
+            if ( ePtr -> useful == 0 ) {
+                
+                ePtr -> tag     = tageTag( adr, hist, i );
+                ePtr -> ctr     = ( taken ) ? 0 : -1;
+                allocated       = true;
+                break;
+            }
+        }
+        
+        if ( ! allocated ) {
+            
+            for ( uint32_t i = provider + 1; i < MAX_TAGE_TABLES; i++ ) {
+                
+                tage[ i ][ tageIndex( adr, hist, i ) ].useful --;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "saveUndo" remembers the speculative state before the FD stage changes it. A push onto the return address
+// stack can only overwrite the entry above the top.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::saveUndo( ) {
+    
+    undoValid       = true;
+    undoHist        = specHist;
+    undoRasTop      = specRasTop;
+    undoRasCnt      = specRasCnt;
+    undoPendHead    = pendHead;
+    undoPendCnt     = pendCnt;
+    
+    if ( bpDesc.rasEntries > 0 ) undoRasEntry = specRas[ ( specRasTop + 1 ) % bpDesc.rasEntries ];
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "pushPending" enters the prediction source of a B, BR or BV instruction into the queue of branches in
+// flight. The queue holds more entries than there are pipeline stages. Should it be full nevertheless, the
+// oldest entry is dropped.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::pushPending( uint32_t adr, BranchPredSrc src ) {
+    
+    if ( pendCnt == MAX_PEND_BRANCHES ) {
+        
+        pendHead = ( pendHead + 1 ) % MAX_PEND_BRANCHES;
+        pendCnt --;
+    }
+    
+    uint32_t idx = ( pendHead + pendCnt ) % MAX_PEND_BRANCHES;
+    
+    pendAdr[ idx ] = adr;
+    pendSrc[ idx ] = src;
+    pendCnt ++;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "predictCond" is called by the FD stage for a conditional branch and returns whether the branch is
+// predicted taken. With the static policy, this is the hint bit of the instruction. Otherwise we ask the
+// direction predictor and shift the prediction into the speculative global history.
+//
+//------------------------------------------------------------------------------------------------------------
+bool BranchPredictor::predictCond( uint32_t adr, bool hint ) {
+    
+    if ( ! isEnabled( )) return( hint );
+    
+    saveUndo( );
+    
+    bool taken = lookupDirection( adr, specHist );
+    
+    specHist = (( specHist << 1 ) | ( taken ? 1 : 0 )) & histMask;
+    return( taken );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "predictTarget" is called by the FD stage for the B, BR and BV instructions and returns the predicted next
+// instruction address. The B instruction target is computed from the offset. A BV instruction without a
+// link register takes the address from the return address stack. Otherwise the branch target buffer is
+// consulted, a miss predicts the next instruction. A branch with a link register pushes the return address.
+// The prediction source is remembered for the hit counters, which are updated when the branch completes.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t BranchPredictor::predictTarget( uint32_t adr, DecodedInstr *dInstr ) {
+    
+    uint32_t        target  = adr + 4;
+    BranchPredSrc   src     = BP_SRC_NONE;
+    
+    saveUndo( );
+    
+    if ( dInstr -> opCode == OP_B ) {
+        
+        target = adr + dInstr -> imm;
+    }
+    else if (( dInstr -> opCode == OP_BV ) && ( dInstr -> regR == 0 ) && ( specRasCnt > 0 )) {
+        
+        target      = specRas[ specRasTop ];
+        specRasTop  = ( specRasTop + bpDesc.rasEntries - 1 ) % bpDesc.rasEntries;
+        specRasCnt  --;
+        src         = BP_SRC_RAS;
+    }
+    else if ( bpDesc.btbEntries > 0 ) {
+        
+        BtbEntry *ePtr = &btb[ ( adr >> 2 ) & ( bpDesc.btbEntries - 1 ) ];
+        
+        if (( ePtr -> valid ) && ( ePtr -> adr == adr )) {
+            
+            target  = ePtr -> target;
+            src     = BP_SRC_BTB;
+        }
+    }
+    
+    pushPending( adr, src );
+    
+    if (( dInstr -> regR != 0 ) && ( bpDesc.rasEntries > 0 )) {
+        
+        specRasTop              = ( specRasTop + 1 ) % bpDesc.rasEntries;
+        specRas[ specRasTop ]   = adr + 4;
+        if ( specRasCnt < bpDesc.rasEntries ) specRasCnt ++;
+    }
+    
+    return( target );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "resolveTarget" is called by the MA stage when it computed the target of a B, BR or BV instruction. The
+// target of BR and BV is entered into the branch target buffer.
+//
+// ??? a branch behind a mispredicted conditional branch is flushed by the EX stage in the same cycle. It
+// is counted nevertheless.
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::resolveTarget( uint32_t adr, DecodedInstr *dInstr, uint32_t target, bool mispredicted ) {
+    
+    targetPredictCnt ++;
+    if ( mispredicted ) targetMispredictCnt ++;
+    
+    if (( isEnabled( )) && ( bpDesc.btbEntries > 0 ) && ( dInstr -> opCode != OP_B )) {
+        
+        BtbEntry *ePtr = &btb[ ( adr >> 2 ) & ( bpDesc.btbEntries - 1 ) ];
+        
+        ePtr -> valid   = true;
+        ePtr -> adr     = adr;
+        ePtr -> target  = target;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "commitCond" is called by the EX stage when a conditional branch completes. The direction predictor is
+// trained with the global history the prediction was made with. All older branches have completed by now
+// and the history is the completed history. The outcome is then shifted into the completed history.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::commitCond( uint32_t adr, bool taken, bool mispredicted ) {
+    
+    condPredictCnt ++;
+    if ( mispredicted ) condMispredictCnt ++;
+    
+    if ( ! isEnabled( )) return;
+    
+    updateDirection( adr, commitHist, taken );
+    commitHist = (( commitHist << 1 ) | ( taken ? 1 : 0 )) & histMask;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "commitBranch" is called by the EX stage when a B, BR or BV instruction completes. The oldest branch in
+// flight is the one completing. Its prediction source is counted and removed from the queue. The completed
+// return address stack is updated the same way the FD stage updated the speculative one.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::commitBranch( uint32_t adr, DecodedInstr *dInstr ) {
+    
+    while ( pendCnt > 0 ) {
+        
+        uint32_t    pAdr    = pendAdr[ pendHead ];
+        uint8_t     pSrc    = pendSrc[ pendHead ];
+        
+        pendHead = ( pendHead + 1 ) % MAX_PEND_BRANCHES;
+        pendCnt --;
+        
+        if ( pAdr == adr ) {
+            
+            if      ( pSrc == BP_SRC_BTB ) btbHitCnt ++;
+            else if ( pSrc == BP_SRC_RAS ) rasHitCnt ++;
+            break;
+        }
+    }
+    
+    if (( ! isEnabled( )) || ( bpDesc.rasEntries == 0 )) return;
+    
+    if (( dInstr -> opCode == OP_BV ) && ( dInstr -> regR == 0 ) && ( commitRasCnt > 0 )) {
+        
+        commitRasTop = ( commitRasTop + bpDesc.rasEntries - 1 ) % bpDesc.rasEntries;
+        commitRasCnt --;
+    }
+    
+    if ( dInstr -> regR != 0 ) {
+        
+        commitRasTop                = ( commitRasTop + 1 ) % bpDesc.rasEntries;
+        commitRas[ commitRasTop ]   = adr + 4;
+        if ( commitRasCnt < bpDesc.rasEntries ) commitRasCnt ++;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "squashFetch" undoes the speculative update of the current cycle. It is called when a later stage stalls
+// the FD stage or flushes the instruction the FD stage just passed on.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::squashFetch( ) {
+    
+    if ( ! undoValid ) return;
+    
+    specHist    = undoHist;
+    specRasTop  = undoRasTop;
+    specRasCnt  = undoRasCnt;
+    pendHead    = undoPendHead;
+    pendCnt     = undoPendCnt;
+    
+    if ( bpDesc.rasEntries > 0 ) specRas[ ( undoRasTop + 1 ) % bpDesc.rasEntries ] = undoRasEntry;
+    
+    undoValid = false;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "recover" is called when the EX stage or a trap flushes the pipeline. There are no branches in flight
+// anymore and the speculative state is set to the completed state.
+//
+//------------------------------------------------------------------------------------------------------------
+void BranchPredictor::recover( ) {
+    
+    memcpy( specRas, commitRas, sizeof( specRas ));
+    
+    specHist    = commitHist;
+    specRasTop  = commitRasTop;
+    specRasCnt  = commitRasCnt;
+    pendCnt     = 0;
+    undoValid   = false;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Getters.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t BranchPredictor::getCondPredictCnt( ) {
+    
+    return( condPredictCnt );
+}
+
+uint32_t BranchPredictor::getTargetPredictCnt( ) {
+    
+    return( targetPredictCnt );
+}
+
+uint32_t BranchPredictor::getBtbHitCnt( ) {
+    
+    return( btbHitCnt );
+}
+
+uint32_t BranchPredictor::getRasHitCnt( ) {
+    
+    return( rasHitCnt );
+}
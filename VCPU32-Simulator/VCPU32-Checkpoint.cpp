@@ -0,0 +1,1249 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Checkpoints
+//
+//------------------------------------------------------------------------------------------------------------
+// A checkpoint is the complete CPU core state written to a binary file. Once a program ran to an interesting
+// point, for example after the operating system has booted, the state is saved. Any number of experiments
+// can then start from there by restoring the checkpoint, instead of executing millions of cycles again. The
+// checkpoint is written component by component in a fixed order. The large memory data arrays are written
+// sparsely in pages, all zero pages are skipped. A restore maps the file into memory and copies the data
+// from there.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Checkpoints
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+#if __APPLE__ || __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. Most of the routines are inline functions.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const char      CKPT_MAGIC[ 8 ]     = { 'V', 'C', 'P', 'U', '3', '2', 'C', 'K' };
+const uint32_t  CKPT_END_MARK       = 0x454E4421;
+const int       CKPT_MEM_OBJ        = 6;
+const uint32_t  CKPT_NO_ENTRY       = 0xFFFFFFFF;
+const uint32_t  CKPT_DESC_WORDS     = 256;
+
+bool isZeroPage( uint8_t *data, uint32_t len ) {
+    
+    return(( data[ 0 ] == 0 ) && ( memcmp( data, data + 1, len - 1 ) == 0 ));
+}
+
+uint32_t pageLen( uint32_t page, uint32_t len ) {
+    
+    uint32_t ofs = page * CKPT_PAGE_SIZE;
+    
+    return(( len - ofs < CKPT_PAGE_SIZE ) ? len - ofs : CKPT_PAGE_SIZE );
+}
+
+void clearPages( uint8_t *data, uint32_t from, uint32_t to, uint32_t len ) {
+    
+    for ( uint32_t i = from; i < to; i++ ) {
+        
+        uint8_t *page = data + i * CKPT_PAGE_SIZE;
+        
+        if ( ! isZeroPage( page, pageLen( i, len ))) memset( page, 0, pageLen( i, len ));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "mapFile" maps the checkpoint file for reading and returns its size, "unmapFile" releases it again. An
+// empty file is not mapped. A host without the POSIX file mapping, such as Windows, reads the file into an
+// allocated buffer instead.
+//
+//------------------------------------------------------------------------------------------------------------
+#if __APPLE__ || __unix__
+
+uint8_t *mapFile( char *fileName, size_t *size ) {
+    
+    struct stat fileStat;
+    
+    int fd = open( fileName, O_RDONLY );
+    if ( fd < 0 ) return( nullptr );
+    
+    if (( fstat( fd, &fileStat ) != 0 ) || ( fileStat.st_size == 0 )) {
+        
+        close( fd );
+        return( nullptr );
+    }
+    
+    void *ptr = mmap( nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    
+    close( fd );
+    if ( ptr == MAP_FAILED ) return( nullptr );
+    
+    *size = fileStat.st_size;
+    return((uint8_t *) ptr );
+}
+
+void unmapFile( uint8_t *buf, size_t size ) {
+    
+    munmap( buf, size );
+}
+
+#else
+
+uint8_t *mapFile( char *fileName, size_t *size ) {
+    
+    FILE *inFile = fopen( fileName, "rb" );
+    if ( inFile == nullptr ) return( nullptr );
+    
+    uint8_t *buf = nullptr;
+    long    len  = 0;
+    
+    if (( fseek( inFile, 0, SEEK_END ) == 0 ) && (( len = ftell( inFile )) > 0 ) && ( fseek( inFile, 0, SEEK_SET ) == 0 )) {
+        
+        buf = (uint8_t *) malloc( len );
+        
+        if (( buf != nullptr ) && ( fread( buf, 1, len, inFile ) != (size_t) len )) {
+            
+            free( buf );
+            buf = nullptr;
+        }
+    }
+    
+    fclose( inFile );
+    if ( buf != nullptr ) *size = len;
+    return( buf );
+}
+
+void unmapFile( uint8_t *buf, size_t ) {
+    
+    free( buf );
+}
+
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU core descriptor is stored field by field as a list of words. The descriptor structures contain
+// padding bytes with undefined content, so their memory image cannot just be written and compared. The
+// routines below list the descriptor fields in a fixed order and return the number of words.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t memDescWords( CpuMemDesc *desc, uint32_t *words ) {
+    
+    words[ 0 ]  = desc -> type;
+    words[ 1 ]  = desc -> accessType;
+    words[ 2 ]  = desc -> blockEntries;
+    words[ 3 ]  = desc -> blockSize;
+    words[ 4 ]  = desc -> blockSets;
+    words[ 5 ]  = desc -> startAdr;
+    words[ 6 ]  = desc -> endAdr;
+    words[ 7 ]  = desc -> latency;
+    words[ 8 ]  = desc -> priority;
+    words[ 9 ]  = desc -> replPolicy;
+    words[ 10 ] = desc -> replSeed;
+    words[ 11 ] = desc -> mshrEntries;
+    words[ 12 ] = desc -> prefetchPolicy;
+    words[ 13 ] = desc -> prefetchDegree;
+    words[ 14 ] = desc -> prefetchEntries;
+    return( 15 );
+}
+
+uint32_t tlbDescWords( TlbDesc *desc, uint32_t *words ) {
+    
+    words[ 0 ]  = desc -> type;
+    words[ 1 ]  = desc -> accessType;
+    words[ 2 ]  = desc -> entries;
+    words[ 3 ]  = desc -> latency;
+    words[ 4 ]  = desc -> ways;
+    words[ 5 ]  = desc -> replPolicy;
+    words[ 6 ]  = desc -> replSeed;
+    return( 7 );
+}
+
+uint32_t coreDescWords( CpuCoreDesc *desc, uint32_t *words ) {
+    
+    uint32_t n = 0;
+    
+    words[ n ++ ] = desc -> flags;
+    words[ n ++ ] = desc -> tlbOptions;
+    words[ n ++ ] = desc -> cacheL1Options;
+    words[ n ++ ] = desc -> cacheL2Options;
+    
+    n += memDescWords( &desc -> iCacheDescL1, words + n );
+    n += memDescWords( &desc -> dCacheDescL1, words + n );
+    n += memDescWords( &desc -> uCacheDescL2, words + n );
+    n += memDescWords( &desc -> memDesc, words + n );
+    n += memDescWords( &desc -> pdcDesc, words + n );
+    n += memDescWords( &desc -> ioDesc, words + n );
+    
+    n += tlbDescWords( &desc -> iTlbDesc, words + n );
+    n += tlbDescWords( &desc -> dTlbDesc, words + n );
+    n += tlbDescWords( &desc -> uTlbDescL2, words + n );
+    
+    words[ n ++ ] = desc -> bpDesc.policy;
+    words[ n ++ ] = desc -> bpDesc.phtEntries;
+    words[ n ++ ] = desc -> bpDesc.historyBits;
+    words[ n ++ ] = desc -> bpDesc.btbEntries;
+    words[ n ++ ] = desc -> bpDesc.rasEntries;
+    
+    words[ n ++ ] = desc -> snoopLatency;
+    words[ n ++ ] = desc -> interventionLatency;
+    words[ n ++ ] = desc -> storeBufferEntries;
+    words[ n ++ ] = desc -> fwdMode;
+    words[ n ++ ] = desc -> issueWidth;
+    words[ n ++ ] = desc -> coreModel;
+    
+    words[ n ++ ] = desc -> oooDesc.robEntries;
+    words[ n ++ ] = desc -> oooDesc.physRegs;
+    words[ n ++ ] = desc -> oooDesc.aluIqEntries;
+    words[ n ++ ] = desc -> oooDesc.memIqEntries;
+    words[ n ++ ] = desc -> oooDesc.lsqEntries;
+    words[ n ++ ] = desc -> oooDesc.width;
+    words[ n ++ ] = desc -> oooDesc.memPorts;
+    words[ n ++ ] = desc -> oooDesc.redirectPenalty;
+    return( n );
+}
+
+}; // namespace
+
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU core routines for the simulator. They just create a checkpoint object for the operation.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuCore::saveCheckpoint( char *fileName ) {
+    
+    CpuCheckpoint ckpt( this );
+    
+    return( ckpt.save( fileName ));
+}
+
+bool CpuCore::restoreCheckpoint( char *fileName ) {
+    
+    CpuCheckpoint ckpt( this );
+    
+    return( ckpt.restore( fileName ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The checkpoint object constructor.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuCheckpoint::CpuCheckpoint( CpuCore *core ) {
+    
+    this -> core = core;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "getMemObjects" lists the memory objects of the CPU core in the order they are written to the file. An
+// object not configured is a null pointer.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::getMemObjects( CpuMem **mem ) {
+    
+    mem[ 0 ] = core -> iCacheL1;
+    mem[ 1 ] = core -> dCacheL1;
+    mem[ 2 ] = core -> uCacheL2;
+    mem[ 3 ] = core -> physMem;
+    mem[ 4 ] = core -> pdcMem;
+    mem[ 5 ] = core -> ioMem;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "save" writes the checkpoint file. The CPU core is not modified, the simulation can just continue after
+// the checkpoint was taken. Any write error is remembered and reported as the result of the operation.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuCheckpoint::save( char *fileName ) {
+    
+    CpuMem  *mem[ CKPT_MEM_OBJ ];
+    CpuTlb  *tlb[ 3 ] = { core -> iTlb, core -> dTlb, core -> uTlbL2 };
+    CpuReg  *maRegs[ ] = { &core -> maStage -> psPstate0, &core -> maStage -> psPstate1,
+                           &core -> maStage -> psInstr, &core -> maStage -> psDecIndex,
+                           &core -> maStage -> psValA, &core -> maStage -> psValB, &core -> maStage -> psValX,
+                           &core -> maStage -> psInstr2, &core -> maStage -> psDecIndex2 };
+    CpuReg  *exRegs[ ] = { &core -> exStage -> psPstate0, &core -> exStage -> psPstate1,
+                           &core -> exStage -> psInstr, &core -> exStage -> psDecIndex,
+                           &core -> exStage -> psValA, &core -> exStage -> psValB, &core -> exStage -> psValX,
+                           &core -> exStage -> psInstr2, &core -> exStage -> psDecIndex2 };
+    
+    getMemObjects( mem );
+    
+    outFile = fopen( fileName, "wb" );
+    if ( outFile == nullptr ) return( false );
+    
+    ok = true;
+    
+    putData( CKPT_MAGIC, sizeof( CKPT_MAGIC ));
+    putWord( CKPT_VERSION );
+    putCoreDesc( );
+    putWord( core -> execMode );
+    
+    putRegFile( &core -> gReg );
+    putRegFile( &core -> sReg );
+    putRegFile( &core -> cReg );
+    
+    FetchDecodeStage *fd = core -> fdStage;
+    
+    putReg( &fd -> psPstate0 );
+    putReg( &fd -> psPstate1 );
+    putWord( fd -> instr );
+    putWord( fd -> isStalled( ));
+    putWord( fd -> instrFetched );
+    putWord( fd -> instrLoad );
+    putWord( fd -> instrLoadViaOpMode );
+    putWord( fd -> instrStor );
+    putWord( fd -> branchesTaken );
+    putWord( fd -> trapsRaised );
+    
+    for ( int i = 0; i < 9; i++ ) putReg( maRegs[ i ] );
+    putWord( core -> maStage -> isStalled( ));
+    putWord( core -> maStage -> instrPrivLevel );
+    putWord( core -> maStage -> trapsRaised );
+    
+    for ( int i = 0; i < 9; i++ ) putReg( exRegs[ i ] );
+    putWord( core -> exStage -> isStalled( ));
+    putWord( core -> exStage -> instrExecuted );
+    putWord( core -> exStage -> branchesTaken );
+    putWord( core -> exStage -> branchesNotTaken );
+    putWord( core -> exStage -> trapsRaised );
+    
+    putWord( core -> fnEngine -> instrExecuted );
+    putWord( core -> fnEngine -> branchesTaken );
+    putWord( core -> fnEngine -> trapsRaised );
+    
+    putData( &core -> stats, sizeof( CpuStatistics ));
+    putData( &core -> sampleStats, sizeof( CpuSampleStats ));
+    putStoreBuffer( core -> storeBuffer );
+    putBranchPred( core -> branchPred );
+    
+    for ( int i = 0; i < 3; i++ ) {
+        
+        if ( tlb[ i ] != nullptr ) putTlb( tlb[ i ] );
+    }
+    
+    for ( int i = 0; i < CKPT_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] != nullptr ) putMem( mem[ i ] );
+    }
+    
+    if ( core -> uCacheL2 != nullptr ) putL2Cache( core -> uCacheL2 );
+    
+    putWord( CKPT_END_MARK );
+    
+    if ( fclose( outFile ) != 0 ) ok = false;
+    outFile = nullptr;
+    
+    return( ok );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "restore" loads a checkpoint file. The file is mapped into memory. Before anything is changed, the header,
+// the version and the CPU core configuration are checked. A checkpoint file not accepted leaves the CPU core
+// untouched. When the file turns out to be damaged later on, the CPU core is reset and the memory content is
+// undefined. After the restore, the decode cache, the translated code blocks and the out-of-order instruction
+// window start out empty, a stop condition is cleared and a sampled run starts over.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuCheckpoint::restore( char *fileName ) {
+    
+    CpuMem      *mem[ CKPT_MEM_OBJ ];
+    CpuTlb      *tlb[ 3 ] = { core -> iTlb, core -> dTlb, core -> uTlbL2 };
+    CpuReg      *maRegs[ ] = { &core -> maStage -> psPstate0, &core -> maStage -> psPstate1,
+                               &core -> maStage -> psInstr, &core -> maStage -> psDecIndex,
+                               &core -> maStage -> psValA, &core -> maStage -> psValB, &core -> maStage -> psValX,
+                               &core -> maStage -> psInstr2, &core -> maStage -> psDecIndex2 };
+    CpuReg      *exRegs[ ] = { &core -> exStage -> psPstate0, &core -> exStage -> psPstate1,
+                               &core -> exStage -> psInstr, &core -> exStage -> psDecIndex,
+                               &core -> exStage -> psValA, &core -> exStage -> psValB, &core -> exStage -> psValX,
+                               &core -> exStage -> psInstr2, &core -> exStage -> psDecIndex2 };
+    char        magic[ sizeof( CKPT_MAGIC ) ];
+    
+    getMemObjects( mem );
+    
+    inSize  = 0;
+    inBuf   = mapFile( fileName, &inSize );
+    inPos   = 0;
+    ok      = true;
+    
+    if ( inBuf == nullptr ) return( false );
+    
+    getData( magic, sizeof( magic ));
+    
+    if (( memcmp( magic, CKPT_MAGIC, sizeof( CKPT_MAGIC )) != 0 ) ||
+        ( getWord( ) != CKPT_VERSION ) ||
+        ( ! matchCoreDesc( ))) {
+        
+        unmapFile( inBuf, inSize );
+        inBuf = nullptr;
+        return( false );
+    }
+    
+    core -> execMode = (ExecMode) getWord( );
+    
+    getRegFile( &core -> gReg );
+    getRegFile( &core -> sReg );
+    getRegFile( &core -> cReg );
+    
+    FetchDecodeStage *fdStage = core -> fdStage;
+    
+    getReg( &fdStage -> psPstate0 );
+    getReg( &fdStage -> psPstate1 );
+    fdStage -> instr                = getWord( );
+    fdStage -> setStalled( getWord( ) != 0 );
+    fdStage -> instrFetched         = getWord( );
+    fdStage -> instrLoad            = getWord( );
+    fdStage -> instrLoadViaOpMode   = getWord( );
+    fdStage -> instrStor            = getWord( );
+    fdStage -> branchesTaken        = getWord( );
+    fdStage -> trapsRaised          = getWord( );
+    
+    for ( int i = 0; i < 9; i++ ) getReg( maRegs[ i ] );
+    core -> maStage -> setStalled( getWord( ) != 0 );
+    core -> maStage -> instrPrivLevel   = getWord( );
+    core -> maStage -> trapsRaised      = getWord( );
+    
+    for ( int i = 0; i < 9; i++ ) getReg( exRegs[ i ] );
+    core -> exStage -> setStalled( getWord( ) != 0 );
+    core -> exStage -> instrExecuted    = getWord( );
+    core -> exStage -> branchesTaken    = getWord( );
+    core -> exStage -> branchesNotTaken = getWord( );
+    core -> exStage -> trapsRaised      = getWord( );
+    
+    core -> fnEngine -> instrExecuted   = getWord( );
+    core -> fnEngine -> branchesTaken   = getWord( );
+    core -> fnEngine -> trapsRaised     = getWord( );
+    
+    getData( &core -> stats, sizeof( CpuStatistics ));
+    getData( &core -> sampleStats, sizeof( CpuSampleStats ));
+    getStoreBuffer( core -> storeBuffer );
+    getBranchPred( core -> branchPred );
+    
+    for ( int i = 0; i < 3; i++ ) {
+        
+        if ( tlb[ i ] != nullptr ) getTlb( tlb[ i ] );
+    }
+    
+    for ( int i = 0; i < CKPT_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] != nullptr ) getMem( mem[ i ] );
+    }
+    
+    if ( core -> uCacheL2 != nullptr ) getL2Cache( core -> uCacheL2 );
+    
+    if ( getWord( ) != CKPT_END_MARK ) ok = false;
+    
+    unmapFile( inBuf, inSize );
+    inBuf = nullptr;
+    
+    if ( ! ok ) {
+        
+        core -> reset( );
+        return( false );
+    }
+    
+    core -> decodeCache -> reset( );
+    core -> tcEngine -> setJitEnabled( core -> execMode == EXEC_MODE_JIT );
+    core -> tcEngine -> flush( );
+    core -> oooEngine -> reset( );
+    core -> stopped         = false;
+    core -> samplePhaseLeft = 0;
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The basic write routines. "putAlign" fills the file up to the next page boundary.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putData( const void *buf, size_t len ) {
+    
+    if (( ok ) && ( fwrite( buf, 1, len, outFile ) != len )) ok = false;
+}
+
+void CpuCheckpoint::putWord( uint32_t val ) {
+    
+    putData( &val, sizeof( uint32_t ));
+}
+
+void CpuCheckpoint::putAlign( ) {
+    
+    uint8_t zeroes[ CKPT_PAGE_SIZE ] = { 0 };
+    long    pos = ftell( outFile );
+    
+    if ( pos < 0 ) ok = false;
+    else if ( pos % CKPT_PAGE_SIZE != 0 ) putData( zeroes, CKPT_PAGE_SIZE - ( pos % CKPT_PAGE_SIZE ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "putCoreDesc" writes the CPU core descriptor as the number of descriptor words followed by the words.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putCoreDesc( ) {
+    
+    uint32_t words[ CKPT_DESC_WORDS ];
+    uint32_t len = coreDescWords( &core -> cpuDesc, words );
+    
+    putWord( len );
+    for ( uint32_t i = 0; i < len; i++ ) putWord( words[ i ] );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "putSparse" writes a data array of "len" bytes. First comes the number of stored pages and the list of the
+// page numbers. Next, starting on a page boundary, the pages themselves. The last page of the array may be
+// shorter, it is filled up to the page boundary in the file.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putSparse( uint8_t *data, uint32_t len ) {
+    
+    uint32_t pages  = ( len + CKPT_PAGE_SIZE - 1 ) / CKPT_PAGE_SIZE;
+    uint32_t stored = 0;
+    
+    for ( uint32_t i = 0; i < pages; i++ ) {
+        
+        if ( ! isZeroPage( data + i * CKPT_PAGE_SIZE, pageLen( i, len ))) stored ++;
+    }
+    
+    putWord( len );
+    putWord( stored );
+    
+    for ( uint32_t i = 0; i < pages; i++ ) {
+        
+        if ( ! isZeroPage( data + i * CKPT_PAGE_SIZE, pageLen( i, len ))) putWord( i );
+    }
+    
+    putAlign( );
+    
+    for ( uint32_t i = 0; i < pages; i++ ) {
+        
+        if ( ! isZeroPage( data + i * CKPT_PAGE_SIZE, pageLen( i, len ))) {
+            
+            putData( data + i * CKPT_PAGE_SIZE, pageLen( i, len ));
+            putAlign( );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A pending block request of a memory object refers to the block of the requesting upper layer. Such a
+// pointer is written as the memory object, the set and the offset into the data array. Otherwise, the value
+// is just written as is. The word requests of physical memory and PDC use the field to hold the data word.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putPtr( uint8_t *ptr ) {
+    
+    CpuMem *mem[ CKPT_MEM_OBJ ];
+    
+    getMemObjects( mem );
+    
+    for ( int i = 0; i < CKPT_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] == nullptr ) continue;
+        
+        uint32_t arrayLen = mem[ i ] -> cDesc.blockEntries * mem[ i ] -> cDesc.blockSize;
+        
+        for ( uint32_t j = 0; j < MAX_BLOCK_SETS; j++ ) {
+            
+            uint8_t *dataPtr = mem[ i ] -> dataArray[ j ];
+            
+            if (( dataPtr != nullptr ) && ( ptr >= dataPtr ) && ( ptr < dataPtr + arrayLen )) {
+                
+                putWord( 1 + i * MAX_BLOCK_SETS + j );
+                putWord((uint32_t) ( ptr - dataPtr ));
+                putWord( 0 );
+                return;
+            }
+        }
+    }
+    
+    uint64_t val = (uint64_t) (uintptr_t) ptr;
+    
+    putWord( 0 );
+    putWord((uint32_t) val );
+    putWord((uint32_t) ( val >> 32 ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A register is written with its outbound and inbound value. A register file also writes its size first.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putReg( CpuReg *reg ) {
+    
+    putWord( reg -> get( ));
+    putWord( reg -> getLatched( ));
+}
+
+void CpuCheckpoint::putRegFile( CpuRegFile *regFile ) {
+    
+    putWord( regFile -> getSize( ));
+    
+    for ( uint8_t i = 0; i < regFile -> getSize( ); i++ ) {
+        
+        putWord( regFile -> get( i ));
+        putWord( regFile -> getLatched( i ));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A TLB is written with its pending request, the entry array with the replacement state and the statistics.
+// The request entry is written as the index into the entry array. The packed tags are rebuilt from the
+// entries when the checkpoint is restored.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putTlb( CpuTlb *tlb ) {
+    
+    putWord( tlb -> tlbOpState );
+    putWord( tlb -> reqOp );
+    putWord( tlb -> reqData );
+    putWord( tlb -> reqDelayCnt );
+    putWord( tlb -> reqSeg );
+    putWord( tlb -> reqOfs );
+    putWord( tlb -> portBusyCnt );
+    putWord(( tlb -> reqTlbEntry != nullptr ) ? (uint32_t) ( tlb -> reqTlbEntry - tlb -> tlbArray ) : CKPT_NO_ENTRY );
+    
+    for ( uint32_t i = 0; i < tlb -> tlbDesc.entries; i++ ) {
+        
+        TlbEntry *entry = &tlb -> tlbArray[ i ];
+        
+        putWord( entry -> vpnHigh );
+        putWord( entry -> vpnLow );
+        putWord( entry -> pInfo );
+        putWord( entry -> aInfo );
+        putWord( tlb -> lruArray[ i ] );
+        putWord( tlb -> plruArray[ i ] );
+        putWord((uint32_t) ( tlb -> evictArray[ i ] >> 32 ));
+        putWord((uint32_t) tlb -> evictArray[ i ] );
+    }
+    
+    putWord( tlb -> lruClock );
+    putWord( tlb -> replRandState );
+    putWord( tlb -> evictPos );
+    
+    putWord( tlb -> tlbInserts );
+    putWord( tlb -> tlbDeletes );
+    putWord( tlb -> tlbAccess );
+    putWord( tlb -> tlbMiss );
+    putWord( tlb -> tlbConflictMiss );
+    putWord( tlb -> tlbCapacityMiss );
+    putWord( tlb -> tlbRefills );
+    putWord( tlb -> tlbWaitCycles );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The store buffer is written with its entries, oldest first, and the statistics. The restored buffer starts
+// with the oldest entry at the first position.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putStoreBuffer( StoreBuffer *sBuf ) {
+    
+    putWord( sBuf -> count );
+    putWord( sBuf -> trapDrain );
+    
+    for ( uint32_t i = 0; i < sBuf -> count; i++ ) {
+        
+        StoreBufferEntry *ePtr = sBuf -> getEntry( i );
+        
+        putWord( ePtr -> seg );
+        putWord( ePtr -> ofs );
+        putWord( ePtr -> adr );
+        putWord( ePtr -> len );
+        putData( ePtr -> data, sizeof( ePtr -> data ));
+    }
+    
+    putData( &sBuf -> occupancySum, sizeof( uint64_t ));
+    putWord( sBuf -> maxOccupancy );
+    putWord( sBuf -> storeCnt );
+    putWord( sBuf -> drainCnt );
+    putWord( sBuf -> forwardCnt );
+    putWord( sBuf -> fullStallCnt );
+    putWord( sBuf -> conflictStallCnt );
+    putWord( sBuf -> fenceStallCnt );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor is written with the speculative and completed history and return address stack, the
+// queue of branches in flight, the direction tables, the branch target buffer and the statistics. The table
+// sizes follow from the descriptor which is part of the CPU core descriptor.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putBranchPred( BranchPredictor *bPred ) {
+    
+    putWord( bPred -> specHist );
+    putWord( bPred -> commitHist );
+    putWord( bPred -> specRasTop );
+    putWord( bPred -> specRasCnt );
+    putWord( bPred -> commitRasTop );
+    putWord( bPred -> commitRasCnt );
+    putData( bPred -> specRas, sizeof( bPred -> specRas ));
+    putData( bPred -> commitRas, sizeof( bPred -> commitRas ));
+    putWord( bPred -> pendHead );
+    putWord( bPred -> pendCnt );
+    putData( bPred -> pendAdr, sizeof( bPred -> pendAdr ));
+    putData( bPred -> pendSrc, sizeof( bPred -> pendSrc ));
+    putData( bPred -> pht, bPred -> bpDesc.phtEntries );
+    
+    for ( uint32_t i = 0; i < MAX_TAGE_TABLES; i++ ) {
+        
+        if ( bPred -> tage[ i ] != nullptr ) {
+            
+            putData( bPred -> tage[ i ], ( 1U << bPred -> tageBits ) * sizeof( TageEntry ));
+        }
+    }
+    
+    for ( uint32_t i = 0; i < bPred -> bpDesc.btbEntries; i++ ) {
+        
+        putWord( bPred -> btb[ i ].valid ? 1 : 0 );
+        putWord( bPred -> btb[ i ].adr );
+        putWord( bPred -> btb[ i ].target );
+    }
+    
+    putWord( bPred -> condPredictCnt );
+    putWord( bPred -> condMispredictCnt );
+    putWord( bPred -> targetPredictCnt );
+    putWord( bPred -> targetMispredictCnt );
+    putWord( bPred -> btbHitCnt );
+    putWord( bPred -> rasHitCnt );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A memory object is written with its pending request, the statistics and then for each set the tag array,
+// if there is one, and the data array. A cache also stores its replacement policy state, the miss status
+// holding registers and the prefetcher table and queue.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putMem( CpuMem *mem ) {
+    
+    putReg( &mem -> opState );
+    putWord( mem -> reqPri );
+    putWord( mem -> reqSeg );
+    putWord( mem -> reqOfs );
+    putWord( mem -> reqTag );
+    putPtr( mem -> reqPtr );
+    putWord( mem -> reqLen );
+    putWord( mem -> reqLatency );
+    putWord( mem -> reqExclusive ? 1 : 0 );
+    putWord( mem -> reqResumeState );
+    putWord( mem -> reqTargetSet );
+    putWord( mem -> reqTargetBlockIndex );
+    
+    putWord( mem -> accessCnt );
+    putWord( mem -> missCnt );
+    putWord( mem -> dirtyMissCnt );
+    putWord( mem -> waitCyclesCnt );
+    putWord( mem -> coherenceMissCnt );
+    putWord( mem -> invalidateCnt );
+    putWord( mem -> interventionCnt );
+    putWord( mem -> upgradeCnt );
+    putWord( mem -> replRandState );
+    putWord( mem -> mshrAllocCnt );
+    putWord( mem -> mshrMergeCnt );
+    putWord( mem -> mshrStallCnt );
+    putWord( mem -> mshrPendingCnt );
+    putWord( mem -> reqMshr );
+    
+    for ( uint32_t i = 0; i < mem -> cDesc.mshrEntries; i++ ) {
+        
+        MemMshrEntry *mPtr = &mem -> mshrArray[ i ];
+        
+        putWord(( mPtr -> valid     ? 1 : 0 ) |
+                ( mPtr -> exclusive ? 2 : 0 ));
+        putWord( mPtr -> tag );
+        putWord( mPtr -> blockIndex );
+        putData( mPtr -> storeMask, MAX_BLOCK_SIZE );
+        putData( mPtr -> storeData, MAX_BLOCK_SIZE );
+    }
+    
+    putWord(( mem -> reqPrefetch        ? 1 : 0 ) |
+            ( mem -> reqPrefetchLate    ? 2 : 0 ) |
+            ( mem -> reqFillPending     ? 4 : 0 ));
+    putWord( mem -> pfIssuedCnt );
+    putWord( mem -> pfUsefulCnt );
+    putWord( mem -> pfLateCnt );
+    putWord( mem -> pfPollutionCnt );
+    putWord( mem -> pfQueueHead );
+    putWord( mem -> pfQueueCnt );
+    putWord( mem -> pfNextStream );
+    putWord( mem -> accessPc );
+    putWord( mem -> lastAccessOfs );
+    putWord( mem -> lastAccessTag );
+    putWord( mem -> lastAccessPc );
+    putWord( mem -> lastAccessMode );
+    putWord(( mem -> accessThisCycle ? 1 : 0 ) |
+            ( mem -> accessLastCycle ? 2 : 0 ));
+    
+    for ( uint32_t i = 0; i < MAX_PREFETCH_ENTRIES; i++ ) {
+        
+        MemPfEntry *ePtr = &mem -> pfTable[ i ];
+        
+        putWord( ePtr -> valid ? 1 : 0 );
+        putWord( ePtr -> key );
+        putWord( ePtr -> lastTag );
+        putWord( ePtr -> stride );
+        putWord( ePtr -> confidence );
+        putWord( mem -> pfQueue[ i ].ofs );
+        putWord( mem -> pfQueue[ i ].tag );
+    }
+    
+    for ( uint32_t i = 0; i < mem -> cDesc.blockSets; i++ ) {
+        
+        if ( mem -> tagArray[ i ] != nullptr ) {
+            
+            for ( uint32_t j = 0; j < mem -> cDesc.blockEntries; j++ ) {
+                
+                MemTagEntry *tagPtr = &mem -> tagArray[ i ] [ j ];
+                
+                putWord(( tagPtr -> valid       ? 1 : 0 ) |
+                        ( tagPtr -> dirty       ? 2 : 0 ) |
+                        ( tagPtr -> shared      ? 4 : 0 ) |
+                        ( tagPtr -> invalidated ? 8 : 0 ) |
+                        ( tagPtr -> prefetched  ? 16 : 0 ));
+                putWord( tagPtr -> tag );
+            }
+        }
+        
+        if ( mem -> dataArray[ i ] != nullptr ) {
+            
+            putSparse( mem -> dataArray[ i ], mem -> cDesc.blockEntries * mem -> cDesc.blockSize );
+        }
+    }
+    
+    if ( mem -> replArray != nullptr ) {
+        
+        for ( uint32_t j = 0; j < mem -> cDesc.blockEntries; j++ ) putWord( mem -> replArray[ j ] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The L2 cache adds its request state, the fill buffer with a block not yet entered and the write back
+// buffer.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::putL2Cache( L2CacheMem *mem ) {
+    
+    putWord( mem -> reqDone ? 1 : 0 );
+    putWord( mem -> reqWriteBackTag );
+    putData( mem -> fillBuf, MAX_BLOCK_SIZE );
+    putData( mem -> writeBackBuf, MAX_BLOCK_SIZE );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The basic read routines. They work on the mapped file. Reading beyond the end of the file marks the
+// restore as failed and returns zeroes.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::getData( void *buf, size_t len ) {
+    
+    if (( ok ) && ( inPos + len <= inSize )) {
+        
+        memcpy( buf, inBuf + inPos, len );
+        inPos += len;
+    }
+    else {
+        
+        memset( buf, 0, len );
+        ok = false;
+    }
+}
+
+uint32_t CpuCheckpoint::getWord( ) {
+    
+    uint32_t val = 0;
+    
+    getData( &val, sizeof( uint32_t ));
+    return( val );
+}
+
+void CpuCheckpoint::getAlign( ) {
+    
+    if ( inPos % CKPT_PAGE_SIZE != 0 ) inPos += CKPT_PAGE_SIZE - ( inPos % CKPT_PAGE_SIZE );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "matchCoreDesc" reads back the CPU core descriptor and compares it field by field with the descriptor of
+// the CPU core. A checkpoint can only be restored into a CPU core with the same configuration.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuCheckpoint::matchCoreDesc( ) {
+    
+    uint32_t words[ CKPT_DESC_WORDS ];
+    uint32_t len    = coreDescWords( &core -> cpuDesc, words );
+    bool     match  = ( getWord( ) == len );
+    
+    for ( uint32_t i = 0; ( match ) && ( i < len ); i++ ) match = ( getWord( ) == words[ i ] );
+    return(( match ) && ( ok ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "getSparse" reads back a data array written by "putSparse". The stored pages are copied from the mapped
+// file, the pages in between are cleared. Only pages that are not zero already are written to, so that the
+// untouched pages of a sparse physical memory stay uncommitted.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::getSparse( uint8_t *data, uint32_t len ) {
+    
+    uint32_t pages      = ( len + CKPT_PAGE_SIZE - 1 ) / CKPT_PAGE_SIZE;
+    uint32_t nextPage   = 0;
+    
+    if ( getWord( ) != len ) ok = false;
+    
+    uint32_t stored     = getWord( );
+    size_t   listPos    = inPos;
+    
+    if (( ! ok ) || ( stored > pages )) {
+        
+        ok = false;
+        return;
+    }
+    
+    inPos += stored * sizeof( uint32_t );
+    getAlign( );
+    
+    for ( uint32_t i = 0; i < stored; i++ ) {
+        
+        uint32_t page = 0;
+        
+        if ( listPos + sizeof( uint32_t ) > inSize ) {
+            
+            ok = false;
+            return;
+        }
+        
+        memcpy( &page, inBuf + listPos, sizeof( uint32_t ));
+        listPos += sizeof( uint32_t );
+        
+        if (( page >= pages ) || ( page < nextPage )) {
+            
+            ok = false;
+            return;
+        }
+        
+        clearPages( data, nextPage, page, len );
+        getData( data + page * CKPT_PAGE_SIZE, pageLen( page, len ));
+        getAlign( );
+        
+        nextPage = page + 1;
+    }
+    
+    clearPages( data, nextPage, pages, len );
+}
+
+uint8_t *CpuCheckpoint::getPtr( ) {
+    
+    CpuMem      *mem[ CKPT_MEM_OBJ ];
+    uint32_t    ref     = getWord( );
+    uint32_t    valLow  = getWord( );
+    uint32_t    valHigh = getWord( );
+    
+    getMemObjects( mem );
+    
+    if ( ref == 0 ) return((uint8_t *) (uintptr_t) ((uint64_t) valHigh << 32 | valLow ));
+    
+    uint32_t memIndex = ( ref - 1 ) / MAX_BLOCK_SETS;
+    uint32_t setIndex = ( ref - 1 ) % MAX_BLOCK_SETS;
+    
+    if (( memIndex >= CKPT_MEM_OBJ ) ||
+        ( mem[ memIndex ] == nullptr ) ||
+        ( mem[ memIndex ] -> dataArray[ setIndex ] == nullptr ) ||
+        ( valLow >= mem[ memIndex ] -> cDesc.blockEntries * mem[ memIndex ] -> cDesc.blockSize )) {
+        
+        ok = false;
+        return( nullptr );
+    }
+    
+    return( mem[ memIndex ] -> dataArray[ setIndex ] + valLow );
+}
+
+void CpuCheckpoint::getReg( CpuReg *reg ) {
+    
+    uint32_t valOut = getWord( );
+    uint32_t valIn  = getWord( );
+    
+    reg -> load( valOut );
+    if ( valIn != valOut ) reg -> set( valIn );
+}
+
+void CpuCheckpoint::getRegFile( CpuRegFile *regFile ) {
+    
+    if ( getWord( ) != regFile -> getSize( )) {
+        
+        ok = false;
+        return;
+    }
+    
+    for ( uint8_t i = 0; i < regFile -> getSize( ); i++ ) {
+        
+        uint32_t valOut = getWord( );
+        uint32_t valIn  = getWord( );
+        
+        regFile -> load( i, valOut );
+        if ( valIn != valOut ) regFile -> set( i, valIn );
+    }
+}
+
+void CpuCheckpoint::getTlb( CpuTlb *tlb ) {
+    
+    tlb -> tlbOpState   = getWord( );
+    tlb -> reqOp        = getWord( );
+    tlb -> reqData      = getWord( );
+    tlb -> reqDelayCnt  = getWord( );
+    tlb -> reqSeg       = getWord( );
+    tlb -> reqOfs       = getWord( );
+    tlb -> portBusyCnt  = getWord( );
+    
+    uint32_t reqIndex   = getWord( );
+    
+    if      ( reqIndex == CKPT_NO_ENTRY )         tlb -> reqTlbEntry = nullptr;
+    else if ( reqIndex < tlb -> tlbDesc.entries ) tlb -> reqTlbEntry = &tlb -> tlbArray[ reqIndex ];
+    else                                          ok = false;
+    
+    for ( uint32_t i = 0; i < tlb -> tlbDesc.entries; i++ ) {
+        
+        TlbEntry *entry = &tlb -> tlbArray[ i ];
+        
+        entry -> vpnHigh    = getWord( );
+        entry -> vpnLow     = getWord( );
+        entry -> pInfo      = getWord( );
+        entry -> aInfo      = getWord( );
+        
+        tlb -> lruArray[ i ]    = getWord( );
+        tlb -> plruArray[ i ]   = getWord( );
+        
+        uint64_t evictTag       = getWord( );
+        tlb -> evictArray[ i ]  = ( evictTag << 32 ) | getWord( );
+        
+        tlb -> updateTag( entry );
+    }
+    
+    tlb -> lruClock         = getWord( );
+    tlb -> replRandState    = getWord( );
+    tlb -> evictPos         = getWord( );
+    
+    if ( tlb -> evictPos >= tlb -> tlbDesc.entries ) ok = false;
+    
+    tlb -> tlbInserts       = getWord( );
+    tlb -> tlbDeletes       = getWord( );
+    tlb -> tlbAccess        = getWord( );
+    tlb -> tlbMiss          = getWord( );
+    tlb -> tlbConflictMiss  = getWord( );
+    tlb -> tlbCapacityMiss  = getWord( );
+    tlb -> tlbRefills       = getWord( );
+    tlb -> tlbWaitCycles    = getWord( );
+}
+
+void CpuCheckpoint::getStoreBuffer( StoreBuffer *sBuf ) {
+    
+    sBuf -> reset( );
+    
+    uint32_t count  = getWord( );
+    bool     drain  = ( getWord( ) != 0 );
+    
+    if ( count > sBuf -> entries ) {
+        
+        ok = false;
+        return;
+    }
+    
+    for ( uint32_t i = 0; i < count; i++ ) {
+        
+        StoreBufferEntry *ePtr = &sBuf -> entryArray[ i ];
+        
+        ePtr -> seg = getWord( );
+        ePtr -> ofs = getWord( );
+        ePtr -> adr = getWord( );
+        ePtr -> len = getWord( );
+        getData( ePtr -> data, sizeof( ePtr -> data ));
+    }
+    
+    sBuf -> count               = count;
+    sBuf -> trapDrain           = drain;
+    
+    getData( &sBuf -> occupancySum, sizeof( uint64_t ));
+    sBuf -> maxOccupancy        = getWord( );
+    sBuf -> storeCnt            = getWord( );
+    sBuf -> drainCnt            = getWord( );
+    sBuf -> forwardCnt          = getWord( );
+    sBuf -> fullStallCnt        = getWord( );
+    sBuf -> conflictStallCnt    = getWord( );
+    sBuf -> fenceStallCnt       = getWord( );
+}
+
+void CpuCheckpoint::getBranchPred( BranchPredictor *bPred ) {
+    
+    bPred -> specHist           = getWord( );
+    bPred -> commitHist         = getWord( );
+    bPred -> specRasTop         = getWord( );
+    bPred -> specRasCnt         = getWord( );
+    bPred -> commitRasTop       = getWord( );
+    bPred -> commitRasCnt       = getWord( );
+    getData( bPred -> specRas, sizeof( bPred -> specRas ));
+    getData( bPred -> commitRas, sizeof( bPred -> commitRas ));
+    bPred -> pendHead           = getWord( );
+    bPred -> pendCnt            = getWord( );
+    getData( bPred -> pendAdr, sizeof( bPred -> pendAdr ));
+    getData( bPred -> pendSrc, sizeof( bPred -> pendSrc ));
+    getData( bPred -> pht, bPred -> bpDesc.phtEntries );
+    
+    for ( uint32_t i = 0; i < MAX_TAGE_TABLES; i++ ) {
+        
+        if ( bPred -> tage[ i ] != nullptr ) {
+            
+            getData( bPred -> tage[ i ], ( 1U << bPred -> tageBits ) * sizeof( TageEntry ));
+        }
+    }
+    
+    for ( uint32_t i = 0; i < bPred -> bpDesc.btbEntries; i++ ) {
+        
+        bPred -> btb[ i ].valid     = ( getWord( ) != 0 );
+        bPred -> btb[ i ].adr       = getWord( );
+        bPred -> btb[ i ].target    = getWord( );
+    }
+    
+    bPred -> condPredictCnt         = getWord( );
+    bPred -> condMispredictCnt      = getWord( );
+    bPred -> targetPredictCnt       = getWord( );
+    bPred -> targetMispredictCnt    = getWord( );
+    bPred -> btbHitCnt              = getWord( );
+    bPred -> rasHitCnt              = getWord( );
+    bPred -> undoValid              = false;
+    
+    if (( bPred -> specRasTop >= MAX_RAS_ENTRIES ) || ( bPred -> commitRasTop >= MAX_RAS_ENTRIES )) ok = false;
+    if (( bPred -> pendHead >= MAX_PEND_BRANCHES ) || ( bPred -> pendCnt > MAX_PEND_BRANCHES )) ok = false;
+}
+
+void CpuCheckpoint::getMem( CpuMem *mem ) {
+    
+    getReg( &mem -> opState );
+    mem -> reqPri               = getWord( );
+    mem -> reqSeg               = getWord( );
+    mem -> reqOfs               = getWord( );
+    mem -> reqTag               = getWord( );
+    mem -> reqPtr               = getPtr( );
+    mem -> reqLen               = getWord( );
+    mem -> reqLatency           = getWord( );
+    mem -> reqExclusive         = getWord( ) != 0;
+    mem -> reqResumeState       = getWord( );
+    mem -> reqTargetSet         = getWord( );
+    mem -> reqTargetBlockIndex  = getWord( );
+    
+    mem -> accessCnt            = getWord( );
+    mem -> missCnt              = getWord( );
+    mem -> dirtyMissCnt         = getWord( );
+    mem -> waitCyclesCnt        = getWord( );
+    mem -> coherenceMissCnt     = getWord( );
+    mem -> invalidateCnt        = getWord( );
+    mem -> interventionCnt      = getWord( );
+    mem -> upgradeCnt           = getWord( );
+    mem -> replRandState        = getWord( );
+    mem -> mshrAllocCnt         = getWord( );
+    mem -> mshrMergeCnt         = getWord( );
+    mem -> mshrStallCnt         = getWord( );
+    mem -> mshrPendingCnt       = getWord( );
+    mem -> reqMshr              = getWord( );
+    
+    for ( uint32_t i = 0; i < mem -> cDesc.mshrEntries; i++ ) {
+        
+        MemMshrEntry    *mPtr   = &mem -> mshrArray[ i ];
+        uint32_t        flags   = getWord( );
+        
+        mPtr -> valid       = ( flags & 1 ) != 0;
+        mPtr -> exclusive   = ( flags & 2 ) != 0;
+        mPtr -> tag         = getWord( );
+        mPtr -> blockIndex  = getWord( );
+        getData( mPtr -> storeMask, MAX_BLOCK_SIZE );
+        getData( mPtr -> storeData, MAX_BLOCK_SIZE );
+    }
+    
+    uint32_t pfFlags            = getWord( );
+    
+    mem -> reqPrefetch          = ( pfFlags & 1 ) != 0;
+    mem -> reqPrefetchLate      = ( pfFlags & 2 ) != 0;
+    mem -> reqFillPending       = ( pfFlags & 4 ) != 0;
+    mem -> pfIssuedCnt          = getWord( );
+    mem -> pfUsefulCnt          = getWord( );
+    mem -> pfLateCnt            = getWord( );
+    mem -> pfPollutionCnt       = getWord( );
+    mem -> pfQueueHead          = getWord( );
+    mem -> pfQueueCnt           = getWord( );
+    mem -> pfNextStream         = getWord( );
+    mem -> accessPc             = getWord( );
+    mem -> lastAccessOfs        = getWord( );
+    mem -> lastAccessTag        = getWord( );
+    mem -> lastAccessPc         = getWord( );
+    mem -> lastAccessMode       = getWord( );
+    
+    uint32_t accessFlags        = getWord( );
+    
+    mem -> accessThisCycle      = ( accessFlags & 1 ) != 0;
+    mem -> accessLastCycle      = ( accessFlags & 2 ) != 0;
+    
+    for ( uint32_t i = 0; i < MAX_PREFETCH_ENTRIES; i++ ) {
+        
+        MemPfEntry *ePtr = &mem -> pfTable[ i ];
+        
+        ePtr -> valid               = getWord( ) != 0;
+        ePtr -> key                 = getWord( );
+        ePtr -> lastTag             = getWord( );
+        ePtr -> stride              = getWord( );
+        ePtr -> confidence          = getWord( );
+        mem -> pfQueue[ i ].ofs     = getWord( );
+        mem -> pfQueue[ i ].tag     = getWord( );
+    }
+    
+    for ( uint32_t i = 0; i < mem -> cDesc.blockSets; i++ ) {
+        
+        if ( mem -> tagArray[ i ] != nullptr ) {
+            
+            for ( uint32_t j = 0; j < mem -> cDesc.blockEntries; j++ ) {
+                
+                MemTagEntry *tagPtr = &mem -> tagArray[ i ] [ j ];
+                uint32_t    flags   = getWord( );
+                
+                tagPtr -> valid         = ( flags & 1 ) != 0;
+                tagPtr -> dirty         = ( flags & 2 ) != 0;
+                tagPtr -> shared        = ( flags & 4 ) != 0;
+                tagPtr -> invalidated   = ( flags & 8 ) != 0;
+                tagPtr -> prefetched    = ( flags & 16 ) != 0;
+                tagPtr -> tag           = getWord( );
+            }
+        }
+        
+        if ( mem -> dataArray[ i ] != nullptr ) {
+            
+            getSparse( mem -> dataArray[ i ], mem -> cDesc.blockEntries * mem -> cDesc.blockSize );
+        }
+    }
+    
+    if ( mem -> replArray != nullptr ) {
+        
+        for ( uint32_t j = 0; j < mem -> cDesc.blockEntries; j++ ) mem -> replArray[ j ] = getWord( );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The L2 cache adds its request state, the fill buffer with a block not yet entered and the write back
+// buffer.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCheckpoint::getL2Cache( L2CacheMem *mem ) {
+    
+    mem -> reqDone          = getWord( ) != 0;
+    mem -> reqWriteBackTag  = getWord( );
+    getData( mem -> fillBuf, MAX_BLOCK_SIZE );
+    getData( mem -> writeBackBuf, MAX_BLOCK_SIZE );
+}
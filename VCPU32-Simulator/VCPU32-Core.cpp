@@ -44,22 +44,32 @@ uint32_t getBitField( uint32_t arg, int pos, int len, bool sign = false ) {
     else        return( tmpA & tmpM );
 }
 
+//------------------------------------------------------------------------------------------------------------
+// The idle cycle skipping captures the CPU core state before and after a clock cycle. The buffer needs to
+// be large enough for all registers, pipeline registers and memory and TLB objects.
+//
+//------------------------------------------------------------------------------------------------------------
+const int MAX_SKIP_MEM_OBJ      = 6;
+const int MAX_CYCLE_STATE_WORDS = 320;
+
 }; // namespace
 
 
 //------------------------------------------------------------------------------------------------------------
 // The CPU24Core object constructor. Based on the cpu descriptor, we initialize the registers and create the
-// memory objects and the pipeline stages.
+// memory objects and the pipeline stages. A core of a multi-core system gets the physical memory, PDC and L2
+// cache objects of the system, its own memory objects share their data. The unified TLB option is modelled
+// as the split L1 TLBs, which share a second level TLB.
 //
 //------------------------------------------------------------------------------------------------------------
-CpuCore::CpuCore( CpuCoreDesc *cfg ) {
+CpuCore::CpuCore( CpuCoreDesc *cfg, PhysMem *sharedMem, PdcMem *sharedPdc, L2CacheMem *sharedL2 ) {
     
     memcpy( &cpuDesc, cfg, sizeof( CpuCoreDesc ));
     
-    for ( uint8_t i = 0; i < 8; i++  )  gReg[ i ].init( 0, false );
-    for ( uint8_t i = 0; i < 3; i++  )  sReg[ i ].init( 0, false );
-    for ( uint8_t i = 4; i < 7; i++  )  sReg[ i ].init( 0, true );
-    for ( uint8_t i = 0; i < 31; i++  ) cReg[ i ].init( 0, true );
+    for ( uint8_t i = 0; i < 8; i++  )  gReg.init( i, 0, false );
+    for ( uint8_t i = 0; i < 3; i++  )  sReg.init( i, 0, false );
+    for ( uint8_t i = 4; i < 7; i++  )  sReg.init( i, 0, true );
+    for ( uint8_t i = 0; i < 31; i++  ) cReg.init( i, 0, true );
     
     if ( cfg -> tlbOptions == VMEM_T_SPLIT_TLB ) {
         
@@ -68,19 +78,21 @@ CpuCore::CpuCore( CpuCoreDesc *cfg ) {
     }
     else if ( cfg -> tlbOptions == VMEM_T_UNIFIED_TLB ) {
         
-        // ??? what is the proper way to model a joint TLB ?
-        iTlb = new CpuTlb( &cpuDesc.iTlbDesc );
-        dTlb = new CpuTlb( &cpuDesc.dTlbDesc );
+        uTlbL2 = new CpuTlb( &cpuDesc.uTlbDescL2 );
+        iTlb   = new CpuTlb( &cpuDesc.iTlbDesc, uTlbL2 );
+        dTlb   = new CpuTlb( &cpuDesc.dTlbDesc, uTlbL2 );
     }
     
-    physMem = new PhysMem( &cpuDesc.memDesc );
-    pdcMem  = new PdcMem( &cpuDesc.pdcDesc );
+    physMem = new PhysMem( &cpuDesc.memDesc, sharedMem );
+    pdcMem  = new PdcMem( &cpuDesc.pdcDesc, sharedPdc );
     
-    if ( cfg -> cacheL2Options == VMEM_T_L2_UNIFIED_CACHE ) {
+    if (( cfg -> cacheL2Options == VMEM_T_L2_UNIFIED_CACHE ) || ( cfg -> cacheL2Options == VMEM_T_L2_INCLUSIVE_CACHE )) {
         
-        uCacheL2 = new L2CacheMem( &cpuDesc.uCacheDescL2, physMem );
+        uCacheL2 = new L2CacheMem( &cpuDesc.uCacheDescL2, physMem, sharedL2 );
         iCacheL1 = new L1CacheMem( &cpuDesc.iCacheDescL1, uCacheL2 );
         dCacheL1 = new L1CacheMem( &cpuDesc.dCacheDescL1, uCacheL2 );
+        
+        uCacheL2 -> setUpperCaches( iCacheL1, dCacheL1, ( cfg -> cacheL2Options == VMEM_T_L2_INCLUSIVE_CACHE ));
     }
     else {
         
@@ -88,10 +100,20 @@ CpuCore::CpuCore( CpuCoreDesc *cfg ) {
         dCacheL1 = new L1CacheMem( &cpuDesc.dCacheDescL1, physMem );
     }
    
+    decodeCache = new DecodeCache( );
+    storeBuffer = new StoreBuffer( this, cpuDesc.storeBufferEntries );
+    branchPred  = new BranchPredictor( this, &cpuDesc.bpDesc );
+    
     fdStage = new FetchDecodeStage( this );
     maStage = new MemoryAccessStage( this );
     exStage = new ExecuteStage( this );
     
+    fnEngine    = new FunctionalEngine( this );
+    tcEngine    = new ThreadedEngine( this );
+    oooEngine   = new OooEngine( this, &cpuDesc.oooDesc );
+    
+    clockStepFn = selectClockStep( &cpuDesc, ( ioMem != nullptr ));
+    
     reset( );
 }
 
@@ -103,16 +125,40 @@ void  CpuCore::clearStats( ) {
     
     if ( iTlb != nullptr )     iTlb -> clearStats( );
     if ( dTlb != nullptr )     dTlb -> clearStats( );
+    if ( uTlbL2 != nullptr )   uTlbL2 -> clearStats( );
     
     if ( iCacheL1 != nullptr ) iCacheL1 -> clearStats( );
     if ( dCacheL1 != nullptr ) dCacheL1 -> clearStats( );
     if ( uCacheL2 != nullptr ) uCacheL2 -> clearStats( );
     physMem -> clearStats( );
+    decodeCache -> clearStats( );
+    storeBuffer -> clearStats( );
+    branchPred -> clearStats( );
     
     stats.clockCntr                = 0;
     stats.instrCntr                = 0;
     stats.branchesTaken            = 0;
     stats.branchesMispredicted     = 0;
+    stats.trapsTaken               = 0;
+    stats.operandsForwarded        = 0;
+    stats.dependencyStalls         = 0;
+    stats.pairsIssued              = 0;
+    stats.pairFailFetch            = 0;
+    stats.pairFailFirst            = 0;
+    stats.pairFailSecond           = 0;
+    stats.pairFailDep              = 0;
+    stats.robFullStalls            = 0;
+    stats.iqFullStalls             = 0;
+    stats.lsqFullStalls            = 0;
+    stats.renameStalls             = 0;
+    stats.mshrFullStalls           = 0;
+    stats.loadsForwarded           = 0;
+    stats.missesOverlapped         = 0;
+    
+    sampleStats                    = CpuSampleStats( );
+    
+    fnEngine -> clearStats( );
+    tcEngine -> clearStats( );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -122,21 +168,30 @@ void  CpuCore::clearStats( ) {
 //------------------------------------------------------------------------------------------------------------
 void CpuCore::reset( ) {
     
-    for ( uint8_t i = 0; i < 16; i++  )  gReg[ i ].reset( );
-    for ( uint8_t i = 0; i < 8; i++  )  sReg[ i ].reset( );
-    for ( uint8_t i = 0; i < 32; i++  ) cReg[ i ].reset( );
+    gReg.reset( );
+    sReg.reset( );
+    cReg.reset( );
    
     if ( iTlb != nullptr )      iTlb -> reset( );
     if ( dTlb != nullptr )      dTlb -> reset( );
+    if ( uTlbL2 != nullptr )    uTlbL2 -> reset( );
     
     if ( iCacheL1 != nullptr )  iCacheL1 -> reset( );
     if ( dCacheL1 != nullptr )  dCacheL1 -> reset( );
     if ( uCacheL2 != nullptr )  uCacheL2 -> reset( );
     
+    decodeCache -> reset( );
+    storeBuffer -> reset( );
+    branchPred -> reset( );
+    
     fdStage -> reset( );
     maStage -> reset( );
     exStage -> reset( );
+    fnEngine -> reset( );
+    tcEngine -> reset( );
+    oooEngine -> reset( );
     
+    clearCodeWrites( );
     clearStats( );
 }
 
@@ -156,53 +211,383 @@ void CpuCore::reset( ) {
 // request to the IDLE L2 cache, there needs to be an order. The L1 caches have a priority number which
 // decides which request will be passed the L2 cache. If the L2 cache however is "processed" before the
 // L1 caches, the request will only be recognized in the next clock cycle. This is not what we want to
-// model with respect to latency. So, the order should be: pipeline, L1, L2, MEM types. The "tick" order
-// does not matter. It will just update all registers in the components, just as intended.
+// model with respect to latency. So, the order should be: pipeline, store buffer, L1, L2, MEM types. The
+// "tick" order does not matter. It will just update all registers in the components, just as intended.
 //
 // ??? not sure if the "handle traps" should come right after the pipelines ?
 //------------------------------------------------------------------------------------------------------------
 void CpuCore::clockStep( uint32_t numOfSteps ) {
- 
-    while ( numOfSteps > 0 ) {
-       
-        fdStage     -> process( );
-        maStage     -> process( );
-        exStage     -> process( );
-        
-        handleTraps( );
-      
-        if ( iTlb != nullptr )      iTlb        -> process( );
-        if ( dTlb != nullptr )      dTlb        -> process( );
-        if ( iCacheL1 != nullptr )  iCacheL1    -> process( );
-        if ( dCacheL1 != nullptr )  dCacheL1    -> process( );
-        if ( uCacheL2 != nullptr )  uCacheL2    -> process( );
-        if ( physMem != nullptr )   physMem     -> process( );
-        if ( pdcMem != nullptr )    pdcMem      -> process( );
-        if ( ioMem != nullptr )     ioMem       -> process( );
-        
-        for ( uint8_t i = 0; i < 16; i++  ) gReg[ i ].tick( );
-        for ( uint8_t i = 0; i < 8; i++  ) sReg[ i ].tick( );
-        for ( uint8_t i = 0; i < 32; i++ ) cReg[ i ].tick( );
-        
-        fdStage     -> tick( );
-        maStage     -> tick( );
-        exStage     -> tick( );
-        
-        if ( iTlb != nullptr )      iTlb        -> tick( );
-        if ( dTlb != nullptr )      dTlb        -> tick( );
-        if ( iCacheL1 != nullptr )  iCacheL1    -> tick( );
-        if ( dCacheL1 != nullptr )  dCacheL1    -> tick( );
-        if ( uCacheL2 != nullptr )  uCacheL2    -> tick( );
-        if ( physMem != nullptr )   physMem     -> tick( );
-        if ( pdcMem != nullptr )    pdcMem      -> tick( );
-        if ( ioMem != nullptr )     ioMem       -> tick( );
     
-        stats.clockCntr++;
+    if ( execMode == EXEC_MODE_FUNCTIONAL ) {
+        
+        functionalStep( numOfSteps );
+        return;
+    }
+    else if (( execMode == EXEC_MODE_THREADED ) || ( execMode == EXEC_MODE_JIT )) {
+        
+        threadedStep( numOfSteps );
+        return;
+    }
+    
+    ( this ->* clockStepFn )( numOfSteps );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "pipelineClockStep" is the clock step loop for the pipeline model. The template parameters tell which of
+// the optional objects are configured. The L1 caches, physical memory and PDC are always there. The memory
+// objects are called with their class qualified routines, so there is no virtual function call and no
+// test for a configured object in the loop.
+//
+// A cache miss stalls the pipeline for the latency of the lower memory layer. During these cycles nothing
+// changes but the latency counter of the lower layer and the wait cycle counters. When the pipeline is
+// stalled and a memory request with a latency of more than one cycle is pending, we try to skip these
+// cycles. See "skipIdleCycles" for the details.
+//
+//------------------------------------------------------------------------------------------------------------
+template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+void CpuCore::pipelineClockStep( uint32_t numOfSteps ) {
+    
+    while (( numOfSteps > 0 ) && ( ! stopped )) {
+        
+        if (( numOfSteps > 1 ) && ( fdStage -> isStalled( )) && ( pendingMemLatency( ) > 1 )) {
+            
+            numOfSteps = numOfSteps - skipIdleCycles< HAS_TLB, HAS_L2, HAS_IO >( numOfSteps );
+        }
+        else {
+            
+            pipelineCycle< HAS_TLB, HAS_L2, HAS_IO >( );
+            numOfSteps = numOfSteps - 1;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "pipelineCycle" is one clock cycle of the pipeline model. All components "process" first, then all
+// registers "tick".
+//
+//------------------------------------------------------------------------------------------------------------
+template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+void CpuCore::pipelineCycle( ) {
+    
+    fdStage     -> process( );
+    maStage     -> process( );
+    exStage     -> process( );
+    maStage     -> forwardResult( );
+    
+    handleTraps( );
+    
+    storeBuffer -> process( );
+    
+    if ( HAS_TLB ) {
+        
+        iTlb    -> process( );
+        dTlb    -> process( );
+    }
+    
+    iCacheL1    -> L1CacheMem::process( );
+    dCacheL1    -> L1CacheMem::process( );
+    if ( HAS_L2 ) uCacheL2 -> L2CacheMem::process( );
+    physMem     -> PhysMem::process( );
+    pdcMem      -> PdcMem::process( );
+    if ( HAS_IO ) ioMem -> IoMem::process( );
+    
+    gReg.tick( );
+    sReg.tick( );
+    cReg.tick( );
+    
+    fdStage     -> tick( );
+    maStage     -> tick( );
+    exStage     -> tick( );
+    
+    if ( HAS_TLB ) {
+        
+        iTlb    -> tick( );
+        dTlb    -> tick( );
+        if ( uTlbL2 != nullptr ) uTlbL2 -> tick( );
+    }
+    
+    iCacheL1    -> tick( );
+    dCacheL1    -> tick( );
+    if ( HAS_L2 ) uCacheL2 -> tick( );
+    physMem     -> tick( );
+    pdcMem      -> tick( );
+    if ( HAS_IO ) ioMem -> tick( );
+    
+    stats.clockCntr++;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "skipIdleCycles" runs one clock cycle as a probe and checks whether this cycle only counted down memory
+// latencies. The state of the pipeline registers, the register files, the stall flags, the memory object
+// requests and all statistic counters except for the wait cycle, access and stall counters is captured
+// before and after the cycle. If nothing changed, the pipeline is waiting for a memory request and the next
+// cycles will do the very same thing until a latency counter reaches zero. We do not want to model this
+// cycle by cycle. Each memory object either counted down its latency by one or did not touch it, and
+// counted a wait cycle and a stall cycle or not. A stalled stage repeating its cache access is not counted
+// as an access, a cycle with a new access is not skipped. The store buffer occupancy and stall counters
+// advance by the same amount in each of these cycles. This is applied for all the cycles we skip in one
+// step. The cycle in which a latency counter is zero completes the request and is executed as a normal
+// cycle again. The result is the same as stepping cycle by cycle. The routine returns the number of cycles
+// done, including the probe cycle.
+//
+// ??? the memory data arrays are not part of the captured state. A store in a stalled pipeline would write
+// the same data again in each cycle, so this is fine for now.
+//------------------------------------------------------------------------------------------------------------
+template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+uint32_t CpuCore::skipIdleCycles( uint32_t numOfSteps ) {
+    
+    CpuMem      *mem[ MAX_SKIP_MEM_OBJ ] = { iCacheL1, dCacheL1, uCacheL2, physMem, pdcMem, ioMem };
+    uint32_t    latency[ MAX_SKIP_MEM_OBJ ];
+    uint32_t    waitCycles[ MAX_SKIP_MEM_OBJ ];
+    uint32_t    accesses[ MAX_SKIP_MEM_OBJ ];
+    uint32_t    stalls[ MAX_SKIP_MEM_OBJ ];
+    uint32_t    before[ MAX_CYCLE_STATE_WORDS ];
+    uint32_t    after[ MAX_CYCLE_STATE_WORDS ];
+    uint32_t    decodeHits  = decodeCache -> hits;
+    uint64_t    sbOccupancy = storeBuffer -> getOccupancySum( );
+    uint32_t    sbFull      = storeBuffer -> getFullStallCnt( );
+    uint32_t    sbConflict  = storeBuffer -> getConflictStallCnt( );
+    uint32_t    sbFence     = storeBuffer -> getFenceStallCnt( );
+    uint32_t    len         = captureCycleState( before );
+    
+    for ( int i = 0; i < MAX_SKIP_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] == nullptr ) continue;
+        
+        latency[ i ]    = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_LATENCY );
+        waitCycles[ i ] = mem[ i ] -> getWaitCycleCnt( );
+        accesses[ i ]   = mem[ i ] -> getAccessCnt( );
+        stalls[ i ]     = mem[ i ] -> getMshrStallCnt( );
+    }
+    
+    pipelineCycle< HAS_TLB, HAS_L2, HAS_IO >( );
+    
+    if (( stopped ) || ( captureCycleState( after ) != len ) || ( memcmp( before, after, len * sizeof( uint32_t )) != 0 ))
+        return( 1 );
+    
+    uint32_t skip = numOfSteps - 1;
+    
+    for ( int i = 0; i < MAX_SKIP_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] == nullptr ) continue;
+        
+        uint32_t latencyStep    = latency[ i ] - mem[ i ] -> getMemCtrlReg( MC_REG_REQ_LATENCY );
+        uint32_t waitStep       = mem[ i ] -> getWaitCycleCnt( ) - waitCycles[ i ];
+        uint32_t accessStep     = mem[ i ] -> getAccessCnt( ) - accesses[ i ];
+        uint32_t stallStep      = mem[ i ] -> getMshrStallCnt( ) - stalls[ i ];
+        
+        if (( latencyStep > 1 ) || ( waitStep > 1 ) || ( accessStep > 0 ) || ( stallStep > 1 )) return( 1 );
+        
+        latency[ i ]    = latencyStep;
+        waitCycles[ i ] = waitStep;
+        stalls[ i ]     = stallStep;
+        
+        if (( latencyStep == 1 ) && ( mem[ i ] -> getMemCtrlReg( MC_REG_REQ_LATENCY ) < skip ))
+            skip = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_LATENCY );
+    }
+    
+    for ( int i = 0; i < MAX_SKIP_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] != nullptr ) mem[ i ] -> skipCycles( latency[ i ] * skip, waitCycles[ i ] * skip,
+                                                            stalls[ i ] * skip );
+    }
+    
+    storeBuffer -> skipCycles(( storeBuffer -> getOccupancySum( ) - sbOccupancy ) * skip,
+                              ( storeBuffer -> getFullStallCnt( ) - sbFull ) * skip,
+                              ( storeBuffer -> getConflictStallCnt( ) - sbConflict ) * skip,
+                              ( storeBuffer -> getFenceStallCnt( ) - sbFence ) * skip );
+    
+    decodeCache -> hits += ( decodeCache -> hits - decodeHits ) * skip;
+    stats.clockCntr     += skip;
+    
+    return( 1 + skip );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "pendingMemLatency" returns the largest latency count of a pending request in the memory objects that
+// count down a latency. The L1 caches do not, they wait for their lower layer.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuCore::pendingMemLatency( ) {
+    
+    CpuMem      *mem[ ] = { uCacheL2, physMem, pdcMem, ioMem };
+    uint32_t    maxLatency  = 0;
+    
+    for ( int i = 0; i < 4; i++ ) {
+        
+        if (( mem[ i ] != nullptr ) && ( mem[ i ] -> getPendingLatency( ) > maxLatency ))
+            maxLatency = mem[ i ] -> getPendingLatency( );
+    }
+    
+    return( maxLatency );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "captureCycleState" copies all state of the CPU core that a clock cycle could change into the buffer,
+// except for the memory latency, wait cycle, access and stall counters, the store buffer occupancy and stall
+// counters, the decode cache hit counter and the clock counter.
+// These are the counters that also advance in a cycle where the pipeline just waits. The number of words
+// captured is returned.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuCore::captureCycleState( uint32_t *buf ) {
+    
+    CpuMem      *mem[ MAX_SKIP_MEM_OBJ ] = { iCacheL1, dCacheL1, uCacheL2, physMem, pdcMem, ioMem };
+    CpuTlb      *tlb[ 3 ] = { iTlb, dTlb, uTlbL2 };
+    CpuReg      *maRegs[ ] = { &maStage -> psPstate0, &maStage -> psPstate1, &maStage -> psInstr,
+                               &maStage -> psDecIndex, &maStage -> psValA, &maStage -> psValB,
+                               &maStage -> psValX, &maStage -> psInstr2, &maStage -> psDecIndex2 };
+    CpuReg      *exRegs[ ] = { &exStage -> psPstate0, &exStage -> psPstate1, &exStage -> psInstr,
+                               &exStage -> psDecIndex, &exStage -> psValA, &exStage -> psValB,
+                               &exStage -> psValX, &exStage -> psInstr2, &exStage -> psDecIndex2 };
+    uint32_t    len = 0;
+    
+    for ( uint8_t i = 0; i < 16; i++ ) {
+        
+        buf[ len++ ] = gReg.get( i );
+        buf[ len++ ] = gReg.getLatched( i );
+    }
+    
+    for ( uint8_t i = 0; i < 8; i++ ) {
+        
+        buf[ len++ ] = sReg.get( i );
+        buf[ len++ ] = sReg.getLatched( i );
+    }
+    
+    for ( uint8_t i = 0; i < 32; i++ ) {
+        
+        buf[ len++ ] = cReg.get( i );
+        buf[ len++ ] = cReg.getLatched( i );
+    }
+    
+    buf[ len++ ] = fdStage -> psPstate0.get( );
+    buf[ len++ ] = fdStage -> psPstate0.getLatched( );
+    buf[ len++ ] = fdStage -> psPstate1.get( );
+    buf[ len++ ] = fdStage -> psPstate1.getLatched( );
+    buf[ len++ ] = fdStage -> instr;
+    buf[ len++ ] = fdStage -> isStalled( );
+    
+    for ( int i = 0; i < 9; i++ ) {
+        
+        buf[ len++ ] = maRegs[ i ] -> get( );
+        buf[ len++ ] = maRegs[ i ] -> getLatched( );
+        buf[ len++ ] = exRegs[ i ] -> get( );
+        buf[ len++ ] = exRegs[ i ] -> getLatched( );
+    }
+    
+    buf[ len++ ] = maStage -> isStalled( );
+    buf[ len++ ] = exStage -> isStalled( );
+    
+    for ( int i = 0; i < MAX_SKIP_MEM_OBJ; i++ ) {
+        
+        if ( mem[ i ] == nullptr ) continue;
+        
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_STATE );
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_SEG );
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_OFS );
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_TAG );
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_BLOCK_SET );
+        buf[ len++ ] = mem[ i ] -> getMemCtrlReg( MC_REG_REQ_BLOCK_INDEX );
+        buf[ len++ ] = mem[ i ] -> getMissCnt( );
+        buf[ len++ ] = mem[ i ] -> getDirtyMissCnt( );
+        buf[ len++ ] = mem[ i ] -> getMshrPendingCnt( );
+        buf[ len++ ] = mem[ i ] -> getMshrMergeCnt( );
+        buf[ len++ ] = mem[ i ] -> getPrefetchIssuedCnt( );
+        buf[ len++ ] = mem[ i ] -> getPrefetchUsefulCnt( );
+        buf[ len++ ] = mem[ i ] -> getPrefetchLateCnt( );
+        buf[ len++ ] = mem[ i ] -> getPrefetchPollutionCnt( );
+        buf[ len++ ] = mem[ i ] -> getPrefetchQueueCnt( );
+    }
+    
+    for ( int i = 0; i < 3; i++ ) {
+        
+        if ( tlb[ i ] == nullptr ) continue;
+        
+        buf[ len++ ] = tlb[ i ] -> getPendingLatency( );
+        buf[ len++ ] = tlb[ i ] -> getTlbRefills( );
+        buf[ len++ ] = tlb[ i ] -> getTlbInserts( );
+        buf[ len++ ] = tlb[ i ] -> getTlbDeletes( );
+        buf[ len++ ] = tlb[ i ] -> getTlbAccess( );
+        buf[ len++ ] = tlb[ i ] -> getTlbMiss( );
+        buf[ len++ ] = tlb[ i ] -> getTlbConflictMiss( );
+        buf[ len++ ] = tlb[ i ] -> getTlbCapacityMiss( );
+        buf[ len++ ] = tlb[ i ] -> getTlbWaitCycles( );
+    }
+    
+    buf[ len++ ] = storeBuffer -> getOccupancy( );
+    buf[ len++ ] = storeBuffer -> isTrapDrain( );
+    buf[ len++ ] = storeBuffer -> getStoreCnt( );
+    buf[ len++ ] = storeBuffer -> getDrainCnt( );
+    buf[ len++ ] = storeBuffer -> getForwardCnt( );
+    
+    buf[ len++ ] = branchPred -> getCondPredictCnt( );
+    buf[ len++ ] = branchPred -> getTargetPredictCnt( );
+    buf[ len++ ] = branchPred -> getBtbHitCnt( );
+    buf[ len++ ] = branchPred -> getRasHitCnt( );
+    
+    buf[ len++ ] = decodeCache -> misses;
+    buf[ len++ ] = decodeCache -> invalidations;
+    buf[ len++ ] = stats.instrCntr;
+    buf[ len++ ] = stats.branchesTaken;
+    buf[ len++ ] = stats.branchesMispredicted;
+    buf[ len++ ] = stats.trapsTaken;
+    buf[ len++ ] = stats.operandsForwarded;
+    buf[ len++ ] = stats.dependencyStalls;
+    buf[ len++ ] = stats.pairsIssued;
+    buf[ len++ ] = stats.pairFailFetch;
+    buf[ len++ ] = stats.pairFailFirst;
+    buf[ len++ ] = stats.pairFailSecond;
+    buf[ len++ ] = stats.pairFailDep;
+    
+    return( len );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "oooClockStep" is the clock step loop for the out-of-order core model. The out-of-order engine does all
+// the work, the instructions are executed by the functional engine. The memory objects are not used, the
+// engine computes the access latencies itself.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::oooClockStep( uint32_t numOfSteps ) {
+    
+    while (( numOfSteps > 0 ) && ( ! stopped )) {
+        
+        stats.instrCntr += oooEngine -> cycle( );
+        stats.clockCntr ++;
         
         numOfSteps = numOfSteps - 1;
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "selectClockStep" is the factory for the clock step loop. It picks the loop instance that matches the
+// CPU core descriptor.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuCore::ClockStepFn CpuCore::selectClockStep( CpuCoreDesc *cfg, bool hasIo ) {
+    
+    if ( cfg -> coreModel == CORE_MODEL_OUT_OF_ORDER ) return( &CpuCore::oooClockStep );
+    
+    bool hasTlb = (( cfg -> tlbOptions == VMEM_T_SPLIT_TLB ) || ( cfg -> tlbOptions == VMEM_T_UNIFIED_TLB ));
+    bool hasL2  = (( cfg -> cacheL2Options == VMEM_T_L2_UNIFIED_CACHE ) ||
+                   ( cfg -> cacheL2Options == VMEM_T_L2_INCLUSIVE_CACHE ));
+    
+    if ( hasTlb ) {
+        
+        if ( hasL2 ) return(( hasIo ) ? &CpuCore::pipelineClockStep< true, true, true >
+                                      : &CpuCore::pipelineClockStep< true, true, false > );
+        else         return(( hasIo ) ? &CpuCore::pipelineClockStep< true, false, true >
+                                      : &CpuCore::pipelineClockStep< true, false, false > );
+    }
+    else {
+        
+        if ( hasL2 ) return(( hasIo ) ? &CpuCore::pipelineClockStep< false, true, true >
+                                      : &CpuCore::pipelineClockStep< false, true, false > );
+        else         return(( hasIo ) ? &CpuCore::pipelineClockStep< false, false, true >
+                                      : &CpuCore::pipelineClockStep< false, false, false > );
+    }
+}
+
 //------------------------------------------------------------------------------------------------------------
 // Trap handling. This routine is called after the processing of the EX pipeline stage. Any trap that occurred
 // in the pipeline will set the trap data in the control registers. The trapping instruction itself will
@@ -224,53 +609,133 @@ void CpuCore::clockStep( uint32_t numOfSteps ) {
 // pipeline as stalled when the trap is detected in an instruction that still is ahead of the stall. Just in
 // case, we resume all stages. Phew.
 //
+// A store of the instruction behind the trapping instruction has already entered the store buffer in this
+// cycle and is removed again. The trap handler is fetched once the stores before the trap are written. The
+// branch predictor drops its speculative state of the flushed instructions, the TLBs drop any refill the
+// flushed instructions waited for.
+//
 // Note: one day we may expand to handle external interrupts... this would follow the same logic.
 //------------------------------------------------------------------------------------------------------------
 void CpuCore::handleTraps( ) {
     
-    if (( cReg[ CR_TEMP_1 ].get( ) != NO_TRAP ) &&
-        ( cReg[ CR_TRAP_PSW_0 ].get( ) == exStage -> psPstate0.get( )) &&
-        ( cReg[ CR_TRAP_PSW_1 ].get( ) == exStage -> psPstate1.get( ))) {
+    if (( cReg.get( CR_TEMP_1 ) != NO_TRAP ) &&
+        ( cReg.get( CR_TRAP_PSW_0 ) == exStage -> psPstate0.get( )) &&
+        ( cReg.get( CR_TRAP_PSW_1 ) == exStage -> psPstate1.get( ))) {
         
         uint32_t trapHandlerOfs = 0;
         
-        if ( cReg[ CR_TEMP_1 ].get( ) < MAX_TRAP_ID ) {
+        if ( cReg.get( CR_TEMP_1 ) < MAX_TRAP_ID ) {
             
-            trapHandlerOfs = cReg[ CR_TRAP_VECTOR_ADR ].get( ) + cReg[ CR_TEMP_1 ].get( ) * TRAP_CODE_BLOCK_SIZE;
+            trapHandlerOfs = cReg.get( CR_TRAP_VECTOR_ADR ) + cReg.get( CR_TEMP_1 ) * TRAP_CODE_BLOCK_SIZE;
         }
         
+        trapTaken( );
+        storeBuffer -> trapEntry( );
+        
         fdStage -> psPstate0.set( 0 ); // ??? also set all status bits to zero ?
         fdStage -> psPstate0.set( trapHandlerOfs );
         fdStage -> setStalled( false );
         maStage -> psInstr.set( 0 );  // ??? what to really set ...
+        maStage -> psInstr2.set( 0 );
         maStage -> setStalled ( false );
         exStage -> psInstr.set( 0 );  // ??? what to really set ...
+        exStage -> psInstr2.set( 0 );
         exStage -> setStalled( false );
+        branchPred -> recover( );
+        
+        if ( iTlb != nullptr ) iTlb -> abortTlbOp( );
+        if ( dTlb != nullptr ) dTlb -> abortTlbOp( );
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "trapTaken" is called by the pipeline and the functional engine whenever a trap is taken. Besides counting
+// the traps, the core can be set up to stop execution on a trap. The "clockStep" and "instrStep" routines
+// then return right after the trap was taken, i.e. the next instruction to execute is the first instruction
+// of the trap handler. This is used by the simulator RUN command to stop on a trap, for example after a
+// BRK instruction. The stop stays in effect until cleared.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::trapTaken( ) {
+    
+    stats.trapsTaken ++;
+    
+    if ( stopOnTrap ) stopped = true;
+}
+
+void CpuCore::setStopOnTrap( bool val ) {
+    
+    stopOnTrap = val;
+}
+
+bool CpuCore::isStopped( ) {
+    
+    return( stopped );
+}
+
+void CpuCore::clearStop( ) {
+    
+    stopped = false;
+}
+
 //------------------------------------------------------------------------------------------------------------
 // "instrStep" will perform a number of instruction. This is different from clock step in that a clock step
 // is truly a clock step, while an instruction step can take a varying number of clock cycles, depending on
 // events such as cache misses, etc. At instruction start we remember the instruction address and repeat
-// issuing clock steps until the instruction address is about to change. In addition, we also maintain a
-// cycle count to abort if we run off with an unreasonable high number of clock steps.
+// issuing clock steps until the instruction address is about to change or the FD stage passed on its
+// instruction without a stall. A branch predicted to itself, such as an idle loop, issues the same address
+// again and again. In addition, we also maintain a cycle count to abort if we run off with an unreasonable
+// high number of clock steps.
 //
 // Note that this does not mean that the instruction completely worked through the pipeline. if all goes well,
 // every clock a new instruction enters the pipeline and another one is leaving it. However, when we have
-// pipeline stalls, they will be handled transparently when stepping though the instructions.
+// pipeline stalls, they will be handled transparently when stepping though the instructions. When the FD
+// stage issued an instruction pair, the step counts as two instructions. The out-of-order core model counts
+// the instructions it commits and does not commit more than the remaining number of instructions.
 //
 //------------------------------------------------------------------------------------------------------------
 const uint32_t MAX_CYCLE_PER_INSTR = 100000; // catch a run-away...
 
 void CpuCore::instrStep( uint32_t numOfInstr ) {
     
+    if ( execMode == EXEC_MODE_FUNCTIONAL ) {
+        
+        functionalStep( numOfInstr );
+        return;
+    }
+    else if (( execMode == EXEC_MODE_THREADED ) || ( execMode == EXEC_MODE_JIT )) {
+        
+        threadedStep( numOfInstr );
+        return;
+    }
+    else if ( cpuDesc.coreModel == CORE_MODEL_OUT_OF_ORDER ) {
+        
+        uint32_t cycleCount = 0;
+        
+        while (( numOfInstr > 0 ) && ( ! stopped ) && ( cycleCount < MAX_CYCLE_PER_INSTR )) {
+            
+            uint32_t committed = oooEngine -> cycle( numOfInstr );
+            
+            stats.instrCntr += committed;
+            stats.clockCntr ++;
+            
+            if ( committed > 0 ) {
+                
+                numOfInstr  = numOfInstr - committed;
+                cycleCount  = 0;
+            }
+            else cycleCount ++;
+        }
+        
+        return;
+    }
+    
     uint32_t    previousIaSeg   = 0;
     uint32_t    previousIaOfs   = 0;
     uint32_t    cycleCount      = 0;
     uint32_t    totalCycleCount = 0;
     
-    while ( numOfInstr > 0 ) {
+    while (( numOfInstr > 0 ) && ( ! stopped )) {
         
         previousIaSeg = getBitField( fdStage -> psPstate0.get( ), 31, 16 );
         previousIaOfs = fdStage -> psPstate1.get( );
@@ -281,17 +746,349 @@ void CpuCore::instrStep( uint32_t numOfInstr ) {
             cycleCount ++;
         }
         while (( cycleCount < MAX_CYCLE_PER_INSTR ) &&
+               ( fdStage -> isStalled( )) &&
                ( fdStage -> psPstate1.get( ) == previousIaOfs) &&
                ( getBitField( fdStage -> psPstate0.get( ), 31, 16 ) == previousIaSeg ));
         
-        stats.instrCntr++;
+        uint32_t issued = ( fdStage -> isPairIssued( )) ? 2 : 1;
+        
+        stats.instrCntr += issued;
         
-        numOfInstr      = numOfInstr - 1;
+        numOfInstr      = ( numOfInstr > issued ) ? numOfInstr - issued : 0;
         totalCycleCount = totalCycleCount + cycleCount;
         cycleCount      = 0;
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "functionalStep" executes instructions with the functional engine. There is no notion of a clock cycle in
+// this mode, each instruction counts as one cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::functionalStep( uint32_t numOfInstr ) {
+    
+    while (( numOfInstr > 0 ) && ( ! stopped )) {
+        
+        fnEngine -> step( );
+        
+        stats.clockCntr++;
+        stats.instrCntr++;
+        
+        numOfInstr = numOfInstr - 1;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "threadedStep" executes instructions with the threaded engine. Just like the functional engine, each
+// instruction counts as one cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::threadedStep( uint32_t numOfInstr ) {
+    
+    uint32_t instrDone = tcEngine -> run( numOfInstr );
+    
+    stats.clockCntr += instrDone;
+    stats.instrCntr += instrDone;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setExecMode" switches between the pipeline model and the functional engine. The architectural state is
+// shared, but the pipeline also has instructions in flight and the caches may hold data not yet written
+// to physical memory. When switching to the functional engine, we therefore drain the pipeline. The
+// oldest instruction not yet executed by the EX stage becomes the next instruction to execute. The MA stage
+// may have done its work for this instruction already, but doing it again is harmless, since all
+// register updates happen in the EX stage. With the out-of-order core model, the instructions in flight were
+// already executed by the functional engine and just count as executed. The branch predictor drops the
+// speculative state of the drained instructions. Next, all dirty cache blocks are written back and the
+// caches are invalidated. Physical memory is now the only copy of the data and the functional engine can
+// work on it directly. Switching back to the pipeline is simple. The pipeline registers are empty, the FD
+// stage PSW is the next instruction address and the caches start out cold. The threaded engine works on
+// physical memory just like the functional engine. Since memory may have been modified in the other modes,
+// all translated blocks are discarded when switching to the threaded engine. The JIT mode is the threaded
+// engine with the compilation of hot blocks enabled.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::setExecMode( ExecMode mode ) {
+    
+    if ( mode == execMode ) return;
+    
+    if ( execMode == EXEC_MODE_PIPELINE ) drainPipeLine( );
+    
+    if (( mode == EXEC_MODE_THREADED ) || ( mode == EXEC_MODE_JIT )) {
+        
+        tcEngine -> setJitEnabled( mode == EXEC_MODE_JIT );
+        tcEngine -> flush( );
+    }
+    
+    execMode = mode;
+}
+
+ExecMode CpuCore::getExecMode( ) {
+    
+    return( execMode );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flushTranslations" discards all translated code blocks. The threaded engine tracks the stores done by
+// the instructions it executes, but not any memory modification done from the outside, for example by the
+// simulator commands. These need to call this routine.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::flushTranslations( ) {
+    
+    tcEngine -> flush( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "invalidateCode" is called for a store done by the functional engine. The decode cache entries and the
+// translated code blocks for the address are invalidated. In a multi-core system, the store is also entered
+// into the code write log, consecutive stores to the same location are entered once. "applyCodeWrites"
+// invalidates the entries for the stores logged by another core, "clearCodeWrites" empties the log.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::invalidateCode( uint32_t physAdr, uint32_t len ) {
+    
+    decodeCache -> invalidate( physAdr, len );
+    tcEngine -> invalidate( physAdr, len );
+    
+    if (( ! codeWrites.enabled ) || ( codeWrites.overflow )) return;
+    
+    if (( codeWrites.cnt > 0 ) &&
+        ( codeWrites.adr[ codeWrites.cnt - 1 ] == physAdr ) &&
+        ( codeWrites.len[ codeWrites.cnt - 1 ] == len )) return;
+    
+    if ( codeWrites.cnt < MAX_CODE_WRITES ) {
+        
+        codeWrites.adr[ codeWrites.cnt ] = physAdr;
+        codeWrites.len[ codeWrites.cnt ] = len;
+        codeWrites.cnt ++;
+    }
+    else codeWrites.overflow = true;
+}
+
+void CpuCore::applyCodeWrites( CpuCore *writer ) {
+    
+    if ( writer -> codeWrites.overflow ) {
+        
+        tcEngine -> flush( );
+        return;
+    }
+    
+    for ( uint32_t i = 0; i < writer -> codeWrites.cnt; i++ ) {
+        
+        decodeCache -> invalidate( writer -> codeWrites.adr[ i ], writer -> codeWrites.len[ i ] );
+        tcEngine -> invalidate( writer -> codeWrites.adr[ i ], writer -> codeWrites.len[ i ] );
+    }
+}
+
+void CpuCore::clearCodeWrites( ) {
+    
+    codeWrites.cnt      = 0;
+    codeWrites.overflow = false;
+}
+
+void CpuCore::drainPipeLine( ) {
+    
+    stats.instrCntr += oooEngine -> drain( );
+    
+    if ( exStage -> psInstr.get( ) != NOP_INSTR ) {
+        
+        fdStage -> psPstate0.load( exStage -> psPstate0.get( ));
+        fdStage -> psPstate1.load( exStage -> psPstate1.get( ));
+    }
+    else if ( maStage -> psInstr.get( ) != NOP_INSTR ) {
+        
+        fdStage -> psPstate0.load( maStage -> psPstate0.get( ));
+        fdStage -> psPstate1.load( maStage -> psPstate1.get( ));
+    }
+    
+    maStage -> psInstr.load( NOP_INSTR );
+    exStage -> psInstr.load( NOP_INSTR );
+    maStage -> psInstr2.load( NOP_INSTR );
+    exStage -> psInstr2.load( NOP_INSTR );
+    
+    fdStage -> setStalled( false );
+    maStage -> setStalled( false );
+    exStage -> setStalled( false );
+    
+    if ( iTlb != nullptr )      iTlb -> abortTlbOp( );
+    if ( dTlb != nullptr )      dTlb -> abortTlbOp( );
+    
+    storeBuffer -> flushAll( );
+    branchPred -> recover( );
+    
+    if ( iCacheL1 != nullptr )  iCacheL1 -> flushAllBlocks( );
+    if ( dCacheL1 != nullptr )  dCacheL1 -> flushAllBlocks( );
+    if ( uCacheL2 != nullptr )  uCacheL2 -> flushAllBlocks( );
+    
+    physMem -> abortOp( );
+    pdcMem  -> abortOp( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Sampled simulation. Running the pipeline model for a long program is slow, running the functional engine
+// is fast but tells nothing about the cycles needed. A sampled run takes a number of short detailed windows
+// out of a long program run and derives the CPI from them. After a fast forward of "fastForward" instructions
+// with the functional, threaded or JIT engine, the functional engine executes "warmUp" instructions and
+// enters the instruction and data blocks it accesses into the caches. Then the pipeline executes "window"
+// instructions, which are measured. This repeats until the requested number of instructions is executed. The
+// TLBs are loaded by software, the functional engine keeps them current just like the pipeline does. Only
+// the caches need to be warmed up.
+//
+// The fast forward phase starts with empty caches. Leaving the pipeline flushes the caches anyway, and any
+// block entered during an earlier warm up could be outdated by then. Only when the sampling starts from one
+// of the fast engines, the caches are flushed here.
+//
+// ??? the pipeline starts each detailed window empty, the few cycles to fill it are part of the window.
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::setSampling( uint32_t fastForward, uint32_t warmUp, uint32_t window, ExecMode fastMode ) {
+    
+    sampleFastForward   = fastForward;
+    sampleWarmUp        = warmUp;
+    sampleWindow        = (( window > 0 ) ? window : 1 );
+    sampleFastMode      = (( fastMode == EXEC_MODE_PIPELINE ) ? EXEC_MODE_FUNCTIONAL : fastMode );
+    samplePhase         = SAMPLE_PHASE_DETAILED;
+    samplePhaseLeft     = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "sampledStep" executes a number of instructions in the sampling phases. The current phase and the number
+// of instructions left in it are kept across calls, so that a long sampled run can be done in batches. When
+// the execution mode was changed in between, for example by a single step, the sampling resumes with a new
+// fast forward phase.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::sampledStep( uint32_t numOfInstr ) {
+    
+    if (( samplePhaseLeft > 0 ) && ( execMode != samplePhaseMode( samplePhase ))) samplePhaseLeft = 0;
+    
+    while (( numOfInstr > 0 ) && ( ! stopped )) {
+        
+        while ( samplePhaseLeft == 0 ) {
+            
+            if      ( samplePhase == SAMPLE_PHASE_FAST_FORWARD )  enterSamplePhase( SAMPLE_PHASE_WARM_UP );
+            else if ( samplePhase == SAMPLE_PHASE_WARM_UP )       enterSamplePhase( SAMPLE_PHASE_DETAILED );
+            else                                                  enterSamplePhase( SAMPLE_PHASE_FAST_FORWARD );
+        }
+        
+        uint32_t steps      = ( numOfInstr < samplePhaseLeft ) ? numOfInstr : samplePhaseLeft;
+        uint32_t startInstr = stats.instrCntr;
+        
+        fnEngine -> setCacheWarming( samplePhase == SAMPLE_PHASE_WARM_UP );
+        instrStep( steps );
+        fnEngine -> setCacheWarming( false );
+        
+        uint32_t instrDone  = stats.instrCntr - startInstr;
+        
+        if ( instrDone > steps ) instrDone = steps;
+        
+        if      ( samplePhase == SAMPLE_PHASE_FAST_FORWARD )  sampleStats.instrFastForward += instrDone;
+        else if ( samplePhase == SAMPLE_PHASE_WARM_UP )       sampleStats.instrWarmUp += instrDone;
+        
+        samplePhaseLeft = samplePhaseLeft - instrDone;
+        numOfInstr      = numOfInstr - instrDone;
+        
+        if (( samplePhase == SAMPLE_PHASE_DETAILED ) && ( samplePhaseLeft == 0 )) endSampleWindow( );
+        
+        if ( instrDone == 0 ) break;
+    }
+}
+
+void CpuCore::enterSamplePhase( SamplePhase phase ) {
+    
+    bool leavesPipeLine = ( execMode == EXEC_MODE_PIPELINE );
+    
+    setExecMode( samplePhaseMode( phase ));
+    
+    samplePhase = phase;
+    
+    switch ( phase ) {
+            
+        case SAMPLE_PHASE_FAST_FORWARD: {
+            
+            if ( ! leavesPipeLine ) {
+                
+                if ( iCacheL1 != nullptr )  iCacheL1 -> flushAllBlocks( );
+                if ( dCacheL1 != nullptr )  dCacheL1 -> flushAllBlocks( );
+                if ( uCacheL2 != nullptr )  uCacheL2 -> flushAllBlocks( );
+            }
+            
+            samplePhaseLeft = sampleFastForward;
+            
+        } break;
+            
+        case SAMPLE_PHASE_WARM_UP: {
+            
+            samplePhaseLeft = sampleWarmUp;
+            
+        } break;
+            
+        case SAMPLE_PHASE_DETAILED: {
+            
+            captureSampleCounters( windowStart );
+            samplePhaseLeft = sampleWindow;
+            
+        } break;
+    }
+}
+
+ExecMode CpuCore::samplePhaseMode( SamplePhase phase ) {
+    
+    switch ( phase ) {
+            
+        case SAMPLE_PHASE_FAST_FORWARD: return( sampleFastMode );
+        case SAMPLE_PHASE_WARM_UP:      return( EXEC_MODE_FUNCTIONAL );
+        default:                        return( EXEC_MODE_PIPELINE );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "endSampleWindow" measures a completed detailed window. The counters are 32-bit values, the differences
+// are correct also when a counter wrapped around during the window.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuCore::endSampleWindow( ) {
+    
+    uint32_t windowEnd[ MAX_SAMPLE_COUNTERS ];
+    uint32_t delta[ MAX_SAMPLE_COUNTERS ];
+    
+    captureSampleCounters( windowEnd );
+    
+    for ( uint32_t i = 0; i < MAX_SAMPLE_COUNTERS; i++ ) delta[ i ] = windowEnd[ i ] - windowStart[ i ];
+    
+    if ( delta[ 1 ] == 0 ) return;
+    
+    double cpi = (double) delta[ 0 ] / (double) delta[ 1 ];
+    
+    sampleStats.samples         ++;
+    sampleStats.cyclesDetailed  += delta[ 0 ];
+    sampleStats.instrDetailed   += delta[ 1 ];
+    sampleStats.cpiSum          += cpi;
+    sampleStats.cpiSumSquares   += cpi * cpi;
+    sampleStats.iCacheAccess    += delta[ 2 ];
+    sampleStats.iCacheMiss      += delta[ 3 ];
+    sampleStats.dCacheAccess    += delta[ 4 ];
+    sampleStats.dCacheMiss      += delta[ 5 ];
+    sampleStats.iTlbAccess      += delta[ 6 ];
+    sampleStats.iTlbMiss        += delta[ 7 ];
+    sampleStats.dTlbAccess      += delta[ 8 ];
+    sampleStats.dTlbMiss        += delta[ 9 ];
+}
+
+void CpuCore::captureSampleCounters( uint32_t *buf ) {
+    
+    buf[ 0 ] = stats.clockCntr;
+    buf[ 1 ] = stats.instrCntr;
+    buf[ 2 ] = iCacheL1 -> getAccessCnt( );
+    buf[ 3 ] = iCacheL1 -> getMissCnt( );
+    buf[ 4 ] = dCacheL1 -> getAccessCnt( );
+    buf[ 5 ] = dCacheL1 -> getMissCnt( );
+    buf[ 6 ] = ( iTlb != nullptr ) ? iTlb -> getTlbAccess( ) : 0;
+    buf[ 7 ] = ( iTlb != nullptr ) ? iTlb -> getTlbMiss( ) : 0;
+    buf[ 8 ] = ( dTlb != nullptr ) ? dTlb -> getTlbAccess( ) : 0;
+    buf[ 9 ] = ( dTlb != nullptr ) ? dTlb -> getTlbMiss( ) : 0;
+}
+
 //------------------------------------------------------------------------------------------------------------
 // CPU register getter and setter functions used by the simulator user interface to display and modify the
 // CPU programmer visible register set.
@@ -301,9 +1098,9 @@ uint32_t CpuCore::getReg( RegClass regClass, uint8_t regNum ) {
     
     switch ( regClass ) {
             
-        case RC_GEN_REG_SET:    return( gReg[ regNum % MAX_GREGS ].get( ) );
-        case RC_SEG_REG_SET:    return( sReg[ regNum % MAX_SREGS ].get( ) );
-        case RC_CTRL_REG_SET:   return( cReg[ regNum % MAX_CREGS ].get( ) );
+        case RC_GEN_REG_SET:    return( gReg.get( regNum % MAX_GREGS ) );
+        case RC_SEG_REG_SET:    return( sReg.get( regNum % MAX_SREGS ) );
+        case RC_CTRL_REG_SET:   return( cReg.get( regNum % MAX_CREGS ) );
             
         case RC_FD_PSTAGE:      return( fdStage -> getPipeLineReg( regNum ));
         case RC_MA_PSTAGE:      return( maStage -> getPipeLineReg( regNum ));
@@ -324,9 +1121,9 @@ void CpuCore::setReg( RegClass regClass, uint8_t regNum, uint32_t val ) {
     
     switch ( regClass ) {
             
-        case RC_GEN_REG_SET:    gReg[ regNum % MAX_GREGS ].load( val );     break;
-        case RC_SEG_REG_SET:    sReg[ regNum % MAX_SREGS ].load( val );     break;
-        case RC_CTRL_REG_SET:   cReg[ regNum % MAX_CREGS ].load( val );     break;
+        case RC_GEN_REG_SET:    gReg.load( regNum % MAX_GREGS, val );     break;
+        case RC_SEG_REG_SET:    sReg.load( regNum % MAX_SREGS, val );     break;
+        case RC_CTRL_REG_SET:   cReg.load( regNum % MAX_CREGS, val );     break;
         
         case RC_FD_PSTAGE:      fdStage -> setPipeLineReg( regNum, val );   break;
         case RC_MA_PSTAGE:      maStage -> setPipeLineReg( regNum, val );   break;
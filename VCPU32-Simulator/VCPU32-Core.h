@@ -39,7 +39,8 @@ enum VmemOptions : uint32_t {
     VMEM_T_SPLIT_TLB            = 1,
     VMEM_T_UNIFIED_TLB          = 2,
     VMEM_T_L1_SPLIT_CACHE       = 3,
-    VMEM_T_L2_UNIFIED_CACHE     = 4
+    VMEM_T_L2_UNIFIED_CACHE     = 4,
+    VMEM_T_L2_INCLUSIVE_CACHE   = 5
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -108,7 +109,8 @@ enum MemoryObjRegId : uint32_t {
     MC_REG_LATENCY          = 12,
     MC_REG_BLOCK_ENTRIES    = 13,
     MC_REG_BLOCK_SIZE       = 14,
-    MC_REG_SETS             = 15
+    MC_REG_SETS             = 15,
+    MC_REG_RESIDENT_PAGES   = 16
 };
 
 
@@ -122,7 +124,8 @@ enum MemoryObjRegId : uint32_t {
 
 
 //------------------------------------------------------------------------------------------------------------
-// We support two types of TLB. The split instruction and data TLB and a unified, dual ported TLB.
+// We support two types of TLB. The split instruction and data TLB and a unified, dual ported TLB. The split
+// TLBs can be backed by a unified second level TLB.
 //
 //------------------------------------------------------------------------------------------------------------
 enum TlbType : uint32_t {
@@ -130,25 +133,41 @@ enum TlbType : uint32_t {
     TLB_T_NIL           = 0,
     TLB_T_L1_INSTR      = 1,
     TLB_T_L1_DATA       = 2,
-    TLB_T_L1_DUAL       = 3
+    TLB_T_L1_DUAL       = 3,
+    TLB_T_L2_UNIFIED    = 4
 };
 
 //------------------------------------------------------------------------------------------------------------
 // TLB access types. The direct mapped allows for a simple indexing. The fully associative access type is
-// intended for the dual ported TLB model.
+// intended for the dual ported TLB model. The set associative TLB hashes into a set of several ways.
 //
 //------------------------------------------------------------------------------------------------------------
 enum TlbAccessType : uint32_t {
     
     TLB_AT_NIL                   = 0,
     TLB_AT_FULLY_ASSOCIATIVE     = 1,
-    TLB_AT_DIRECT_MAPPED         = 2
+    TLB_AT_DIRECT_MAPPED         = 2,
+    TLB_AT_SET_ASSOCIATIVE       = 3
 };
 
 //------------------------------------------------------------------------------------------------------------
-// A TLB object is described through a TLB descriptor. Access methods are direct mapped or fully associative.
-// All TLB entry tables are a power of two in size. A TLB has a number entries. The TLB is accessed in one
-// cycle.
+// TLB replacement policies. When all ways of a set are valid, the policy selects the entry to replace. True
+// LRU keeps a use stamp per entry, tree PLRU a bit tree per set. The random policy uses a seeded generator,
+// so that runs are repeatable.
+//
+//------------------------------------------------------------------------------------------------------------
+enum TlbReplPolicy : uint32_t {
+    
+    TLB_RP_LRU                   = 0,
+    TLB_RP_PLRU                  = 1,
+    TLB_RP_RANDOM                = 2
+};
+
+//------------------------------------------------------------------------------------------------------------
+// A TLB object is described through a TLB descriptor. Access methods are direct mapped, set associative or
+// fully associative. All TLB entry tables are a power of two in size. A TLB has a number entries, the ways
+// are the number of entries per set for the set associative TLB. The TLB is accessed in one cycle. For the
+// second level TLB, the latency is the number of cycles for a lookup.
 //
 //------------------------------------------------------------------------------------------------------------
 struct TlbDesc {
@@ -157,6 +176,9 @@ struct TlbDesc {
     TlbAccessType  accessType  = TLB_AT_NIL;
     uint16_t       entries     = 0;
     uint16_t       latency     = 0;
+    uint16_t       ways        = 4;
+    TlbReplPolicy  replPolicy  = TLB_RP_LRU;
+    uint32_t       replSeed    = 1;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -189,13 +211,47 @@ enum CpuMemAccessType : uint32_t {
     MEM_AT_DIRECT_MAPPED        = 2
 };
 
+//------------------------------------------------------------------------------------------------------------
+// Cache replacement policies. When all sets of a block index are valid, the policy selects the victim. The
+// policy state for each block index is kept in one word next to the tag array. True LRU keeps the order
+// of the sets, tree PLRU a bit tree, SRRIP and BRRIP a 2-bit re-reference prediction value per set. The
+// random policy uses a seeded generator per cache, so that runs are repeatable.
+//
+//------------------------------------------------------------------------------------------------------------
+enum CpuMemReplPolicy : uint32_t {
+    
+    MEM_RP_RANDOM               = 0,
+    MEM_RP_LRU                  = 1,
+    MEM_RP_PLRU                 = 2,
+    MEM_RP_SRRIP                = 3,
+    MEM_RP_BRRIP                = 4
+};
+
+//------------------------------------------------------------------------------------------------------------
+// Cache prefetch policies. The next-N-line prefetcher fetches the blocks following a miss. The stride
+// prefetcher keeps a table of the last address and the distance between two accesses, indexed by the
+// instruction address, and fetches ahead once the same stride was seen twice. The stream prefetcher follows
+// several sequential streams, a stream is confirmed by two misses to adjacent blocks and is then run ahead of
+// the accesses. The prefetch degree is the number of blocks fetched ahead.
+//
+//------------------------------------------------------------------------------------------------------------
+enum CpuMemPfPolicy : uint32_t {
+    
+    MEM_PF_NONE                 = 0,
+    MEM_PF_NEXT_LINE            = 1,
+    MEM_PF_STRIDE               = 2,
+    MEM_PF_STREAM               = 3
+};
+
 //------------------------------------------------------------------------------------------------------------
 // A cache or memory object is described through a descriptor. There are the type and access types. Size
 // information the number of entries in an array, the line size describes the number of words in a block.
 // the block sets value described the number of sets for n-way associative caches. The latency will specify
 // how many clock cycles it will take to perform the respective operation. For main memory, the PDC and the
 // IO memory there is a start and ending address, since these memory will not cover all of the possible
-// memory range.
+// memory range. A cache selects its replacement policy. An L1 cache with miss status holding registers is
+// a non-blocking cache, with zero entries the cache blocks on a miss. The L1 and L2 caches can have a
+// prefetcher, the table entries are the stride table entries or the number of streams followed.
 //
 //------------------------------------------------------------------------------------------------------------
 struct CpuMemDesc {
@@ -209,12 +265,92 @@ struct CpuMemDesc {
     uint32_t            endAdr          = 0;
     uint32_t            latency         = 0;
     uint32_t            priority        = 0;
+    CpuMemReplPolicy    replPolicy      = MEM_RP_RANDOM;
+    uint32_t            replSeed        = 1;
+    uint32_t            mshrEntries     = 0;
+    CpuMemPfPolicy      prefetchPolicy  = MEM_PF_NONE;
+    uint32_t            prefetchDegree  = 1;
+    uint32_t            prefetchEntries = 4;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor is described by its own descriptor. The static policy uses the hint bit encoded in
+// the conditional branch instruction and leaves all other branches to the MA stage, just as the pipeline
+// always did. The other policies select the direction predictor for the conditional branches. The pattern
+// history table entries are the counters of the bimodal and gshare predictor and the base predictor of
+// TAGE. The history bits are the global history length used by gshare, which is also the longest history
+// used by TAGE. The branch target buffer and return address stack sizes are the number of entries.
+//
+//------------------------------------------------------------------------------------------------------------
+enum BranchPredPolicy : uint32_t {
+    
+    BP_STATIC                   = 0,
+    BP_BIMODAL                  = 1,
+    BP_GSHARE                   = 2,
+    BP_TAGE                     = 3
+};
+
+struct BranchPredDesc {
+    
+    BranchPredPolicy    policy          = BP_STATIC;
+    uint32_t            phtEntries      = 1024;
+    uint32_t            historyBits     = 16;
+    uint32_t            btbEntries      = 64;
+    uint32_t            rasEntries      = 8;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// Operand forwarding modes. Without forwarding, an instruction in the FD stage that reads a register an
+// instruction in the MA or EX stage will write waits until the value is written back. The EX forwarding mode
+// passes the EX stage results to the instructions in the FD and MA stage, an address computation or a store
+// that needs the result of the instruction just ahead still waits one cycle. The full forwarding mode in
+// addition passes the results that are already known at the end of the MA stage, such as loaded data, to
+// the FD stage. Only an EX stage result needed by the MA stage of the next instruction then waits.
+//
+//------------------------------------------------------------------------------------------------------------
+enum CpuFwdMode : uint32_t {
+    
+    FWD_MODE_NONE               = 0,
+    FWD_MODE_EX                 = 1,
+    FWD_MODE_FULL               = 2
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU core model. The in-order model is the FD, MA and EX stage pipeline. The out-of-order model is the
+// timing model of an out-of-order implementation, see the "OooEngine" for details. Its descriptor sets the
+// size of the reorder buffer, the number of physical registers for renaming, the issue queue sizes for the
+// ALU and the memory instructions and the size of the load/store queue. The width is the number of
+// instructions fetched, issued and committed per cycle, of which up to "memPorts" may be memory accesses.
+// The redirect penalty is the number of cycles for restarting the fetch after a mispredicted branch or a
+// trap. The number of outstanding data cache misses is the number of MSHR entries of the L1 data cache.
+//
+//------------------------------------------------------------------------------------------------------------
+enum CpuCoreModel : uint32_t {
+    
+    CORE_MODEL_IN_ORDER         = 0,
+    CORE_MODEL_OUT_OF_ORDER     = 1
+};
+
+struct OooDesc {
+    
+    uint32_t            robEntries          = 64;
+    uint32_t            physRegs            = 80;
+    uint32_t            aluIqEntries        = 24;
+    uint32_t            memIqEntries        = 16;
+    uint32_t            lsqEntries          = 32;
+    uint32_t            width               = 4;
+    uint32_t            memPorts            = 2;
+    uint32_t            redirectPenalty     = 3;
 };
 
 //------------------------------------------------------------------------------------------------------------
 // The CPU core object descriptor holds the configuration settings for the CPU core objects. The descriptor
 // contains the overall memory model, i.e. whether it is a split or unified model for L1 caches or TLB, and
-// descriptors for each building block.
+// descriptors for each building block. A store buffer with zero entries means that stores are written to
+// the L1 data cache directly. The branch predictor of the FD stage has its own descriptor. The unified TLB
+// option adds the second level TLB described by "uTlbDescL2" behind the split L1 TLBs. The forwarding mode
+// selects the bypass network of the pipeline. An issue width of two configures the dual issue pipeline. The
+// core model selects the in-order pipeline or the out-of-order core model described by "oooDesc".
 //
 // ??? should the core have knowledge of L2 and MEM or just an abstract memory interface ? Consider the
 // case where we have several cores ...
@@ -236,6 +372,17 @@ struct CpuCoreDesc {
     
     TlbDesc             iTlbDesc;
     TlbDesc             dTlbDesc;
+    TlbDesc             uTlbDescL2;
+    
+    BranchPredDesc      bpDesc;
+    
+    uint32_t            snoopLatency        = 4;
+    uint32_t            interventionLatency = 8;
+    uint32_t            storeBufferEntries  = 0;
+    CpuFwdMode          fwdMode             = FWD_MODE_FULL;
+    uint32_t            issueWidth          = 1;
+    CpuCoreModel        coreModel           = CORE_MODEL_IN_ORDER;
+    OooDesc             oooDesc;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -282,6 +429,46 @@ private:
     bool        isPriv      = false;
 };
 
+//------------------------------------------------------------------------------------------------------------
+// The general, segment and control registers are organized as register files. A register file behaves like
+// a set of registers, but keeps the inbound and outbound values of all registers in two arrays. A "set"
+// marks the register as changed. The "tick" of the register file then only copies the changed registers to
+// their outbound value. In a typical clock cycle, only one or two registers are written. The two arrays
+// also make it easy to take a copy of the register state.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_REG_FILE_SIZE = 32;
+
+struct CpuRegFile {
+    
+public:
+    
+    CpuRegFile( uint32_t size );
+    
+    void        init( uint8_t regId, uint32_t val = 0, bool isPriv = false );
+    void        reset( );
+    void        tick( );
+    
+    void        load( uint8_t regId, uint32_t val );
+    void        set( uint8_t regId, uint32_t val );
+    uint32_t    get( uint8_t regId );
+    uint32_t    getLatched( uint8_t regId );
+    uint32_t    getBitField( uint8_t regId, int pos, int len, bool sign = false );
+    
+    bool        isPrivReg( uint8_t regId );
+    uint32_t    getSize( );
+    
+private:
+    
+    uint32_t    regIn[ MAX_REG_FILE_SIZE ]      = { 0 };
+    uint32_t    regOut[ MAX_REG_FILE_SIZE ]     = { 0 };
+    uint32_t    privMask                        = 0;
+    uint32_t    dirtyMask                       = 0;
+    uint32_t    size                            = 0;
+    
+    friend struct JitEngine;
+};
+
 //------------------------------------------------------------------------------------------------------------
 // The TLB entry. Each TLB entry has the translation information, which is the virtual page number and the
 // physical page number. Then there are the access rights of the page and the protection Id. Finally there
@@ -318,12 +505,23 @@ public:
 // protection and access rights data, which will ten set the entry valid. The object also maintains a set
 // of statistics to keep track of hits, misses, wait cycles and so on.
 //
+// The entry array is organized as sets of ways, a direct mapped TLB has one way per set and a fully
+// associative TLB one set with all entries. Next to the entries, the TLB keeps a packed tag array with the
+// segment and virtual page number of each valid entry, which is what a lookup scans. Misses are split into
+// conflict misses, which hit a page that was replaced within the last TLB size replacements, and capacity
+// misses for all others, including the first reference to a page.
+//
+// A first level TLB can have a lower level TLB. On a miss, the stage asks for a refill, which looks up the
+// lower TLB after its latency and enters a found translation. The lower TLB has one port. Refill requests
+// in the same cycle are served one after the other, the FD stage before the MA stage. Entries inserted or
+// purged by software are inserted or purged in the lower TLB too.
+//
 //------------------------------------------------------------------------------------------------------------
 struct CpuTlb {
     
 public:
     
-    CpuTlb( TlbDesc *cfg );
+    CpuTlb( TlbDesc *cfg, CpuTlb *lowerTlb = nullptr );
     
     void            reset( );
     void            tick( );
@@ -338,6 +536,8 @@ public:
     bool            purgeTlbEntry( uint32_t seg, uint32_t ofs );
     
     TlbEntry        *lookupTlbEntry( uint32_t seg, uint32_t ofs );
+    TlbEntry        *refillTlbEntry( uint32_t seg, uint32_t ofs, bool timed = true );
+    bool            isRefillPending( );
     TlbEntry        *getTlbEntry( uint32_t index );
     
     bool            purgeTlbEntryData( uint32_t seg, uint32_t ofs );
@@ -348,28 +548,60 @@ public:
     uint32_t        getTlbDeletes( );
     uint32_t        getTlbAccess( );
     uint32_t        getTlbMiss( );
+    uint32_t        getTlbConflictMiss( );
+    uint32_t        getTlbCapacityMiss( );
+    uint32_t        getTlbRefills( );
     uint32_t        getTlbWaitCycles( );
+    uint32_t        getPendingLatency( );
     
     uint32_t        getTlbCtrlReg( uint8_t tReg );
     void            setTlbCtrlReg( uint8_t tReg, uint32_t val );
     
 private:
     
+    TlbEntry        *findEntry( uint32_t seg, uint32_t ofs );
+    TlbEntry        *selectEntry( uint32_t seg, uint32_t ofs );
+    void            touchEntry( uint32_t index );
+    void            updateTag( TlbEntry *ptr );
+    void            recordEviction( uint64_t tag );
+    void            classifyMiss( uint64_t tag );
+    void            fillEntry( uint32_t seg, uint32_t ofs, uint32_t argAcc, uint32_t argAdr );
+    uint32_t        reservePort( );
+    
     TlbDesc         tlbDesc;
+    CpuTlb          *lowerTlb           = nullptr;
+    uint16_t        tlbSets             = 0;
+    uint16_t        tlbWays             = 0;
     
     uint32_t        tlbOpState          = 0;
     uint32_t        reqOp               = 0;
     uint32_t        reqData             = 0;
     uint32_t        reqDelayCnt         = 0;
+    uint32_t        reqSeg              = 0;
+    uint32_t        reqOfs              = 0;
+    uint32_t        portBusyCnt         = 0;
     
     TlbEntry        *reqTlbEntry        = nullptr;
     TlbEntry        *tlbArray           = nullptr;
+    uint64_t        *tagArray           = nullptr;
+    uint32_t        *lruArray           = nullptr;
+    uint8_t         *plruArray          = nullptr;
+    uint64_t        *evictArray         = nullptr;
+    
+    uint32_t        lruClock            = 0;
+    uint32_t        replRandState       = 1;
+    uint32_t        evictPos            = 0;
     
     uint32_t        tlbInserts         = 0;
     uint32_t        tlbDeletes         = 0;
     uint32_t        tlbAccess          = 0;
     uint32_t        tlbMiss            = 0;
+    uint32_t        tlbConflictMiss    = 0;
+    uint32_t        tlbCapacityMiss    = 0;
+    uint32_t        tlbRefills         = 0;
     uint32_t        tlbWaitCycles      = 0;
+    
+    friend struct   CpuCheckpoint;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -380,12 +612,60 @@ private:
 // size configured. Normally, a cache would just store the block number, saving the bits in the tag. Our
 // version just stores the physical block address with the block size bits set to zero as the tag.
 //
+// In a multi-core system, the L1 data caches keep their blocks coherent with the MESI protocol. The four
+// states are encoded with the valid, dirty and shared flags. "M" is valid and dirty, "E" is valid and neither
+// dirty nor shared, "S" is valid and shared and "I" is not valid. A block invalidated by another cache keeps
+// its tag and is marked, so that a later miss on the block is recognized as a coherence miss. A block
+// brought in by the prefetcher is marked until the first access to it.
+//
 //------------------------------------------------------------------------------------------------------------
 struct MemTagEntry {
     
-    bool            valid   = false;
-    bool            dirty   = false;
-    uint32_t        tag     = 0;
+    bool            valid       = false;
+    bool            dirty       = false;
+    bool            shared      = false;
+    bool            invalidated = false;
+    bool            prefetched  = false;
+    uint32_t        tag         = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// A non-blocking L1 cache keeps track of its outstanding misses in miss status holding registers. An entry
+// holds the block address and the block index the block will be entered at. Stores to the block while the
+// miss is pending are merged into the entry and written into the block once it arrived. The "storeMask"
+// marks the bytes written.
+//
+//------------------------------------------------------------------------------------------------------------
+struct MemMshrEntry {
+    
+    bool            valid                           = false;
+    bool            exclusive                       = false;
+    uint32_t        tag                             = 0;
+    uint32_t        blockIndex                      = 0;
+    uint8_t         storeMask[ MAX_BLOCK_SIZE ]     = { 0 };
+    uint8_t         storeData[ MAX_BLOCK_SIZE ]     = { 0 };
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The prefetcher of a cache keeps a table of entries. For the stride prefetcher, an entry holds the last
+// address accessed by an instruction, the stride to the access before and how often the stride was seen.
+// For the stream prefetcher, an entry is a stream with its last block and the direction it moves in. The
+// blocks to prefetch are kept in a queue with the block offset for the cache index and the block address.
+//
+//------------------------------------------------------------------------------------------------------------
+struct MemPfEntry {
+    
+    bool            valid                           = false;
+    uint32_t        key                             = 0;
+    uint32_t        lastTag                         = 0;
+    int32_t         stride                          = 0;
+    uint32_t        confidence                      = 0;
+};
+
+struct MemPfRequest {
+    
+    uint32_t        ofs                             = 0;
+    uint32_t        tag                             = 0;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -429,6 +709,8 @@ struct CpuMem {
     virtual void    process( ) = 0;
     void            clearStats( );
     void            abortOp( );
+    void            skipCycles( uint32_t latencyCycles, uint32_t waitCycles, uint32_t stallCycles );
+    uint32_t        getPendingLatency( );
    
     virtual bool    readWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t *word, uint32_t pri = 0 );
     virtual bool    writeWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t word, uint32_t pri = 0 );
@@ -443,8 +725,13 @@ struct CpuMem {
     uint8_t         *getMemBlockEntry( uint32_t index, uint8_t set = 0 );
     uint32_t        getMemDataWord( uint32_t ofs, uint8_t set = 0 );
     void            putMemDataWord( uint32_t ofs, uint32_t val, uint8_t set = 0 );
+    void            putMemDataBlock( uint32_t adr, uint8_t *buf, uint32_t len );
+    void            putMemDataBlock( uint32_t ofs, uint32_t adrTag, uint8_t *buf, uint32_t len );
+    void            flushAllBlocks( );
+    bool            warmBlock( uint32_t ofs, uint32_t adrTag, uint8_t *memData, bool isWrite = false );
     
     uint32_t        getMemSize( );
+    uint32_t        getResidentPages( );
     uint32_t        getStartAdr( );
     uint32_t        getEndAdr( );
     uint32_t        getBlockEntries( );
@@ -454,6 +741,22 @@ struct CpuMem {
     uint32_t        getDirtyMissCnt( );
     uint32_t        getAccessCnt( );
     uint32_t        getWaitCycleCnt( );
+    uint32_t        getCoherenceMissCnt( );
+    uint32_t        getInvalidateCnt( );
+    uint32_t        getInterventionCnt( );
+    uint32_t        getUpgradeCnt( );
+    uint32_t        getMshrAllocCnt( );
+    uint32_t        getMshrMergeCnt( );
+    uint32_t        getMshrStallCnt( );
+    uint32_t        getMshrPendingCnt( );
+    uint32_t        getPrefetchIssuedCnt( );
+    uint32_t        getPrefetchUsefulCnt( );
+    uint32_t        getPrefetchLateCnt( );
+    uint32_t        getPrefetchPollutionCnt( );
+    uint32_t        getPrefetchQueueCnt( );
+    
+    void            setAccessPc( uint32_t pc );
+    bool            isIdle( );
     
     uint32_t        getMemCtrlReg( uint8_t mReg );
     void            setMemCtrlReg( uint8_t mReg, uint32_t val );
@@ -465,6 +768,19 @@ protected:
     CpuMemDesc      cDesc;
     
     uint16_t        matchTag( uint32_t index, uint32_t tag );
+    uint16_t        selectVictim( uint32_t index );
+    void            touchBlock( uint32_t index, uint16_t set );
+    void            insertBlock( uint32_t index, uint16_t set );
+    void            resetReplState( );
+    
+    void            trainPrefetcher( uint32_t ofs, uint32_t adrTag, MemTagEntry *tagPtr );
+    void            trainStride( uint32_t ofs, uint32_t adrTag );
+    void            trainStream( uint32_t ofs, uint32_t adrTag );
+    void            queuePrefetch( uint32_t ofs, uint32_t adrTag, int32_t delta );
+    bool            nextPrefetch( uint32_t *ofs, uint32_t *adrTag );
+    bool            isPrefetchPending( uint32_t adrTag );
+    void            resetPrefetcher( );
+    bool            isNewAccess( uint32_t ofs, uint32_t adrTag, uint32_t len, bool isWrite );
     
     CpuReg          opState             = 0;
     uint16_t        reqPri              = 0;
@@ -474,6 +790,11 @@ protected:
     uint8_t         *reqPtr             = nullptr;
     uint32_t        reqLen              = 0;
     uint32_t        reqLatency          = 0;
+    bool            reqExclusive        = false;
+    uint16_t        reqResumeState      = 0;
+    bool            reqFillPending      = false;
+    bool            reqPrefetch         = false;
+    bool            reqPrefetchLate     = false;
     
     uint16_t        reqTargetSet        = 0;
     uint32_t        reqTargetBlockIndex = 0;
@@ -486,53 +807,189 @@ protected:
     uint32_t        missCnt             = 0;
     uint32_t        dirtyMissCnt        = 0;
     uint32_t        waitCyclesCnt       = 0;
+    uint32_t        coherenceMissCnt    = 0;
+    uint32_t        invalidateCnt       = 0;
+    uint32_t        interventionCnt     = 0;
+    uint32_t        upgradeCnt          = 0;
+    uint32_t        mshrAllocCnt        = 0;
+    uint32_t        mshrMergeCnt        = 0;
+    uint32_t        mshrStallCnt        = 0;
+    uint32_t        pfIssuedCnt         = 0;
+    uint32_t        pfUsefulCnt         = 0;
+    uint32_t        pfLateCnt           = 0;
+    uint32_t        pfPollutionCnt      = 0;
     
     MemTagEntry     *tagArray[ MAX_BLOCK_SETS ]     = { nullptr };
     uint8_t         *dataArray[ MAX_BLOCK_SETS ]    = { nullptr };
+    bool            dataMapped                      = false;
+    uint32_t        *replArray                      = nullptr;
+    uint32_t        replRandState                   = 1;
+    MemMshrEntry    mshrArray[ MAX_MSHR_ENTRIES ];
+    uint16_t        mshrPendingCnt                  = 0;
+    uint16_t        reqMshr                         = MAX_MSHR_ENTRIES;
+    MemPfEntry      pfTable[ MAX_PREFETCH_ENTRIES ];
+    MemPfRequest    pfQueue[ MAX_PREFETCH_ENTRIES ];
+    uint16_t        pfQueueHead                     = 0;
+    uint16_t        pfQueueCnt                      = 0;
+    uint16_t        pfNextStream                    = 0;
+    uint32_t        accessPc                        = 0;
+    uint32_t        lastAccessOfs                   = 0;
+    uint32_t        lastAccessTag                   = 0;
+    uint32_t        lastAccessPc                    = 0;
+    uint32_t        lastAccessMode                  = 0;
+    bool            accessThisCycle                 = false;
+    bool            accessLastCycle                 = false;
     CpuMem          *lowerMem                       = nullptr;
+    
+    friend struct   CpuCheckpoint;
 };
 
 
 //------------------------------------------------------------------------------------------------------------
 // "L1CacheMem" is the memory object representing the L1 caches. It overrides the word and block access
 // routines of a basic memory object, since it has a data and tag array structure. Also, a read or write
-// word access is severed directly in case of a cache hit.
+// word access is severed directly in case of a cache hit. An L1 data cache of a multi-core system is
+// connected to the snoop bus and answers the snoop requests of the other caches.
 //
 //------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_CPU_CORES = 16;
+
+enum SnoopResult : uint16_t {
+    
+    SNOOP_MISS          = 0,
+    SNOOP_HIT           = 1,
+    SNOOP_HIT_DIRTY     = 2
+};
+
 struct L1CacheMem : CpuMem {
     
     L1CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem );
     
     bool    readWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t len, uint32_t *data, uint32_t pri = 0 );
     bool    writeWord( uint32_t seg, uint32_t ofs, uint32_t len, uint32_t adrTag, uint32_t data, uint32_t pri = 0 );
+    bool    readNextWord( uint32_t ofs, uint32_t adrTag, uint32_t *data );
     
     bool    flushBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t pri = 0 );
     bool    purgeBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t pri = 0 );
 
     void    process( );    
+    void    tick( );
+    
+    void        setSnoopBus( struct CpuSnoopBus *bus );
+    SnoopResult snoop( uint32_t blockAdr, bool invalidate, uint8_t *buf );
+    void        backInvalidate( uint32_t blockAdr );
+    
+private:
+    
+    bool                isCoherenceMiss( uint32_t blockIndex, uint32_t adrTag );
+    uint16_t            findMshr( uint32_t adrTag );
+    uint16_t            allocMshr( uint32_t adrTag, uint32_t blockIndex, bool exclusive );
+    void                mergeMshr( uint16_t mshr, uint32_t adrTag, uint32_t len, uint32_t data );
+    void                startMshr( );
+    void                startPrefetch( );
+    void                enterBlock( );
+    
+    struct CpuSnoopBus  *snoopBus = nullptr;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// "CpuSnoopBus" connects the L1 data caches of a multi-core system. A cache that fills a block or wants to
+// write to a shared block sends its request to the bus, which snoops all other caches. A read request turns
+// the other copies into shared copies, a read for ownership or an upgrade request invalidates them. A cache
+// holding the block modified supplies the data and writes it back to memory. This is the intervention. The
+// bus returns the cycles the request takes on top of the memory access. All bus requests and the writes
+// into the data caches are serialized by the bus lock, since the cores run on their own host threads.
+//
+// The L2 cache of a multi-core system is shared by all cores and attached to the bus as well. It uses the
+// bus lock for its tag and data arrays and invalidates the blocks it replaces in all L1 data caches. An L1
+// data cache already holds the bus lock when it calls the L2 cache, so the lock is a recursive one.
+//
+// ??? the instruction caches do not take part in the protocol.
+//------------------------------------------------------------------------------------------------------------
+struct CpuSnoopBus {
+    
+public:
+    
+    CpuSnoopBus( CpuCoreDesc *cfg );
+    
+    void            attach( L1CacheMem *cache );
+    void            attach( struct L2CacheMem *cache );
+    void            clearStats( );
+    uint32_t        busRead( L1CacheMem *requestor, uint32_t blockAdr, bool exclusive, uint8_t *buf, bool *shared );
+    uint32_t        busUpgrade( L1CacheMem *requestor, uint32_t blockAdr );
+    void            backInvalidate( uint32_t blockAdr );
+    
+    std::recursive_mutex busLock;
+    
+    uint32_t        busReads            = 0;
+    uint32_t        busReadsExclusive   = 0;
+    uint32_t        busUpgrades         = 0;
+    uint32_t        busInvalidations    = 0;
+    uint32_t        busInterventions    = 0;
+    
+private:
+    
+    L1CacheMem      *caches[ MAX_CPU_CORES ]    = { nullptr };
+    uint32_t        numOfCaches                 = 0;
+    uint32_t        snoopLatency                = 0;
+    uint32_t        interventionLatency         = 0;
 };
 
 //------------------------------------------------------------------------------------------------------------
 // "L2CacheMem" is an optional layer between main memory and the L1 caches. It has a data and a tag array.
-// Since it is physically indexed and tagged, there is no need to overwrite the basic block access methods
-// of the base class. The L2 cache state machine will do the tag match handling.
+// Since it is physically indexed and tagged, the block access methods work on physical addresses. They are
+// overridden to arbitrate between the two L1 caches, which share the L2 cache. The L2 cache state machine
+// will do the tag match handling. An inclusive L2 cache knows its L1 caches, so that it can invalidate
+// their copies of a block it replaces.
 //
+// In a multi-core system, each CPU core has its own L2 cache object, which implements the request state
+// machine for the core. Just like for the physical memory, the tag and data arrays are shared with the L2
+// cache object of the system passed to the constructor. The cache objects are attached to the snoop bus.
+// A cache object reads and writes the blocks of the lower layer through its own fill and write back buffer,
+// since the lower layer transfers the data without the bus lock. A filled block is entered into the shared
+// arrays under the bus lock.
 //
 //------------------------------------------------------------------------------------------------------------
 struct L2CacheMem : CpuMem {
     
-    L2CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem );
-   
+    L2CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem, L2CacheMem *sharedL2 = nullptr );
+    
+    bool    readBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri = 0 );
+    bool    writeBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri = 0 );
+    bool    warmBlock( uint32_t ofs, uint32_t adrTag, uint8_t *memData, bool isWrite = false );
+    
+    void    setUpperCaches( L1CacheMem *iCache, L1CacheMem *dCache, bool inclusive );
+    void    setSnoopBus( struct CpuSnoopBus *bus );
     void    process( );
+    
+private:
+    
+    bool    blockRequest( uint16_t op, uint32_t ofs, uint8_t *buf, uint32_t len, uint32_t pri );
+    bool    transferBlock( );
+    void    enterBlock( );
+    void    invalidateUpper( uint32_t adrTag );
+    void    startPrefetch( );
+    
+    L1CacheMem          *upperMem[ 2 ]                  = { nullptr, nullptr };
+    bool                inclusive                       = false;
+    bool                reqDone                         = false;
+    uint32_t            reqWriteBackTag                 = 0;
+    uint8_t             fillBuf[ MAX_BLOCK_SIZE ]       = { 0 };
+    uint8_t             writeBackBuf[ MAX_BLOCK_SIZE ]  = { 0 };
+    struct CpuSnoopBus  *snoopBus                       = nullptr;
+    
+    friend struct       CpuCheckpoint;
 };
 
 //------------------------------------------------------------------------------------------------------------
-// "PhysMem" represents the actual main memory.
+// "PhysMem" represents the actual main memory. In a multi-core system, each CPU core has its own physical
+// memory object, which implements the request state machine for the core. The data array is shared with
+// the physical memory object of the system passed to the constructor.
 //
 //------------------------------------------------------------------------------------------------------------
 struct PhysMem : CpuMem {
     
-    PhysMem( CpuMemDesc *mDesc );
+    PhysMem( CpuMemDesc *mDesc, PhysMem *sharedMem = nullptr );
     
     void    process( );
 };
@@ -543,7 +1000,7 @@ struct PhysMem : CpuMem {
 //------------------------------------------------------------------------------------------------------------
 struct PdcMem : CpuMem {
     
-    PdcMem( CpuMemDesc *mDesc );
+    PdcMem( CpuMemDesc *mDesc, PdcMem *sharedMem = nullptr );
 
     void    process( );
 };
@@ -573,10 +1030,326 @@ struct CpuStatistics {
     
     uint32_t        branchesTaken           = 0;
     uint32_t        branchesMispredicted    = 0;
+    uint32_t        trapsTaken              = 0;
+    
+    uint32_t        operandsForwarded       = 0;
+    uint32_t        dependencyStalls        = 0;
+    
+    uint32_t        pairsIssued             = 0;
+    uint32_t        pairFailFetch           = 0;
+    uint32_t        pairFailFirst           = 0;
+    uint32_t        pairFailSecond          = 0;
+    uint32_t        pairFailDep             = 0;
+    
+    uint32_t        robFullStalls           = 0;
+    uint32_t        iqFullStalls            = 0;
+    uint32_t        lsqFullStalls           = 0;
+    uint32_t        renameStalls            = 0;
+    uint32_t        mshrFullStalls          = 0;
+    uint32_t        loadsForwarded          = 0;
+    uint32_t        missesOverlapped        = 0;
     
     // ??? what else ....
 };
 
+//------------------------------------------------------------------------------------------------------------
+// Sampled simulation statistics. A sampled run alternates between a functional fast forward, a functional
+// warm up of the caches and a detailed pipeline window. Only the detailed windows are measured. For each
+// window, the CPI is added to the sum and the sum of squares, from which the mean and the confidence interval
+// are computed. The cache and TLB counters are the totals of the detailed windows.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_SAMPLE_COUNTERS = 10;
+
+struct CpuSampleStats {
+    
+    uint32_t        samples                 = 0;
+    uint64_t        instrFastForward        = 0;
+    uint64_t        instrWarmUp             = 0;
+    uint64_t        instrDetailed           = 0;
+    uint64_t        cyclesDetailed          = 0;
+    double          cpiSum                  = 0.0;
+    double          cpiSumSquares           = 0.0;
+    
+    uint64_t        iCacheAccess            = 0;
+    uint64_t        iCacheMiss              = 0;
+    uint64_t        dCacheAccess            = 0;
+    uint64_t        dCacheMiss              = 0;
+    uint64_t        iTlbAccess              = 0;
+    uint64_t        iTlbMiss                = 0;
+    uint64_t        dTlbAccess              = 0;
+    uint64_t        dTlbMiss                = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The decoded instruction record. Instead of extracting the instruction fields with bit field operations
+// in each pipeline stage over and over again, the fields are extracted once and kept in this record. The
+// "imm" field holds the immediate value of the instruction, sign extended and shifted as the instruction
+// definition requires. Its meaning therefore depends on the opCode. The "regW" field is the general register
+// the instruction writes, zero if none. It is "regR" for most instructions, but ADDIL always writes R1. The
+// "memRead" and "memWrite" flags tell whether the instruction will access a data memory location in the MA
+// stage.
+//
+//------------------------------------------------------------------------------------------------------------
+struct DecodedInstr {
+
+    uint32_t        instr       = 0;
+    uint32_t        flags       = 0;
+    uint32_t        imm         = 0;
+    uint8_t         opCode      = 0;
+    uint8_t         opMode      = 0;
+    uint8_t         regR        = 0;
+    uint8_t         regA        = 0;
+    uint8_t         regB        = 0;
+    uint8_t         regW        = 0;
+    uint8_t         dwField     = 0;
+    uint8_t         dataLen     = 0;
+    bool            memRead     = false;
+    bool            memWrite    = false;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The decode cache holds decoded instruction records, indexed by the physical address of the instruction.
+// It is a direct mapped table. The FD stage looks up the record after fetching the instruction word and
+// passes the table index down the pipeline. The MA and EX stage use that index to find their record. Since
+// an entry could be replaced while the instruction is still in flight, the record is only used when the
+// instruction word still matches, otherwise it is decoded again. A store to a physical address invalidates
+// the entry for that address. The same word compare covers memory modifications that bypass the pipeline,
+// such as those done by the simulator commands.
+//
+//------------------------------------------------------------------------------------------------------------
+struct DecodeCache {
+
+public:
+
+    DecodeCache( uint32_t entries = 1024 );
+
+    void            reset( );
+    void            clearStats( );
+
+    DecodedInstr    *lookup( uint32_t physAdr, uint32_t instr, uint32_t *index );
+    DecodedInstr    *getDecoded( uint32_t index, uint32_t instr, DecodedInstr *scratch );
+    void            invalidate( uint32_t physAdr, uint32_t len = 4 );
+
+    static void     decode( uint32_t instr, DecodedInstr *dInstr );
+
+    uint32_t        hits;
+    uint32_t        misses;
+    uint32_t        invalidations;
+
+private:
+
+    uint32_t        entries     = 0;
+    DecodedInstr    *decTab     = nullptr;
+    uint32_t        *tagTab     = nullptr;
+    bool            *validTab   = nullptr;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The store buffer sits between the MA stage and the L1 data cache. A store instruction enters its data into
+// the buffer and moves on, the buffer writes the entries to the data cache in FIFO order. An entry is only
+// written in a cycle where the MA stage did not access the data cache itself. A load first looks at the
+// buffer. When the youngest entry that overlaps the load covers all of its bytes, the data is forwarded from
+// that entry. A partial overlap waits until the entry has been written. Instructions that need all earlier
+// stores to be done, i.e. a fence, wait for an empty buffer. After a trap was taken, the first instruction
+// of the trap handler is fetched when the buffer is empty. With zero entries, there is no store buffer.
+//
+//------------------------------------------------------------------------------------------------------------
+enum StoreFwdResult : uint32_t {
+    
+    SB_FWD_NONE                 = 0,
+    SB_FWD_HIT                  = 1,
+    SB_FWD_CONFLICT             = 2
+};
+
+struct StoreBufferEntry {
+    
+    uint32_t        seg;
+    uint32_t        ofs;
+    uint32_t        adr;
+    uint32_t        len;
+    uint8_t         data[ 4 ];
+};
+
+struct StoreBuffer {
+    
+public:
+    
+    StoreBuffer( struct CpuCore *core, uint32_t entries );
+    
+    void            reset( );
+    void            clearStats( );
+    void            process( );
+    void            skipCycles( uint64_t occupancy, uint32_t fullStalls, uint32_t conflictStalls, uint32_t fenceStalls );
+    
+    bool            isEnabled( );
+    bool            isEmpty( );
+    bool            isTrapDrain( );
+    
+    bool            addStore( uint32_t seg, uint32_t ofs, uint32_t adr, uint32_t len, uint32_t word );
+    StoreFwdResult  forwardLoad( uint32_t adr, uint32_t len, uint32_t *word );
+    bool            fence( );
+    void            setPortBusy( );
+    void            trapEntry( );
+    void            flushAll( );
+    
+    uint32_t        getOccupancy( );
+    uint32_t        getMaxOccupancy( );
+    uint64_t        getOccupancySum( );
+    uint32_t        getStoreCnt( );
+    uint32_t        getDrainCnt( );
+    uint32_t        getForwardCnt( );
+    uint32_t        getFullStallCnt( );
+    uint32_t        getConflictStallCnt( );
+    uint32_t        getFenceStallCnt( );
+    
+private:
+    
+    friend struct   CpuCheckpoint;
+    
+    StoreBufferEntry *getEntry( uint32_t i );
+    
+    struct CpuCore  *core               = nullptr;
+    uint32_t        entries             = 0;
+    uint32_t        head                = 0;
+    uint32_t        count               = 0;
+    uint32_t        added               = 0;
+    bool            portBusy            = false;
+    bool            trapDrain           = false;
+    
+    StoreBufferEntry entryArray[ MAX_STORE_BUF_ENTRIES ];
+    
+    uint64_t        occupancySum        = 0;
+    uint32_t        maxOccupancy        = 0;
+    uint32_t        storeCnt            = 0;
+    uint32_t        drainCnt            = 0;
+    uint32_t        forwardCnt          = 0;
+    uint32_t        fullStallCnt        = 0;
+    uint32_t        conflictStallCnt    = 0;
+    uint32_t        fenceStallCnt       = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor is part of the FD stage and decides on the next instruction address to fetch after a
+// branch. For the conditional branches, the direction comes from the bimodal, gshare or TAGE-lite predictor,
+// the target is computed from the instruction offset. The unconditional branch B is always taken to its
+// offset. A BR or BV instruction takes its target from the branch target buffer, a BV without a link
+// register is a procedure return and takes the target from the return address stack. A branch with a link
+// register is a call and pushes the return address. The external branches BE, BVE and the GATE instruction
+// change the segment and are not predicted. They are resolved in the MA stage as before.
+//
+// The predictor state is updated speculatively in the FD stage. The EX stage updates a second copy of the
+// global history and the return address stack when a branch completes. When the pipeline is flushed, the
+// speculative copy is set to the completed one. The work of an FD stage cycle that is stalled or flushed
+// by a later stage is undone right away. The direction tables are updated when the branch completes, the
+// branch target buffer when the MA stage computed the target.
+//
+// The source of a target prediction, the branch target buffer or the return address stack, is kept in a
+// small queue until the branch completes. The hit counters are only updated then, so that wrong path fetches
+// are not counted.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_TAGE_TABLES      = 4;
+const uint32_t MAX_PEND_BRANCHES    = 4;
+
+enum BranchPredSrc : uint8_t {
+    
+    BP_SRC_NONE                 = 0,
+    BP_SRC_BTB                  = 1,
+    BP_SRC_RAS                  = 2
+};
+
+struct BtbEntry {
+    
+    bool            valid;
+    uint32_t        adr;
+    uint32_t        target;
+};
+
+struct TageEntry {
+    
+    uint16_t        tag;
+    int8_t          ctr;
+    uint8_t         useful;
+};
+
+struct BranchPredictor {
+    
+public:
+    
+    BranchPredictor( struct CpuCore *core, BranchPredDesc *bDesc );
+    
+    void            reset( );
+    void            clearStats( );
+    void            tick( );
+    
+    bool            isEnabled( );
+    bool            predictCond( uint32_t adr, bool hint );
+    uint32_t        predictTarget( uint32_t adr, DecodedInstr *dInstr );
+    void            resolveTarget( uint32_t adr, DecodedInstr *dInstr, uint32_t target, bool mispredicted );
+    void            commitCond( uint32_t adr, bool taken, bool mispredicted );
+    void            commitBranch( uint32_t adr, DecodedInstr *dInstr );
+    void            squashFetch( );
+    void            recover( );
+    
+    uint32_t        getCondPredictCnt( );
+    uint32_t        getTargetPredictCnt( );
+    uint32_t        getBtbHitCnt( );
+    uint32_t        getRasHitCnt( );
+    
+private:
+    
+    friend struct   CpuCheckpoint;
+    
+    bool            lookupDirection( uint32_t adr, uint32_t hist );
+    void            updateDirection( uint32_t adr, uint32_t hist, bool taken );
+    uint32_t        phtIndex( uint32_t adr, uint32_t hist );
+    uint32_t        tageIndex( uint32_t adr, uint32_t hist, uint32_t table );
+    uint32_t        tageTag( uint32_t adr, uint32_t hist, uint32_t table );
+    int             tageProvider( uint32_t adr, uint32_t hist, int *altProvider );
+    void            saveUndo( );
+    void            pushPending( uint32_t adr, BranchPredSrc src );
+    
+    struct CpuCore  *core               = nullptr;
+    BranchPredDesc  bpDesc;
+    
+    uint32_t        phtBits             = 0;
+    uint32_t        tageBits            = 0;
+    uint32_t        histMask            = 0;
+    uint8_t         *pht                = nullptr;
+    TageEntry       *tage[ MAX_TAGE_TABLES ] = { nullptr };
+    BtbEntry        *btb                = nullptr;
+    
+    uint32_t        specHist            = 0;
+    uint32_t        commitHist          = 0;
+    uint32_t        specRas[ MAX_RAS_ENTRIES ];
+    uint32_t        commitRas[ MAX_RAS_ENTRIES ];
+    uint32_t        specRasTop          = 0;
+    uint32_t        specRasCnt          = 0;
+    uint32_t        commitRasTop        = 0;
+    uint32_t        commitRasCnt        = 0;
+    
+    uint32_t        pendAdr[ MAX_PEND_BRANCHES ];
+    uint8_t         pendSrc[ MAX_PEND_BRANCHES ];
+    uint32_t        pendHead            = 0;
+    uint32_t        pendCnt             = 0;
+    
+    bool            undoValid           = false;
+    uint32_t        undoHist            = 0;
+    uint32_t        undoRasTop          = 0;
+    uint32_t        undoRasCnt          = 0;
+    uint32_t        undoRasEntry        = 0;
+    uint32_t        undoPendHead        = 0;
+    uint32_t        undoPendCnt         = 0;
+    
+    uint32_t        condPredictCnt      = 0;
+    uint32_t        condMispredictCnt   = 0;
+    uint32_t        targetPredictCnt    = 0;
+    uint32_t        targetMispredictCnt = 0;
+    uint32_t        btbHitCnt           = 0;
+    uint32_t        rasHitCnt           = 0;
+};
+
 //------------------------------------------------------------------------------------------------------------
 // The CPU24 pipeline stages file represent the CPU24 processor pipeline. It is a three stage pipeline. The
 // details of each stage are described in the declaration section for each stage in the object declaration.
@@ -585,6 +1358,21 @@ struct CpuStatistics {
 //  MA  - memory access
 //  EX  - execute
 //
+// With an issue width of two, the FD stage looks at the instruction following the one just fetched. When it
+// is in the same instruction cache block and the pairing rules are met, both instructions enter the pipeline
+// together. The second one travels in its own instruction pipeline register and is executed in the second
+// EX lane right after the first one. The pairing result records why no pair was formed.
+//
+//------------------------------------------------------------------------------------------------------------
+enum PairResult : uint32_t {
+    
+    PAIR_OK                     = 0,
+    PAIR_FAIL_FETCH             = 1,
+    PAIR_FAIL_FIRST             = 2,
+    PAIR_FAIL_SECOND            = 3,
+    PAIR_FAIL_DEP               = 4
+};
+
 //------------------------------------------------------------------------------------------------------------
 // The instruction fetch and decode stage will retrieve the next instruction. The instruction address to be
 // used is read from the instruction address register address. Depending on whether code address translation
@@ -629,12 +1417,18 @@ public:
     bool            dependencyValB( uint32_t regId );
     bool            dependencyValX( uint32_t regId );
     bool            dependencyValST( );
+    bool            consumesValA( );
     bool            consumesValB( );
     bool            consumesValX( );
+    bool            dependsOn( DecodedInstr *producer );
+    bool            consumesResult( DecodedInstr *producer );
+    bool            isPairIssued( );
+    void            squashPair( );
     
     CpuReg          psPstate0;
     CpuReg          psPstate1;
     uint32_t        instr;
+    DecodedInstr    *dInstr;
    
     uint32_t        instrFetched;
     uint32_t        instrLoad;
@@ -645,8 +1439,17 @@ public:
     
 private:
     
-    struct CpuCore  *core   = nullptr;
-    bool            stalled = false;
+    PairResult      pairSecondInstr( uint32_t physAdr, uint32_t *instr2, uint32_t *decIndex2 );
+    bool            canIssueFirst( );
+    bool            canIssueSecond( DecodedInstr *dInstr2 );
+    void            countPairResult( );
+    
+    struct CpuCore  *core       = nullptr;
+    bool            stalled     = false;
+    bool            pairIssued  = false;
+    bool            pairChecked = false;
+    PairResult      pairResult  = PAIR_OK;
+    DecodedInstr    decScratch;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -696,13 +1499,21 @@ public:
     bool            dependencyValB( uint32_t regId );
     bool            dependencyValX( uint32_t regId );
     bool            dependencyValST( );
+    bool            hasEarlyResult( );
+    void            forwardResult( );
+    
+    DecodedInstr    *getDecoded( );
+    DecodedInstr    *getDecoded2( );
     
     CpuReg          psPstate0;
     CpuReg          psPstate1;
     CpuReg          psInstr;
+    CpuReg          psDecIndex;
     CpuReg          psValA;
     CpuReg          psValB;
     CpuReg          psValX;
+    CpuReg          psInstr2;
+    CpuReg          psDecIndex2;
     
     uint32_t        instrPrivLevel;
     uint32_t        trapsRaised;
@@ -711,6 +1522,8 @@ private:
     
     struct CpuCore  *core       = nullptr;
     bool            stalled     = false;
+    DecodedInstr    decScratch;
+    DecodedInstr    decScratch2;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -744,12 +1557,18 @@ public:
                                   uint32_t  p2 = 0,
                                   uint32_t  p3 = 0 );
     
+    DecodedInstr    *getDecoded( );
+    DecodedInstr    *getDecoded2( );
+    
     CpuReg          psPstate0;
     CpuReg          psPstate1;
     CpuReg          psInstr;
+    CpuReg          psDecIndex;
     CpuReg          psValA;
     CpuReg          psValB;
     CpuReg          psValX;
+    CpuReg          psInstr2;
+    CpuReg          psDecIndex2;
 
     uint32_t        instrExecuted;
     uint32_t        branchesTaken;
@@ -758,8 +1577,459 @@ public:
     
 private:
     
+    void            executeSecondLane( );
+    void            bypassResult( uint32_t regId );
+    
     CpuCore         *core       = nullptr;
     bool            stalled     = false;
+    DecodedInstr    decScratch;
+    DecodedInstr    decScratch2;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The level of the memory hierarchy that held an instruction or data block, as found by the cache warm up of
+// the functional engine. Uncached accesses count as memory accesses.
+//
+//------------------------------------------------------------------------------------------------------------
+enum MemLevel : uint32_t {
+    
+    MEM_LEVEL_NONE      = 0,
+    MEM_LEVEL_L1        = 1,
+    MEM_LEVEL_L2        = 2,
+    MEM_LEVEL_MEM       = 3
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The functional engine is the fast alternative to the pipeline stages. It executes one instruction per
+// step directly on the architectural state, i.e. the FD stage PSW and the register sets of the CPU core.
+// There are no pipeline registers, stalls or cycle counts. Traps are recorded the same way as the pipeline
+// stages do and are taken right away. Optionally, the engine enters the blocks it accesses into the caches,
+// so that a switch to the pipeline does not start with cold caches. While doing so, the engine records the
+// instruction executed last and the memory hierarchy levels of its accesses for the out-of-order core model.
+//
+//------------------------------------------------------------------------------------------------------------
+struct FunctionalEngine {
+    
+public:
+    
+    FunctionalEngine( struct CpuCore *core );
+    
+    void            reset( );
+    void            clearStats( );
+    void            step( );
+    void            execute( uint32_t instr );
+    
+    void            setupTrapData( uint32_t trapId,
+                                  uint32_t psw0,
+                                  uint32_t psw1,
+                                  uint32_t p1 = 0,
+                                  uint32_t p2 = 0,
+                                  uint32_t p3 = 0 );
+    
+    bool            checkProtectId( uint16_t segId );
+    void            setCacheWarming( bool arg );
+    
+    uint32_t        instrExecuted;
+    uint32_t        branchesTaken;
+    uint32_t        trapsRaised;
+    
+private:
+    
+    void            raiseTrap( uint32_t trapId, uint32_t p1 = 0, uint32_t p2 = 0, uint32_t p3 = 0 );
+    void            storePsw( );
+    uint32_t        lookupInstrAdr( uint32_t *physAdr );
+    bool            fetchInstr( uint32_t *instr );
+    uint32_t        selectSeg( uint32_t instr, uint32_t ofs );
+    bool            translateDataAdr( uint32_t instr, uint32_t seg, uint32_t ofs, bool isWrite, uint32_t *physAdr );
+    uint8_t         *mapPhysAdr( uint32_t physAdr, uint32_t len );
+    bool            readData( uint32_t instr, uint32_t seg, uint32_t ofs, uint32_t len, uint32_t *word );
+    bool            writeData( uint32_t instr, uint32_t seg, uint32_t ofs, uint32_t len, uint32_t word );
+    uint32_t        warmCaches( CpuMem *l1Cache, uint32_t ofs, uint32_t physAdr, bool isWrite = false );
+    
+    struct CpuCore  *core           = nullptr;
+    uint32_t        psw0            = 0;
+    uint32_t        psw1            = 0;
+    bool            trapped         = false;
+    bool            cacheWarming    = false;
+    
+    uint32_t        lastInstr       = NOP_INSTR;
+    uint32_t        instrLevel      = MEM_LEVEL_NONE;
+    uint32_t        dataLevel       = MEM_LEVEL_NONE;
+    uint32_t        dataPhysAdr     = 0;
+    
+    friend struct   ThreadedEngine;
+    friend struct   OooEngine;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The threaded engine is a faster variant of the functional engine. Instead of decoding each instruction on
+// every execution, a basic block of instructions is translated once into an array of operation records.
+// Each record holds the handler routine for the instruction and the operand fields already extracted. A
+// block ends with a branch type instruction, at a page boundary or when the maximum block size is reached.
+// Executing a block is then a simple loop calling the handlers one after the other. The common ALU and
+// immediate instructions have their own handlers, all others are passed to the functional engine. At the
+// end of a block, the block remembers its successor blocks for the fall through and the branch taken case,
+// so that the next block is in most cases found without a block table lookup.
+//
+// The blocks are identified by the physical address of the first instruction. The instruction address is
+// translated on every block entry, TLB changes therefore need no special treatment. Stores to a page that
+// holds translated code, however, flush all translated blocks.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_TC_BLOCK_OPS     = 32;
+const uint32_t MAX_TC_BLOCKS        = 1024;
+
+struct ThreadedEngine;
+struct JitEngine;
+
+typedef uint32_t ( *JitBlockFn )( );
+
+struct TcOp {
+    
+    bool            ( *handler )( ThreadedEngine *tc, TcOp *op );
+    uint32_t        instr;
+    uint32_t        ofs;
+    uint32_t        imm;
+    uint8_t         regR;
+    uint8_t         regA;
+    uint8_t         regB;
+    bool            useImm;
+    bool            optA;
+    bool            optB;
+};
+
+struct TcBlock {
+    
+    bool            valid;
+    uint32_t        physAdr;
+    uint32_t        numOps;
+    uint32_t        execCount;
+    JitBlockFn      jitCode;
+    TcBlock         *link[ 2 ];
+    TcOp            ops[ MAX_TC_BLOCK_OPS ];
+};
+
+struct ThreadedEngine {
+    
+public:
+    
+    ThreadedEngine( struct CpuCore *core );
+    
+    void            reset( );
+    void            clearStats( );
+    void            flush( );
+    void            invalidate( uint32_t physAdr, uint32_t len );
+    void            setJitEnabled( bool val );
+    uint32_t        run( uint32_t numOfInstr );
+    
+    uint32_t        blocksTranslated;
+    uint32_t        blocksExecuted;
+    uint32_t        blocksChained;
+    uint32_t        flushes;
+    
+    struct JitEngine        *jit            = nullptr;
+    
+private:
+    
+    TcBlock         *lookupBlock( uint32_t physAdr );
+    TcBlock         *translate( uint32_t physAdr );
+    void            singleStep( );
+    
+    static bool     opGeneric( ThreadedEngine *tc, TcOp *op );
+    static bool     opAdd( ThreadedEngine *tc, TcOp *op );
+    static bool     opSub( ThreadedEngine *tc, TcOp *op );
+    static bool     opAnd( ThreadedEngine *tc, TcOp *op );
+    static bool     opOr( ThreadedEngine *tc, TcOp *op );
+    static bool     opXor( ThreadedEngine *tc, TcOp *op );
+    static bool     opLdil( ThreadedEngine *tc, TcOp *op );
+    static bool     opAddil( ThreadedEngine *tc, TcOp *op );
+    static bool     opLdo( ThreadedEngine *tc, TcOp *op );
+    
+    struct CpuCore          *core           = nullptr;
+    struct FunctionalEngine *fn             = nullptr;
+    CpuRegFile              *gReg           = nullptr;
+    TcBlock                 *blockTab       = nullptr;
+    bool                    *codePageTab    = nullptr;
+    uint32_t                codePages       = 0;
+    uint32_t                generation      = 0;
+    uint32_t                blockIa         = 0;
+    bool                    jitEnabled      = false;
+    
+    friend struct   JitEngine;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The JIT engine compiles the hot blocks of the threaded engine into host machine code. A block becomes hot
+// after it was executed a number of times by the threaded engine. The generated code works directly on the
+// CPU core general registers and on the working status word of the functional engine. There is no separate
+// copy of the registers, the simulator sees the current state whenever the engine stops. Instructions
+// without an own code sequence, in particular all memory access instructions, call the generic handler of
+// the threaded engine. The compiled block returns the number of instructions executed. The exit flag is set
+// when the block was left before its last instruction or by a branch, trap or status change in the last
+// generic instruction.
+//
+// The code cache is one memory area filled from the start. When it is full, all translations are flushed.
+// The flush of the threaded engine also resets the code cache. The code cache pages are either writable or
+// executable, never both. Code generation is only available on x86-64 hosts with a POSIX or Windows memory
+// mapping interface. On other hosts, "compile" does nothing and the blocks just stay with the threaded engine.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t JIT_HOT_THRESHOLD    = 16;
+const uint32_t JIT_CODE_CACHE_SIZE  = 4 * 1024 * 1024;
+const uint32_t JIT_MAX_BLOCK_BYTES  = MAX_TC_BLOCK_OPS * 96 + 64;
+const uint32_t JIT_EXIT_FLAG        = 0x80000000;
+
+struct JitEngine {
+    
+public:
+    
+    JitEngine( ThreadedEngine *tc, CpuRegFile *gReg, uint32_t *psw0 );
+    
+    void            reset( );
+    void            clearStats( );
+    bool            isAvailable( );
+    bool            compile( TcBlock *blk );
+    
+    uint32_t        blocksCompiled;
+    uint32_t        cacheFlushes;
+    
+private:
+    
+    void            emitByte( uint8_t val );
+    void            emitWord( uint32_t val );
+    void            emitAdr( void *adr );
+    void            emitLoadReg( uint8_t hostReg, uint8_t regId );
+    void            emitStoreReg( uint8_t regId );
+    void            emitLoadOperands( TcOp *op );
+    void            emitSetCarry( uint8_t setCcOp );
+    void            emitExit( uint32_t retVal );
+    bool            emitOp( TcOp *op, uint32_t index );
+    
+    ThreadedEngine  *tc             = nullptr;
+    CpuRegFile      *gReg           = nullptr;
+    uint32_t        *psw0           = nullptr;
+    uint8_t         *codeCache      = nullptr;
+    uint8_t         *codePtr        = nullptr;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The out-of-order engine is the timing model of an out-of-order implementation of VCPU32. Instructions are
+// fetched in program order, renamed and placed into the reorder buffer and an issue queue, issued to the
+// function units when their source operands are available and committed in program order. The renaming
+// covers the general registers and the carry and divide step status bits, which are renamed as one extra
+// register. Register zero always reads zero and is not renamed. Loads and stores in addition occupy a
+// load/store queue entry. A load is served from the youngest older store to the same word, otherwise from
+// the data cache. Since all addresses are known, there is no memory dependence speculation. Data cache misses
+// to different blocks are handled in parallel, up to the number of MSHR entries of the L1 data cache, a load
+// to a block with a miss outstanding waits for that miss.
+//
+// The instructions are executed by the functional engine when they are fetched, which is the same approach
+// an "execute at dispatch" simulator takes. The out-of-order engine then only needs to compute when each
+// instruction can issue and complete, the results and the memory addresses are already known. The functional
+// engine runs with cache warming enabled and records the memory hierarchy level that held the instruction
+// and the data, from which the engine derives the access latency. Fetch continues past a correctly predicted
+// branch. A mispredicted branch stops the fetch until it is resolved, plus the redirect penalty. A trap is
+// recorded by "setupTrapData" of the functional engine just as for the pipeline. It stops the fetch until
+// the trapping instruction commits, the trap handler is then fetched after the redirect penalty. Control
+// instructions are executed alone, they wait for the reorder buffer to drain and block the fetch until they
+// commit.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t OOO_ARCH_REGS        = MAX_GREGS + 1;
+const uint32_t OOO_STATUS_REG       = MAX_GREGS;
+const uint32_t OOO_MAX_SRC_REGS     = 4;
+const uint32_t OOO_MAX_DST_REGS     = 2;
+
+struct OooRobEntry {
+    
+    uint32_t        seqNum          = 0;
+    uint32_t        instr           = 0;
+    uint32_t        memAdr          = 0;
+    uint32_t        memLevel        = MEM_LEVEL_NONE;
+    uint32_t        fetchCycle      = 0;
+    uint32_t        doneCycle       = 0;
+    uint8_t         srcReg[ OOO_MAX_SRC_REGS ];
+    uint8_t         dstReg[ OOO_MAX_DST_REGS ];
+    uint16_t        srcTag[ OOO_MAX_SRC_REGS ];
+    uint16_t        dstTag[ OOO_MAX_DST_REGS ];
+    uint16_t        prevTag[ OOO_MAX_DST_REGS ];
+    uint8_t         numSrc          = 0;
+    uint8_t         numDst          = 0;
+    bool            isLoad          = false;
+    bool            isStore         = false;
+    bool            issued          = false;
+    bool            taken           = false;
+    bool            redirect        = false;
+    bool            serialize       = false;
+    bool            trapped         = false;
+};
+
+struct OooMissEntry {
+    
+    uint32_t        blockAdr        = 0;
+    uint32_t        doneCycle       = 0;
+};
+
+struct OooEngine {
+    
+public:
+    
+    OooEngine( struct CpuCore *core, OooDesc *oDesc );
+    
+    void            reset( );
+    uint32_t        cycle( uint32_t maxCommit = UINT32_MAX );
+    uint32_t        drain( );
+    
+private:
+    
+    uint32_t        commit( uint32_t maxCommit );
+    void            issue( );
+    void            dispatch( );
+    void            fetchInstr( );
+    bool            allocate( OooRobEntry *ePtr );
+    void            decodeRegs( OooRobEntry *ePtr, DecodedInstr *dInstr );
+    void            predictBranch( OooRobEntry *ePtr, DecodedInstr *dInstr, uint32_t adr, uint32_t nextAdr );
+    bool            operandsReady( OooRobEntry *ePtr );
+    bool            issueLoad( uint32_t pos, OooRobEntry *ePtr );
+    uint32_t        accessLatency( uint32_t level );
+    OooRobEntry     *robEntry( uint32_t pos );
+    
+    struct CpuCore  *core           = nullptr;
+    OooDesc         oDesc;
+    
+    OooRobEntry     *rob            = nullptr;
+    uint32_t        robHead         = 0;
+    uint32_t        robCount        = 0;
+    uint32_t        aluIqCount      = 0;
+    uint32_t        memIqCount      = 0;
+    uint32_t        lsqCount        = 0;
+    
+    uint16_t        renameMap[ OOO_ARCH_REGS ];
+    uint16_t        *freeList       = nullptr;
+    uint32_t        freeCount       = 0;
+    uint32_t        *regReadyCycle  = nullptr;
+    
+    OooMissEntry    *missTab        = nullptr;
+    uint32_t        missEntries     = 0;
+    uint32_t        blockSize       = 0;
+    
+    OooRobEntry     fetchBuf;
+    bool            fetchValid      = false;
+    bool            fetchBlocked    = false;
+    uint32_t        blockSeqNum     = 0;
+    uint32_t        fetchStallEnd   = 0;
+    uint32_t        nextSeqNum      = 0;
+    uint32_t        curCycle        = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU core can execute instructions either with the cycle level pipeline model, with the functional
+// engine or with the threaded engine, optionally compiling hot blocks with the JIT engine. The mode can be
+// switched at any time between steps.
+//
+//------------------------------------------------------------------------------------------------------------
+enum ExecMode : uint32_t {
+    
+    EXEC_MODE_PIPELINE      = 0,
+    EXEC_MODE_FUNCTIONAL    = 1,
+    EXEC_MODE_THREADED      = 2,
+    EXEC_MODE_JIT           = 3
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The phases of a sampled run. See "sampledStep" in the CPU core for details.
+//
+//------------------------------------------------------------------------------------------------------------
+enum SamplePhase : uint32_t {
+    
+    SAMPLE_PHASE_FAST_FORWARD   = 0,
+    SAMPLE_PHASE_WARM_UP        = 1,
+    SAMPLE_PHASE_DETAILED       = 2
+};
+
+//------------------------------------------------------------------------------------------------------------
+// A checkpoint is the complete state of the CPU core written to a binary file. It contains the registers,
+// the pipeline registers, the store buffer, the TLB and cache arrays, the memory contents, any pending memory
+// or TLB request and the statistics. Restoring a checkpoint puts the CPU core into exactly the state it had
+// when the checkpoint was taken, which is much faster than executing a program up to this point again. The
+// CPU core configuration is part of the checkpoint, a checkpoint can only be restored into a CPU core with
+// the same configuration. The decode cache and the translated code blocks are not saved, they are just
+// rebuilt. The instructions in flight in the out-of-order core model are not saved either, a restored CPU
+// core starts with an empty reorder buffer.
+//
+// The file starts with a header and a version number. The memory data arrays are written in pages and only
+// pages that are not all zeroes are stored. The stored pages start at a page boundary in the file. For the
+// restore, the file is mapped into memory and the pages are copied from there.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t CKPT_VERSION     = 17;
+const uint32_t CKPT_PAGE_SIZE   = 4096;
+
+struct CpuCheckpoint {
+    
+public:
+    
+    CpuCheckpoint( struct CpuCore *core );
+    
+    bool            save( char *fileName );
+    bool            restore( char *fileName );
+    
+private:
+    
+    void            putData( const void *buf, size_t len );
+    void            putWord( uint32_t val );
+    void            putAlign( );
+    void            putCoreDesc( );
+    void            putSparse( uint8_t *data, uint32_t len );
+    void            putPtr( uint8_t *ptr );
+    void            putReg( CpuReg *reg );
+    void            putRegFile( CpuRegFile *regFile );
+    void            putTlb( CpuTlb *tlb );
+    void            putStoreBuffer( StoreBuffer *sBuf );
+    void            putBranchPred( BranchPredictor *bPred );
+    void            putMem( CpuMem *mem );
+    void            putL2Cache( L2CacheMem *mem );
+    
+    void            getData( void *buf, size_t len );
+    uint32_t        getWord( );
+    void            getAlign( );
+    bool            matchCoreDesc( );
+    void            getSparse( uint8_t *data, uint32_t len );
+    uint8_t         *getPtr( );
+    void            getReg( CpuReg *reg );
+    void            getRegFile( CpuRegFile *regFile );
+    void            getTlb( CpuTlb *tlb );
+    void            getStoreBuffer( StoreBuffer *sBuf );
+    void            getBranchPred( BranchPredictor *bPred );
+    void            getMem( CpuMem *mem );
+    void            getL2Cache( L2CacheMem *mem );
+    
+    void            getMemObjects( CpuMem **mem );
+    
+    struct CpuCore  *core       = nullptr;
+    FILE            *outFile    = nullptr;
+    uint8_t         *inBuf      = nullptr;
+    size_t          inSize      = 0;
+    size_t          inPos       = 0;
+    bool            ok          = true;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// The code write log. In a multi-core system, the stores done by the functional engine of a core are
+// remembered, so that the other cores can invalidate their decode cache entries and translated code blocks
+// for these addresses at the end of the quantum. When the log is full, the other cores discard all their
+// translated code blocks instead. The decode cache compares the instruction word anyway.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t MAX_CODE_WRITES = 256;
+
+struct CodeWriteLog {
+    
+    bool            enabled                     = false;
+    bool            overflow                    = false;
+    uint32_t        cnt                         = 0;
+    uint32_t        adr[ MAX_CODE_WRITES ]      = { 0 };
+    uint32_t        len[ MAX_CODE_WRITES ]      = { 0 };
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -776,33 +2046,56 @@ public:
     // The visible part of the CPU24 object.
     //
     //--------------------------------------------------------------------------------------------------------
-    CpuCore( CpuCoreDesc *cfg );
+    CpuCore( CpuCoreDesc *cfg, PhysMem *sharedMem = nullptr, PdcMem *sharedPdc = nullptr, L2CacheMem *sharedL2 = nullptr );
     
     void            reset( );
     void            clearStats( );
     void            clockStep( uint32_t numOfSteps = 1 );
     void            instrStep( uint32_t numOfInstr = 1 );
     
+    void            setExecMode( ExecMode mode );
+    ExecMode        getExecMode( );
+    void            flushTranslations( );
+    void            invalidateCode( uint32_t physAdr, uint32_t len );
+    void            applyCodeWrites( CpuCore *writer );
+    void            clearCodeWrites( );
+    
+    void            setSampling( uint32_t fastForward, uint32_t warmUp, uint32_t window, ExecMode fastMode );
+    void            sampledStep( uint32_t numOfInstr );
+    
+    bool            saveCheckpoint( char *fileName );
+    bool            restoreCheckpoint( char *fileName );
+    
+    void            setStopOnTrap( bool val );
+    bool            isStopped( );
+    void            clearStop( );
+    
     uint32_t        getReg( RegClass regClass, uint8_t regId );
     void            setReg( RegClass regClass, uint8_t regId, uint32_t val );
     
     //--------------------------------------------------------------------------------------------------------
     // The CPU core objects. Since the driver needs access to all of them frequently, we could either have
-    // a ton of getter functions, or make the public. Let's go for the latter
+    // a ton of getter functions, or make the public. Let's go for the latter. In a multi-core system, the
+    // physical memory and PDC objects of the core share their data with the memory objects of the system.
     //
-    // ??? unified cache, physical memory, PDC and IO should be moved out of the core when we have many
-    // cores...
+    // ??? the unified cache and IO should be moved out of the core too...
     //--------------------------------------------------------------------------------------------------------
     CpuTlb          *iTlb       = nullptr;
     CpuTlb          *dTlb       = nullptr;
+    CpuTlb          *uTlbL2     = nullptr;
     L1CacheMem      *iCacheL1   = nullptr;
     L1CacheMem      *dCacheL1   = nullptr;
     L2CacheMem      *uCacheL2   = nullptr;
     PhysMem         *physMem    = nullptr;
     PdcMem          *pdcMem     = nullptr;
     IoMem           *ioMem      = nullptr;
+    DecodeCache     *decodeCache = nullptr;
+    StoreBuffer     *storeBuffer = nullptr;
+    BranchPredictor *branchPred = nullptr;
     
+    CodeWriteLog    codeWrites;
     CpuStatistics   stats;
+    CpuSampleStats  sampleStats;
     
 private:
     
@@ -811,16 +2104,69 @@ private:
     //
     //--------------------------------------------------------------------------------------------------------
     CpuCoreDesc     cpuDesc;
+    ExecMode        execMode    = EXEC_MODE_PIPELINE;
+    bool            stopOnTrap  = false;
+    bool            stopped     = false;
    
-    CpuReg          gReg[ MAX_GREGS ];
-    CpuReg          sReg[ MAX_SREGS ];
-    CpuReg          cReg[ MAX_CREGS ];
+    CpuRegFile      gReg        = CpuRegFile( MAX_GREGS );
+    CpuRegFile      sReg        = CpuRegFile( MAX_SREGS );
+    CpuRegFile      cReg        = CpuRegFile( MAX_CREGS );
     
     //--------------------------------------------------------------------------------------------------------
     // Utility routines.
     //
     //--------------------------------------------------------------------------------------------------------
     void            handleTraps( );
+    void            trapTaken( );
+    
+    //--------------------------------------------------------------------------------------------------------
+    // The pipeline clock step loop. The memory hierarchy is fixed when the CPU core is created. There is an
+    // instance of the loop for each combination of the optional building blocks, which calls the process
+    // and tick routines of the configured objects directly. The instance for our configuration is selected
+    // once by the constructor. When the stalled pipeline just waits for a memory request, the cycles until
+    // the request completes are skipped in one step. The out-of-order core model has its own loop.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    typedef void    ( CpuCore::*ClockStepFn )( uint32_t numOfSteps );
+    
+    template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+    void            pipelineClockStep( uint32_t numOfSteps );
+    
+    template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+    void            pipelineCycle( );
+    
+    template < bool HAS_TLB, bool HAS_L2, bool HAS_IO >
+    uint32_t        skipIdleCycles( uint32_t numOfSteps );
+    
+    void            oooClockStep( uint32_t numOfSteps );
+    
+    uint32_t        pendingMemLatency( );
+    uint32_t        captureCycleState( uint32_t *buf );
+    
+    static ClockStepFn selectClockStep( CpuCoreDesc *cfg, bool hasIo );
+    
+    ClockStepFn     clockStepFn = nullptr;
+    void            functionalStep( uint32_t numOfInstr );
+    void            threadedStep( uint32_t numOfInstr );
+    void            drainPipeLine( );
+    
+    //--------------------------------------------------------------------------------------------------------
+    // Sampled simulation. The phase lengths are in instructions. When a detailed window starts, the counters
+    // are remembered, so that the window can be measured when it ends.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    void            enterSamplePhase( SamplePhase phase );
+    ExecMode        samplePhaseMode( SamplePhase phase );
+    void            endSampleWindow( );
+    void            captureSampleCounters( uint32_t *buf );
+    
+    uint32_t        sampleFastForward       = 0;
+    uint32_t        sampleWarmUp            = 0;
+    uint32_t        sampleWindow            = 1;
+    ExecMode        sampleFastMode          = EXEC_MODE_FUNCTIONAL;
+    SamplePhase     samplePhase             = SAMPLE_PHASE_DETAILED;
+    uint32_t        samplePhaseLeft         = 0;
+    uint32_t        windowStart[ MAX_SAMPLE_COUNTERS ] = { 0 };
     
     //--------------------------------------------------------------------------------------------------------
     // References to other classes. The core needs to have access to the pipeline stages, the virtual and
@@ -831,10 +2177,86 @@ private:
     friend struct   FetchDecodeStage;
     friend struct   MemoryAccessStage;
     friend struct   ExecuteStage;
+    friend struct   FunctionalEngine;
+    friend struct   ThreadedEngine;
+    friend struct   OooEngine;
+    friend struct   CpuCheckpoint;
     
     struct          FetchDecodeStage    *fdStage    = nullptr;
     struct          MemoryAccessStage   *maStage    = nullptr;
     struct          ExecuteStage        *exStage    = nullptr;
+    struct          FunctionalEngine    *fnEngine   = nullptr;
+    struct          ThreadedEngine      *tcEngine   = nullptr;
+    struct          OooEngine           *oooEngine  = nullptr;
+};
+
+//------------------------------------------------------------------------------------------------------------
+// "CpuSystem" is a multi-core system. All CPU cores have the same configuration. Each core has its own
+// pipeline, TLBs and L1 caches. Physical memory, PDC and the optional L2 cache are created once by the
+// system and shared by all cores. Each core has its own memory objects for the request state machines, which
+// work on the shared data arrays. Contention between the cores for the memory is not modelled.
+//
+// With more than one core, the cores run on their own host threads. Core zero runs on the calling thread.
+// The cores synchronize after each quantum of cycles, or instructions when stepping by instructions. Within
+// a quantum, the cores run independently of each other, a store by one core becomes visible to the other
+// cores at some point during the quantum. A smaller quantum brings the cores closer together, at the price
+// of more synchronization. The L1 data caches of the cores are kept coherent through the snoop bus, a block
+// written back by one core is found by the other cores in the shared L2 cache. The stores done by the
+// functional engine of a core invalidate the decode cache entries and translated code blocks of the other
+// cores when the quantum ends.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t DEF_CPU_QUANTUM      = 1000;
+
+struct CpuSystem {
+    
+public:
+    
+    CpuSystem( CpuCoreDesc *cfg, uint32_t numOfCores = 1 );
+    ~CpuSystem( );
+    
+    void            reset( );
+    void            clearStats( );
+    void            clockStep( uint32_t numOfSteps = 1 );
+    void            instrStep( uint32_t numOfInstr = 1 );
+    
+    void            setExecMode( ExecMode mode );
+    void            flushTranslations( );
+    void            setStopOnTrap( bool val );
+    bool            isStopped( );
+    void            clearStop( );
+    
+    void            setQuantum( uint32_t numOfSteps );
+    uint32_t        getQuantum( );
+    uint32_t        getNumOfCores( );
+    CpuCore         *getCore( uint32_t coreId );
+    
+    PhysMem         *physMem    = nullptr;
+    PdcMem          *pdcMem     = nullptr;
+    IoMem           *ioMem      = nullptr;
+    L2CacheMem      *uCacheL2   = nullptr;
+    CpuSnoopBus     *snoopBus   = nullptr;
+    
+private:
+    
+    void            runCores( uint32_t numOfSteps, bool inInstr );
+    void            broadcastCodeWrites( );
+    void            workerLoop( uint32_t coreId );
+    static void     stepCore( CpuCore *core, uint32_t numOfSteps, bool inInstr );
+    
+    CpuCore         *cores[ MAX_CPU_CORES ]     = { nullptr };
+    uint32_t        numOfCores                  = 0;
+    uint32_t        quantum                     = DEF_CPU_QUANTUM;
+    
+    std::thread     workers[ MAX_CPU_CORES ];
+    std::mutex      syncLock;
+    std::condition_variable startCond;
+    std::condition_variable doneCond;
+    uint32_t        quantumId                   = 0;
+    uint32_t        quantumSteps                = 0;
+    bool            quantumInInstr              = false;
+    uint32_t        coresBusy                   = 0;
+    bool            shutdown                    = false;
 };
 
 #endif
@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Decode Cache
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 decode cache. Each pipeline stage needs to know about the fields of the instruction it works
+// on. Extracting these fields with bit field operations in every stage on every clock is a good part of the
+// simulation effort. The decode cache keeps the instruction fields decoded once in a record, indexed by the
+// physical address of the instruction. In a loop, the instructions are decoded on their first execution and
+// from then on the stages just read the record.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Decode Cache
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. Most of the routines are inline functions.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+uint32_t getBit( uint32_t arg, int pos ) {
+    
+    return(( arg & ( 1U << ( 31 - ( pos % 32 )))) ? 1 : 0 );
+}
+
+uint32_t getBitField( uint32_t arg, int pos, int len, bool sign = false ) {
+    
+    pos = pos % 32;
+    len = len % 32;
+    
+    uint32_t tmpM = ( 1U << len ) - 1;
+    uint32_t tmpA = ( arg >> ( 31 - pos )) & tmpM;
+    
+    if (( sign ) && ( tmpA & ( 1U << ( len - 1 )))) return( tmpA | ( ~ tmpM ));
+    else                                            return( tmpA );
+}
+
+uint32_t mapDataLen( uint32_t dwField ) {
+    
+    switch( dwField ) {
+        
+        case 0:     return( 1 );
+        case 1:     return( 2 );
+        case 2:     return( 4 );
+        case 3:     return( 8 );
+        default:    return( 0 );
+    }
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The decode cache object constructor. The number of entries should be a power of two, the index is formed
+// from the word address bits of the physical address.
+//
+//------------------------------------------------------------------------------------------------------------
+DecodeCache::DecodeCache( uint32_t entries ) {
+    
+    this -> entries = entries;
+    
+    decTab      = (DecodedInstr *) calloc( entries, sizeof( DecodedInstr ));
+    tagTab      = (uint32_t *) calloc( entries, sizeof( uint32_t ));
+    validTab    = (bool *) calloc( entries, sizeof( bool ));
+    
+    reset( );
+}
+
+void DecodeCache::reset( ) {
+    
+    for ( uint32_t i = 0; i < entries; i++ ) validTab[ i ] = false;
+    
+    clearStats( );
+}
+
+void DecodeCache::clearStats( ) {
+    
+    hits            = 0;
+    misses          = 0;
+    invalidations   = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "decode" extracts the instruction fields into the decoded record. The register fields and the operand
+// mode are always extracted, whether the instruction uses them or not. The immediate value depends on the
+// instruction and is prepared such that the FD stage can directly pass it to the pipeline registers.
+//
+//------------------------------------------------------------------------------------------------------------
+void DecodeCache::decode( uint32_t instr, DecodedInstr *dInstr ) {
+    
+    uint8_t opCode = getBitField( instr, 5, 6 );
+    
+    dInstr -> instr     = instr;
+    dInstr -> opCode    = opCode;
+    dInstr -> flags     = opCodeTab[ opCode ].flags;
+    dInstr -> opMode    = getBitField( instr, 13, 2 );
+    dInstr -> regR      = getBitField( instr, 9, 4 );
+    dInstr -> regA      = getBitField( instr, 27, 4 );
+    dInstr -> regB      = getBitField( instr, 31, 4 );
+    dInstr -> regW      = ( opCode == OP_ADDIL ) ? 1 : (( dInstr -> flags & REG_R_INSTR ) ? dInstr -> regR : 0 );
+    dInstr -> dwField   = getBitField( instr, 15, 2 );
+    dInstr -> dataLen   = mapDataLen( dInstr -> dwField );
+    dInstr -> imm       = 0;
+    dInstr -> memRead   = false;
+    dInstr -> memWrite  = false;
+    
+    switch ( opCode ) {
+        
+        case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:
+        case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU: {
+            
+            if      ( dInstr -> opMode == OP_MODE_IMM )  dInstr -> imm = getBitField( instr, 31, 18, true );
+            else if ( dInstr -> opMode == OP_MODE_INDX ) dInstr -> imm = getBitField( instr, 27, 12, true );
+            
+            dInstr -> memRead = ( dInstr -> opMode >= OP_MODE_REG_INDX );
+            
+        } break;
+        
+        case OP_ADDIL:
+        case OP_LDIL:   dInstr -> imm = getBitField( instr, 31, 22 ) << 10;             break;
+        
+        case OP_B:
+        case OP_GATE:   dInstr -> imm = getBitField( instr, 31, 22, true ) << 2;        break;
+        
+        case OP_BE:     dInstr -> imm = getBitField( instr, 23, 14, true ) << 2;        break;
+        
+        case OP_CBR:
+        case OP_CBRU:   dInstr -> imm = getBitField( instr, 31, 22, true );             break;
+        
+        case OP_LDO:    dInstr -> imm = getBitField( instr, 27, 18, true );             break;
+        
+        case OP_DEP:    dInstr -> imm = getBitField( instr, 31, 4 );                    break;
+        
+        case OP_MST:    dInstr -> imm = getBitField( instr, 31, 6 );                    break;
+        
+        case OP_BRK:    dInstr -> imm = getBitField( instr, 31, 16 );                   break;
+        
+        case OP_LD:     case OP_LDA:    case OP_LDR: {
+            
+            if (( opCode == OP_LDR ) || ( ! getBit( instr, 10 ))) dInstr -> imm = getBitField( instr, 27, 12, true );
+            dInstr -> memRead = true;
+            
+        } break;
+        
+        case OP_ST:     case OP_STA:    case OP_STC: {
+            
+            if (( opCode == OP_STC ) || ( ! getBit( instr, 10 ))) dInstr -> imm = getBitField( instr, 27, 12, true );
+            dInstr -> memWrite = true;
+            
+        } break;
+        
+        default: ;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "lookup" is called by the FD stage with the physical address of the instruction and the instruction word
+// just fetched. If the entry is valid and matches both, the record is returned right away. Otherwise, the
+// instruction is decoded and the entry is replaced. The index of the entry is returned too, the FD stage
+// passes it along with the instruction to the MA stage.
+//
+//------------------------------------------------------------------------------------------------------------
+DecodedInstr *DecodeCache::lookup( uint32_t physAdr, uint32_t instr, uint32_t *index ) {
+    
+    uint32_t     idx     = ( physAdr >> 2 ) % entries;
+    DecodedInstr *dInstr = &decTab[ idx ];
+    
+    *index = idx;
+    
+    if (( validTab[ idx ] ) && ( tagTab[ idx ] == physAdr ) && ( dInstr -> instr == instr )) {
+        
+        hits ++;
+        return( dInstr );
+    }
+    
+    misses ++;
+    decode( instr, dInstr );
+    tagTab[ idx ]   = physAdr;
+    validTab[ idx ] = true;
+    return( dInstr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "getDecoded" is used by the MA and EX stage with the index passed down the pipeline. When the entry no
+// longer holds the instruction, we decode into the scratch record provided by the caller. This happens for
+// the NOPs inserted on a stall or flush and for entries replaced while the instruction was in flight.
+//
+//------------------------------------------------------------------------------------------------------------
+DecodedInstr *DecodeCache::getDecoded( uint32_t index, uint32_t instr, DecodedInstr *scratch ) {
+    
+    DecodedInstr *dInstr = &decTab[ index % entries ];
+    
+    if ( dInstr -> instr == instr ) return( dInstr );
+    
+    if ( scratch -> instr != instr ) decode( instr, scratch );
+    return( scratch );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A store invalidates all entries for the word addresses covered by the store.
+//
+//------------------------------------------------------------------------------------------------------------
+void DecodeCache::invalidate( uint32_t physAdr, uint32_t len ) {
+    
+    for ( uint32_t adr = physAdr & ( ~ 0x3U ); adr < physAdr + len; adr += 4 ) {
+        
+        uint32_t idx = ( adr >> 2 ) % entries;
+        
+        if (( validTab[ idx ] ) && ( tagTab[ idx ] == adr )) {
+            
+            validTab[ idx ] = false;
+            invalidations ++;
+        }
+    }
+}
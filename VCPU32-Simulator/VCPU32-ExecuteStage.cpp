@@ -129,9 +129,15 @@ void ExecuteStage::reset( )  {
     psPstate0.reset( );
     psPstate1.reset( );
     psInstr.reset( );
+    psDecIndex.reset( );
     psValA.reset( );
     psValB.reset( );
     psValX.reset( );
+    psInstr2.reset( );
+    psDecIndex2.reset( );
+    
+    DecodeCache::decode( NOP_INSTR, &decScratch );
+    DecodeCache::decode( NOP_INSTR, &decScratch2 );
 }
 
 void ExecuteStage::tick( ) {
@@ -141,9 +147,12 @@ void ExecuteStage::tick( ) {
         psPstate0.tick( );
         psPstate1.tick( );
         psInstr.tick( );
+        psDecIndex.tick( );
         psValA.tick( );
         psValB.tick( );
         psValX.tick( );
+        psInstr2.tick( );
+        psDecIndex2.tick( );
     }
 }
 
@@ -182,6 +191,7 @@ void ExecuteStage::flushPipeLine( ) {
     psValA.set( 0 );
     psValB.set( 0 );
     psValX.set( 0 );
+    psInstr2.set( NOP_INSTR );
     core -> maStage -> flushPipeLine( );
 }
 
@@ -201,12 +211,12 @@ void ExecuteStage::setupTrapData( uint32_t trapId,
                                  uint32_t p2,
                                  uint32_t p3 ) {
     
-    core -> cReg[ CR_TRAP_PSW_0 ].set( psw0 );
-    core -> cReg[ CR_TRAP_PSW_1 ].set( psw1 );
-    core -> cReg[ CR_TRAP_PARM_1 ].set( p1 );
-    core -> cReg[ CR_TRAP_PARM_2 ].set( p2 );
-    core -> cReg[ CR_TRAP_PARM_3 ].set( p3 );
-    core -> cReg[ CR_TEMP_1 ].set( trapId );
+    core -> cReg.set( CR_TRAP_PSW_0, psw0 );
+    core -> cReg.set( CR_TRAP_PSW_1, psw1 );
+    core -> cReg.set( CR_TRAP_PARM_1, p1 );
+    core -> cReg.set( CR_TRAP_PARM_2, p2 );
+    core -> cReg.set( CR_TRAP_PARM_3, p3 );
+    core -> cReg.set( CR_TEMP_1, trapId );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -241,6 +251,21 @@ void ExecuteStage::setPipeLineReg( uint32_t pReg, uint32_t val ) {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "getDecoded" returns the decoded record for the instruction in our pipeline register. The index was passed
+// on from the MA stage. "getDecoded2" does the same for the second instruction of a dual issue pair.
+//
+//------------------------------------------------------------------------------------------------------------
+DecodedInstr *ExecuteStage::getDecoded( ) {
+    
+    return( core -> decodeCache -> getDecoded( psDecIndex.get( ), psInstr.get( ), &decScratch ));
+}
+
+DecodedInstr *ExecuteStage::getDecoded2( ) {
+    
+    return( core -> decodeCache -> getDecoded( psDecIndex2.get( ), psInstr2.get( ), &decScratch2 ));
+}
+
 #if 0
 //------------------------------------------------------------------------------------------------------------
 // Some registers are subject to the privilege mode check of the execution thread. Any register can be read
@@ -252,9 +277,9 @@ bool CpuCore::isPrivRegForAccMode( RegClass regClass, uint32_t regId, AccessMode
     
     switch ( regClass ) {
             
-        case RC_GEN_REG_SET:    return( gReg[ regId % 8 ].isPrivReg( ));
-        case RC_SEG_REG_SET:    return( sReg[ regId % 8 ].isPrivReg( ) && mode == ACC_READ_WRITE );
-        case RC_CTRL_REG_SET:   return( cReg[ regId % 32 ].isPrivReg( ) && mode == ACC_READ_WRITE );
+        case RC_GEN_REG_SET:    return( gReg.isPrivReg( regId % 8 ));
+        case RC_SEG_REG_SET:    return( sReg.isPrivReg( regId % 8 ) && mode == ACC_READ_WRITE );
+        case RC_CTRL_REG_SET:   return( cReg.isPrivReg( regId % 32 ) && mode == ACC_READ_WRITE );
         
         default: return( true );
     }
@@ -288,7 +313,9 @@ bool CpuCore::isPrivRegForAccMode( RegClass regClass, uint32_t regId, AccessMode
 // For the CBR conditional branch instruction, we need to evaluate the condition and then compare the result
 // to the branch prediction decision taken in the FD stage. If we mis-predicted the pipeline needs to be
 // flushed and instruction fetching continues from the alternate address passed forward through the pipeline
-// "X" register.
+// "X" register. The predicted address is the other one of the branch target and the next instruction. The
+// branch predictor is trained with the outcome and recovers its speculative state on a misprediction. When
+// a B, BR or BV instruction completes, the branch predictor updates its return address stack.
 //
 // This routine will so far not cause a stall the pipeline but certainly it can trap. When a trap occurs, the
 // pipeline is flushed and the procedure returns right away. This is consistent with the other stages. The
@@ -305,8 +332,9 @@ bool CpuCore::isPrivRegForAccMode( RegClass regClass, uint32_t regId, AccessMode
 //------------------------------------------------------------------------------------------------------------
 void ExecuteStage::process( ) {
     
-    uint32_t            instr       = psInstr.get( );
-    uint8_t             opCode      = getBitField( psInstr.get( ), 5, 6 );
+    DecodedInstr        *dInstr     = getDecoded( );
+    uint32_t            instr       = dInstr -> instr;
+    uint8_t             opCode      = dInstr -> opCode;
    
     MemoryAccessStage   *maStage    = core -> maStage;
     FetchDecodeStage    *fdStage    = core -> fdStage;
@@ -347,14 +375,14 @@ void ExecuteStage::process( ) {
                     }
                 }
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpU );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpU );
                 fdStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 maStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 psPstate0.setBit( ST_CARRY, tmpC );
             }
             else {
                
-                int64_t tmpS = (int64_t) psValA.get( ) + psValB.get( );
+                int64_t tmpS = (int64_t) (int32_t) psValA.get( ) + (int32_t) psValB.get( );
                     
                 if ( opCode == OP_ADC ) {
                         
@@ -372,7 +400,7 @@ void ExecuteStage::process( ) {
                     }
                 }
                     
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpS );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpS );
                 fdStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 maStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 psPstate0.setBit( ST_CARRY, tmpC );
@@ -382,38 +410,49 @@ void ExecuteStage::process( ) {
             
         case OP_ADDIL: {
             
-            core -> gReg[ 1 ].set( psValA.get( ) + psValB.get( ));
+            core -> gReg.set( 1, psValA.get( ) + psValB.get( ));
             
         } break;
             
         case OP_AND: {
             
+            uint32_t valB = psValB.get( );
             uint32_t valR;
             
-            if ( getBit( instr, 11 )) psValB.set( ~ psValB.get( ));
-            valR = psValA.get( ) & psValB.get( );
+            if ( getBit( instr, 11 )) valB = ~ valB;
+            valR = psValA.get( ) & valB;
             if ( getBit( instr, 10 )) valR = ~ valR;
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
-        case OP_B: {
+        case OP_B:  case OP_BR:     case OP_BV: {
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psPstate1.get( ) + 4 );
+            core -> gReg.set( dInstr -> regR, psPstate1.get( ) + 4 );
+            core -> branchPred -> commitBranch( psPstate1.get( ), dInstr );
+            core -> stats.branchesTaken ++;
             
         } break;
             
         case OP_BE: {
             
-            core -> sReg[ 0 ].set( getBitField( psPstate0.get( ), 31, 16 ));
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psPstate1.get( ) + 4 );
+            core -> sReg.set( 0, getBitField( psPstate0.get( ), 31, 16 ));
+            core -> gReg.set( dInstr -> regR, psPstate1.get( ) + 4 );
+            core -> stats.branchesTaken ++;
+            
+        } break;
+            
+        case OP_BVE: {
+            
+            core -> gReg.set( dInstr -> regR, psPstate1.get( ) + 4 );
+            core -> stats.branchesTaken ++;
             
         } break;
             
         case OP_BRK: {
             
-            if (( getBitField( instr, 9, 4 ) != 0 ) || ( getBitField( instr, 31, 16 ) != 0 )) {
+            if (( dInstr -> regR != 0 ) || ( dInstr -> imm != 0 )) {
                 
                 setupTrapData( BREAK_TRAP, psPstate0.get( ), psPstate1.get( ), instr, psValA.get( ), psValB.get( ) );
                 return;
@@ -423,19 +462,27 @@ void ExecuteStage::process( ) {
             
         case OP_CBR:    case OP_CBRU: {
                  
-             bool branchPedict  = getBit( instr, 23 );
-             bool branchTaken   = false;;
+             uint32_t fallThru      = psPstate1.get( ) + 4;
+             uint32_t target        = psPstate1.get( ) + dInstr -> imm;
+             bool     branchTaken   = false;;
              
              if ( opCode == OP_CBR ) branchTaken = compareCond( instr, psValA.get( ), psValB.get( ));
              else                    branchTaken = compareCondU( instr, psValA.get( ), psValB.get( ));
              
-             if ( branchPedict != branchTaken ) {
-                 
-                 // ??? add branch address ?
+             uint32_t predictAdr    = ( psValX.get( ) == fallThru ) ? target : fallThru;
+             uint32_t actualAdr     = ( branchTaken ) ? target : fallThru;
+             bool     mispredicted  = ( predictAdr != actualAdr );
+             
+             core -> branchPred -> commitCond( psPstate1.get( ), branchTaken, mispredicted );
+             if ( branchTaken ) core -> stats.branchesTaken ++;
+             
+             if ( mispredicted ) {
                  
+                 core -> stats.branchesMispredicted ++;
                  core -> fdStage -> psPstate0.set( psPstate0.get( ));
                  core -> fdStage -> psPstate1.set( psValX.get( ));
                  flushPipeLine( );
+                 core -> branchPred -> recover( );
              }
              
          } break;
@@ -443,25 +490,25 @@ void ExecuteStage::process( ) {
         case OP_CMP: {
             
             uint32_t valR = (( compareCond( instr, psValA.get( ), psValB.get( ) )) ? 1 : 0 );
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
         case OP_CMPU: {
             
             uint32_t valR = (( compareCondU( instr, psValA.get( ), psValB.get( ) )) ? 1 : 0 );
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
         case OP_CMR: {
             
             uint32_t valR = (( compareCond( instr, psValA.get( ), psValB.get( ) )) ? 1 : 0 );
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
             if ( testCond( instr, psValB.get( ))) {
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValA.get( ));
+                core -> gReg.set( dInstr -> regR, psValA.get( ));
             }
             
         } break;
@@ -471,14 +518,14 @@ void ExecuteStage::process( ) {
             uint8_t  depOpPos = getBitField( instr, 27, 5 );
             uint8_t  depOpLen = getBitField( instr, 21, 5 );
           
-            if ( getBit( instr, 11 )) depOpPos = core -> cReg[ CR_SHIFT_AMOUNT ].getBitField( 31, 5 );
+            if ( getBit( instr, 11 )) depOpPos = core -> cReg.getBitField( CR_SHIFT_AMOUNT, 31, 5 );
             
             if ( getBit( instr, 10 )) psValA.set( 0 );
             
-            if ( getBit( instr, 12 )) psValA.setBitField( depOpPos, depOpLen, getBitField( instr, 31, 4 ));
+            if ( getBit( instr, 12 )) psValA.setBitField( depOpPos, depOpLen, dInstr -> regB);
             else                      psValA.setBitField( depOpPos, depOpLen, psValB.get( ));
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValA.get( ));
+            core -> gReg.set( dInstr -> regR, psValA.get( ));
           
         } break;
             
@@ -493,12 +540,12 @@ void ExecuteStage::process( ) {
             if ( psPstate0.getBit( ST_DIVIDE_STEP )) {
                 
                 tmp = tmp - psValB.get( );
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmp );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmp );
             }
             else {
                 
                 tmp = tmp + psValB.get( );
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmp );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmp );
                 
                 if ( tmp > UINT32_MAX ) psPstate0.setBit( ST_CARRY );
                 else                    psPstate0.clearBit( ST_CARRY );
@@ -513,10 +560,10 @@ void ExecuteStage::process( ) {
             uint8_t  shAmtLen = getBitField( instr, 21, 5 );
             uint32_t valR;
             
-            if ( getBit( instr, 11 )) shAmtLen =  core -> cReg[ CR_SHIFT_AMOUNT ].getBitField( 31, 5 );
+            if ( getBit( instr, 11 )) shAmtLen =  core -> cReg.getBitField( CR_SHIFT_AMOUNT, 31, 5 );
             
             valR = (( psValA.get( ) >> shAmtLen ) | ( psValB.get( ) << ( WORD_SIZE - shAmtLen )));
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
@@ -526,10 +573,10 @@ void ExecuteStage::process( ) {
              uint8_t  extrOpLen = getBitField( instr, 21, 5 );
              uint32_t valR;
              
-             if ( getBit( instr, 11 )) extrOpPos = core -> cReg[ CR_SHIFT_AMOUNT ].getBitField( 31, 5 );
+             if ( getBit( instr, 11 )) extrOpPos = core -> cReg.getBitField( CR_SHIFT_AMOUNT, 31, 5 );
              
              valR = psValB.getBitField( extrOpPos, extrOpLen, getBit( instr, 10 ));
-             core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+             core -> gReg.set( dInstr -> regR, valR );
              
          } break;
             
@@ -538,7 +585,7 @@ void ExecuteStage::process( ) {
             // ??? the offset was already executed in the previous stage, all we do here is to set the status bit
             // and return the former privilege status.
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValB.get( )); // ??? check when we set R
+            core -> gReg.set( dInstr -> regR, psValB.get( )); // ??? check when we set R
             
         } break;
             
@@ -549,9 +596,9 @@ void ExecuteStage::process( ) {
         case OP_LD:
         case OP_LDA: {
           
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValB.get( ));
-            if ( getBit( instr, 11 ) && ( getBitField( instr, 9, 4 ) != getBitField( instr, 31, 4 )))
-                core -> gReg[ getBitField( instr, 31, 4 ) ].set( psValX.get( ));
+            core -> gReg.set( dInstr -> regR, psValB.get( ));
+            if ( getBit( instr, 11 ) && ( dInstr -> regR != dInstr -> regB))
+                core -> gReg.set( dInstr -> regB, psValX.get( ));
             
         } break;
             
@@ -564,13 +611,13 @@ void ExecuteStage::process( ) {
         case OP_LDIL:
         case OP_LDO: {
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValB.get( ));
+            core -> gReg.set( dInstr -> regR, psValB.get( ));
             
         } break;
             
         case OP_LSID: {
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValB.get( ));
+            core -> gReg.set( dInstr -> regR, psValB.get( ));
           
         } break;
             
@@ -578,10 +625,10 @@ void ExecuteStage::process( ) {
             
             if ( getBit( instr, 10 )) {
                 
-                if ( getBit( instr, 11 ))   core -> sReg[ getBitField( instr, 31, 4 ) ].set( psValB.get( ));
-                else                        core -> cReg[ getBitField( instr, 31, 5  ) ].set( psValB.get( ));
+                if ( getBit( instr, 11 ))   core -> sReg.set( dInstr -> regB, psValB.get( ));
+                else                        core -> cReg.set( getBitField( instr, 31, 5  ), psValB.get( ));
                 
-            } else core -> gReg[ getBitField( instr, 9, 4 ) ].set( psValB.get( ));
+            } else core -> gReg.set( dInstr -> regR, psValB.get( ));
             
         } break;
             
@@ -589,7 +636,7 @@ void ExecuteStage::process( ) {
            
             switch ( getBitField( instr, 11, 2 )) {
                     
-                case 0: fdStage -> psPstate0.setBitField( getBitField( instr, 31, 4 ), 15, 4 ); break;
+                case 0: fdStage -> psPstate0.setBitField( dInstr -> regB, 15, 4 ); break;
                 case 1: fdStage -> psPstate0.orBitField( psValB.getBitField( 31, 4 ), 15, 4 );  break;
                 case 2: fdStage -> psPstate0.andBitField( psValB.getBitField( 31, 4 ), 15, 4 ); break;
                 default: ;
@@ -599,13 +646,14 @@ void ExecuteStage::process( ) {
             
         case OP_OR: {
             
+            uint32_t valB = psValB.get( );
             uint32_t valR;
             
-            if ( getBit( instr, 11 )) psValB.set( ~ psValB.get( ));
-            valR = psValA.get( ) | psValB.get( );
+            if ( getBit( instr, 11 )) valB = ~ valB;
+            valR = psValA.get( ) | valB;
             if ( getBit( instr, 10 )) valR = ~ valR;
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
@@ -619,15 +667,15 @@ void ExecuteStage::process( ) {
          
         case OP_RFI: {
              
-            core -> fdStage -> psPstate0.set( core -> cReg[ CR_TRAP_PSW_0 ].get( ));
-            core -> fdStage -> psPstate1.set( core -> cReg[ CR_TRAP_PSW_1 ].get( ));
+            core -> fdStage -> psPstate0.set( core -> cReg.get( CR_TRAP_PSW_0 ));
+            core -> fdStage -> psPstate1.set( core -> cReg.get( CR_TRAP_PSW_1 ));
              
         } break;
             
         case OP_ST:
         case OP_STA:    {
             
-            if ( getBit( instr, 11 )) core -> gReg[ getBitField( instr, 31, 4 ) ].set( psValX.get( ));
+            if ( getBit( instr, 11 )) core -> gReg.set( dInstr -> regB, psValX.get( ));
             
         } break;
             
@@ -635,7 +683,7 @@ void ExecuteStage::process( ) {
             
             // ??? need to store the result ...
             uint32_t valR = 0;
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
@@ -656,7 +704,7 @@ void ExecuteStage::process( ) {
                     }
                 }
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpU );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpU );
             }
             else {
                 
@@ -671,7 +719,7 @@ void ExecuteStage::process( ) {
                     }
                 }
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpS );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpS );
             }
          
         } break;
@@ -699,14 +747,14 @@ void ExecuteStage::process( ) {
                     }
                 }
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpU );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpU );
                 fdStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 maStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 psPstate0.setBit( ST_CARRY, tmpC );
             }
             else {
                 
-                uint64_t tmpS = (int64_t) psValA.get( ) - psValB.get( );
+                int64_t tmpS = (int64_t) (int32_t) psValA.get( ) - (int32_t) psValB.get( );
                 
                 if ( opCode == OP_SBC ) {
                     
@@ -724,7 +772,7 @@ void ExecuteStage::process( ) {
                     }
                 }
                 
-                core -> gReg[ getBitField( instr, 9, 4 ) ].set((uint32_t) tmpS );
+                core -> gReg.set( dInstr -> regR, (uint32_t) tmpS );
                 fdStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 maStage -> psPstate0.setBit( ST_CARRY, tmpC );
                 psPstate0.setBit( ST_CARRY, tmpC );
@@ -739,7 +787,7 @@ void ExecuteStage::process( ) {
             valR = psValA.get( ) ^ psValB.get( );
             if ( getBit( instr, 10 )) valR = ~ valR;
             
-            core -> gReg[ getBitField( instr, 9, 4 ) ].set( valR );
+            core -> gReg.set( dInstr -> regR, valR );
             
         } break;
             
@@ -750,33 +798,148 @@ void ExecuteStage::process( ) {
         }
     }
     
+    //--------------------------------------------------------------------------------------------------------
+    // The second instruction of a dual issue pair is executed once the first instruction completed without
+    // a trap.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    if ( psInstr2.get( ) != NOP_INSTR ) executeSecondLane( );
+    
     //--------------------------------------------------------------------------------------------------------
     // Bypass logic. We check the instruction currently in the FD or OF stage and "patch" the pipeline
     // register in the OF and EX stage if needed. Again, an instruction that would depend on computed
-    // results in the OF stage, has been stalled already until we can reach it via a bypass.
+    // results in the OF stage, has been stalled already until we can reach it via a bypass. Without operand
+    // forwarding, the FD stage waits for the write back instead and there is nothing to patch. The result
+    // of a second instruction is bypassed the same way.
     //
     //--------------------------------------------------------------------------------------------------------
-    if ( opCodeTab[ opCode ].flags & REG_R_INSTR ) {
-        
-        FetchDecodeStage    *fdStage        = core -> fdStage;
-       
-        uint32_t            regIdForValR    = getBitField( instr, 9, 4 );
-        uint32_t            valR            = core -> gReg[ regIdForValR ].getLatched( );
+    if ( core -> cpuDesc.fwdMode != FWD_MODE_NONE ) {
         
+        bypassResult( dInstr -> regW );
+        if ( psInstr2.get( ) != NOP_INSTR ) bypassResult( getDecoded2( ) -> regW );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "bypassResult" patches the pipeline registers of the instructions in the FD and MA stage that fetched the
+// general register "regId" before the value computed in this cycle is written back. A forwarded operand is
+// only counted when the consuming stage is not stalled. A stalled instruction does not advance with the
+// value and is bypassed again in the next cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void ExecuteStage::bypassResult( uint32_t regId ) {
+    
+    MemoryAccessStage   *maStage        = core -> maStage;
+    FetchDecodeStage    *fdStage        = core -> fdStage;
+    uint32_t            valR            = core -> gReg.getLatched( regId );
+    uint32_t            fwdCountFd      = 0;
+    uint32_t            fwdCountMa      = 0;
+    
 #if 0
-        printf( "FD bypass: Instr: 0x%x -> R%d, Val: 0x%x\n", instr, regIdForValR, valR );
-        printf( "FD - ValA: %d\n", fdStage -> dependencyValA( regIdForValR ));
-        printf( "FD - ValB: %d\n", fdStage -> dependencyValB( regIdForValR ));
-        printf( "FD - ValX: %d\n", fdStage -> dependencyValX( regIdForValR ));
-        printf( "OF - ValA: %d\n", maStage -> dependencyValA( regIdForValR ));
-        printf( "OF - ValB: %d\n", maStage -> dependencyValB( regIdForValR ));
+    printf( "FD bypass: Instr: 0x%x -> R%d, Val: 0x%x\n", psInstr.get( ), regId, valR );
+    printf( "FD - ValA: %d\n", fdStage -> dependencyValA( regId ));
+    printf( "FD - ValB: %d\n", fdStage -> dependencyValB( regId ));
+    printf( "FD - ValX: %d\n", fdStage -> dependencyValX( regId ));
+    printf( "OF - ValA: %d\n", maStage -> dependencyValA( regId ));
+    printf( "OF - ValB: %d\n", maStage -> dependencyValB( regId ));
 #endif
+    
+    if ( fdStage -> dependencyValA( regId )) { maStage -> psValA.set( valR ); fwdCountFd++; }
+    if ( fdStage -> dependencyValB( regId )) { maStage -> psValB.set( valR ); fwdCountFd++; }
+    if ( fdStage -> dependencyValX( regId )) { maStage -> psValX.set( valR ); fwdCountFd++; }
+    
+    if ( maStage -> dependencyValA( regId )) { psValA.set( valR ); fwdCountMa++; }
+    if ( maStage -> dependencyValB( regId )) { psValB.set( valR ); fwdCountMa++; }
+    
+    if ( ! fdStage -> isStalled( )) core -> stats.operandsForwarded += fwdCountFd;
+    if ( ! maStage -> isStalled( )) core -> stats.operandsForwarded += fwdCountMa;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "executeSecondLane" is the second EX lane of the dual issue pipeline. It is a simple ALU for the
+// instructions the FD stage pairs as the second instruction. The operands are read from the general
+// register file right here. All older instructions have written their results, and the FD stage does not
+// pair an instruction that depends on the first instruction of the pair. Just like the first lane, the
+// carry is passed to the instructions behind us.
+//
+//------------------------------------------------------------------------------------------------------------
+void ExecuteStage::executeSecondLane( ) {
+    
+    DecodedInstr        *dInstr2    = getDecoded2( );
+    uint32_t            instr2      = dInstr2 -> instr;
+    uint32_t            valA        = 0;
+    uint32_t            valB        = 0;
+    uint32_t            valR        = 0;
+    
+    if ( dInstr2 -> opMode == OP_MODE_IMM ) {
         
-        if ( fdStage -> dependencyValA( regIdForValR )) maStage -> psValA.set( valR );
-        if ( fdStage -> dependencyValB( regIdForValR )) maStage -> psValB.set( valR );
-        if ( fdStage -> dependencyValX( regIdForValR )) maStage -> psValX.set( valR );
+        valA = core -> gReg.get( dInstr2 -> regR );
+        valB = dInstr2 -> imm;
+    }
+    else {
         
-        if ( maStage -> dependencyValA( regIdForValR )) psValA.set( valR );
-        if ( maStage -> dependencyValB( regIdForValR )) psValB.set( valR );
+        valA = core -> gReg.get( dInstr2 -> regA );
+        valB = core -> gReg.get( dInstr2 -> regB );
+    }
+    
+    switch ( dInstr2 -> opCode ) {
+            
+        case OP_ADD:
+        case OP_SUB: {
+            
+            bool tmpC;
+            
+            if ( getBit( instr2, 10 )) {
+                
+                uint64_t tmpU = ( dInstr2 -> opCode == OP_ADD ) ? (uint64_t) valA + valB
+                                                                : (uint64_t) valA - valB;
+                
+                tmpC = ( dInstr2 -> opCode == OP_ADD ) ? ( tmpU > UINT32_MAX ) : ((int64_t) tmpU < 0 );
+                valR = (uint32_t) tmpU;
+            }
+            else {
+                
+                int64_t tmpS = ( dInstr2 -> opCode == OP_ADD ) ? (int64_t) (int32_t) valA + (int32_t) valB
+                                                               : (int64_t) (int32_t) valA - (int32_t) valB;
+                
+                tmpC = ( tmpS > INT32_MAX ) || ( tmpS < INT32_MIN );
+                valR = (uint32_t) tmpS;
+            }
+            
+            core -> fdStage -> psPstate0.setBit( ST_CARRY, tmpC );
+            core -> maStage -> psPstate0.setBit( ST_CARRY, tmpC );
+            psPstate0.setBit( ST_CARRY, tmpC );
+            
+        } break;
+            
+        case OP_AND: {
+            
+            if ( getBit( instr2, 11 )) valB = ~ valB;
+            valR = valA & valB;
+            if ( getBit( instr2, 10 )) valR = ~ valR;
+            
+        } break;
+            
+        case OP_OR: {
+            
+            if ( getBit( instr2, 11 )) valB = ~ valB;
+            valR = valA | valB;
+            if ( getBit( instr2, 10 )) valR = ~ valR;
+            
+        } break;
+            
+        case OP_XOR: {
+            
+            valR = valA ^ valB;
+            if ( getBit( instr2, 10 )) valR = ~ valR;
+            
+        } break;
+            
+        case OP_CMP:    valR = (( compareCond( instr2, valA, valB )) ? 1 : 0 );   break;
+        case OP_CMPU:   valR = (( compareCondU( instr2, valA, valB )) ? 1 : 0 );  break;
+            
+        default: return;
     }
+    
+    core -> gReg.set( dInstr2 -> regR, valR );
 }
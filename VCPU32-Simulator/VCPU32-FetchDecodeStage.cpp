@@ -88,12 +88,18 @@ FetchDecodeStage::FetchDecodeStage( CpuCore *core ) {
 
 //------------------------------------------------------------------------------------------------------------
 // "reset" and "tick" manage the pipeline register. A "tick" will only update the pipeline register when
-// there is no stall.
+// there is no stall. A stall also undoes the branch predictor update done in this cycle.
 //
 //------------------------------------------------------------------------------------------------------------
 void FetchDecodeStage::reset( )  {
     
-    stalled = false;
+    stalled     = false;
+    pairIssued  = false;
+    pairChecked = false;
+    instr       = NOP_INSTR;
+    
+    DecodeCache::decode( NOP_INSTR, &decScratch );
+    dInstr  = &decScratch;
     
     psPstate0.load( 0 );
     psPstate1.load( 0xF0000000 );
@@ -101,11 +107,22 @@ void FetchDecodeStage::reset( )  {
 
 void FetchDecodeStage::tick( ) {
     
+    //--------------------------------------------------------------------------------------------------------
+    // The status word is latched even when we are stalled. We do not modify it while stalled, but the EX
+    // stage may have passed us a new carry bit. It would be lost otherwise, since the instruction we are
+    // waiting for is passed on with the latched status word once the stall is resolved.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    psPstate0.tick( );
+    
     if ( ! stalled ) {
         
-        psPstate0.tick( );
         psPstate1.tick( );
+        countPairResult( );
     }
+    else core -> branchPred -> squashFetch( );
+    
+    core -> branchPred -> tick( );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -124,6 +141,7 @@ void FetchDecodeStage::stallPipeLine( ) {
     core -> maStage -> psValA.set( 0 );
     core -> maStage -> psValB.set( 0 );
     core -> maStage -> psValX.set( 0 );
+    core -> maStage -> psInstr2.set( NOP_INSTR );
 }
 
 bool FetchDecodeStage::isStalled( ) {
@@ -131,6 +149,38 @@ bool FetchDecodeStage::isStalled( ) {
     return( stalled );
 }
 
+bool FetchDecodeStage::isPairIssued( ) {
+    
+    return( pairIssued );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The pairing statistics. The FD stage evaluates the same pair again in every cycle it is stalled, so the
+// result of the evaluation is only counted when the instruction actually advances at the end of the cycle.
+// A flush of the instruction we just passed on also drops the pending result.
+//
+//------------------------------------------------------------------------------------------------------------
+void FetchDecodeStage::squashPair( ) {
+    
+    pairChecked = false;
+}
+
+void FetchDecodeStage::countPairResult( ) {
+    
+    if ( ! pairChecked ) return;
+    
+    switch ( pairResult ) {
+            
+        case PAIR_OK:           core -> stats.pairsIssued ++;       break;
+        case PAIR_FAIL_FETCH:   core -> stats.pairFailFetch ++;     break;
+        case PAIR_FAIL_FIRST:   core -> stats.pairFailFirst ++;     break;
+        case PAIR_FAIL_SECOND:  core -> stats.pairFailSecond ++;    break;
+        case PAIR_FAIL_DEP:     core -> stats.pairFailDep ++;       break;
+    }
+    
+    pairChecked = false;
+}
+
 void FetchDecodeStage::setStalled( bool arg ) {
    
     stalled = arg;
@@ -147,34 +197,40 @@ bool FetchDecodeStage::dependencyValA( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            if ( getBitField( instr, 27, 4 ) == 0 ) return( false );
+            uint32_t mode = dInstr -> opMode;
+            
+            if (( mode == OP_MODE_IMM ) || ( mode == OP_MODE_REG_INDX )) return( dInstr -> regR == regId );
+            else if ( mode == OP_MODE_REG ) return( dInstr -> regA == regId );
+            else return( false );
+        }
+            
+        case OP_ADDIL: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
-            return((( mode == 1 ) || ( mode == 2 )) && ( getBitField( instr, 27, 4 ) == regId ));
+            return( dInstr -> regR == regId );
         }
             
         case OP_DEP: {
             
-            if ( getBitField( instr, 9, 4 ) == 0 ) return( false );
-            return(( ! getBit( instr, 10 )) ? ( getBitField( instr, 9, 4 ) == regId ) : false );
+            if ( dInstr -> regR == 0 ) return( false );
+            return(( ! getBit( instr, 10 )) ? ( dInstr -> regR == regId ) : false );
         }
             
         case OP_DSR:    case OP_SHLA:   case OP_CMR:    case OP_BVE:    case OP_CBR:    case OP_CBRU:
         case OP_LDPA:   case OP_PRB:    case OP_PTLB:   case OP_PCA:    case OP_DIAG: {
         
-            if ( getBitField( instr, 27, 4 ) == 0 ) return( false );
-            return( getBitField( instr, 27, 4 ) == regId );
+            if ( dInstr -> regA == 0 ) return( false );
+            return( dInstr -> regA == regId );
         }
             
        case OP_ST:     case OP_STA: {
             
-            if ( getBitField( instr, 9, 4 ) == 0 ) return( false );
-            return( getBitField( instr, 9, 4 ) == regId );
+            if ( dInstr -> regR == 0 ) return( false );
+            return( dInstr -> regR == regId );
         }
             
         default: return ( false );
@@ -194,15 +250,15 @@ bool FetchDecodeStage::dependencyValA( uint32_t regId ) {
 bool FetchDecodeStage::dependencyValB( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
-    if ( getBitField( instr, 31, 4 ) == 0 ) return( false );
+    if ( dInstr -> regB == 0 ) return( false );
    
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
-            return(( mode > 0 ) && ( getBitField( instr, 31, 4 ) == regId ));
+            uint32_t mode = dInstr -> opMode;
+            return(( mode > 0 ) && ( dInstr -> regB == regId ));
         }
             
         case OP_LSID:   case OP_EXTR:   case OP_DEP:    case OP_DSR:    case OP_SHLA:   case OP_CMR:
@@ -211,7 +267,7 @@ bool FetchDecodeStage::dependencyValB( uint32_t regId ) {
         case OP_MST:    case OP_LDPA:   case OP_PRB:    case OP_ITLB:   case OP_PTLB:   case OP_PCA:
         case OP_DIAG: {
             
-            return( getBitField( instr, 31, 4 ) == regId );
+            return( dInstr -> regB == regId );
         }
             
         default: return ( false );
@@ -232,34 +288,34 @@ bool FetchDecodeStage::dependencyValX( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
    
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            if ( getBitField( instr, 27, 4 ) == 0 ) return( false );
+            if ( dInstr -> regA == 0 ) return( false );
             
-            uint32_t mode = getBitField( instr, 13, 2 );
-            return(( mode == 2 ) && ( getBitField( instr, 27, 4 ) == regId ));
+            uint32_t mode = dInstr -> opMode;
+            return(( mode == 2 ) && ( dInstr -> regA == regId ));
         }
             
         case OP_LD:     case OP_LDA:    case OP_ST:     case OP_STA: {
             
-            if ( getBitField( instr, 27, 4 ) == 0 ) return( false );
-            return(( getBit( instr, 10 ) && ( getBitField( instr, 27, 4 ) == regId )));
+            if ( dInstr -> regA == 0 ) return( false );
+            return(( getBit( instr, 10 ) && ( dInstr -> regA == regId )));
             
         } break;
             
         case OP_BR: {
             
-            if ( getBitField( instr, 31, 4 ) == 0 ) return( false );
-            return( getBitField( instr, 31, 4 ) == regId );
+            if ( dInstr -> regB == 0 ) return( false );
+            return( dInstr -> regB == regId );
         }
             
         case OP_BVE: {
             
-            if ( getBitField( instr, 27, 4 ) == 0 ) return( false );
-            return( getBitField( instr, 27, 4 ) == regId );
+            if ( dInstr -> regA == 0 ) return( false );
+            return( dInstr -> regA == regId );
         }
         
         default: return ( false );
@@ -273,7 +329,7 @@ bool FetchDecodeStage::dependencyValX( uint32_t regId ) {
 //------------------------------------------------------------------------------------------------------------
 bool FetchDecodeStage::dependencyValST( ) {
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADC:    case OP_SBC: return( true );
             
@@ -281,6 +337,24 @@ bool FetchDecodeStage::dependencyValST( ) {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "consumesValA" determines whether the "A" value would be consumed in the MA stage. This is the case for the
+// store instructions, which write the data in "A" to memory in the MA stage. The EX stage bypass is too late
+// for them.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FetchDecodeStage::consumesValA( ) {
+    
+    if ( dInstr -> regR == 0 ) return( false );
+    
+    switch ( dInstr -> opCode ) {
+            
+        case OP_ST:     case OP_STA: return( true );
+            
+        default: return( false );
+    }
+}
+
 //------------------------------------------------------------------------------------------------------------
 // "consumesValB" determines whether the "B" value would be consumed in the MA stage. This is the case when
 // we use "B" as the base register and the instruction will for example load a value from memory. The data
@@ -290,18 +364,18 @@ bool FetchDecodeStage::dependencyValST( ) {
 //------------------------------------------------------------------------------------------------------------
 bool FetchDecodeStage::consumesValB( ) {
     
-    if ( getBitField( instr, 31, 4 ) == 0 ) return( false );
+    if ( dInstr -> regB == 0 ) return( false );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
      
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
+            uint32_t mode = dInstr -> opMode;
             return(( mode == 2 ) || ( mode == 3 ));
         }
             
-        case OP_LD:     case OP_LDA:    case OP_ST:     case OP_STA: {
+        case OP_LD:     case OP_LDA:    case OP_ST:     case OP_STA:    case OP_LDO: {
          
             return( true );
         }
@@ -312,6 +386,108 @@ bool FetchDecodeStage::consumesValB( ) {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "dependsOn" checks whether the instruction fetches any of its operands from the general register that the
+// "producer" instruction further down the pipeline will write. This is the test used when the pipeline is
+// configured without operand forwarding.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FetchDecodeStage::dependsOn( DecodedInstr *producer ) {
+    
+    uint32_t regId = producer -> regW;
+    
+    return(( dependencyValA( regId )) || ( dependencyValB( regId )) || ( dependencyValX( regId )));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "consumesResult" checks whether the instruction needs the result of the "producer" instruction in the MA
+// stage already. These are the operands used for an address computation or the data to store.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FetchDecodeStage::consumesResult( DecodedInstr *producer ) {
+    
+    uint32_t regId = producer -> regW;
+    
+    return((( consumesValA( )) && ( dependencyValA( regId ))) ||
+           (( consumesValB( )) && ( dependencyValB( regId ))) ||
+           (( consumesValX( )) && ( dependencyValX( regId ))));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Pairing rules for the dual issue pipeline. The first instruction can be any computational or memory
+// access instruction. Branches, control and privileged instructions as well as the reserved opcodes are
+// issued alone. The second instruction executes in the second EX lane, which is a simple ALU. It can be any
+// ADD, SUB, AND, OR, XOR, CMP or CMPU with an immediate or register operand, as long as it cannot trap. The
+// carry using ADC and SBC are not paired either, since the carry of the first instruction is not yet set.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FetchDecodeStage::canIssueFirst( ) {
+    
+    if ( dInstr -> flags & ( BRANCH_INSTR | CTRL_INSTR | PRIV_INSTR )) return( false );
+    if ( dInstr -> flags == NO_FLAGS ) return( false );
+    
+    return(( dInstr -> opCode != OP_LDR ) && ( dInstr -> opCode != OP_STC ));
+}
+
+bool FetchDecodeStage::canIssueSecond( DecodedInstr *dInstr2 ) {
+    
+    bool simpleMode = (( dInstr2 -> opMode == OP_MODE_IMM ) || ( dInstr2 -> opMode == OP_MODE_REG ));
+    
+    switch ( dInstr2 -> opCode ) {
+            
+        case OP_ADD:    case OP_SUB: {
+            
+            return(( simpleMode ) && ( ! getBit( dInstr2 -> instr, 11 )));
+        }
+            
+        case OP_AND:    case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU: {
+            
+            return( simpleMode );
+        }
+            
+        default: return( false );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "pairSecondInstr" decides whether the instruction following the current instruction is issued together
+// with it. The second instruction word is taken from the instruction cache block just read. The FD stage
+// does not read any registers for the second instruction, the second EX lane reads them when it executes
+// the instruction. At that point, all older instructions have written their results, except for the first
+// instruction of the pair. Therefore, the second instruction must neither use nor write a register the
+// first instruction writes. The first instruction writes its "R" register, except for ADDIL which writes
+// GR1, and a load or store with base register modification also writes its "B" register.
+//
+//------------------------------------------------------------------------------------------------------------
+PairResult FetchDecodeStage::pairSecondInstr( uint32_t physAdr, uint32_t *instr2, uint32_t *decIndex2 ) {
+    
+    if ( ! canIssueFirst( )) return( PAIR_FAIL_FIRST );
+    
+    if (( physAdr > core -> physMem -> getEndAdr( ) - 8 ) ||
+        ( ! core -> iCacheL1 -> readNextWord( psPstate1.get( ), physAdr, instr2 ))) return( PAIR_FAIL_FETCH );
+    
+    DecodedInstr *dInstr2 = core -> decodeCache -> lookup( physAdr + 4, *instr2, decIndex2 );
+    
+    if ( ! canIssueSecond( dInstr2 )) return( PAIR_FAIL_SECOND );
+    
+    uint32_t    regW1   = 0;
+    uint32_t    regW2   = 0;
+    uint32_t    regR1   = ( dInstr2 -> opMode == OP_MODE_IMM ) ? dInstr2 -> regR : dInstr2 -> regA;
+    uint32_t    regR2   = ( dInstr2 -> opMode == OP_MODE_REG ) ? dInstr2 -> regB : 0;
+    
+    regW1 = dInstr -> regW;
+    if (( dInstr -> flags & ( LOAD_INSTR | STORE_INSTR )) && ( getBit( instr, 11 ))) regW2 = dInstr -> regB;
+    
+    uint32_t    regs[ ] = { regR1, regR2, dInstr2 -> regR };
+    
+    for ( int i = 0; i < 3; i++ ) {
+        
+        if (( regs[ i ] != 0 ) && (( regs[ i ] == regW1 ) || ( regs[ i ] == regW2 ))) return( PAIR_FAIL_DEP );
+    }
+    
+    return( PAIR_OK );
+}
+
 //------------------------------------------------------------------------------------------------------------
 // "consumesValX" determines whether the "X" value would be consumed in the OF stage. This is the case when
 // we use "C" as the index register and the instruction will for example load a value from memory.
@@ -320,18 +496,18 @@ bool FetchDecodeStage::consumesValB( ) {
 //------------------------------------------------------------------------------------------------------------
 bool FetchDecodeStage::consumesValX( ) {
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
      
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
-            return(( mode == 2 ) && ( getBitField( instr, 27, 4 ) != 0 ));
+            uint32_t mode = dInstr -> opMode;
+            return(( mode == 2 ) && ( dInstr -> regA != 0 ));
         }
             
         case OP_LD:     case OP_LDA:    case OP_ST:     case OP_STA: {
             
-            return(( getBit( instr, 10 )) && ( getBitField( instr, 27, 4 ) != 0 ));
+            return(( getBit( instr, 10 )) && ( dInstr -> regA != 0 ));
         }
                     
         default: return( false );
@@ -385,12 +561,12 @@ void FetchDecodeStage::setupTrapData( uint32_t trapId,
                                       uint32_t p2,
                                       uint32_t p3 ) {
     
-    core -> cReg[ CR_TRAP_PSW_0 ].set( psw0 );
-    core -> cReg[ CR_TRAP_PSW_1 ].set( psw1 );
-    core -> cReg[ CR_TRAP_PARM_1 ].set( p1 );
-    core -> cReg[ CR_TRAP_PARM_2 ].set( p2 );
-    core -> cReg[ CR_TRAP_PARM_3 ].set( p3 );
-    core -> cReg[ CR_TEMP_1 ].set( trapId );
+    core -> cReg.set( CR_TRAP_PSW_0, psw0 );
+    core -> cReg.set( CR_TRAP_PSW_1, psw1 );
+    core -> cReg.set( CR_TRAP_PARM_1, p1 );
+    core -> cReg.set( CR_TRAP_PARM_2, p2 );
+    core -> cReg.set( CR_TRAP_PARM_3, p3 );
+    core -> cReg.set( CR_TEMP_1, trapId );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -401,22 +577,23 @@ void FetchDecodeStage::setupTrapData( uint32_t trapId,
 //------------------------------------------------------------------------------------------------------------
 bool FetchDecodeStage::checkProtectId( uint16_t segId ) {
     
-    return((( segId  == getBitField( core -> cReg[ CR_SEG_ID_0_1 ].get( ), 15, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_0_1 ].get( ), 31, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_2_3 ].get( ), 15, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_2_3 ].get( ), 31, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_4_5 ].get( ), 15, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_4_5 ].get( ), 31, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_6_7 ].get( ), 15, 16 )) ||
-            ( segId  == getBitField( core -> cReg[ CR_SEG_ID_6_7 ].get( ), 31, 16 ))));
+    return((( segId  == getBitField( core -> cReg.get( CR_SEG_ID_0_1 ), 15, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_0_1 ), 31, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_2_3 ), 15, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_2_3 ), 31, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_4_5 ), 15, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_4_5 ), 31, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_6_7 ), 15, 16 )) ||
+            ( segId  == getBitField( core -> cReg.get( CR_SEG_ID_6_7 ), 31, 16 ))));
 }
 
 //------------------------------------------------------------------------------------------------------------
 // Instruction fetch and decode stage processing. First, we get the current instruction address from the PSW
 // register. If code translation is enabled, the TLB needs to map the virtual address to a physical address.
-// This can cause several traps. If the entry is not found, a ITLB_MISS_TRAP is recorded. Next the access
-// rights are validated. The access is a code page (execute) access with a sufficient privilege level.
-// Invalid access results in a ITLB_ACC_RIGHTS_TRAP. Finally, if protection checking is enabled, the TLB
+// This can cause several traps. If the entry is not found, the second level TLB is asked for a refill, the
+// stage stalls while the refill is pending. If the entry is not found there either or there is no second
+// level TLB, a ITLB_MISS_TRAP is recorded. Next the access rights are validated. The access is a code page
+// (execute) access with a sufficient privilege level. Invalid access results in a ITLB_ACC_RIGHTS_TRAP. Finally, if protection checking is enabled, the TLB
 // protection info is checked against the protection ID control registers. If there is no match, an
 // ITLB_PROTECT_ID_TRAP is recorded. If all worked out, we have the physical address. Also, if code
 // translation was disabled, the physical address is the offset part from the current instruction register.
@@ -455,15 +632,18 @@ bool FetchDecodeStage::checkProtectId( uint16_t segId ) {
 // branch taken a positive address is considered as a branch not taken. When we actually evaluate the
 // condition in the EX stage, the branch decision needs to be corrected when mis-predicted. For this to work,
 // the alternate branch address needs to make its way to the EX stage. The MA stage will actually create
-// the alternate branch target address and pass in "X" to the EX stage. Since a backward branch has a negative
-// offset and is predicted as branch taken, the sign bit of the effect os used in the EX stage to figure out
-// whether we mis-predicted.
+// the alternate branch target address and pass in "X" to the EX stage. When the alternate address is the
+// next instruction, the branch was predicted taken. This is used in the EX stage to figure out whether we
+// mis-predicted. When a branch predictor is configured, it replaces the static scheme for the direction.
 //
 // For instruction that will do arithmetic in the MA stage, we will check if the previous instruction is
 // an instruction that sets a general register. If the register matches one of our just fetched registers,
 // we need to stall the pipeline for one cycle such that we can resolve this issue with a simple bypass
 // when the result to store has been computed.
 //
+// In the dual issue configuration, the instruction following a non-stalled instruction is examined for
+// pairing once the instruction is ready to enter the MA stage. A pair advances the instruction address by 8.
+//
 // Note that in the case of traps we only record the trap information. At this stage we cannot cause a trap
 // because we do not know whether a previous instruction still in flight will cause a trap. Every potential
 // trap encountered in a previous instruction will overwrite the trap data recorded by this instruction.
@@ -471,7 +651,8 @@ bool FetchDecodeStage::checkProtectId( uint16_t segId ) {
 // end. If that instruction raises a trap, it will overwrite the trap info, so that in any case we end up with
 // the actual trap to raise in the EX stage. Before fetching the next instruction in the EX stage the trap
 // pending flag is checked and if set, we will set the next instruction address to that of the respective
-// trap handler. When a trap occurs, the pipeline is stalled and the procedure returns right away.
+// trap handler. When a trap occurs, the pipeline is stalled and the procedure returns right away. After a
+// trap was taken, the fetch of the first trap handler instruction waits until the store buffer is empty.
 //
 //
 // Note: this is a rather long routine. Perhaps we should split this into smaller portions.
@@ -488,6 +669,16 @@ void FetchDecodeStage::process( ) {
     //--------------------------------------------------------------------------------------------------------
     setStalled( false );
     
+    pairIssued  = false;
+    pairChecked = false;
+    core -> maStage -> psInstr2.set( NOP_INSTR );
+    
+    if ( core -> storeBuffer -> isTrapDrain( )) {
+        
+        stallPipeLine( );
+        return;
+    }
+    
     //--------------------------------------------------------------------------------------------------------
     // Instruction Address Translation. If the instruction segment is zero, translation and protection checks
     // are bypassed. The offset is the physical memory address. We also must be privileged.
@@ -498,6 +689,17 @@ void FetchDecodeStage::process( ) {
         tlbEntryPtr = core -> iTlb -> lookupTlbEntry( psPstate1.getBitField( 31, 16 ), psPstate1.get( ));
         if ( tlbEntryPtr == nullptr ) {
             
+            tlbEntryPtr = core -> iTlb -> refillTlbEntry( psPstate1.getBitField( 31, 16 ), psPstate1.get( ));
+        }
+        
+        if ( tlbEntryPtr == nullptr ) {
+            
+            if ( core -> iTlb -> isRefillPending( )) {
+                
+                stallPipeLine( );
+                return;
+            }
+            
             setupTrapData( ITLB_MISS_TRAP, psPstate0.get( ), psPstate1.get( ), instr );
             stallPipeLine( );
             return;
@@ -578,10 +780,16 @@ void FetchDecodeStage::process( ) {
     }
     
     //--------------------------------------------------------------------------------------------------------
-    // Instruction Decode. Essentially a giant case statement.
+    // Instruction Decode. The instruction fields are taken from the decode cache. Only when the instruction
+    // at this physical address is not in the cache, it is decoded and entered. The decode cache index is
+    // passed along with the instruction, so that the MA and EX stage can use the same decoded record.
     //
     //--------------------------------------------------------------------------------------------------------
-    uint32_t opCode = getBitField( instr, 5, 6 );
+    uint32_t decIndex   = 0;
+    
+    dInstr = core -> decodeCache -> lookup( physAdr, instr, &decIndex );
+    
+    uint32_t opCode     = dInstr -> opCode;
     
     //--------------------------------------------------------------------------------------------------------
     // Instruction execution privilege check.
@@ -602,7 +810,7 @@ void FetchDecodeStage::process( ) {
     // Privileged instruction check.
     //
     //--------------------------------------------------------------------------------------------------------
-    if ( opCodeTab[ opCode ].flags & PRIV_INSTR ) {
+    if ( dInstr -> flags & PRIV_INSTR ) {
         
         if ( getBit( psPstate0.get( ), ST_EXECUTION_LEVEL ) > 0 ) {
             
@@ -621,22 +829,22 @@ void FetchDecodeStage::process( ) {
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:
         case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t opMode = getBitField( instr, 13, 2 );
+            uint32_t opMode = dInstr -> opMode;
            
             switch ( opMode ) {
                     
                 case OP_MODE_IMM: {
                    
-                    maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
-                    maStage -> psValB.set( getBitField( instr, 31, 18, true ));
+                    maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
+                    maStage -> psValB.set( dInstr -> imm );
                     maStage -> psValX.set( 0 );
                    
                 } break;
                     
                 case OP_MODE_REG: {
                     
-                    maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-                    maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+                    maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+                    maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
                     maStage -> psValX.set( 0 );
                     
                 } break;
@@ -644,22 +852,22 @@ void FetchDecodeStage::process( ) {
                
                 case OP_MODE_REG_INDX: {
                     
-                    maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
-                    maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-                    maStage -> psValX.set( core -> gReg[ getBitField( instr, 27,4 ) ].get( ));
+                    maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
+                    maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+                    maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
                     
                 } break;
                     
                 case OP_MODE_INDX: {
                     
-                    if ( opCodeTab[ opCode ].flags & STORE_INSTR ) {
+                    if ( dInstr -> flags & STORE_INSTR ) {
                         
-                        maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
+                        maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
                     }
                     else maStage -> psValA.set( 0 );
                     
-                    maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-                    maStage -> psValX.set( getBitField( instr, 27, 12, true ));
+                    maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+                    maStage -> psValX.set( dInstr -> imm );
                     
                 } break;
             }
@@ -668,8 +876,8 @@ void FetchDecodeStage::process( ) {
             
         case OP_ADDIL: {
         
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
-            maStage -> psValB.set( getBitField( instr, 31, 22 ) << 10 );
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
+            maStage -> psValB.set( dInstr -> imm );
             maStage -> psValX.set( 0 );
             
         } break;
@@ -678,7 +886,7 @@ void FetchDecodeStage::process( ) {
           
             maStage -> psValA.set( 0 );
             maStage -> psValB.set( psPstate1.get( ));
-            maStage -> psValX.set( getBitField( instr, 31, 22, true ) << 2 );
+            maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
@@ -689,23 +897,23 @@ void FetchDecodeStage::process( ) {
         case OP_BE: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( getBitField( instr, 23, 14, true ) << 2 );
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
         case OP_BR: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( psPstate1.get( ));
             
         } break;
             
         case OP_BRK: {
             
-            maStage -> psValA.set( getBitField( instr, 9, 4 ));
-            maStage -> psValB.set( getBitField( instr, 31, 16 ));
+            maStage -> psValA.set( dInstr -> regR );
+            maStage -> psValB.set( dInstr -> imm );
             maStage -> psValX.set( 0 );
          
         } break;
@@ -713,7 +921,7 @@ void FetchDecodeStage::process( ) {
         case OP_BV: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -721,23 +929,23 @@ void FetchDecodeStage::process( ) {
         case OP_BVE: {
         
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
            
         } break;
             
         case OP_CBR:    case OP_CBRU: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
             
         case OP_CMR: {
        
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -746,15 +954,15 @@ void FetchDecodeStage::process( ) {
             
             if ( ! getBit( instr, 10 )) {
                 
-                maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
+                maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
             }
             else maStage -> psValA.set( 0 );
             
             if ( ! getBit( instr, 12 )) {
                 
-                maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+                maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             }
-            else maStage -> psValB.set( getBitField( instr, 31, 4 ));
+            else maStage -> psValB.set( dInstr -> imm );
             
             maStage -> psValX.set( 0 );
             
@@ -762,24 +970,24 @@ void FetchDecodeStage::process( ) {
             
         case OP_DIAG: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
             
         case OP_DS: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
             
         case OP_DSR: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -787,7 +995,7 @@ void FetchDecodeStage::process( ) {
         case OP_EXTR: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -796,7 +1004,7 @@ void FetchDecodeStage::process( ) {
             
             maStage -> psValA.set( 0 );
             maStage -> psValB.set( psPstate1.get( ));
-            maStage -> psValX.set( getBitField( instr, 31, 22, true ) << 2 );
+            maStage -> psValX.set( dInstr -> imm );
            
             // ??? when do we exactly set the execution level in the status reg ? There are
             // two instructions ahead of us which should NOT benefit from the potential priv change....
@@ -817,7 +1025,7 @@ void FetchDecodeStage::process( ) {
         case OP_ITLB: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -825,20 +1033,20 @@ void FetchDecodeStage::process( ) {
         case OP_LD: case OP_LDA: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             
             if ( getBit( instr, 10 )) {
             
-                maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+                maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
             }
-            else maStage -> psValX.set( getBitField( instr, 27, 12, true ));
+            else maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
         case OP_LDIL: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( getBitField( instr, 31, 22 ));
+            maStage -> psValB.set( dInstr -> imm );
             maStage -> psValX.set( 0 );
             
         } break;
@@ -846,31 +1054,31 @@ void FetchDecodeStage::process( ) {
         case OP_LDO: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( getBitField( instr, 27, 18, true ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
         case OP_LDPA: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
             
         } break;
             
         case OP_LDR: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( getBitField( instr, 27, 12, true ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
         case OP_LSID: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
@@ -882,7 +1090,7 @@ void FetchDecodeStage::process( ) {
             
             if ( getBit( instr, 11 )) {
                 
-                maStage -> psValB.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
+                maStage -> psValB.set( core -> gReg.get( dInstr -> regR ));
             }
             else maStage -> psValB.set( 0 );
             
@@ -897,14 +1105,14 @@ void FetchDecodeStage::process( ) {
                     
                 case 0: {
                     
-                    maStage -> psValB.setBitField( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ), 31, 6 );
+                    maStage -> psValB.setBitField( core -> gReg.get( dInstr -> regR ), 31, 6 );
                  
                 } break;
                     
                 case 1:
                 case 2: {
                     
-                    maStage -> psValB.set( getBitField( instr, 31, 6 ));
+                    maStage -> psValB.set( dInstr -> imm );
                     
                 } break;
                     
@@ -921,19 +1129,19 @@ void FetchDecodeStage::process( ) {
         case OP_PCA: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
            
         } break;
             
         case OP_PRB: {
     
             maStage -> psValX.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             
             if ( ! getBit( instr, 11 )) {
                 
-                maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+                maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
             }
             else maStage -> psValA.setBit( 31, getBit( instr, 27 ));
         
@@ -942,8 +1150,8 @@ void FetchDecodeStage::process( ) {
         case OP_PTLB: {
             
             maStage -> psValA.set( 0 );
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
            
         } break;
             
@@ -953,30 +1161,30 @@ void FetchDecodeStage::process( ) {
           
         case OP_SHLA:{
          
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regA ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             maStage -> psValX.set( 0 );
             
         } break;
             
         case OP_ST: case OP_STA: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
             
             if ( getBit( instr, 10 )) {
                 
-                maStage -> psValX.set( core -> gReg[ getBitField( instr, 27, 4 ) ].get( ));
+                maStage -> psValX.set( core -> gReg.get( dInstr -> regA ));
             }
-            else maStage -> psValX.set( getBitField( instr, 27, 12, true ));
+            else maStage -> psValX.set( dInstr -> imm );
           
         } break;
             
         case OP_STC: {
             
-            maStage -> psValA.set( core -> gReg[ getBitField( instr, 9, 4 ) ].get( ));
-            maStage -> psValB.set( core -> gReg[ getBitField( instr, 31, 4 ) ].get( ));
-            maStage -> psValX.set( getBitField( instr, 27, 12, true ));
+            maStage -> psValA.set( core -> gReg.get( dInstr -> regR ));
+            maStage -> psValB.set( core -> gReg.get( dInstr -> regB ));
+            maStage -> psValX.set( dInstr -> imm );
             
         } break;
             
@@ -997,25 +1205,43 @@ void FetchDecodeStage::process( ) {
     // and we will use the correct values for the MA stage.
     //
     // When the instruction in the MA stage is one that will produce a register result, we will test for a
-    // dependency of the "B" and "X" fields on that instruction.
+    // dependency of the "B" and "X" fields on that instruction. The same is true for the store data in "A",
+    // the store is done in the MA stage too. With full forwarding, a result the MA stage already knows, such
+    // as loaded data, is passed to us at the end of the cycle and there is no need to wait. Without any
+    // forwarding, we wait for every register the instructions in the MA and EX stage will write until it has
+    // been written back. In the dual issue pipeline, the second instructions in the MA and EX stage are
+    // producers too. Their result is computed in the EX stage.
     //
     // ??? what about the status or segment register ?
     //---------------------------------------------------------------------------------------------------------
-    if ( opCodeTab[ getBitField( maStage -> psInstr.get( ), 5, 6 )].flags & REG_R_INSTR ) {
+    DecodedInstr    *maInstr    = maStage -> getDecoded( );
+    CpuFwdMode      fwdMode     = core -> cpuDesc.fwdMode;
+    bool            dualIssue   = ( core -> cpuDesc.issueWidth > 1 );
+    bool            depStall    = false;
+    
+    if ( fwdMode == FWD_MODE_NONE ) {
         
-        uint32_t regIdR = maStage -> psInstr.getBitField( 9, 4 );
+        depStall = ( dependsOn( maInstr )) || ( dependsOn( core -> exStage -> getDecoded( )));
         
-        if (( consumesValB( )) && ( dependencyValB( regIdR ))) {
+        if (( ! depStall ) && ( dualIssue )) {
             
-            stallPipeLine( );
-            return;
+            depStall = ( dependsOn( maStage -> getDecoded2( ))) ||
+                       ( dependsOn( core -> exStage -> getDecoded2( )));
         }
+    }
+    else {
         
-        if (( consumesValX( )) && ( dependencyValX( regIdR ))) {
-            
-            stallPipeLine( );
-            return;
-        }
+        if (( fwdMode != FWD_MODE_FULL ) || ( ! maStage -> hasEarlyResult( )))
+            depStall = consumesResult( maInstr );
+        
+        if (( ! depStall ) && ( dualIssue )) depStall = consumesResult( maStage -> getDecoded2( ));
+    }
+    
+    if ( depStall ) {
+        
+        core -> stats.dependencyStalls ++;
+        stallPipeLine( );
+        return;
     }
     
     //--------------------------------------------------------------------------------------------------------
@@ -1025,27 +1251,57 @@ void FetchDecodeStage::process( ) {
     core -> maStage -> psPstate0.set( psPstate0.get( ));
     core -> maStage -> psPstate1.set( psPstate1.get( ));
     core -> maStage -> psInstr.set( instr );
+    core -> maStage -> psDecIndex.set( decIndex );
+    
+    //--------------------------------------------------------------------------------------------------------
+    // Dual issue. The instruction following our instruction is passed along in the second instruction
+    // pipeline register when the pair can be issued. The pairing result is counted at the end of the cycle,
+    // when we know that the instruction really advances.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    if ( dualIssue ) {
+        
+        uint32_t instr2     = NOP_INSTR;
+        uint32_t decIndex2  = 0;
+        
+        pairResult  = pairSecondInstr( physAdr, &instr2, &decIndex2 );
+        pairChecked = true;
+        
+        if ( pairResult == PAIR_OK ) {
+            
+            core -> maStage -> psInstr2.set( instr2 );
+            core -> maStage -> psDecIndex2.set( decIndex2 );
+            pairIssued = true;
+        }
+    }
     
     //--------------------------------------------------------------------------------------------------------
     // Compute the next instruction address. Typically, this is the current instruction plus 4 bytes. For the
     // conditional branch we either increment by 4 or by the offset encoded in the instruction. In addition,
-    // we pass on the offset or the value of 4 to the next stage.
+    // we pass on the offset or the value of 4 to the next stage. With a branch predictor, the B, BR and BV
+    // instructions continue at their predicted target. After an instruction pair, the next instruction is
+    // 8 bytes further.
     //
     // ??? what exactly is the instruction offset arithmetic ?
     // ??? we add a signed value to an unsigned value ....
     //--------------------------------------------------------------------------------------------------------
     if (( opCode == OP_CBR ) || ( opCode == OP_CBRU )) {
         
-        if ( getBit( instr, 23 )) {
+        if ( core -> branchPred -> predictCond( psPstate1.get( ), getBit( instr, 23 ))) {
             
-            psPstate1.set( add32( psPstate1.get( ), getBitField( instr, 31, 22, true )));
+            psPstate1.set( add32( psPstate1.get( ), dInstr -> imm ));
             maStage -> psValX.set( 4 );
         }
         else {
             
             psPstate1.set( psPstate1.get( ) + 4 );
-            maStage -> psValX.set( getBitField( instr, 31, 22, true ));
+            maStage -> psValX.set( dInstr -> imm );
         }
     }
-    else psPstate1.set( psPstate1.get( ) + 4 );
+    else if ((( opCode == OP_B ) || ( opCode == OP_BR ) || ( opCode == OP_BV )) &&
+             ( core -> branchPred -> isEnabled( ))) {
+        
+        psPstate1.set( core -> branchPred -> predictTarget( psPstate1.get( ), dInstr ));
+    }
+    else psPstate1.set( psPstate1.get( ) + (( pairIssued ) ? 8 : 4 ));
 }
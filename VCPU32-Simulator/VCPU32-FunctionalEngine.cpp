@@ -0,0 +1,1084 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Functional Engine
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 functional engine. The pipeline stages model the envisioned hardware cycle by cycle. This is
+// great for looking at the timing, but slow when we just want to boot a system or run a program to the point
+// where things get interesting. The functional engine executes one instruction per step, straight from the
+// architectural state. There are no pipeline registers, no stalls and no bypasses. The instruction address
+// is the FD stage PSW, the registers are the general, segment and control registers of the CPU core. All
+// we do is to fetch the instruction, perform the work that the FD, MA and EX stage would do for it and
+// advance the instruction address.
+//
+// Address translation uses the TLBs of the CPU core with the same checks as the pipeline stages. Memory is
+// accessed directly in the physical memory and PDC data arrays, i.e. the caches are bypassed. The CPU core
+// will write back and invalidate the caches when switching to the functional engine, so that physical
+// memory holds the current data. Traps record the same data in the control registers as the pipeline stages
+// do and then directly continue at the trap handler address.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Functional Engine
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. Most of the routines are inline functions.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+//------------------------------------------------------------------------------------------------------------
+// Bit field access. The signed variant sign extends the field from its leftmost bit.
+//
+//------------------------------------------------------------------------------------------------------------
+bool getBit( uint32_t arg, int pos ) {
+    
+    return(( arg & ( 1U << ( 31 - ( pos % 32 )))) ? 1 : 0 );
+}
+
+uint32_t getBitField( uint32_t arg, int pos, int len, bool sign = false ) {
+    
+    pos = pos % 32;
+    len = len % 32;
+    
+    uint32_t tmpM = ( 1U << len ) - 1;
+    uint32_t tmpA = ( arg >> ( 31 - pos )) & tmpM;
+    
+    if (( sign ) && ( tmpA & ( 1U << ( len - 1 )))) return( tmpA | ( ~ tmpM ));
+    else                                            return( tmpA );
+}
+
+uint32_t setBitField( uint32_t arg, uint32_t val, int pos, int len ) {
+    
+    pos = pos % 32;
+    len = len % 32;
+    
+    uint32_t tmpM = (( 1U << len ) - 1 ) << ( 31 - pos );
+    
+    return(( arg & ( ~ tmpM )) | (( val << ( 31 - pos )) & tmpM ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Little helper function to return the data length in bytes as encoded in the "dw" field.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t mapDataLen( uint32_t instr ) {
+    
+    switch( getBitField( instr, 15, 2 )) {
+        
+        case 0:     return( 1 );
+        case 1:     return( 2 );
+        case 2:     return( 4 );
+        case 3:     return( 8 );
+        default:    return( 0 );
+    }
+}
+
+bool isAligned( uint32_t adr, uint32_t dwField ) {
+    
+    switch( dwField ) {
+        
+        case 0: return( true );
+        case 1: return(( adr & 0x1 ) == 0 );
+        case 2: return(( adr & 0x3 ) == 0 );
+        case 3: return(( adr & 0x7 ) == 0 );
+        default: return( false );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Compare helpers for the CMP, CMR and CBR instructions. Same as in the execute stage.
+//
+//------------------------------------------------------------------------------------------------------------
+bool compareCond( uint32_t instr, uint32_t valA, uint32_t valB ) {
+    
+    switch( getBitField( instr, 8, 2 )) {
+        
+        case CC_EQ: return( valA == valB );
+        case CC_NE: return( valA != valB );
+        case CC_LT: return(((int32_t) valA )  < ((int32_t) valB ));
+        case CC_LE: return(((int32_t) valA )  <= ((int32_t) valB ));
+        default: return( false );
+    }
+}
+
+bool compareCondU( uint32_t instr, uint32_t valA, uint32_t valB ) {
+    
+    switch( getBitField( instr, 8, 2 )) {
+        
+        case CC_EQ: return( valA == valB );
+        case CC_NE: return( valA != valB );
+        case CC_LT: return( valA  < valB );
+        case CC_LE: return( valA <= valB );
+        default: return( false );
+    }
+}
+
+bool testCond( uint32_t instr, uint32_t val ) {
+    
+    switch ( getBitField( instr, 13, 4 )) {
+        
+        case CC_EQ: return( val == 0 );
+        case CC_NE: return( val != 0 );
+        case CC_LT: return((int32_t) val <  0 );
+        case CC_LE: return((int32_t) val <= 0 );
+        
+        default: return ( false );
+    }
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The functional engine object constructor.
+//
+//------------------------------------------------------------------------------------------------------------
+FunctionalEngine::FunctionalEngine( CpuCore *core ) {
+    
+    this -> core = core;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "reset" and "clearStats". The engine has no state of its own other than the statistics.
+//
+//------------------------------------------------------------------------------------------------------------
+void FunctionalEngine::reset( ) {
+    
+    clearStats( );
+}
+
+void FunctionalEngine::clearStats( ) {
+    
+    instrExecuted   = 0;
+    branchesTaken   = 0;
+    trapsRaised     = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Traps. We record the same data as the pipeline stages do. Since there are no other instructions in flight,
+// the trap is taken right away. The status word is cleared and execution continues at the trap handler
+// address. This is what the CPU core "handleTraps" routine does for the pipeline.
+//
+//------------------------------------------------------------------------------------------------------------
+void FunctionalEngine::setupTrapData( uint32_t trapId,
+                                      uint32_t psw0,
+                                      uint32_t psw1,
+                                      uint32_t p1,
+                                      uint32_t p2,
+                                      uint32_t p3 ) {
+    
+    core -> cReg.load( CR_TRAP_PSW_0, psw0 );
+    core -> cReg.load( CR_TRAP_PSW_1, psw1 );
+    core -> cReg.load( CR_TRAP_PARM_1, p1 );
+    core -> cReg.load( CR_TRAP_PARM_2, p2 );
+    core -> cReg.load( CR_TRAP_PARM_3, p3 );
+    core -> cReg.load( CR_TEMP_1, trapId );
+}
+
+void FunctionalEngine::raiseTrap( uint32_t trapId, uint32_t p1, uint32_t p2, uint32_t p3 ) {
+    
+    uint32_t trapHandlerOfs = 0;
+    
+    setupTrapData( trapId, psw0, psw1, p1, p2, p3 );
+    
+    if ( trapId < MAX_TRAP_ID ) {
+        
+        trapHandlerOfs = core -> cReg.get( CR_TRAP_VECTOR_ADR ) + trapId * TRAP_CODE_BLOCK_SIZE;
+    }
+    
+    psw0    = 0;
+    psw1    = trapHandlerOfs;
+    trapped = true;
+    trapsRaised ++;
+    
+    core -> trapTaken( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Access to a segment may be subject to protection checking. The little helper routine will compare the
+// target segment Id with the segments stored in the protection control registers.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FunctionalEngine::checkProtectId( uint16_t segId ) {
+    
+    for ( uint32_t i = CR_SEG_ID_0_1; i <= CR_SEG_ID_6_7; i++ ) {
+        
+        if (( segId == getBitField( core -> cReg.get( i ), 15, 16 )) ||
+            ( segId == getBitField( core -> cReg.get( i ), 31, 16 ))) return( true );
+    }
+    
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Segment selection for a data address. With data translation disabled the segment is zero. Otherwise a
+// zero segment select field selects one of the upper four segment registers based on the leftmost two bits
+// of the offset. Same as in the memory access stage.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t FunctionalEngine::selectSeg( uint32_t instr, uint32_t ofs ) {
+    
+    if ( ! getBit( psw0, ST_DATA_TRANSLATION_ENABLE )) return( 0 );
+    
+    uint32_t segSelect = getBitField( instr, 13, 2 );
+    
+    if ( segSelect == 0 ) return( core -> sReg.get( getBitField( ofs, 1, 2 ) + 4 ));
+    else                  return( core -> sReg.get( segSelect ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Data address translation. If data translation is enabled, the data TLB is consulted and the access rights,
+// privilege level and protection id are checked. Otherwise the offset is the physical address and we must
+// run privileged. On a trap, the routine returns false and the trap is already raised.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FunctionalEngine::translateDataAdr( uint32_t instr, uint32_t seg, uint32_t ofs, bool isWrite, uint32_t *physAdr ) {
+    
+    if ( getBit( psw0, ST_DATA_TRANSLATION_ENABLE )) {
+        
+        TlbEntry *tlbEntryPtr = core -> dTlb -> lookupTlbEntry( seg, ofs );
+        if ( tlbEntryPtr == nullptr ) tlbEntryPtr = core -> dTlb -> refillTlbEntry( seg, ofs, false );
+        
+        if ( tlbEntryPtr == nullptr ) {
+            
+            raiseTrap( DTLB_MISS_TRAP, instr, seg, ofs );
+            return( false );
+        }
+        
+        uint32_t privLevel = getBit( psw0, ST_EXECUTION_LEVEL );
+        
+        if ( isWrite ) {
+            
+            if ( tlbEntryPtr -> tPageType( ) != ACC_READ_WRITE ) {
+                
+                raiseTrap( DTLB_ACC_RIGHTS_TRAP, instr, seg, ofs );
+                return( false );
+            }
+            
+            if ( privLevel > tlbEntryPtr -> tPrivL2( )) {
+                
+                raiseTrap( DATA_MEM_PROTECT_TRAP, instr, seg, ofs );
+                return( false );
+            }
+        }
+        else {
+            
+            if (( tlbEntryPtr -> tPageType( ) != ACC_READ_WRITE ) &&
+                ( tlbEntryPtr -> tPageType( ) != ACC_READ_ONLY )) {
+                
+                raiseTrap( DTLB_ACC_RIGHTS_TRAP, instr, seg, ofs );
+                return( false );
+            }
+            
+            if ( privLevel > tlbEntryPtr -> tPrivL1( )) {
+                
+                raiseTrap( DATA_MEM_PROTECT_TRAP, instr, seg, ofs );
+                return( false );
+            }
+        }
+        
+        if ( getBit( psw0, ST_PROTECT_ID_CHECK_ENABLE )) {
+            
+            if ( ! checkProtectId( tlbEntryPtr -> tSegId( ))) {
+                
+                raiseTrap( DTLB_PROTECT_ID_TRAP, instr, seg, ofs );
+                return( false );
+            }
+        }
+        
+        *physAdr = tlbEntryPtr -> tPhysPage( ) | ( ofs % PAGE_SIZE_BYTES );
+    }
+    else {
+        
+        if ( getBit( psw0, ST_EXECUTION_LEVEL )) {
+            
+            raiseTrap( DATA_MEM_PROTECT_TRAP, instr, seg, ofs );
+            return( false );
+        }
+        
+        *physAdr = ofs;
+    }
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "mapPhysAdr" returns a reference to the data byte at the physical address. Physical memory and the PDC
+// range are directly accessed in their data arrays. Anything else is reported and returns a null pointer.
+//
+// ??? the IO memory range is not handled yet...
+//------------------------------------------------------------------------------------------------------------
+uint8_t *FunctionalEngine::mapPhysAdr( uint32_t physAdr, uint32_t len ) {
+    
+    PhysMem *physMem = core -> physMem;
+    PdcMem  *pdcMem  = core -> pdcMem;
+    
+    if (( physAdr <= physMem -> getEndAdr( )) && ( physAdr + len - 1 <= physMem -> getEndAdr( ))) {
+        
+        return( physMem -> getMemBlockEntry( 0 ) + physAdr );
+    }
+    else if (( physAdr >= pdcMem -> getStartAdr( )) && ( physAdr + len - 1 <= pdcMem -> getEndAdr( ))) {
+        
+        return( pdcMem -> getMemBlockEntry( 0 ) + ( physAdr - pdcMem -> getStartAdr( )));
+    }
+    else {
+        
+        // ??? invalid address. Should we raise a HPMC ?
+        fprintf( stdout, "Invalid physical address in functional access adr: %x \n", physAdr );
+        return( nullptr );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Data read and write. The data is accessed the same way the L1 caches access their blocks. Writes to the PDC
+// range are ignored.
+//
+// ??? the 8-byte "dw" length is treated as a word access, just like the caches do.
+//------------------------------------------------------------------------------------------------------------
+bool FunctionalEngine::readData( uint32_t instr, uint32_t seg, uint32_t ofs, uint32_t len, uint32_t *word ) {
+    
+    uint32_t physAdr = 0;
+    
+    if ( ! translateDataAdr( instr, seg, ofs, false, &physAdr )) return( false );
+    
+    uint8_t *dataPtr = mapPhysAdr( physAdr, len );
+    
+    if      ( dataPtr == nullptr ) *word = 0;
+    else if ( len == 1 )           *word = *dataPtr;
+    else if ( len == 2 )           { uint16_t tmp; memcpy( &tmp, dataPtr, 2 ); *word = tmp; }
+    else                           memcpy( word, dataPtr, 4 );
+    
+    if ( cacheWarming ) {
+        
+        dataLevel   = warmCaches( core -> dCacheL1, ofs, physAdr );
+        dataPhysAdr = physAdr;
+    }
+    
+    return( true );
+}
+
+bool FunctionalEngine::writeData( uint32_t instr, uint32_t seg, uint32_t ofs, uint32_t len, uint32_t word ) {
+    
+    uint32_t physAdr = 0;
+    
+    if ( ! translateDataAdr( instr, seg, ofs, true, &physAdr )) return( false );
+    
+    if ( physAdr > core -> physMem -> getEndAdr( )) return( true );
+    
+    uint8_t *dataPtr = mapPhysAdr( physAdr, len );
+    
+    if      ( dataPtr == nullptr ) ;
+    else if ( len == 1 )           *dataPtr = (uint8_t) word;
+    else if ( len == 2 )           { uint16_t tmp = (uint16_t) word; memcpy( dataPtr, &tmp, 2 ); }
+    else                           memcpy( dataPtr, &word, 4 );
+    
+    core -> invalidateCode( physAdr, len );
+    
+    if ( cacheWarming ) {
+        
+        dataLevel   = warmCaches( core -> dCacheL1, ofs, physAdr, true );
+        dataPhysAdr = physAdr;
+    }
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "warmCaches" enters the block of an instruction or data access into the L1 cache and the L2 cache, when
+// configured, so that a detailed pipeline run after a functional run does not start with cold caches. The
+// L1 caches are indexed by the offset, the L2 cache by the physical address. Only physical memory is cached.
+// A write already went to physical memory, the warm up refreshes the blocks the caches hold and marks the L1
+// block dirty. The L2 block would only become dirty with the L1 write back. Note that the caches are only
+// kept current while warming is enabled. Since the functional engine is always entered with flushed caches,
+// a run that warms the caches must be the last one before switching to the pipeline. The routine returns the
+// level of the memory hierarchy that held the block, the out-of-order core model charges its latency.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t FunctionalEngine::warmCaches( CpuMem *l1Cache, uint32_t ofs, uint32_t physAdr, bool isWrite ) {
+    
+    PhysMem *physMem = core -> physMem;
+    
+    if ( physAdr > physMem -> getEndAdr( )) return( MEM_LEVEL_MEM );
+    
+    uint8_t     *memData    = physMem -> getMemBlockEntry( 0 );
+    uint32_t    level       = MEM_LEVEL_MEM;
+    
+    if ( l1Cache -> warmBlock( ofs, physAdr, memData, isWrite )) level = MEM_LEVEL_L1;
+    
+    if ( core -> uCacheL2 != nullptr ) {
+        
+        if (( core -> uCacheL2 -> warmBlock( physAdr, physAdr, memData )) && ( level == MEM_LEVEL_MEM ))
+            level = MEM_LEVEL_L2;
+    }
+    
+    return( level );
+}
+
+void FunctionalEngine::setCacheWarming( bool arg ) {
+    
+    cacheWarming = arg;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Instruction address translation. The instruction address is translated with the instruction TLB when code
+// translation is enabled and checked for execute access rights, privilege level and protection id. Otherwise
+// we must run privileged and the offset is the physical address. The routine returns the trap to raise or
+// NO_TRAP when the physical address could be determined.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t FunctionalEngine::lookupInstrAdr( uint32_t *physAdr ) {
+    
+    if ( getBit( psw0, ST_CODE_TRANSLATION_ENABLE )) {
+        
+        uint32_t seg            = getBitField( psw0, 31, 16 );
+        TlbEntry *tlbEntryPtr   = core -> iTlb -> lookupTlbEntry( seg, psw1 );
+        if ( tlbEntryPtr == nullptr ) tlbEntryPtr = core -> iTlb -> refillTlbEntry( seg, psw1, false );
+        
+        if ( tlbEntryPtr == nullptr ) return( ITLB_MISS_TRAP );
+        
+        if ( tlbEntryPtr -> tPageType( ) != ACC_EXECUTE ) return( ITLB_ACC_RIGHTS_TRAP );
+        
+        if ( getBit( psw0, ST_PROTECT_ID_CHECK_ENABLE )) {
+            
+            if ( ! checkProtectId( tlbEntryPtr -> tSegId( ))) return( ITLB_PROTECT_ID_TRAP );
+        }
+        
+        if ( ! (( tlbEntryPtr -> tPrivL2( ) <= getBit( psw0, ST_EXECUTION_LEVEL )) &&
+                ( getBit( psw0, ST_EXECUTION_LEVEL ) <= tlbEntryPtr -> tPrivL1( )))) {
+            
+            return( INSTR_MEM_PROTECT_TRAP );
+        }
+        
+        *physAdr = tlbEntryPtr -> tPhysPage( ) | getBitField( psw1, 31, PAGE_OFFSET_BITS );
+    }
+    else {
+        
+        if ( getBit( psw0, ST_EXECUTION_LEVEL )) return( INSTR_MEM_PROTECT_TRAP );
+        
+        *physAdr = psw1;
+    }
+    
+    if ( ! isAligned( *physAdr, 2 )) return( CODE_ALIGNMENT_TRAP );
+    
+    return( NO_TRAP );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Instruction fetch. On a trap, the routine returns false and the trap is already raised.
+//
+//------------------------------------------------------------------------------------------------------------
+bool FunctionalEngine::fetchInstr( uint32_t *instr ) {
+    
+    uint32_t physAdr = 0;
+    uint32_t trapId  = lookupInstrAdr( &physAdr );
+    
+    if ( trapId != NO_TRAP ) {
+        
+        raiseTrap( trapId );
+        return( false );
+    }
+    
+    uint8_t *dataPtr = mapPhysAdr( physAdr, 4 );
+    
+    if ( dataPtr != nullptr ) memcpy( instr, dataPtr, 4 );
+    else                      *instr = NOP_INSTR;
+    
+    if ( cacheWarming ) instrLevel = warmCaches( core -> iCacheL1, psw1, physAdr );
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The working copy of the PSW is written back to the FD stage PSW, which is the architectural instruction
+// address for both the pipeline and the functional engine.
+//
+//------------------------------------------------------------------------------------------------------------
+void FunctionalEngine::storePsw( ) {
+    
+    core -> fdStage -> psPstate0.load( psw0 );
+    core -> fdStage -> psPstate1.load( psw1 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "step" executes one instruction. We take the instruction address from the FD stage PSW, fetch and execute
+// the instruction and store the next instruction address back. The work itself is done by "execute".
+//
+//------------------------------------------------------------------------------------------------------------
+void FunctionalEngine::step( ) {
+    
+    uint32_t instr = 0;
+    
+    psw0    = core -> fdStage -> psPstate0.get( );
+    psw1    = core -> fdStage -> psPstate1.get( );
+    trapped = false;
+    
+    lastInstr   = NOP_INSTR;
+    instrLevel  = MEM_LEVEL_NONE;
+    dataLevel   = MEM_LEVEL_NONE;
+    
+    instrExecuted ++;
+    
+    if ( fetchInstr( &instr )) {
+        
+        lastInstr = instr;
+        execute( instr );
+    }
+    
+    storePsw( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "execute" performs the instruction work on the working copy of the PSW. The execution follows the
+// instruction definitions as implemented by the pipeline stages. Operand fetch corresponds to the FD stage,
+// address computation and memory access to the MA stage and the result computation to the EX stage. Any
+// trap aborts the instruction and continues with the trap handler. The routine is also used by the threaded
+// engine for the instructions it does not handle itself.
+//
+// Note: this is a rather long routine. But it is just one big case statement.
+//------------------------------------------------------------------------------------------------------------
+void FunctionalEngine::execute( uint32_t instr ) {
+    
+    CpuRegFile  *gReg       = &core -> gReg;
+    CpuRegFile  *sReg       = &core -> sReg;
+    CpuRegFile  *cReg       = &core -> cReg;
+    
+    uint32_t    nextIa      = 0;
+    uint32_t    opCode      = getBitField( instr, 5, 6 );
+    uint32_t    regR        = getBitField( instr, 9, 4 );
+    uint32_t    regA        = getBitField( instr, 27, 4 );
+    uint32_t    regB        = getBitField( instr, 31, 4 );
+    
+    if (( opCodeTab[ opCode ].flags & PRIV_INSTR ) && ( getBit( psw0, ST_EXECUTION_LEVEL ))) {
+        
+        raiseTrap( PRIV_OPERATION_TRAP, instr );
+        return;
+    }
+    
+    nextIa = psw1 + 4;
+    
+    switch ( opCode ) {
+        
+        case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:
+        case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU: {
+            
+            uint32_t valA = 0;
+            uint32_t valB = 0;
+            
+            switch ( getBitField( instr, 13, 2 )) {
+                
+                case OP_MODE_IMM: {
+                    
+                    valA = gReg -> get( regR );
+                    valB = getBitField( instr, 31, 18, true );
+                    
+                } break;
+                
+                case OP_MODE_REG: {
+                    
+                    valA = gReg -> get( regA );
+                    valB = gReg -> get( regB );
+                    
+                } break;
+                
+                case OP_MODE_REG_INDX: {
+                    
+                    uint32_t ofs = gReg -> get( regB ) + gReg -> get( regA );
+                    
+                    valA = gReg -> get( regR );
+                    
+                    if ( ! isAligned( ofs, getBitField( instr, 15, 2 ))) {
+                        
+                        raiseTrap( DATA_ALIGNMENT_TRAP, instr, 0, ofs );
+                        break;
+                    }
+                    
+                    if ( ! readData( instr, selectSeg( instr, ofs ), ofs, mapDataLen( instr ), &valB )) break;
+                    
+                } break;
+                
+                case OP_MODE_INDX: {
+                    
+                    uint32_t ofs = gReg -> get( regB ) + getBitField( instr, 27, 12, true );
+                    
+                    valA = gReg -> get( regR );
+                    
+                    if ( ! isAligned( ofs, getBitField( instr, 15, 2 ))) {
+                        
+                        raiseTrap( DATA_ALIGNMENT_TRAP, instr, 0, ofs );
+                        break;
+                    }
+                    
+                    if ( ! readData( instr, selectSeg( instr, ofs ), ofs, mapDataLen( instr ), &valB )) break;
+                    
+                } break;
+            }
+            
+            if ( trapped ) break;
+            
+            switch ( opCode ) {
+                
+                case OP_ADD: case OP_ADC: {
+                    
+                    uint32_t carryIn = (( opCode == OP_ADC ) && ( getBit( psw0, ST_CARRY ))) ? 1 : 0;
+                    bool     tmpC;
+                    uint32_t valR;
+                    
+                    if ( getBit( instr, 10 )) {
+                        
+                        uint64_t tmpU = (uint64_t) valA + valB + carryIn;
+                        tmpC = ( tmpU > UINT32_MAX );
+                        valR = (uint32_t) tmpU;
+                    }
+                    else {
+                        
+                        int64_t tmpS = (int64_t) (int32_t) valA + (int32_t) valB + carryIn;
+                        tmpC = ( tmpS > INT32_MAX ) || ( tmpS < INT32_MIN );
+                        valR = (uint32_t) tmpS;
+                    }
+                    
+                    if (( getBit( instr, 11 )) && ( tmpC )) {
+                        
+                        raiseTrap( OVERFLOW_TRAP, instr );
+                        break;
+                    }
+                    
+                    gReg -> load( regR, valR );
+                    psw0 = setBitField( psw0, tmpC, ST_CARRY, 1 );
+                    
+                } break;
+                
+                case OP_SUB: case OP_SBC: {
+                    
+                    uint32_t borrowIn = (( opCode == OP_SBC ) && ( getBit( psw0, ST_CARRY ))) ? 1 : 0;
+                    bool     tmpC;
+                    uint32_t valR;
+                    
+                    if ( getBit( instr, 10 )) {
+                        
+                        int64_t tmpU = (int64_t) valA - valB - borrowIn;
+                        tmpC = ( tmpU < 0 );
+                        valR = (uint32_t) tmpU;
+                    }
+                    else {
+                        
+                        int64_t tmpS = (int64_t) (int32_t) valA - (int32_t) valB - borrowIn;
+                        tmpC = ( tmpS > INT32_MAX ) || ( tmpS < INT32_MIN );
+                        valR = (uint32_t) tmpS;
+                    }
+                    
+                    if (( getBit( instr, 11 )) && ( tmpC )) {
+                        
+                        raiseTrap( OVERFLOW_TRAP, instr );
+                        break;
+                    }
+                    
+                    gReg -> load( regR, valR );
+                    psw0 = setBitField( psw0, tmpC, ST_CARRY, 1 );
+                    
+                } break;
+                
+                case OP_AND: {
+                    
+                    if ( getBit( instr, 11 )) valB = ~ valB;
+                    uint32_t valR = valA & valB;
+                    if ( getBit( instr, 10 )) valR = ~ valR;
+                    gReg -> load( regR, valR );
+                    
+                } break;
+                
+                case OP_OR: {
+                    
+                    if ( getBit( instr, 11 )) valB = ~ valB;
+                    uint32_t valR = valA | valB;
+                    if ( getBit( instr, 10 )) valR = ~ valR;
+                    gReg -> load( regR, valR );
+                    
+                } break;
+                
+                case OP_XOR: {
+                    
+                    uint32_t valR = valA ^ valB;
+                    if ( getBit( instr, 10 )) valR = ~ valR;
+                    gReg -> load( regR, valR );
+                    
+                } break;
+                
+                case OP_CMP: {
+                    
+                    gReg -> load( regR, compareCond( instr, valA, valB ) ? 1 : 0 );
+                    
+                } break;
+                
+                case OP_CMPU: {
+                    
+                    gReg -> load( regR, compareCondU( instr, valA, valB ) ? 1 : 0 );
+                    
+                } break;
+            }
+            
+        } break;
+        
+        case OP_ADDIL: {
+            
+            gReg -> load( 1, gReg -> get( regR ) + ( getBitField( instr, 31, 22 ) << 10 ));
+            
+        } break;
+        
+        case OP_LDIL: {
+            
+            gReg -> load( regR, getBitField( instr, 31, 22 ) << 10 );
+            
+        } break;
+        
+        case OP_LDO: {
+            
+            gReg -> load( regR, gReg -> get( regB ) + getBitField( instr, 27, 18, true ));
+            
+        } break;
+        
+        case OP_LSID: {
+            
+            gReg -> load( regR, sReg -> get( getBitField( instr, 31, 3 ) ));
+            
+        } break;
+        
+        case OP_EXTR: {
+            
+            uint32_t extrOpPos = getBitField( instr, 27, 5 );
+            uint32_t extrOpLen = getBitField( instr, 21, 5 );
+            
+            if ( getBit( instr, 11 )) extrOpPos = getBitField( cReg -> get( CR_SHIFT_AMOUNT ), 31, 5 );
+            
+            gReg -> load( regR, getBitField( gReg -> get( regB ), extrOpPos, extrOpLen, getBit( instr, 10 )));
+            
+        } break;
+        
+        case OP_DEP: {
+            
+            uint32_t depOpPos = getBitField( instr, 27, 5 );
+            uint32_t depOpLen = getBitField( instr, 21, 5 );
+            uint32_t valA     = ( getBit( instr, 10 )) ? 0 : gReg -> get( regR );
+            uint32_t valB     = ( getBit( instr, 12 )) ? regB : gReg -> get( regB );
+            
+            if ( getBit( instr, 11 )) depOpPos = getBitField( cReg -> get( CR_SHIFT_AMOUNT ), 31, 5 );
+            
+            gReg -> load( regR, setBitField( valA, valB, depOpPos, depOpLen ));
+            
+        } break;
+        
+        case OP_DSR: {
+            
+            uint32_t shAmtLen = getBitField( instr, 21, 5 );
+            
+            if ( getBit( instr, 11 )) shAmtLen = getBitField( cReg -> get( CR_SHIFT_AMOUNT ), 31, 5 );
+            
+            uint64_t tmp = ((uint64_t) gReg -> get( regB ) << WORD_SIZE ) | gReg -> get( regA );
+            gReg -> load( regR, (uint32_t) ( tmp >> shAmtLen ));
+            
+        } break;
+        
+        case OP_SHLA: {
+            
+            uint32_t shAmt  = getBitField( instr, 21, 2 );
+            uint32_t valA   = gReg -> get( regA );
+            uint32_t valB   = gReg -> get( regB );
+            
+            if ( getBit( instr, 12 )) {
+                
+                uint64_t tmpU = ((uint64_t) valA << shAmt ) + valB;
+                
+                if (( getBit( instr, 11 )) && ( tmpU > UINT32_MAX )) {
+                    
+                    raiseTrap( OVERFLOW_TRAP, instr );
+                    break;
+                }
+                
+                gReg -> load( regR, (uint32_t) tmpU );
+            }
+            else {
+                
+                int64_t tmpS = ((int64_t) (int32_t) valA * ( 1 << shAmt )) + (int32_t) valB;
+                
+                if (( getBit( instr, 11 )) && (( tmpS < INT32_MIN ) || ( tmpS > INT32_MAX ))) {
+                    
+                    raiseTrap( OVERFLOW_TRAP, instr );
+                    break;
+                }
+                
+                gReg -> load( regR, (uint32_t) tmpS );
+            }
+            
+        } break;
+        
+        case OP_CMR: {
+            
+            uint32_t valA = gReg -> get( regA );
+            uint32_t valB = gReg -> get( regB );
+            
+            if ( testCond( instr, valB )) gReg -> load( regR, valA );
+            else                          gReg -> load( regR, compareCond( instr, valA, valB ) ? 1 : 0 );
+            
+        } break;
+        
+        case OP_DS: {
+            
+            uint32_t valA = gReg -> get( regA );
+            uint32_t valB = gReg -> get( regB );
+            uint64_t tmp  = ((uint64_t) valA << 1 ) | ( getBit( psw0, ST_CARRY ) ? 1 : 0 );
+            
+            if ( getBit( psw0, ST_DIVIDE_STEP )) tmp = tmp - valB;
+            else                                 tmp = tmp + valB;
+            
+            gReg -> load( regR, (uint32_t) tmp );
+            psw0 = setBitField( psw0, ( tmp > UINT32_MAX ), ST_CARRY, 1 );
+            psw0 = setBitField( psw0, getBit( psw0, ST_CARRY ) ^ getBit( valB, 0 ), ST_DIVIDE_STEP, 1 );
+            
+        } break;
+        
+        case OP_MR: {
+            
+            if ( getBit( instr, 10 )) {
+                
+                if ( getBit( instr, 11 )) cReg -> load( getBitField( instr, 31, 5 ), gReg -> get( regR ));
+                else                      sReg -> load( getBitField( instr, 31, 3 ), gReg -> get( regR ));
+            }
+            else {
+                
+                if ( getBit( instr, 11 )) gReg -> load( regR, cReg -> get( getBitField( instr, 31, 5 ) ));
+                else                      gReg -> load( regR, sReg -> get( getBitField( instr, 31, 3 ) ));
+            }
+            
+        } break;
+        
+        case OP_MST: {
+            
+            switch ( getBitField( instr, 11, 2 )) {
+                
+                case 0: psw0 = setBitField( psw0, gReg -> get( regB ), 15, 6 );                          break;
+                case 1: psw0 = psw0 | ( getBitField( instr, 31, 6 ) << ( 31 - 15 ));                    break;
+                case 2: psw0 = psw0 & ( ~ ( getBitField( instr, 31, 6 ) << ( 31 - 15 )));                break;
+                default: raiseTrap( ILLEGAL_INSTR_TRAP, instr );
+            }
+            
+        } break;
+        
+        case OP_LD:     case OP_LDR:    case OP_LDA: {
+            
+            uint32_t valX = ( getBit( instr, 10 )) ? gReg -> get( regA ) : getBitField( instr, 27, 12, true );
+            uint32_t ofs  = gReg -> get( regB ) + valX;
+            uint32_t seg  = ( opCode == OP_LDA ) ? 0 : selectSeg( instr, ofs );
+            uint32_t len  = ( opCode == OP_LDA ) ? 4 : mapDataLen( instr );
+            uint32_t valB = 0;
+            
+            if ( ! isAligned( ofs, ( opCode == OP_LDA ) ? 2 : getBitField( instr, 15, 2 ))) {
+                
+                raiseTrap( DATA_ALIGNMENT_TRAP, instr, seg, ofs );
+                break;
+            }
+            
+            if ( ! readData( instr, seg, ofs, len, &valB )) break;
+            
+            gReg -> load( regR, valB );
+            
+            if (( opCode != OP_LDR ) && ( getBit( instr, 11 )) && ( regR != regB )) gReg -> load( regB, ofs );
+            
+        } break;
+        
+        case OP_ST:     case OP_STC:    case OP_STA: {
+            
+            uint32_t valX = ( getBit( instr, 10 )) ? gReg -> get( regA ) : getBitField( instr, 27, 12, true );
+            uint32_t ofs  = gReg -> get( regB ) + valX;
+            uint32_t seg  = ( opCode == OP_STA ) ? 0 : selectSeg( instr, ofs );
+            uint32_t len  = ( opCode == OP_STA ) ? 4 : mapDataLen( instr );
+            
+            if ( ! isAligned( ofs, ( opCode == OP_STA ) ? 2 : getBitField( instr, 15, 2 ))) {
+                
+                raiseTrap( DATA_ALIGNMENT_TRAP, instr, seg, ofs );
+                break;
+            }
+            
+            if ( ! writeData( instr, seg, ofs, len, gReg -> get( regR ))) break;
+            
+            // ??? the STC reservation check is not implemented yet, we always succeed.
+            if      ( opCode == OP_STC )      gReg -> load( regR, 0 );
+            else if ( getBit( instr, 11 ))    gReg -> load( regB, ofs );
+            
+        } break;
+        
+        case OP_B: {
+            
+            gReg -> load( regR, psw1 + 4 );
+            nextIa = psw1 + ( getBitField( instr, 31, 22, true ) << 2 );
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_GATE: {
+            
+            // ??? what about the priv stuff ?
+            gReg -> load( regR, psw1 );
+            nextIa = psw1 + ( getBitField( instr, 31, 22, true ) << 2 );
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_BR: {
+            
+            gReg -> load( regR, psw1 + 4 );
+            nextIa = psw1 + gReg -> get( regB );
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_BV: {
+            
+            gReg -> load( regR, psw1 + 4 );
+            nextIa = gReg -> get( regB );
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_BE: {
+            
+            uint32_t segAdr = getBitField( sReg -> get( regA ), 31, 16 );
+            
+            sReg -> load( 0, getBitField( psw0, 31, 16 ));
+            gReg -> load( regR, psw1 + 4 );
+            psw0    = setBitField( psw0, segAdr, 31, 16 );
+            nextIa  = gReg -> get( regB ) + ( getBitField( instr, 23, 14, true ) << 2 );
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_BVE: {
+            
+            uint32_t ofs    = gReg -> get( regB ) + gReg -> get( regA );
+            uint32_t segAdr = selectSeg( instr, ofs );
+            
+            gReg -> load( regR, psw1 + 4 );
+            psw0    = setBitField( psw0, segAdr, 31, 16 );
+            nextIa  = ofs;
+            branchesTaken ++;
+            
+        } break;
+        
+        case OP_CBR:    case OP_CBRU: {
+            
+            uint32_t valA = gReg -> get( regA );
+            uint32_t valB = gReg -> get( regB );
+            bool     branchTaken;
+            
+            if ( opCode == OP_CBR ) branchTaken = compareCond( instr, valA, valB );
+            else                    branchTaken = compareCondU( instr, valA, valB );
+            
+            if ( branchTaken ) {
+                
+                nextIa = psw1 + getBitField( instr, 31, 22, true );
+                branchesTaken ++;
+            }
+            
+        } break;
+        
+        case OP_LDPA:   case OP_PRB: {
+            
+            uint32_t  ofs         = gReg -> get( regB ) + (( opCode == OP_LDPA ) ? gReg -> get( regA ) : 0 );
+            uint32_t  seg         = selectSeg( instr, ofs );
+            TlbEntry  *tlbEntryPtr = core -> dTlb -> lookupTlbEntry( seg, ofs );
+            
+            if ( opCode == OP_LDPA ) {
+                
+                if ( tlbEntryPtr == nullptr ) gReg -> load( regR, 0 );
+                else gReg -> load( regR, tlbEntryPtr -> tPhysPage( ) | ( ofs % PAGE_SIZE_BYTES ));
+            }
+            else {
+                
+                bool accessOk = ( tlbEntryPtr != nullptr );
+                
+                if (( accessOk ) && ( getBit( instr, 10 ))) {
+                    
+                    accessOk = ( tlbEntryPtr -> tPageType( ) == ACC_READ_WRITE );
+                }
+                else if ( accessOk ) {
+                    
+                    accessOk = (( tlbEntryPtr -> tPageType( ) == ACC_READ_WRITE ) ||
+                                ( tlbEntryPtr -> tPageType( ) == ACC_READ_ONLY ));
+                }
+                
+                gReg -> load( regR, accessOk ? 1 : 0 );
+            }
+            
+        } break;
+        
+        case OP_ITLB: {
+            
+            CpuTlb      *tlbPtr = ( getBit( instr, 11 )) ? core -> dTlb : core -> iTlb;
+            uint32_t    tlbSeg  = sReg -> get( regA % MAX_SREGS );
+            uint32_t    tlbOfs  = getBitField( gReg -> get( regB ), 31, 30 );
+            
+            if ( getBit( instr, 12 )) tlbPtr -> insertTlbEntryProt( tlbSeg, tlbOfs, gReg -> get( regR ));
+            else                      tlbPtr -> insertTlbEntryAdr( tlbSeg, tlbOfs, gReg -> get( regR ));
+            
+        } break;
+        
+        case OP_PTLB: {
+            
+            uint32_t ofs    = gReg -> get( regB ) + gReg -> get( regA );
+            CpuTlb   *tlbPtr = ( getBit( instr, 11 )) ? core -> dTlb : core -> iTlb;
+            
+            tlbPtr -> purgeTlbEntry( selectSeg( instr, ofs ), ofs );
+            
+        } break;
+        
+        case OP_PCA: {
+            
+            // ??? the caches are bypassed in the functional mode, nothing to flush or purge.
+            
+        } break;
+        
+        case OP_DIAG: {
+            
+        } break;
+        
+        case OP_BRK: {
+            
+            if (( regR != 0 ) || ( getBitField( instr, 31, 16 ) != 0 )) {
+                
+                raiseTrap( BREAK_TRAP, instr, regR, getBitField( instr, 31, 16 ));
+            }
+            
+        } break;
+        
+        case OP_RFI: {
+            
+            psw0    = cReg -> get( CR_TRAP_PSW_0 );
+            nextIa  = cReg -> get( CR_TRAP_PSW_1 );
+            
+        } break;
+        
+        default: {
+            
+            raiseTrap( ILLEGAL_INSTR_TRAP, instr );
+        }
+    }
+    
+    //--------------------------------------------------------------------------------------------------------
+    // A trap has already set the instruction address to the trap handler. Otherwise we advance to the next
+    // instruction address.
+    //
+    //--------------------------------------------------------------------------------------------------------
+    if ( ! trapped ) psw1 = nextIa;
+}
@@ -0,0 +1,386 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - JIT Engine
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 JIT engine. The threaded engine already avoids the decoding of instructions, but still calls a
+// handler for each instruction. For really long runs, the hot blocks are compiled into host machine code.
+// The code for a block is a straight sequence of host instructions for each instruction in the block. The
+// ALU instructions in register and immediate mode and the immediate load instructions are translated into
+// a few host instructions. All other instructions call the generic handler of the threaded engine, which
+// hands them to the functional engine. This way, memory access, address translation and traps are handled
+// in one place and the compiled code does not need to know about them.
+//
+// The compiled code works directly on the general registers of the CPU core and on the working status word
+// of the functional engine. Their addresses are fixed for the lifetime of the CPU core and are put into
+// the code as constants.
+//
+// Register use of the generated code on x86-64 hosts:
+//
+//      RBX     - address of the general register file
+//      R12     - address of the working status word
+//      EAX     - operand A and result
+//      ECX     - operand B
+//      EDX     - carry bit
+//      R8D     - status word update
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - JIT Engine
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+#include <stddef.h>
+
+#if __APPLE__ || __unix__
+#include <unistd.h>
+#include <sys/mman.h>
+#elif _WIN32
+#include <windows.h>
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. Most of the routines are inline functions.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+const bool JIT_HOST_X86_64 = true;
+#else
+const bool JIT_HOST_X86_64 = false;
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+// Host register numbers and instruction bytes used by the code generator.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint8_t HOST_EAX      = 0;
+const uint8_t HOST_ECX      = 1;
+
+const uint8_t SETC_DL       = 0x92;
+const uint8_t SETO_DL       = 0x90;
+
+const uint32_t CARRY_SHIFT  = 31 - ST_CARRY;
+
+//------------------------------------------------------------------------------------------------------------
+// The code cache is never writable and executable at the same time. "allocCodeCache" allocates it with read
+// and write access, "protectCodeCache" switches the pages of an address range between write access and
+// execute access. On macOS, the area is mapped with MAP_JIT, as the hardened runtime otherwise refuses to
+// make the pages executable. On a host without a known memory mapping interface, there is no code cache and
+// the JIT is not available.
+//
+//------------------------------------------------------------------------------------------------------------
+#if __APPLE__ || __unix__
+
+#if __APPLE__
+const int CODE_CACHE_MAP_FLAGS = MAP_PRIVATE | MAP_ANONYMOUS | MAP_JIT;
+#else
+const int CODE_CACHE_MAP_FLAGS = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+
+uint8_t *allocCodeCache( size_t size ) {
+    
+    void *mem = mmap( nullptr, size, PROT_READ | PROT_WRITE, CODE_CACHE_MAP_FLAGS, -1, 0 );
+    return(( mem != MAP_FAILED ) ? (uint8_t *) mem : nullptr );
+}
+
+bool protectCodeCache( uint8_t *adr, size_t len, bool exec ) {
+    
+    uintptr_t pageSize  = sysconf( _SC_PAGESIZE );
+    uintptr_t start     = ((uintptr_t) adr ) & ~ ( pageSize - 1 );
+    
+    return( mprotect((void *) start,
+                     ((uintptr_t) adr + len ) - start,
+                     exec ? ( PROT_READ | PROT_EXEC ) : ( PROT_READ | PROT_WRITE )) == 0 );
+}
+
+#elif _WIN32
+
+uint8_t *allocCodeCache( size_t size ) {
+    
+    return((uint8_t *) VirtualAlloc( nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE ));
+}
+
+bool protectCodeCache( uint8_t *adr, size_t len, bool exec ) {
+    
+    DWORD oldProtect;
+    
+    if ( ! VirtualProtect( adr, len, exec ? PAGE_EXECUTE_READ : PAGE_READWRITE, &oldProtect )) return( false );
+    if ( exec ) FlushInstructionCache( GetCurrentProcess( ), adr, len );
+    return( true );
+}
+
+#else
+
+uint8_t *allocCodeCache( size_t ) {
+    
+    return( nullptr );
+}
+
+bool protectCodeCache( uint8_t *, size_t, bool ) {
+    
+    return( false );
+}
+
+#endif
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The JIT engine object constructor. The code cache is allocated once. If this fails or we are not on an
+// x86-64 host, the JIT is just not available.
+//
+//------------------------------------------------------------------------------------------------------------
+JitEngine::JitEngine( ThreadedEngine *tc, CpuRegFile *gReg, uint32_t *psw0 ) {
+    
+    this -> tc      = tc;
+    this -> gReg    = gReg;
+    this -> psw0    = psw0;
+    
+    if ( JIT_HOST_X86_64 ) codeCache = allocCodeCache( JIT_CODE_CACHE_SIZE );
+    
+    reset( );
+    clearStats( );
+}
+
+void JitEngine::reset( ) {
+    
+    codePtr = codeCache;
+}
+
+void JitEngine::clearStats( ) {
+    
+    blocksCompiled  = 0;
+    cacheFlushes    = 0;
+}
+
+bool JitEngine::isAvailable( ) {
+    
+    return( codeCache != nullptr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Code emitter helpers. Register operands are addressed relative to RBX with a 32-bit displacement. A
+// register load in the CPU core sets both the inbound and outbound value, so the store writes both.
+//
+//------------------------------------------------------------------------------------------------------------
+void JitEngine::emitByte( uint8_t val ) {
+    
+    *codePtr++ = val;
+}
+
+void JitEngine::emitWord( uint32_t val ) {
+    
+    memcpy( codePtr, &val, 4 );
+    codePtr += 4;
+}
+
+void JitEngine::emitAdr( void *adr ) {
+    
+    uint64_t val = (uint64_t) adr;
+    
+    memcpy( codePtr, &val, 8 );
+    codePtr += 8;
+}
+
+void JitEngine::emitLoadReg( uint8_t hostReg, uint8_t regId ) {
+    
+    emitByte( 0x8B );
+    emitByte( 0x83 | ( hostReg << 3 ));
+    emitWord( offsetof( CpuRegFile, regOut ) + regId * sizeof( uint32_t ));
+}
+
+void JitEngine::emitStoreReg( uint8_t regId ) {
+    
+    emitByte( 0x89 );
+    emitByte( 0x83 );
+    emitWord( offsetof( CpuRegFile, regIn ) + regId * sizeof( uint32_t ));
+    
+    emitByte( 0x89 );
+    emitByte( 0x83 );
+    emitWord( offsetof( CpuRegFile, regOut ) + regId * sizeof( uint32_t ));
+}
+
+void JitEngine::emitLoadOperands( TcOp *op ) {
+    
+    emitLoadReg( HOST_EAX, op -> regA );
+    
+    if ( op -> useImm ) {
+        
+        emitByte( 0xB9 );
+        emitWord( op -> imm );
+    }
+    else emitLoadReg( HOST_ECX, op -> regB );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The carry bit is taken from the host flags right after the arithmetic instruction. The register store in
+// between does not change the flags.
+//
+//------------------------------------------------------------------------------------------------------------
+void JitEngine::emitSetCarry( uint8_t setCcOp ) {
+    
+    emitByte( 0x0F ); emitByte( setCcOp ); emitByte( 0xC2 );                            // setcc dl
+    emitByte( 0x0F ); emitByte( 0xB6 ); emitByte( 0xD2 );                               // movzx edx, dl
+    
+    if ( CARRY_SHIFT > 0 ) {
+        
+        emitByte( 0xC1 ); emitByte( 0xE2 ); emitByte( CARRY_SHIFT );                    // shl edx, n
+    }
+    
+    emitByte( 0x45 ); emitByte( 0x8B ); emitByte( 0x04 ); emitByte( 0x24 );             // mov r8d, [r12]
+    emitByte( 0x41 ); emitByte( 0x81 ); emitByte( 0xE0 ); emitWord( ~ ( 1U << CARRY_SHIFT ));   // and r8d, m
+    emitByte( 0x41 ); emitByte( 0x09 ); emitByte( 0xD0 );                               // or r8d, edx
+    emitByte( 0x45 ); emitByte( 0x89 ); emitByte( 0x04 ); emitByte( 0x24 );             // mov [r12], r8d
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The block exit sets the return value and restores the host registers saved on entry.
+//
+//------------------------------------------------------------------------------------------------------------
+void JitEngine::emitExit( uint32_t retVal ) {
+    
+    emitByte( 0xB8 ); emitWord( retVal );                                               // mov eax, val
+    emitByte( 0x48 ); emitByte( 0x83 ); emitByte( 0xC4 ); emitByte( 0x08 );             // add rsp, 8
+    emitByte( 0x41 ); emitByte( 0x5C );                                                 // pop r12
+    emitByte( 0x5B );                                                                   // pop rbx
+    emitByte( 0xC3 );                                                                   // ret
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "emitOp" generates the code for one instruction. The handler selected by the threaded engine tells what
+// kind of instruction we have and the operation record has the fields already extracted. The generic case
+// calls the generic handler with the threaded engine and the operation record as arguments. When the
+// handler returns false, the block is left right away with the number of instructions executed so far.
+//
+//------------------------------------------------------------------------------------------------------------
+bool JitEngine::emitOp( TcOp *op, uint32_t index ) {
+    
+    if ( op -> handler == ThreadedEngine::opAdd ) {
+        
+        emitLoadOperands( op );
+        emitByte( 0x01 ); emitByte( 0xC8 );                                             // add eax, ecx
+        emitStoreReg( op -> regR );
+        emitSetCarry(( op -> optA ) ? SETC_DL : SETO_DL );
+    }
+    else if ( op -> handler == ThreadedEngine::opSub ) {
+        
+        emitLoadOperands( op );
+        emitByte( 0x29 ); emitByte( 0xC8 );                                             // sub eax, ecx
+        emitStoreReg( op -> regR );
+        emitSetCarry(( op -> optA ) ? SETC_DL : SETO_DL );
+    }
+    else if (( op -> handler == ThreadedEngine::opAnd ) || ( op -> handler == ThreadedEngine::opOr )) {
+        
+        emitLoadOperands( op );
+        if ( op -> optB ) { emitByte( 0xF7 ); emitByte( 0xD1 ); }                       // not ecx
+        
+        if ( op -> handler == ThreadedEngine::opAnd ) { emitByte( 0x21 ); emitByte( 0xC8 ); }  // and eax, ecx
+        else                                          { emitByte( 0x09 ); emitByte( 0xC8 ); }  // or eax, ecx
+        
+        if ( op -> optA ) { emitByte( 0xF7 ); emitByte( 0xD0 ); }                       // not eax
+        emitStoreReg( op -> regR );
+    }
+    else if ( op -> handler == ThreadedEngine::opXor ) {
+        
+        emitLoadOperands( op );
+        emitByte( 0x31 ); emitByte( 0xC8 );                                             // xor eax, ecx
+        if ( op -> optA ) { emitByte( 0xF7 ); emitByte( 0xD0 ); }                       // not eax
+        emitStoreReg( op -> regR );
+    }
+    else if ( op -> handler == ThreadedEngine::opLdil ) {
+        
+        emitByte( 0xB8 ); emitWord( op -> imm );                                        // mov eax, imm
+        emitStoreReg( op -> regR );
+    }
+    else if ( op -> handler == ThreadedEngine::opAddil ) {
+        
+        emitLoadReg( HOST_EAX, op -> regR );
+        emitByte( 0x05 ); emitWord( op -> imm );                                        // add eax, imm
+        emitStoreReg( 1 );
+    }
+    else if ( op -> handler == ThreadedEngine::opLdo ) {
+        
+        emitLoadReg( HOST_EAX, op -> regB );
+        emitByte( 0x05 ); emitWord( op -> imm );                                        // add eax, imm
+        emitStoreReg( op -> regR );
+    }
+    else if ( op -> handler == ThreadedEngine::opGeneric ) {
+        
+        emitByte( 0x48 ); emitByte( 0xBF ); emitAdr( tc );                              // mov rdi, tc
+        emitByte( 0x48 ); emitByte( 0xBE ); emitAdr( op );                              // mov rsi, op
+        emitByte( 0x48 ); emitByte( 0xB8 ); emitAdr((void *) ThreadedEngine::opGeneric );  // mov rax, fn
+        emitByte( 0xFF ); emitByte( 0xD0 );                                             // call rax
+        emitByte( 0x84 ); emitByte( 0xC0 );                                             // test al, al
+        emitByte( 0x75 ); emitByte( 0x0D );                                             // jnz +13
+        emitExit(( index + 1 ) | JIT_EXIT_FLAG );
+    }
+    else return( false );
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "compile" generates the code for a block. On entry, the host registers we use for the base addresses are
+// saved and the stack is aligned for the handler calls. If the code cache cannot hold another block, all
+// translations are flushed and the block stays with the threaded engine for now. Should we find a handler
+// we do not know, the block is not compiled. The pages the block can occupy are writable only while the code
+// is generated, they may also hold earlier blocks and are made executable again in any case.
+//
+//------------------------------------------------------------------------------------------------------------
+bool JitEngine::compile( TcBlock *blk ) {
+    
+    if (( ! JIT_HOST_X86_64 ) || ( codeCache == nullptr )) return( false );
+    
+    if ( codePtr + JIT_MAX_BLOCK_BYTES > codeCache + JIT_CODE_CACHE_SIZE ) {
+        
+        cacheFlushes ++;
+        tc -> flush( );
+        return( false );
+    }
+    
+    uint8_t *start = codePtr;
+    
+    if ( ! protectCodeCache( start, JIT_MAX_BLOCK_BYTES, false )) return( false );
+    
+    emitByte( 0x53 );                                                                   // push rbx
+    emitByte( 0x41 ); emitByte( 0x54 );                                                 // push r12
+    emitByte( 0x48 ); emitByte( 0x83 ); emitByte( 0xEC ); emitByte( 0x08 );             // sub rsp, 8
+    emitByte( 0x48 ); emitByte( 0xBB ); emitAdr( gReg );                                // mov rbx, gReg
+    emitByte( 0x49 ); emitByte( 0xBC ); emitAdr( psw0 );                                // mov r12, psw0
+    
+    for ( uint32_t i = 0; i < blk -> numOps; i++ ) {
+        
+        if ( ! emitOp( &blk -> ops[ i ], i )) {
+            
+            codePtr = start;
+            protectCodeCache( start, JIT_MAX_BLOCK_BYTES, true );
+            return( false );
+        }
+    }
+    
+    emitExit( blk -> numOps );
+    
+    if ( ! protectCodeCache( start, JIT_MAX_BLOCK_BYTES, true )) {
+        
+        codePtr = start;
+        return( false );
+    }
+    
+    blk -> jitCode = (JitBlockFn) start;
+    blocksCompiled ++;
+    return( true );
+}
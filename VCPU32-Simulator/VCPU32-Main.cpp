@@ -31,7 +31,11 @@
 // be used to create a descriptor with the data coming from these variables. Also, we should have an option to
 // set the environment variables from a file, specified as an input argument to the program.
 //
-// ??? do we keep all descriptors in one structure ? What if the CPU has two cores ?
+// The CPU system consists of one or more cores with the same descriptor, which share the physical memory.
+// The number of cores is set with the "-cores=<n>" program argument or else the "VCPU32_CORES" environment
+// variable, the default is one core. The simulator windows show the first core.
+//
+// ??? do we keep all descriptors in one structure ?
 // ??? is the IO subsystem part of the CPU structure ? Still, we would need a memory range to configure...
 // ??? it would be nice to set some of the values via program argument inputs.whelp
 //------------------------------------------------------------------------------------------------------------
@@ -39,6 +43,27 @@ int main( int argc, const char* argv[ ] ) {
     
     VCPU32Globals     glbDesc;
     CpuCoreDesc       cpuDesc;
+    uint32_t          numOfCores        = 1;
+    const char        *coresArg         = getenv( "VCPU32_CORES" );
+    
+    for ( int i = 1; i < argc; i++ ) {
+        
+        if ( strncmp( argv[ i ], "-cores=", 7 ) == 0 ) coresArg = argv[ i ] + 7;
+    }
+    
+    if ( coresArg != nullptr ) {
+        
+        char            *endPtr = nullptr;
+        unsigned long   val     = strtoul( coresArg, &endPtr, 10 );
+        
+        if (( *coresArg == '\0' ) || ( *endPtr != '\0' ) || ( val == 0 ) || ( val > MAX_CPU_CORES )) {
+            
+            fprintf( stderr, "Invalid number of cores: %s, expected 1 .. %u\n", coresArg, MAX_CPU_CORES );
+            return( 1 );
+        }
+        
+        numOfCores = (uint32_t) val;
+    }
     
     cpuDesc.flags                       = 0;
     
@@ -54,6 +79,12 @@ int main( int argc, const char* argv[ ] ) {
     cpuDesc.dTlbDesc.entries            = 1024;
     cpuDesc.dTlbDesc.accessType         = TLB_AT_DIRECT_MAPPED;
     
+    cpuDesc.uTlbDescL2.type             = TLB_T_L2_UNIFIED;
+    cpuDesc.uTlbDescL2.entries          = 2048;
+    cpuDesc.uTlbDescL2.accessType       = TLB_AT_SET_ASSOCIATIVE;
+    cpuDesc.uTlbDescL2.ways             = 4;
+    cpuDesc.uTlbDescL2.latency          = 2;
+    
     cpuDesc.iCacheDescL1.type           = MEM_T_L1_INSTR;
     cpuDesc.iCacheDescL1.accessType     = MEM_AT_DIRECT_MAPPED;
     cpuDesc.iCacheDescL1.blockEntries   = 1024;
@@ -105,7 +136,8 @@ int main( int argc, const char* argv[ ] ) {
     cpuDesc.ioDesc.latency              = 2;
     cpuDesc.ioDesc.priority             = 3;
     
-    glbDesc.cpu                         = new CpuCore( &cpuDesc );
+    glbDesc.sys                         = new CpuSystem( &cpuDesc, numOfCores );
+    glbDesc.cpu                         = glbDesc.sys -> getCore( 0 );
     
     glbDesc.env                         = new SimEnv( MAX_ENV_VARIABLES );
     glbDesc.console                     = new SimConsoleIO( );
@@ -114,6 +146,6 @@ int main( int argc, const char* argv[ ] ) {
     glbDesc.console     -> initConsoleIO( );
     glbDesc.env         -> setupPredefined( );
     glbDesc.winDisplay  -> setupWinDisplay( argc, argv );
-    glbDesc.cpu         -> reset( );
+    glbDesc.sys         -> reset( );
     glbDesc.winDisplay  -> startWinDisplay( );
 }
@@ -55,6 +55,11 @@
 #include "VCPU32-Types.h"
 #include "VCPU32-Core.h"
 
+#if __APPLE__ || __unix__
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 //------------------------------------------------------------------------------------------------------------
 // File local declarations. There are constants and routines used internally and not visible outside of this
 // file.
@@ -84,7 +89,9 @@ enum MemOpState : uint16_t {
     MO_WRITE_BLOCK              = 5,
     MO_WRITE_BACK_BLOCK         = 6,
     MO_FLUSH_BLOCK              = 7,
-    MO_PURGE_BLOCK              = 8
+    MO_PURGE_BLOCK              = 8,
+    MO_SNOOP_WAIT               = 9,
+    MO_FILL_BLOCK               = 10
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -132,6 +139,177 @@ uint32_t maxBlocks( CpuMemType memType, uint32_t blockSize ) {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// Replacement policy helpers. The policy state of a block index is one word. True LRU keeps the sets as a
+// list of 4-bit set numbers, the most recently used set in the lowest nibble. Tree PLRU uses the bits 1 to
+// "blockSets - 1" as a binary tree, a bit points to the half that is to be replaced next. SRRIP and BRRIP
+// keep a 2-bit re-reference prediction value per set, a value of three predicts a distant re-reference.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t RRPV_MAX         = 3;
+const uint32_t BRRIP_LONG_ODDS  = 32;
+
+//------------------------------------------------------------------------------------------------------------
+// Prefetcher constants. An access continues a stream when it is at most this many blocks away from the last
+// block of the stream.
+//
+//------------------------------------------------------------------------------------------------------------
+const int32_t  STREAM_WINDOW    = 4;
+
+uint32_t initReplState( CpuMemReplPolicy policy ) {
+    
+    switch ( policy ) {
+            
+        case MEM_RP_LRU:    return( 0x76543210 );
+        case MEM_RP_SRRIP:
+        case MEM_RP_BRRIP:  return( 0xFFFFFFFF );
+        default:            return( 0 );
+    }
+}
+
+uint32_t nextRandom( uint32_t *state ) {
+    
+    uint32_t x = *state;
+    
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    
+    *state = x;
+    return( x );
+}
+
+uint32_t lruTouch( uint32_t state, uint16_t set, uint32_t sets ) {
+    
+    uint32_t pos = 0;
+    while (( pos < sets - 1 ) && ((( state >> ( pos * 4 )) & 0xF ) != set )) pos++;
+    
+    uint32_t lowMask = ( 1U << ( pos * 4 )) - 1;
+    uint32_t posMask = 0xFU << ( pos * 4 );
+    
+    return(( state & ~ ( lowMask | posMask )) | (( state & lowMask ) << 4 ) | set );
+}
+
+uint16_t lruVictim( uint32_t state, uint32_t sets ) {
+    
+    return(( state >> (( sets - 1 ) * 4 )) & 0xF );
+}
+
+uint32_t plruTouch( uint32_t state, uint16_t set, uint32_t sets ) {
+    
+    for ( uint32_t node = set + sets; node > 1; node = node / 2 ) {
+        
+        if ( node & 1 ) state &= ~ ( 1U << ( node / 2 ));
+        else            state |= ( 1U << ( node / 2 ));
+    }
+    
+    return( state );
+}
+
+uint16_t plruVictim( uint32_t state, uint32_t sets ) {
+    
+    uint32_t node = 1;
+    while ( node < sets ) node = node * 2 + (( state >> node ) & 1 );
+    
+    return( node - sets );
+}
+
+uint32_t rrpvSet( uint32_t state, uint16_t set, uint32_t val ) {
+    
+    return(( state & ~ ( RRPV_MAX << ( set * 2 ))) | ( val << ( set * 2 )));
+}
+
+uint16_t rrpvVictim( uint32_t *state, uint32_t sets ) {
+    
+    while ( true ) {
+        
+        for ( uint32_t i = 0; i < sets; i++ ) {
+            
+            if ((( *state >> ( i * 2 )) & RRPV_MAX ) == RRPV_MAX ) return( i );
+        }
+        
+        for ( uint32_t i = 0; i < sets; i++ ) *state += ( 1U << ( i * 2 ));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Sparse data array helpers. A large data array is an anonymous private mapping that reserves no swap space.
+// The host commits a page on the first write, reading an untouched page just returns zeroes. Clearing the
+// array maps a fresh range over the old one, which gives back all committed pages at once. "mincore" takes
+// a different vector type on macOS. A host without these POSIX routines, such as Windows, does not map the
+// data array, the caller then allocates it and clears it with "memset".
+//
+//------------------------------------------------------------------------------------------------------------
+#if __APPLE__ || __unix__
+
+#if __APPLE__
+typedef char            MincoreVec;
+#else
+typedef unsigned char   MincoreVec;
+#endif
+
+size_t hostPageSize( ) {
+    
+    return( sysconf( _SC_PAGESIZE ));
+}
+
+uint8_t *mapDataArray( size_t len ) {
+    
+    void *ptr = mmap( nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0 );
+    
+    return(( ptr == MAP_FAILED ) ? nullptr : (uint8_t *) ptr );
+}
+
+bool remapDataArray( uint8_t *data, size_t len ) {
+    
+    int  flags  = MAP_PRIVATE | MAP_ANON | MAP_NORESERVE | MAP_FIXED;
+    void *ptr   = mmap( data, len, PROT_READ | PROT_WRITE, flags, -1, 0 );
+    
+    return( ptr == data );
+}
+
+uint32_t residentPages( uint8_t *data, size_t len ) {
+    
+    size_t      pageSize    = hostPageSize( );
+    size_t      pages       = ( len + pageSize - 1 ) / pageSize;
+    uint32_t    resident    = 0;
+    MincoreVec  *vec        = (MincoreVec *) malloc( pages );
+    
+    if ( vec == nullptr ) return( 0 );
+    
+    if ( mincore( data, len, vec ) == 0 ) {
+        
+        for ( size_t i = 0; i < pages; i++ ) if ( vec[ i ] & 1 ) resident ++;
+    }
+    
+    free( vec );
+    return( resident );
+}
+
+#else
+
+size_t hostPageSize( ) {
+    
+    return( 4096 );
+}
+
+uint8_t *mapDataArray( size_t ) {
+    
+    return( nullptr );
+}
+
+bool remapDataArray( uint8_t *, size_t ) {
+    
+    return( false );
+}
+
+uint32_t residentPages( uint8_t *, size_t ) {
+    
+    return( 0 );
+}
+
+#endif
+
 }; // namespace
 
 
@@ -141,7 +319,8 @@ uint32_t maxBlocks( CpuMemType memType, uint32_t blockSize ) {
 // tag match operation of the selected block. Besides the the configuration descriptor, we are passed an
 // optional handle to a lower memory layer. Note that the memory object is an abstract class used by a
 // particular memory object. Allocating space for data and tag memory must be handled by the inheriting
-// class.
+// class. The number of blocks is rounded to a power of two that stays within the maximum size of the memory
+// type, a physical memory close to 4 Gbytes would otherwise wrap the size computation.
 //
 //------------------------------------------------------------------------------------------------------------
 CpuMem::CpuMem( CpuMemDesc *cfg, CpuMem *mem ) {
@@ -151,16 +330,25 @@ CpuMem::CpuMem( CpuMemDesc *cfg, CpuMem *mem ) {
     cDesc.blockSize     = roundUp( cDesc.blockSize, MAX_BLOCK_SIZE );
     cDesc.blockSets     = roundUp( cDesc.blockSets, MAX_BLOCK_SETS );
     cDesc.blockEntries  = roundUp( cDesc.blockEntries, maxBlocks( cDesc.type, cDesc.blockSize ));
+    
+    if ( cDesc.blockEntries > maxBlocks( cDesc.type, cDesc.blockSize )) cDesc.blockEntries /= 2;
+    
     cDesc.endAdr        = cDesc.startAdr + cDesc.blockEntries * cDesc.blockSize - 1;
     blockBits           = getBlockBits( cDesc.blockSize );
     blockBitMask        = getBlockBitMask( cDesc.blockSize );
     memObjPriority      = cDesc.priority;
     opState             = MO_IDLE;
     lowerMem            = mem;
+    
+    if ( cDesc.mshrEntries > MAX_MSHR_ENTRIES )         cDesc.mshrEntries       = MAX_MSHR_ENTRIES;
+    if ( cDesc.prefetchEntries > MAX_PREFETCH_ENTRIES ) cDesc.prefetchEntries   = MAX_PREFETCH_ENTRIES;
+    if ( cDesc.prefetchEntries == 0 )                   cDesc.prefetchEntries   = 1;
+    if ( cDesc.prefetchDegree > MAX_PREFETCH_ENTRIES )  cDesc.prefetchDegree    = MAX_PREFETCH_ENTRIES;
 }
 
 //------------------------------------------------------------------------------------------------------------
-// Reset the memory object. We clear the data structures and set the request state machine to idle.
+// Reset the memory object. We clear the data structures and set the request state machine to idle. A sparse
+// data array is cleared by mapping it anew, the cost depends on the pages touched, not on the memory size.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuMem::reset( ) {
@@ -171,34 +359,53 @@ void CpuMem::reset( ) {
             
             for ( uint32_t j = 0; j < cDesc.blockEntries; j++ ) {
                 
-                tagArray[ i ] [ j ].valid = false;
-                tagArray[ i ] [ j ].dirty = false;
-                tagArray[ i ] [ j ].tag   = 0;
+                tagArray[ i ] [ j ].valid       = false;
+                tagArray[ i ] [ j ].dirty       = false;
+                tagArray[ i ] [ j ].shared      = false;
+                tagArray[ i ] [ j ].invalidated = false;
+                tagArray[ i ] [ j ].prefetched  = false;
+                tagArray[ i ] [ j ].tag         = 0;
             }
         }
         
         if ( dataArray[ i ] != nullptr ) {
             
-            uint32_t tmpSize = cDesc.blockEntries * cDesc.blockSize;
-            for ( uint32_t j = 0; j < tmpSize; j++ ) dataArray[ i ] [ j ] = 0;
+            size_t tmpSize = (size_t) cDesc.blockEntries * cDesc.blockSize;
+            
+            if (( ! dataMapped ) || ( ! remapDataArray( dataArray[ i ], tmpSize )))
+                memset( dataArray[ i ], 0, tmpSize );
         }
     }
     
     opState.load( MO_IDLE );
-    reqSeg      = 0;
-    reqOfs      = 0;
-    reqPri      = 0;
-    reqTag      = 0;
-    reqLen      = 0;
-    reqPtr      = nullptr;
-    reqLatency  = cDesc.latency;
-   
+    reqSeg          = 0;
+    reqOfs          = 0;
+    reqPri          = 0;
+    reqTag          = 0;
+    reqLen          = 0;
+    reqPtr          = nullptr;
+    reqLatency      = cDesc.latency;
+    reqExclusive    = false;
+    reqResumeState  = MO_IDLE;
+    reqFillPending  = false;
+    reqMshr         = MAX_MSHR_ENTRIES;
+    accessThisCycle = false;
+    accessLastCycle = false;
+    reqPrefetch     = false;
+    reqPrefetchLate = false;
+    mshrPendingCnt  = 0;
+    
+    for ( uint32_t i = 0; i < MAX_MSHR_ENTRIES; i++ ) mshrArray[ i ].valid = false;
+    
+    resetReplState( );
+    resetPrefetcher( );
     clearStats( );
 }
 
 //------------------------------------------------------------------------------------------------------------
 // Reset the statistics. We maintain counters for total access, misses and how many cycles we waited for a
-// lower layer to read/ write some data.
+// lower layer to read/ write some data. The coherence counters are only used by the L1 data caches of a
+// multi-core system. The prefetch counters are used by caches with a prefetcher.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuMem::clearStats( ) {
@@ -207,6 +414,17 @@ void CpuMem::clearStats( ) {
     missCnt       = 0;
     dirtyMissCnt  = 0;
     waitCyclesCnt = 0;
+    coherenceMissCnt    = 0;
+    invalidateCnt       = 0;
+    interventionCnt     = 0;
+    upgradeCnt          = 0;
+    mshrAllocCnt        = 0;
+    mshrMergeCnt        = 0;
+    mshrStallCnt        = 0;
+    pfIssuedCnt         = 0;
+    pfUsefulCnt         = 0;
+    pfLateCnt           = 0;
+    pfPollutionCnt      = 0;
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -219,11 +437,14 @@ void CpuMem::clearStats( ) {
 void CpuMem::tick( ) {
     
     opState.tick( );
+    
+    accessLastCycle = accessThisCycle;
+    accessThisCycle = false;
 }
 
 //------------------------------------------------------------------------------------------------------------
 // "abortMemOp" will abort any current operation. It is necessary when we flush the pipeline to avoid fetching
-// data that we do not need.
+// data that we do not need. A block read by the L2 cache, but not yet entered, is dropped as well.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuMem::abortOp( ) {
@@ -231,13 +452,36 @@ void CpuMem::abortOp( ) {
     if ( opState.get( ) != MO_IDLE ) {
         
         opState.set( MO_IDLE );
-        reqSeg  = 0;
-        reqOfs  = 0;
-        reqPri  = 0;
-        reqTag  = 0;
-        reqLen  = 0;
-        reqPtr  = nullptr;
+        reqSeg      = 0;
+        reqOfs      = 0;
+        reqPri      = 0;
+        reqTag      = 0;
+        reqLen      = 0;
+        reqPtr      = nullptr;
+        reqPrefetch = false;
     }
+    
+    reqFillPending = false;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "skipCycles" is used by the CPU core when it skips clock cycles in which the pipeline is stalled and the
+// memory objects just count down the latency of a pending request. The core has observed how the latency
+// and wait cycle counters change in one such cycle and passes the amounts for the entire range skipped. A
+// non-blocking L1 cache counts a stall cycle when the stage waits for a pending miss. A stalled stage that
+// repeats its access is not counted as an access again, so there is no access count to extrapolate.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuMem::skipCycles( uint32_t latencyCycles, uint32_t waitCycles, uint32_t stallCycles ) {
+    
+    reqLatency      -= latencyCycles;
+    waitCyclesCnt   += waitCycles;
+    mshrStallCnt    += stallCycles;
+}
+
+uint32_t CpuMem::getPendingLatency( ) {
+    
+    return(( opState.get( ) != MO_IDLE ) ? reqLatency : 0 );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -263,127 +507,463 @@ uint16_t CpuMem::matchTag( uint32_t index, uint32_t tag ) {
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "readWord" fills in the request data for reading a word, a half-word or a byte from the data array. The
-// method supports the latency option, so that we can model the latency behavior of a physical memory
-// ´request. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
-// processing the request. Note that this method will be called every clock cycle as long as the lower layer
-// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
-// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
-// done with the current request.
+// Replacement policy. "selectVictim" returns the set to use for a new block at the block index. An invalid
+// set is always used first. Otherwise, the configured policy decides. "touchBlock" is called on a hit and
+// "insertBlock" when a new block was entered. The policy state is kept in the "replArray", one word for
+// each block index. A memory object without a replacement array has only one set to choose from.
 //
 //------------------------------------------------------------------------------------------------------------
-bool CpuMem::readWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t *word, uint32_t pri ) {
-   
-    if (( opState.get( ) == MO_IDLE ) && ( pri > reqPri )) {
+uint16_t CpuMem::selectVictim( uint32_t index ) {
+    
+    for ( uint16_t i = 0; i < cDesc.blockSets; i++ ) {
         
-        opState.set( MO_READ_WORD );
-        reqSeg      = seg;
-        reqOfs      = ofs;
-        reqTag      = tag;
-        reqPtr      = (uint8_t *) word;
-        reqLen      = len;
-        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
-        reqLatency  = cDesc.latency;
-        return( false );
+        if ( ! tagArray[ i ] [ index ].valid ) return( i );
+    }
+    
+    if (( cDesc.blockSets == 1 ) || ( replArray == nullptr )) return( 0 );
+    
+    switch ( cDesc.replPolicy ) {
+            
+        case MEM_RP_LRU:    return( lruVictim( replArray[ index ], cDesc.blockSets ));
+        case MEM_RP_PLRU:   return( plruVictim( replArray[ index ], cDesc.blockSets ));
+        case MEM_RP_SRRIP:
+        case MEM_RP_BRRIP:  return( rrpvVictim( &replArray[ index ], cDesc.blockSets ));
+        default:            return( nextRandom( &replRandState ) % cDesc.blockSets );
+    }
+}
+
+void CpuMem::touchBlock( uint32_t index, uint16_t set ) {
+    
+    if (( cDesc.blockSets == 1 ) || ( replArray == nullptr )) return;
+    
+    switch ( cDesc.replPolicy ) {
+            
+        case MEM_RP_LRU:    replArray[ index ] = lruTouch( replArray[ index ], set, cDesc.blockSets ); break;
+        case MEM_RP_PLRU:   replArray[ index ] = plruTouch( replArray[ index ], set, cDesc.blockSets ); break;
+        case MEM_RP_SRRIP:
+        case MEM_RP_BRRIP:  replArray[ index ] = rrpvSet( replArray[ index ], set, 0 ); break;
+        default: ;
+    }
+}
+
+void CpuMem::insertBlock( uint32_t index, uint16_t set ) {
+    
+    if (( cDesc.blockSets == 1 ) || ( replArray == nullptr )) return;
+    
+    switch ( cDesc.replPolicy ) {
+            
+        case MEM_RP_SRRIP: {
+            
+            replArray[ index ] = rrpvSet( replArray[ index ], set, RRPV_MAX - 1 );
+            
+        } break;
+            
+        case MEM_RP_BRRIP: {
+            
+            uint32_t val = (( nextRandom( &replRandState ) % BRRIP_LONG_ODDS ) == 0 ) ? RRPV_MAX - 1 : RRPV_MAX;
+            replArray[ index ] = rrpvSet( replArray[ index ], set, val );
+            
+        } break;
+            
+        default: touchBlock( index, set );
+    }
+}
+
+void CpuMem::resetReplState( ) {
+    
+    replRandState = ( cDesc.replSeed != 0 ) ? cDesc.replSeed : 1;
+    
+    if ( replArray != nullptr ) {
+        
+        uint32_t initVal = initReplState( cDesc.replPolicy );
+        for ( uint32_t i = 0; i < cDesc.blockEntries; i++ ) replArray[ i ] = initVal;
     }
-    else return ( reqLatency == 0 );
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "writeWord" fills in the request data for writing a word, a half-word or a byte into the data array. The
-// method supports the latency option, so that we can model the latency behavior of a physical memory
-// ´request. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
-// processing the request. Note that this method will be called every clock cycle as long as the lower layer
-// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
-// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
-// done with the current request.
+// Prefetcher. "trainPrefetcher" is called by a cache for a demand access. A "tagPtr" of nullptr is a miss,
+// otherwise it is the block that was hit. The first hit on a prefetched block makes the prefetch a useful
+// one. The next-N-line and the stream prefetcher look at the misses and at the useful hits, which keep a
+// stream going. The stride prefetcher looks at every access. The blocks to fetch are entered into the
+// prefetch queue and the cache state machine issues them when it and the lower layer are IDLE.
+//
+// The stride table is indexed by the address of the instruction that accesses the data. The MA stage sets it
+// with "setAccessPc" right before the access. All other accesses, such as the instruction fetches, the L2
+// cache requests or the store buffer writes, use the page number of the address instead.
+//
+// Prefetching stops at the page boundary of the access. An L1 cache is virtually indexed and the next page
+// could map to any physical page.
 //
 //------------------------------------------------------------------------------------------------------------
-bool CpuMem::writeWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t word, uint32_t pri ) {
+void CpuMem::trainPrefetcher( uint32_t ofs, uint32_t adrTag, MemTagEntry *tagPtr ) {
     
-    if (( opState.get( ) == MO_IDLE ) && ( pri > reqPri )) {
+    bool trigger = ( tagPtr == nullptr );
+    
+    if (( tagPtr != nullptr ) && ( tagPtr -> prefetched )) {
         
-        opState.set( MO_WRITE_BLOCK );
-        reqSeg      = seg;
-        reqOfs      = ofs;
-        reqTag      = tag;
-        reqPtr      = (uint8_t *) &word;
-        reqLen      = len;
-        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
-        reqLatency  = cDesc.latency;
+        tagPtr -> prefetched = false;
+        pfUsefulCnt ++;
+        trigger = true;
+    }
+    
+    switch ( cDesc.prefetchPolicy ) {
         
-        return( false );
+        case MEM_PF_NEXT_LINE: {
+            
+            if ( trigger ) {
+                
+                for ( uint32_t i = 1; i <= cDesc.prefetchDegree; i++ ) queuePrefetch( ofs, adrTag, i * cDesc.blockSize );
+            }
+            
+        } break;
+        
+        case MEM_PF_STRIDE: trainStride( ofs, adrTag ); break;
+        case MEM_PF_STREAM: if ( trigger ) trainStream( ofs, adrTag ); break;
+        default: ;
     }
-    else return ( reqLatency == 0 );
+    
+    accessPc = 0;
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "readBlock" is called by an upper memory layer to read a block of data from a lower layer. This method will
-// fill in a request for the memory layer state machine. The block sizes of the upper and lower layer do not
-// necessarily have to match. However, the upper layer must always be configured smaller than the lower layer.
-// If the memory object is IDLE, we fill in the request parameters and the next cycle will start processing
-// the request. Note that this method will be called every clock cycle as long as the lower layer operation
-// is not completed. The completion is signaled by the latency count being zero. Note also that the "IDLE"
-// state will be set with the next clock cycle, hence we need the latency count to know that we are done with
-// the current request.
+// "trainStride" updates the stride table entry of the accessing instruction. A repeated access to the same
+// address, such as a stalled stage calling again, is ignored. Once the same stride was seen twice, the
+// blocks "prefetchDegree" strides ahead are queued. A stride smaller than a block moves one block at a time.
 //
 //------------------------------------------------------------------------------------------------------------
-bool CpuMem::readBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri ) {
+void CpuMem::trainStride( uint32_t ofs, uint32_t adrTag ) {
     
-    if ( opState.get( ) == MO_IDLE ) {
+    uint32_t    key     = ( accessPc != 0 ) ? accessPc : adrTag / PAGE_SIZE_BYTES;
+    MemPfEntry  *ePtr   = &pfTable[ key % cDesc.prefetchEntries ];
+    
+    if (( ! ePtr -> valid ) || ( ePtr -> key != key )) {
         
-        opState.set( MO_READ_BLOCK );
-        reqSeg      = seg;
-        reqOfs      = ofs;
-        reqTag      = tag;
-        reqPtr      = buf;
-        reqLen      = len;
-        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
-        reqLatency  = cDesc.latency;
-        return( false );
+        ePtr -> valid       = true;
+        ePtr -> key         = key;
+        ePtr -> lastTag     = adrTag;
+        ePtr -> stride      = 0;
+        ePtr -> confidence  = 0;
+        return;
+    }
+    
+    int32_t delta = (int32_t) ( adrTag - ePtr -> lastTag );
+    if ( delta == 0 ) return;
+    
+    if ( delta == ePtr -> stride ) {
+        
+        if ( ePtr -> confidence < 3 ) ePtr -> confidence ++;
+    }
+    else {
+        
+        ePtr -> stride      = delta;
+        ePtr -> confidence  = 0;
+    }
+    
+    ePtr -> lastTag = adrTag;
+    
+    if ( ePtr -> confidence > 0 ) {
+        
+        int32_t step = delta;
+        
+        if      (( delta > 0 ) && ( delta < (int32_t) cDesc.blockSize ))    step = cDesc.blockSize;
+        else if (( delta < 0 ) && ( - delta < (int32_t) cDesc.blockSize ))  step = - (int32_t) cDesc.blockSize;
+        
+        for ( uint32_t i = 1; i <= cDesc.prefetchDegree; i++ ) queuePrefetch( ofs, adrTag, i * step );
     }
-    else return ( reqLatency == 0 );
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "writeBlock" will transfer multiple bytes to the lower layer. The block sizes of the upper and lower layer
-// do not necessarily have to match. However, the upper layer must always be configured smaller than the lower
-// layer. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
-// processing the request. Note that this method will be called every clock cycle as long as the lower layer 
-// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
-// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
-// done with the current request.
+// "trainStream" looks for a stream whose last block is close to the block accessed. The stream takes the
+// direction of the first step and follows it from then on, a confirmed stream queues the next
+// "prefetchDegree" blocks. Blocks already in the cache or in the queue are not queued again, so the stream
+// runs ahead of the accesses by just the new blocks. An access that does not continue any stream starts a
+// new one, replacing the streams in a round robin fashion.
 //
 //------------------------------------------------------------------------------------------------------------
-bool CpuMem::writeBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri ) {
+void CpuMem::trainStream( uint32_t ofs, uint32_t adrTag ) {
     
-    if ( opState.get( ) == MO_IDLE ) {
+    uint32_t blockTag = adrTag & ( ~ blockBitMask );
+    
+    for ( uint32_t i = 0; i < cDesc.prefetchEntries; i++ ) {
         
-        opState.set( MO_WRITE_BLOCK );
-        reqSeg      = seg;
-        reqOfs      = ofs;
-        reqTag      = tag;
-        reqPtr      = buf;
-        reqLen      = len;
-        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
-        reqLatency  = cDesc.latency;
-        return( false );
+        MemPfEntry  *ePtr   = &pfTable[ i ];
+        int32_t     delta   = (int32_t) ( blockTag - ePtr -> lastTag ) / (int32_t) cDesc.blockSize;
+        int32_t     dir     = ( delta > 0 ) ? cDesc.blockSize : - (int32_t) cDesc.blockSize;
+        
+        if (( ! ePtr -> valid ) || ( delta == 0 ) || ( delta > STREAM_WINDOW ) || ( - delta > STREAM_WINDOW )) continue;
+        if (( ePtr -> confidence > 0 ) && ( dir != ePtr -> stride )) continue;
+        
+        ePtr -> lastTag     = blockTag;
+        ePtr -> stride      = dir;
+        if ( ePtr -> confidence < 3 ) ePtr -> confidence ++;
+        
+        for ( uint32_t j = 1; j <= cDesc.prefetchDegree; j++ ) queuePrefetch( ofs, adrTag, j * dir );
+        return;
     }
-    else return ( reqLatency == 0 );
+    
+    MemPfEntry *ePtr = &pfTable[ pfNextStream ];
+    
+    ePtr -> valid       = true;
+    ePtr -> key         = 0;
+    ePtr -> lastTag     = blockTag;
+    ePtr -> stride      = 0;
+    ePtr -> confidence  = 0;
+    
+    pfNextStream = ( pfNextStream + 1 ) % cDesc.prefetchEntries;
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "flushBlockPhys" will write the content of the block at address "adr" to the lower layer. This method only
-// applies to caches that are connected to a physical memory layer. The block is marked "clean" after the
-// operation. If the operation is not supported by the lower layer, the state machine will simply ignore
-// this request.
+// "queuePrefetch" enters the block "delta" bytes away from the access into the prefetch queue. A block in
+// another page, a block already in the cache, just being prefetched or already queued is not entered. When
+// the queue is full, the oldest entry is dropped, a newer request is the more timely one.
 //
 //------------------------------------------------------------------------------------------------------------
-bool CpuMem::flushBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t pri ) {
+void CpuMem::queuePrefetch( uint32_t ofs, uint32_t adrTag, int32_t delta ) {
     
-    if ( opState.get( ) == MO_IDLE ) {
+    uint32_t pfTag = ( adrTag + delta ) & ( ~ blockBitMask );
+    uint32_t pfOfs = ( ofs + delta ) & ( ~ blockBitMask );
+    
+    if (( pfTag / PAGE_SIZE_BYTES ) != ( adrTag / PAGE_SIZE_BYTES )) return;
+    if ( matchTag(( pfOfs / cDesc.blockSize ) % cDesc.blockEntries, pfTag ) < cDesc.blockSets ) return;
+    if (( reqPrefetch ) && ( opState.get( ) != MO_IDLE ) && ( pfTag == ( reqTag & ( ~ blockBitMask )))) return;
+    
+    for ( uint32_t i = 0; i < pfQueueCnt; i++ ) {
         
-        opState.set( MO_WRITE_BLOCK );
+        if ( pfQueue[ ( pfQueueHead + i ) % MAX_PREFETCH_ENTRIES ].tag == pfTag ) return;
+    }
+    
+    if ( pfQueueCnt >= MAX_PREFETCH_ENTRIES ) {
+        
+        pfQueueHead = ( pfQueueHead + 1 ) % MAX_PREFETCH_ENTRIES;
+        pfQueueCnt --;
+    }
+    
+    MemPfRequest *rPtr = &pfQueue[ ( pfQueueHead + pfQueueCnt ) % MAX_PREFETCH_ENTRIES ];
+    
+    rPtr -> ofs = pfOfs;
+    rPtr -> tag = pfTag;
+    pfQueueCnt ++;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "nextPrefetch" removes the oldest request from the prefetch queue. A block that came into the cache in the
+// meantime is skipped. The function returns false when there is no request left.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::nextPrefetch( uint32_t *ofs, uint32_t *adrTag ) {
+    
+    while ( pfQueueCnt > 0 ) {
+        
+        MemPfRequest *rPtr = &pfQueue[ pfQueueHead ];
+        
+        pfQueueHead = ( pfQueueHead + 1 ) % MAX_PREFETCH_ENTRIES;
+        pfQueueCnt --;
+        
+        if ( matchTag(( rPtr -> ofs / cDesc.blockSize ) % cDesc.blockEntries, rPtr -> tag ) >= cDesc.blockSets ) {
+            
+            *ofs    = rPtr -> ofs;
+            *adrTag = rPtr -> tag;
+            return( true );
+        }
+    }
+    
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "isPrefetchPending" is called by a cache for a demand access that cannot be served right now. When the
+// access is to the block just being prefetched, the prefetch came too late to hide the miss. This is counted
+// once for the prefetch. Once the block is there, the access will also count the prefetch as a useful one.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::isPrefetchPending( uint32_t adrTag ) {
+    
+    if (( ! reqPrefetch ) || ( opState.get( ) == MO_IDLE )) return( false );
+    if (( adrTag & ( ~ blockBitMask )) != ( reqTag & ( ~ blockBitMask ))) return( false );
+    
+    if ( ! reqPrefetchLate ) {
+        
+        reqPrefetchLate = true;
+        pfLateCnt ++;
+    }
+    
+    return( true );
+}
+
+void CpuMem::resetPrefetcher( ) {
+    
+    for ( uint32_t i = 0; i < MAX_PREFETCH_ENTRIES; i++ ) pfTable[ i ].valid = false;
+    
+    pfQueueHead     = 0;
+    pfQueueCnt      = 0;
+    pfNextStream    = 0;
+    accessPc        = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setAccessPc" passes the instruction address of the next access to the stride prefetcher. "isIdle" tells
+// whether the memory object has no request and also did not accept one in the current clock cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuMem::setAccessPc( uint32_t pc ) {
+    
+    accessPc = pc;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "isNewAccess" tells whether an access to the L1 cache is a new request. A stalled pipeline stage calls
+// again in the next cycle with the same request until it is served, be it a hit it cannot use yet or a miss
+// in progress. Such a repeated call is not a new access. An access is a repeat when the previous clock
+// cycle saw the same address, length, direction and instruction address.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::isNewAccess( uint32_t ofs, uint32_t adrTag, uint32_t len, bool isWrite ) {
+    
+    uint32_t    mode    = ( len << 1 ) | ( isWrite ? 1 : 0 );
+    bool        repeat  = (( accessLastCycle ) &&
+                           ( lastAccessOfs == ofs ) && ( lastAccessTag == adrTag ) &&
+                           ( lastAccessPc == accessPc ) && ( lastAccessMode == mode ));
+    
+    lastAccessOfs   = ofs;
+    lastAccessTag   = adrTag;
+    lastAccessPc    = accessPc;
+    lastAccessMode  = mode;
+    accessThisCycle = true;
+    
+    return( ! repeat );
+}
+
+bool CpuMem::isIdle( ) {
+    
+    return(( opState.get( ) == MO_IDLE ) && ( opState.getLatched( ) == MO_IDLE ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "readWord" fills in the request data for reading a word, a half-word or a byte from the data array. The
+// method supports the latency option, so that we can model the latency behavior of a physical memory
+// ´request. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
+// processing the request. Note that this method will be called every clock cycle as long as the lower layer
+// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
+// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
+// done with the current request.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::readWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t *word, uint32_t pri ) {
+   
+    if (( opState.get( ) == MO_IDLE ) && ( pri > reqPri )) {
+        
+        opState.set( MO_READ_WORD );
+        reqSeg      = seg;
+        reqOfs      = ofs;
+        reqTag      = tag;
+        reqPtr      = (uint8_t *) word;
+        reqLen      = len;
+        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
+        reqLatency  = cDesc.latency;
+        return( false );
+    }
+    else return ( reqLatency == 0 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "writeWord" fills in the request data for writing a word, a half-word or a byte into the data array. The
+// method supports the latency option, so that we can model the latency behavior of a physical memory
+// ´request. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
+// processing the request. Note that this method will be called every clock cycle as long as the lower layer
+// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
+// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
+// done with the current request.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::writeWord( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t len, uint32_t word, uint32_t pri ) {
+    
+    if (( opState.get( ) == MO_IDLE ) && ( pri > reqPri )) {
+        
+        opState.set( MO_WRITE_BLOCK );
+        reqSeg      = seg;
+        reqOfs      = ofs;
+        reqTag      = tag;
+        reqPtr      = (uint8_t *) &word;
+        reqLen      = len;
+        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
+        reqLatency  = cDesc.latency;
+        
+        return( false );
+    }
+    else return ( reqLatency == 0 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "readBlock" is called by an upper memory layer to read a block of data from a lower layer. This method will
+// fill in a request for the memory layer state machine. The block sizes of the upper and lower layer do not
+// necessarily have to match. However, the upper layer must always be configured smaller than the lower layer.
+// If the memory object is IDLE, we fill in the request parameters and the next cycle will start processing
+// the request. Note that this method will be called every clock cycle as long as the lower layer operation
+// is not completed. The completion is signaled by the latency count being zero. Note also that the "IDLE"
+// state will be set with the next clock cycle, hence we need the latency count to know that we are done with
+// the current request. Only the caller that placed the request is told that it is done. Another caller,
+// such as the other L1 cache while a non-blocking cache has a miss pending, waits for the IDLE state.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::readBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri ) {
+    
+    if ( opState.get( ) == MO_IDLE ) {
+        
+        opState.set( MO_READ_BLOCK );
+        reqSeg      = seg;
+        reqOfs      = ofs;
+        reqTag      = tag;
+        reqPtr      = buf;
+        reqLen      = len;
+        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
+        reqLatency  = cDesc.latency;
+        return( false );
+    }
+    else return (( opState.get( ) == MO_READ_BLOCK ) &&
+                 ( reqPtr == buf ) && ( reqOfs == ofs ) && ( reqLatency == 0 ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "writeBlock" will transfer multiple bytes to the lower layer. The block sizes of the upper and lower layer
+// do not necessarily have to match. However, the upper layer must always be configured smaller than the lower
+// layer. If the memory object is IDLE, we fill in the request parameters and the next cycle will start
+// processing the request. Note that this method will be called every clock cycle as long as the lower layer 
+// operation is not completed. The completion is signaled by the latency count being zero. Note also that the
+// "IDLE" state will be set with the next clock cycle, hence we need the latency count to know that we are
+// done with the current request. As with "readBlock", only the caller that placed the request is told that
+// it is done.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::writeBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint8_t *buf, uint32_t len, uint32_t pri ) {
+    
+    if ( opState.get( ) == MO_IDLE ) {
+        
+        opState.set( MO_WRITE_BLOCK );
+        reqSeg      = seg;
+        reqOfs      = ofs;
+        reqTag      = tag;
+        reqPtr      = buf;
+        reqLen      = len;
+        reqPri      = (( pri == 0 ) ? cDesc.priority : pri );
+        reqLatency  = cDesc.latency;
+        return( false );
+    }
+    else return (( opState.get( ) == MO_WRITE_BLOCK ) &&
+                 ( reqPtr == buf ) && ( reqOfs == ofs ) && ( reqLatency == 0 ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flushBlockPhys" will write the content of the block at address "adr" to the lower layer. This method only
+// applies to caches that are connected to a physical memory layer. The block is marked "clean" after the
+// operation. If the operation is not supported by the lower layer, the state machine will simply ignore
+// this request.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::flushBlock( uint32_t seg, uint32_t ofs, uint32_t tag, uint32_t pri ) {
+    
+    if ( opState.get( ) == MO_IDLE ) {
+        
+        opState.set( MO_WRITE_BLOCK );
         reqSeg      = seg;
         reqOfs      = ofs;
         reqTag      = tag;
@@ -446,6 +1026,7 @@ uint32_t CpuMem::getMemCtrlReg( uint8_t mReg ) {
         case MC_REG_BLOCK_SIZE:         return( cDesc.blockSize );
         case MC_REG_SETS:               return( cDesc.blockSets );
         case MC_REG_LATENCY:            return( cDesc.latency );
+        case MC_REG_RESIDENT_PAGES:     return( getResidentPages( ));
             
         default: return( 0 );
     }
@@ -477,6 +1058,8 @@ char *CpuMem::getMemOpStr( uint32_t opArg ) {
         case MO_WRITE_BACK_BLOCK:       return((char *) "WRITE BACK BLOCK" );
         case MO_FLUSH_BLOCK:            return((char *) "FLUSH BLOCK" );
         case MO_PURGE_BLOCK:            return((char *) "PURGE  BLOCK" );
+        case MO_SNOOP_WAIT:             return((char *) "SNOOP  WAIT" );
+        case MO_FILL_BLOCK:             return((char *) "FILL   BLOCK" );
             
         default:                        return((char *) "****" );
     }
@@ -537,6 +1120,141 @@ void CpuMem::putMemDataWord( uint32_t ofs, uint32_t val, uint8_t set ) {
     memcpy( &dataArray[ set ] [ ofs - cDesc.startAdr ], &tmp, sizeof( uint32_t ));
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "putMemDataBlock" stores a block of data at the physical address right away, without going through the
+// state machine. A memory layer without tags just copies the data. A cache layer updates a matching block
+// and marks it dirty, otherwise the data is passed on to the lower layer. The L1 caches are indexed by the
+// virtual address offset, the caller passes the offset for the index and the physical address for the tag.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuMem::putMemDataBlock( uint32_t adr, uint8_t *buf, uint32_t len ) {
+    
+    putMemDataBlock( adr, adr, buf, len );
+}
+
+void CpuMem::putMemDataBlock( uint32_t ofs, uint32_t adrTag, uint8_t *buf, uint32_t len ) {
+    
+    if ( tagArray[ 0 ] == nullptr ) {
+        
+        if (( validAdr( adrTag )) && ( validAdr( adrTag + len - 1 ))) {
+            
+            memcpy( &dataArray[ 0 ] [ adrTag - cDesc.startAdr ], buf, len );
+        }
+    }
+    else {
+        
+        uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
+        uint16_t    matchSet    = matchTag( blockIndex, adrTag );
+        
+        if ( matchSet < cDesc.blockSets ) {
+            
+            memcpy( &dataArray[ matchSet ] [ blockIndex * cDesc.blockSize + ( ofs & blockBitMask ) ], buf, len );
+            tagArray[ matchSet ] [ blockIndex ].dirty = true;
+        }
+        else if ( lowerMem != nullptr ) lowerMem -> putMemDataBlock( adrTag, buf, len );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flushAllBlocks" writes back all dirty blocks to the lower layer and invalidates all blocks. Like the
+// other "put" routines, this is done right away and not through the state machine. Any pending request is
+// aborted. It is used by the CPU core when switching to the functional engine, which accesses physical
+// memory directly. The stores merged into the pending misses of a non-blocking cache are passed on to the
+// lower layer. Blocks queued for a prefetch are dropped.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuMem::flushAllBlocks( ) {
+    
+    abortOp( );
+    
+    for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) {
+        
+        if ( tagArray[ i ] == nullptr ) continue;
+        
+        for ( uint32_t j = 0; j < cDesc.blockEntries; j++ ) {
+            
+            MemTagEntry *tagPtr = &tagArray[ i ] [ j ];
+            
+            if (( tagPtr -> valid ) && ( tagPtr -> dirty ) && ( lowerMem != nullptr )) {
+                
+                lowerMem -> putMemDataBlock( tagPtr -> tag & ( ~ blockBitMask ),
+                                             &dataArray[ i ] [ j * cDesc.blockSize ],
+                                             cDesc.blockSize );
+            }
+            
+            tagPtr -> valid         = false;
+            tagPtr -> dirty         = false;
+            tagPtr -> shared        = false;
+            tagPtr -> invalidated   = false;
+            tagPtr -> prefetched    = false;
+        }
+    }
+    
+    for ( uint32_t i = 0; i < MAX_MSHR_ENTRIES; i++ ) {
+        
+        MemMshrEntry *mPtr = &mshrArray[ i ];
+        
+        if (( mPtr -> valid ) && ( lowerMem != nullptr )) {
+            
+            for ( uint32_t j = 0; j < cDesc.blockSize; j++ ) {
+                
+                if ( mPtr -> storeMask[ j ] ) lowerMem -> putMemDataBlock( mPtr -> tag + j, &mPtr -> storeData[ j ], 1 );
+            }
+        }
+        
+        mPtr -> valid = false;
+    }
+    
+    mshrPendingCnt  = 0;
+    reqMshr         = MAX_MSHR_ENTRIES;
+    
+    resetPrefetcher( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "warmBlock" enters the block containing the physical address "adrTag" into the cache right away, without
+// going through the state machine and without counting. It is used to warm up the caches while the
+// functional engine executes, so that a detailed pipeline run that follows does not start with cold caches.
+// The block data is copied from "memData", which is the start of the physical memory data. A block already
+// in the cache is refreshed, since the functional engine writes to physical memory directly. Otherwise, the
+// target set is selected the same way the cache miss handling does. A write marks the block dirty, so that
+// the pipeline sees the write backs it would have to do. While the functional engine runs, physical memory
+// holds the current data and all cache blocks are just copies. A dirty block is therefore replaced without
+// a write back. A memory layer without tags ignores the request. The routine returns whether the block was
+// already in the cache, which the out-of-order core model uses to determine the access latency.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuMem::warmBlock( uint32_t ofs, uint32_t adrTag, uint8_t *memData, bool isWrite ) {
+    
+    if ( tagArray[ 0 ] == nullptr ) return( false );
+    
+    uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
+    uint16_t    targetSet   = matchTag( blockIndex, adrTag );
+    bool        present     = ( targetSet < cDesc.blockSets );
+    
+    if ( present ) touchBlock( blockIndex, targetSet );
+    else {
+        
+        targetSet = selectVictim( blockIndex );
+        insertBlock( blockIndex, targetSet );
+    }
+    
+    MemTagEntry *tagPtr = &tagArray[ targetSet ] [ blockIndex ];
+    
+    memcpy( &dataArray[ targetSet ] [ blockIndex * cDesc.blockSize ],
+            &memData[ adrTag & ( ~ blockBitMask ) ],
+            cDesc.blockSize );
+    
+    tagPtr -> valid         = true;
+    tagPtr -> dirty         = (( tagPtr -> dirty ) && ( tagPtr -> tag == ( adrTag & ( ~ blockBitMask )))) || isWrite;
+    tagPtr -> shared        = false;
+    tagPtr -> invalidated   = false;
+    tagPtr -> prefetched    = false;
+    tagPtr -> tag           = adrTag & ( ~ blockBitMask );
+    
+    return( present );
+}
+
 //------------------------------------------------------------------------------------------------------------
 // Simple Getters.
 //
@@ -546,6 +1264,28 @@ uint32_t CpuMem::getMemSize( ) {
     return( cDesc.blockEntries * cDesc.blockSize );
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "getResidentPages" reports how many host pages of the data arrays are actually committed. For a sparse
+// data array we ask the host, an allocated data array counts in full.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuMem::getResidentPages( ) {
+    
+    size_t      pageSize    = hostPageSize( );
+    size_t      len         = (size_t) cDesc.blockEntries * cDesc.blockSize;
+    uint32_t    resident    = 0;
+    
+    for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) {
+        
+        if ( dataArray[ i ] == nullptr ) continue;
+        
+        if ( dataMapped ) resident += residentPages( dataArray[ i ], len );
+        else              resident += ( len + pageSize - 1 ) / pageSize;
+    }
+    
+    return( resident );
+}
+
 uint32_t CpuMem::getStartAdr( ) {
     
     return( cDesc.startAdr );
@@ -591,18 +1331,83 @@ uint32_t CpuMem::getWaitCycleCnt( )  {
     return( waitCyclesCnt );
 }
 
-bool CpuMem::validAdr( uint32_t ofs ) {
+uint32_t CpuMem::getCoherenceMissCnt( )  {
     
-    return(( ofs >= cDesc.startAdr ) && ( ofs <= cDesc.endAdr ));
+    return( coherenceMissCnt );
 }
 
+uint32_t CpuMem::getInvalidateCnt( )  {
+    
+    return( invalidateCnt );
+}
 
+uint32_t CpuMem::getInterventionCnt( )  {
+    
+    return( interventionCnt );
+}
+
+uint32_t CpuMem::getUpgradeCnt( )  {
+    
+    return( upgradeCnt );
+}
+
+uint32_t CpuMem::getMshrAllocCnt( )  {
+    
+    return( mshrAllocCnt );
+}
+
+uint32_t CpuMem::getMshrMergeCnt( )  {
+    
+    return( mshrMergeCnt );
+}
+
+uint32_t CpuMem::getMshrStallCnt( )  {
+    
+    return( mshrStallCnt );
+}
+
+uint32_t CpuMem::getMshrPendingCnt( )  {
+    
+    return( mshrPendingCnt );
+}
+
+uint32_t CpuMem::getPrefetchIssuedCnt( )  {
+    
+    return( pfIssuedCnt );
+}
+
+uint32_t CpuMem::getPrefetchUsefulCnt( )  {
+    
+    return( pfUsefulCnt );
+}
+
+uint32_t CpuMem::getPrefetchLateCnt( )  {
+    
+    return( pfLateCnt );
+}
+
+uint32_t CpuMem::getPrefetchPollutionCnt( )  {
+    
+    return( pfPollutionCnt );
+}
+
+uint32_t CpuMem::getPrefetchQueueCnt( )  {
+    
+    return( pfQueueCnt );
+}
+
+bool CpuMem::validAdr( uint32_t ofs ) {
+    
+    return(( ofs >= cDesc.startAdr ) && ( ofs <= cDesc.endAdr ));
+}
+
+
+//------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------
+//
+// L1 cache object methods.
+//
 //------------------------------------------------------------------------------------------------------------
-//------------------------------------------------------------------------------------------------------------
-//
-// L1 cache object methods.
-//
-//------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------
 
 
@@ -619,6 +1424,7 @@ L1CacheMem::L1CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem ) : CpuMem( mDesc, l
     for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
         dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
     
+    replArray = (uint32_t *) calloc( cDesc.blockEntries, sizeof( uint32_t ));
     reset( );
 }
 
@@ -634,12 +1440,28 @@ L1CacheMem::L1CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem ) : CpuMem( mDesc, l
 // processing the request. Note that the CPU core layer will call this routine every clock cycle as long as
 // the operation is not completed, i.e. it is back to IDLE.
 //
+// A non-blocking cache serves hits while misses are pending. A miss is entered into a free miss status
+// holding register and the state machine reads the block when it gets to it. The caller waits until the
+// block is there. A miss to a block that is already pending or a miss with all registers in use is just a
+// stall cycle.
+//
+// With a prefetcher, the access trains it. A miss to the block that is just being prefetched waits for the
+// prefetch to complete.
+//
+// With a snoop bus, the read is done under the bus lock, so that another core cannot change the block while
+// we read it.
+//
 //------------------------------------------------------------------------------------------------------------
 bool L1CacheMem::readWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t len, uint32_t *word, uint32_t pri ) {
     
-    if ( opState.get( ) == MO_IDLE ) {
-       
-        uint32_t    blockIndex  = ofs / cDesc.blockSize;
+    if ( isNewAccess( ofs, adrTag, len, false )) accessCnt ++;
+    
+    if (( opState.get( ) == MO_IDLE ) || ( cDesc.mshrEntries > 0 )) {
+        
+        std::unique_lock< std::recursive_mutex > lock;
+        if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+        
+        uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
         uint16_t    matchSet    = matchTag( blockIndex, adrTag );
         
         if ( matchSet < cDesc.blockSets ) {
@@ -651,10 +1473,33 @@ bool L1CacheMem::readWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t
             else if ( len == 2 ) *word = *((uint16_t *) dataPtr );
             else                 *word = *((uint32_t *) dataPtr );
             
+            touchBlock( blockIndex, matchSet );
+            
+            if ( cDesc.prefetchPolicy != MEM_PF_NONE )
+                trainPrefetcher( ofs, adrTag, &tagArray[ matchSet ] [ blockIndex ] );
+            
             return( true );
         }
+        else if ( cDesc.mshrEntries > 0 ) {
+            
+            if (( ! isPrefetchPending( adrTag )) &&
+                ( findMshr( adrTag ) >= MAX_MSHR_ENTRIES ) &&
+                ( allocMshr( adrTag, blockIndex, false ) < MAX_MSHR_ENTRIES )) {
+                
+                missCnt ++;
+                if ( isCoherenceMiss( blockIndex, adrTag )) coherenceMissCnt ++;
+                if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( ofs, adrTag, nullptr );
+            }
+            else mshrStallCnt ++;
+            
+            return( false );
+        }
         else {
             
+            missCnt ++;
+            if ( isCoherenceMiss( blockIndex, adrTag )) coherenceMissCnt ++;
+            if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( ofs, adrTag, nullptr );
+            
             opState.set( MO_ALLOCATE_BLOCK );
             reqSeg              = seg;
             reqOfs              = ofs;
@@ -663,13 +1508,44 @@ bool L1CacheMem::readWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t
             reqLen              = 0;
             reqPri              = (( pri == 0 ) ? cDesc.priority : pri );
             reqLatency          = cDesc.latency;
+            reqExclusive        = false;
             
             reqTargetSet        = matchSet;
             reqTargetBlockIndex = blockIndex;
             return( false );
         }
     }
-    else return(false );
+    else {
+        
+        isPrefetchPending( adrTag );
+        return( false );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "readNextWord" returns the word following the word at "ofs", when it is in the same cache block and the
+// block is in the cache. It is used by the dual issue FD stage, which reads two instruction words from the
+// block it just accessed. This is still one cache access, so there is no state change and nothing counted.
+// When the next word is in another block, or the block is not there, the FD stage just issues one
+// instruction.
+//
+//------------------------------------------------------------------------------------------------------------
+bool L1CacheMem::readNextWord( uint32_t ofs, uint32_t adrTag, uint32_t *data ) {
+    
+    if (( ofs & blockBitMask ) + 8 > cDesc.blockSize ) return( false );
+    
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
+    uint16_t    matchSet    = matchTag( blockIndex, adrTag );
+    
+    if ( matchSet >= cDesc.blockSets ) return( false );
+    
+    uint8_t *blockPtr = &dataArray[ matchSet ] [ blockIndex * cDesc.blockSize ];
+    
+    *data = *((uint32_t *) &blockPtr[ ( ofs & blockBitMask ) + 4 ] );
+    return( true );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -681,27 +1557,95 @@ bool L1CacheMem::readWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t
 // byte or half-word is stored at the byte address in the cache. Otherwise, we follow the same logic as
 // described for the read virtual data operation.
 //
+// With a snoop bus, the write is done under the bus lock. A write hit to a shared block first needs to
+// invalidate the other copies. The upgrade request is sent to the bus and we wait for the snoop latency.
+// The write is then done when the CPU core calls again. A write miss reads the block for ownership.
+//
+// In a non-blocking cache, a write miss does not stall. The data is merged into the miss status holding
+// register of the block and written to the block when it arrives. Only when all registers are in use, the
+// caller has to wait.
+//
 //------------------------------------------------------------------------------------------------------------
 bool L1CacheMem::writeWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t len, uint32_t word, uint32_t pri ) {
     
-    if ( opState.get( ) == MO_IDLE ) {
+    if ( isNewAccess( ofs, adrTag, len, true )) accessCnt ++;
+    
+    if (( opState.get( ) == MO_IDLE ) || ( cDesc.mshrEntries > 0 )) {
         
-        uint32_t    blockIndex  = ofs / cDesc.blockSize;
+        std::unique_lock< std::recursive_mutex > lock;
+        if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+        
+        uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
         uint16_t    matchSet    = matchTag( blockIndex, adrTag );
        
         if ( matchSet < cDesc.blockSets ) {
             
+            MemTagEntry *tagPtr = &tagArray[ matchSet ] [ blockIndex ];
+            
+            if (( snoopBus != nullptr ) && ( tagPtr -> shared )) {
+                
+                if ( opState.get( ) != MO_IDLE ) {
+                    
+                    mshrStallCnt ++;
+                    return( false );
+                }
+                
+                upgradeCnt ++;
+                tagPtr -> shared = false;
+                reqLatency       = snoopBus -> busUpgrade( this, tagPtr -> tag );
+                opState.set( MO_SNOOP_WAIT );
+                return( false );
+            }
+            
             uint8_t *blockPtr = &dataArray[ matchSet ] [ blockIndex * cDesc.blockSize ];
             uint8_t *dataPtr  = &blockPtr[ ofs & blockBitMask ];
             
-            if      ( reqLen == 1 ) *dataPtr                 = (uint8_t) word;
-            else if ( reqLen == 2 ) *((uint16_t *) dataPtr ) = (uint16_t) word;
-            else                    *((uint32_t *) dataPtr ) = word;
+            if      ( len == 1 ) *dataPtr                 = (uint8_t) word;
+            else if ( len == 2 ) *((uint16_t *) dataPtr ) = (uint16_t) word;
+            else                 *((uint32_t *) dataPtr ) = word;
+            
+            tagPtr -> dirty = true;
+            touchBlock( blockIndex, matchSet );
+            
+            if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( ofs, adrTag, tagPtr );
+            
+            return( true );
+        }
+        else if ( cDesc.mshrEntries > 0 ) {
+            
+            if ( isPrefetchPending( adrTag )) {
+                
+                mshrStallCnt ++;
+                return( false );
+            }
+            
+            uint16_t mshr = findMshr( adrTag );
+            
+            if ( mshr < MAX_MSHR_ENTRIES ) mshrMergeCnt ++;
+            else {
+                
+                mshr = allocMshr( adrTag, blockIndex, true );
+                
+                if ( mshr >= MAX_MSHR_ENTRIES ) {
+                    
+                    mshrStallCnt ++;
+                    return( false );
+                }
+                
+                missCnt ++;
+                if ( isCoherenceMiss( blockIndex, adrTag )) coherenceMissCnt ++;
+                if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( ofs, adrTag, nullptr );
+            }
             
+            mergeMshr( mshr, adrTag, len, word );
             return( true );
         }
         else {
             
+            missCnt ++;
+            if ( isCoherenceMiss( blockIndex, adrTag )) coherenceMissCnt ++;
+            if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( ofs, adrTag, nullptr );
+            
             opState.set( MO_ALLOCATE_BLOCK );
             reqSeg              = seg;
             reqOfs              = ofs;
@@ -710,26 +1654,35 @@ bool L1CacheMem::writeWord( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_
             reqLen              = 0;
             reqPri              = (( pri == 0 ) ? cDesc.priority : pri );
             reqLatency          = cDesc.latency;
+            reqExclusive        = true;
             
             reqTargetSet        = matchSet;
             reqTargetBlockIndex = blockIndex;
             return( false );
         }
     }
-    else return( false );
+    else {
+        
+        isPrefetchPending( adrTag );
+        return( false );
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------
 // "flushBlock" overrides the base class method. It is the method for writing a dirty block back to the lower
 // layer. If there is a match and the block is dirty it will be written back to the lower layer. The next 
-// state will be FLUSH_BLOCK_VIRT. Otherwise the request is ignored.
+// state will be FLUSH_BLOCK_VIRT. Otherwise the request is ignored. With a snoop bus, the tag is checked
+// under the bus lock, just like for a read.
 //
 //------------------------------------------------------------------------------------------------------------
 bool L1CacheMem::flushBlock( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t pri ) {
     
     if ( opState.get( ) == MO_IDLE ) {
         
-        uint32_t    blockIndex  = ofs % cDesc.blockSize;
+        std::unique_lock< std::recursive_mutex > lock;
+        if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+        
+        uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
         uint16_t    matchSet    = matchTag( blockIndex, adrTag );
         
         if ( matchSet < cDesc.blockSets ) {
@@ -758,14 +1711,18 @@ bool L1CacheMem::flushBlock( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32
 
 //------------------------------------------------------------------------------------------------------------
 // "purgeBlock" overrides the base class method. It is the method for invalidating the block in the current
-// slot. If there is a match, the entry will just be set to invalid, otherwise the request is ignored.
+// slot. If there is a match, the entry will just be set to invalid, otherwise the request is ignored. With a
+// snoop bus, the tag is checked under the bus lock.
 //
 //------------------------------------------------------------------------------------------------------------
 bool L1CacheMem::purgeBlock( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32_t pri ) {
     
     if ( opState.get( ) == MO_IDLE ) {
         
-        uint32_t    blockIndex  = ofs % cDesc.blockSize;
+        std::unique_lock< std::recursive_mutex > lock;
+        if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+        
+        uint32_t    blockIndex  = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
         uint16_t    matchSet    = ( matchTag( blockIndex, adrTag ) < cDesc.blockSets );
         
         if ( matchSet < cDesc.blockSets ) {
@@ -797,9 +1754,11 @@ bool L1CacheMem::purgeBlock( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32
 //
 // MO_ALLOCATE_BLOCK: on a cache miss, we start here. The first task is to locate the block to use for the
 // cache miss. If there is an invalid block in the sets, this is the one to use and the next state is
-// MO_READ_BLOCK, where we will read the block that contains the requested data. Otherwise, we will
-// randomly select a block from the sets to be the candidate for serving the cache miss. If the selected
-// block is dirty it will be written back first and the next state MO_WRITE_BACK_BLOCK.
+// MO_READ_BLOCK, where we will read the block that contains the requested data. Otherwise, the replacement
+// policy selects a block from the sets to be the candidate for serving the cache miss. If the selected
+// block is dirty it will be written back first and the next state MO_WRITE_BACK_BLOCK. A clean block is
+// invalidated right away, so that a lower layer that completes a read for an aborted request does not
+// change the data of a valid block.
 //
 // MO_READ_BLOCK: coming from the MO_ALLOCATE_BLOCK state, this state will read the block from the lower
 // layer. The target block has already been identified and we will stay in this state until the lower
@@ -814,60 +1773,94 @@ bool L1CacheMem::purgeBlock( uint32_t seg, uint32_t ofs, uint32_t adrTag, uint32
 // MO_FLUSH_BLOCK: this is state entered when we need to explicitly flush a block. After operation, the
 // next state is MO_IDLE.
 //
+// MO_SNOOP_WAIT: with a snoop bus, a block read or an upgrade request is sent to the bus. The other caches
+// are snooped and the cycles this takes are counted down in this state. The next state is MO_IDLE.
+//
 // The cache block to read, write back or flush was stored in the two request block fields "reqTargetSet"
 // and "reqTargetBlockIndex" by the cache access methods. The block index is computed from the request offset
 // value. The target set is determined through finding a replacement candidate. The values are set during
 // the ALLOCATE state and passed ro the follow up state. The two fields are also set for flushing a block,
 // however in this case the target set is a valid set.
 //
+// A non-blocking cache starts from IDLE with the next pending miss status holding register. The request
+// fields are set up from the register and the miss is handled by the states described above. When the block
+// is read, the merged store data is written to it and the register is free again. The lower layer copies
+// the block data later in the same clock cycle, so a block with merged stores is entered in the next cycle
+// in the MO_FILL_BLOCK state. The registers are served
+// in a round robin fashion, so that a load waiting for its block is not passed by new store misses forever.
+//
+// With a prefetcher, an IDLE cache without pending misses starts the next block in the prefetch queue. The
+// prefetch goes through the same states as a read miss. A prefetched block that is replaced before it was
+// ever accessed is counted as a polluting prefetch.
+//
+// With a snoop bus, the state machine runs under the bus lock, including the IDLE state, which sets up the
+// request from a miss status holding register or the prefetch queue.
+//
+// ??? the lower layer serves one request at a time, the misses are read one after the other.
+// ??? a flush or purge of a block with a pending miss is not held back until the block arrived.
 //------------------------------------------------------------------------------------------------------------
 void L1CacheMem::process( ) {
     
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    if ( opState.get( ) == MO_IDLE ) {
+        
+        if      ( mshrPendingCnt > 0 )  startMshr( );
+        else if ( pfQueueCnt > 0 )      startPrefetch( );
+        return;
+    }
+    
     switch( opState.get( )) {
             
         case MO_ALLOCATE_BLOCK: {
            
-            for ( int i = 0; i < cDesc.blockSets; i++ ) {
-                
-                MemTagEntry *tagPtr = &tagArray[ i ] [ reqTargetBlockIndex ];
-                if ( ! tagPtr -> valid ) {
-                    
-                    reqTargetSet = i;
-                    break;
-                }
-            }
-            
-            if ( reqTargetSet >= cDesc.blockSets ) reqTargetSet = rand( ) % cDesc.blockSets;
+            reqTargetSet = selectVictim( reqTargetBlockIndex );
             
             MemTagEntry *tagPtr = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
             
-            if (( tagPtr -> valid ) && ( tagPtr -> dirty )) opState.set( MO_WRITE_BACK_BLOCK );
-            else                                            opState.set( MO_READ_BLOCK );
+            if (( tagPtr -> valid ) && ( tagPtr -> prefetched )) pfPollutionCnt ++;
+            
+            if (( tagPtr -> valid ) && ( tagPtr -> dirty )) {
+                
+                dirtyMissCnt ++;
+                opState.set( MO_WRITE_BACK_BLOCK );
+            }
+            else {
+                
+                tagPtr -> valid = false;
+                opState.set( MO_READ_BLOCK );
+            }
             
         } break;
             
         case MO_READ_BLOCK: {
             
-            MemTagEntry *tagPtr    = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
-            uint8_t     *blockPtr  = &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
+            uint8_t *blockPtr = &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
          
             if ( lowerMem -> readBlock( 0, reqTag & ( ~ blockBitMask ), 0, blockPtr, cDesc.blockSize, reqPri )) {
                 
-                tagPtr -> valid = true;
-                tagPtr -> dirty = false;
-                tagPtr -> tag   = reqOfs & ( ~ blockBitMask );
-                opState.set( MO_IDLE );
+                if (( reqMshr < MAX_MSHR_ENTRIES ) &&
+                    ( mshrArray[ reqMshr ].valid ) &&
+                    ( mshrArray[ reqMshr ].exclusive )) opState.set( MO_FILL_BLOCK );
+                else enterBlock( );
             }
             else waitCyclesCnt ++;
             
         } break;
             
+        case MO_FILL_BLOCK: {
+            
+            enterBlock( );
+            
+        } break;
+            
         case MO_WRITE_BACK_BLOCK: {
             
             MemTagEntry *tagPtr    = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
             uint8_t     *blockPtr  = &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
             
-            if ( lowerMem -> writeBlock( 0, reqTag & ( ~ blockBitMask ), 0, blockPtr, cDesc.blockSize, reqPri )) {
+            if ( lowerMem -> writeBlock( 0, tagPtr -> tag & ( ~ blockBitMask ), 0, blockPtr, cDesc.blockSize, reqPri )) {
                 
                 tagPtr -> valid = false;
                 tagPtr -> dirty = false;
@@ -895,132 +1888,837 @@ void L1CacheMem::process( ) {
             } else opState.set( MO_IDLE );
             
         } break;
+        
+        case MO_SNOOP_WAIT: {
+            
+            if ( reqLatency > 0 ) {
+                
+                reqLatency --;
+                waitCyclesCnt ++;
+            }
+            else opState.set( MO_IDLE );
+            
+        } break;
     }
 }
 
-
-//------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------
+// "enterBlock" marks the block just read as valid. With a snoop bus, the other caches are snooped for the
+// block. The stores merged into the miss status holding register of the block are written to the block,
+// which frees the register. A prefetched block is marked as such.
 //
-// L2 cache object methods.
-//
 //------------------------------------------------------------------------------------------------------------
+void L1CacheMem::enterBlock( ) {
+    
+    MemTagEntry     *tagPtr     = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
+    uint8_t         *blockPtr   = &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
+    MemMshrEntry    *mPtr       = nullptr;
+    
+    if (( reqMshr < MAX_MSHR_ENTRIES ) && ( mshrArray[ reqMshr ].valid )) {
+        
+        mPtr            = &mshrArray[ reqMshr ];
+        reqExclusive    = mPtr -> exclusive;
+    }
+    
+    tagPtr -> valid         = true;
+    tagPtr -> dirty         = false;
+    tagPtr -> shared        = false;
+    tagPtr -> invalidated   = false;
+    tagPtr -> prefetched    = reqPrefetch;
+    tagPtr -> tag           = reqTag & ( ~ blockBitMask );
+    insertBlock( reqTargetBlockIndex, reqTargetSet );
+    reqPrefetch             = false;
+    
+    if ( snoopBus != nullptr ) {
+        
+        bool shared = false;
+        
+        reqLatency      = snoopBus -> busRead( this, tagPtr -> tag, reqExclusive, blockPtr, &shared );
+        tagPtr -> shared = shared;
+        opState.set(( reqLatency > 0 ) ? MO_SNOOP_WAIT : MO_IDLE );
+    }
+    else opState.set( MO_IDLE );
+    
+    if ( mPtr != nullptr ) {
+        
+        for ( uint32_t i = 0; i < cDesc.blockSize; i++ ) {
+            
+            if ( mPtr -> storeMask[ i ] ) {
+                
+                blockPtr[ i ]   = mPtr -> storeData[ i ];
+                tagPtr -> dirty = true;
+            }
+        }
+        
+        mPtr -> valid = false;
+        mshrPendingCnt --;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Miss status holding register routines. "findMshr" returns the register with a pending miss for the block
+// containing "adrTag". "allocMshr" enters a new miss, if there is a free register. "mergeMshr" records the
+// data of a store to the pending block. "startMshr" sets up the state machine for the next pending miss,
+// unless a request was just started by a cache access method in this cycle.
+//
 //------------------------------------------------------------------------------------------------------------
+uint16_t L1CacheMem::findMshr( uint32_t adrTag ) {
+    
+    for ( uint16_t i = 0; i < cDesc.mshrEntries; i++ ) {
+        
+        MemMshrEntry *mPtr = &mshrArray[ i ];
+        if (( mPtr -> valid ) && ( mPtr -> tag == ( adrTag & ( ~ blockBitMask )))) return( i );
+    }
+    
+    return( MAX_MSHR_ENTRIES );
+}
+
+uint16_t L1CacheMem::allocMshr( uint32_t adrTag, uint32_t blockIndex, bool exclusive ) {
+    
+    if ( mshrPendingCnt >= cDesc.mshrEntries ) return( MAX_MSHR_ENTRIES );
+    
+    for ( uint16_t i = 0; i < cDesc.mshrEntries; i++ ) {
+        
+        MemMshrEntry *mPtr = &mshrArray[ i ];
+        
+        if ( ! mPtr -> valid ) {
+            
+            mPtr -> valid       = true;
+            mPtr -> exclusive   = exclusive;
+            mPtr -> tag         = adrTag & ( ~ blockBitMask );
+            mPtr -> blockIndex  = blockIndex;
+            memset( mPtr -> storeMask, 0, cDesc.blockSize );
+            
+            mshrPendingCnt ++;
+            mshrAllocCnt ++;
+            return( i );
+        }
+    }
+    
+    return( MAX_MSHR_ENTRIES );
+}
+
+void L1CacheMem::mergeMshr( uint16_t mshr, uint32_t adrTag, uint32_t len, uint32_t data ) {
+    
+    MemMshrEntry    *mPtr       = &mshrArray[ mshr ];
+    uint8_t         *dataPtr    = &mPtr -> storeData[ adrTag & blockBitMask ];
+    
+    if      ( len == 1 ) *dataPtr                 = (uint8_t) data;
+    else if ( len == 2 ) *((uint16_t *) dataPtr ) = (uint16_t) data;
+    else                 *((uint32_t *) dataPtr ) = data;
+    
+    memset( &mPtr -> storeMask[ adrTag & blockBitMask ], 1, len );
+    mPtr -> exclusive = true;
+}
 
+void L1CacheMem::startMshr( ) {
+    
+    if ( opState.getLatched( ) != MO_IDLE ) return;
+    
+    for ( uint16_t i = 1; i <= cDesc.mshrEntries; i++ ) {
+        
+        uint16_t        mshr    = ( reqMshr + i ) % cDesc.mshrEntries;
+        MemMshrEntry    *mPtr   = &mshrArray[ mshr ];
+        
+        if ( mPtr -> valid ) {
+            
+            opState.set( MO_ALLOCATE_BLOCK );
+            reqSeg              = 0;
+            reqOfs              = mPtr -> tag;
+            reqTag              = mPtr -> tag;
+            reqPtr              = nullptr;
+            reqLen              = 0;
+            reqPri              = cDesc.priority;
+            reqLatency          = cDesc.latency;
+            reqExclusive        = mPtr -> exclusive;
+            reqMshr             = mshr;
+            
+            reqTargetSet        = MAX_BLOCK_SETS;
+            reqTargetBlockIndex = mPtr -> blockIndex;
+            return;
+        }
+    }
+}
 
 //------------------------------------------------------------------------------------------------------------
-// The "L2CacheMem" represents the L2 cache. It has a data and a tag array, which we allocate right here. The
-// cache is physically indexed and physically tagged.
+// "startPrefetch" sets up the state machine for the next block in the prefetch queue. A prefetch is only
+// started when the lower layer is IDLE as well, so that it does not hold up a demand miss of the other L1
+// cache. A block with a pending miss is not prefetched. The prefetch does not use a miss status holding
+// register, it is handled by the states for a miss and marked with "reqPrefetch".
 //
 //------------------------------------------------------------------------------------------------------------
-L2CacheMem::L2CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem ) : CpuMem( mDesc, lowerMem ) {
+void L1CacheMem::startPrefetch( ) {
     
-    for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
-            tagArray[ i ] = (MemTagEntry *) calloc( cDesc.blockEntries, sizeof( MemTagEntry));
+    if (( opState.getLatched( ) != MO_IDLE ) || ( ! lowerMem -> isIdle( ))) return;
     
-    for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
-        dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
-   
-    reset( );
+    uint32_t ofs;
+    uint32_t adrTag;
+    
+    while ( nextPrefetch( &ofs, &adrTag )) {
+        
+        if ( findMshr( adrTag ) < MAX_MSHR_ENTRIES ) continue;
+        
+        opState.set( MO_ALLOCATE_BLOCK );
+        reqSeg              = 0;
+        reqOfs              = ofs;
+        reqTag              = adrTag;
+        reqPtr              = nullptr;
+        reqLen              = 0;
+        reqPri              = cDesc.priority;
+        reqLatency          = cDesc.latency;
+        reqExclusive        = false;
+        reqMshr             = MAX_MSHR_ENTRIES;
+        reqPrefetch         = true;
+        reqPrefetchLate     = false;
+        
+        reqTargetSet        = MAX_BLOCK_SETS;
+        reqTargetBlockIndex = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
+        
+        pfIssuedCnt ++;
+        return;
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------
-// "processL2CacheRequest" is the state machine for the L2 cache. The L2 cache is a thing in the middle
-// between the L1 cache and the physical memory. It is a physically indexed, physically tagged cache and
-// serves both L1 caches with the L1 instruction cache having priority over the L1 data cache. The "seg"
-// parameter in the access methods is zero, and so is the "tag". The ofs" parameter contains the byte address
-// which is both the address and the tag for comparison.
+// "isCoherenceMiss" checks whether a miss is caused by another cache that invalidated our copy of the block.
+// Such a block keeps its tag and is marked invalidated until the entry is used again.
 //
-// The block sizes of the upper and lower layer do not necessarily have to match. For example, we could have
-// a 32 byte block L2 cache and a 16 byte block L1 cache. However, the upper layer must always be configured
-// smaller than the lower layer.
+//------------------------------------------------------------------------------------------------------------
+bool L1CacheMem::isCoherenceMiss( uint32_t blockIndex, uint32_t adrTag ) {
+    
+    for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) {
+        
+        MemTagEntry *ptr = &tagArray[ i ] [ blockIndex ];
+        if (( ptr -> invalidated ) && (( adrTag & ( ~ blockBitMask )) == ptr -> tag )) return( true );
+    }
+    
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setSnoopBus" connects the cache to the snoop bus of a multi-core system.
 //
-// There are some open questions:
+//------------------------------------------------------------------------------------------------------------
+void L1CacheMem::setSnoopBus( CpuSnoopBus *bus ) {
+    
+    snoopBus = bus;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "tick" latches the request state. With a snoop bus, this is done under the bus lock. A snoop request of
+// another core checks our request state for a block we just write back.
 //
-// 1.) Is this cache strictly inclusive ? If so, an entry in L2 must exist before it is moved to L1.
-// 2.) Invalidating L2 in a strictly inclusive model also needs to invalidate L1.
-// 3.) Coherence protocol for more than CPU core ?
+//------------------------------------------------------------------------------------------------------------
+void L1CacheMem::tick( ) {
+    
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    CpuMem::tick( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "snoop" is called by the snoop bus for a request of another cache. The cache is virtually indexed, so a
+// physical block address can be found at several block indexes when the cache is larger than a page. All
+// of them are checked. A modified block is written back to the lower layer and its data is copied to the
+// requestor's buffer. A read request leaves a shared copy, a read for ownership or an upgrade request
+// invalidates our copy. A block that is just being written back for a replacement still supplies its data,
+// it is invalidated when the write back is done. The bus lock is held by the caller. Our request state and
+// target block are only changed under the bus lock, the state is latched under the lock as well.
 //
-// ??? under construction ..... first get L1 and MEM stable...
 //------------------------------------------------------------------------------------------------------------
-void L2CacheMem::process( ) {
+SnoopResult L1CacheMem::snoop( uint32_t blockAdr, bool invalidate, uint8_t *buf ) {
     
-    uint32_t        blockIndex  = reqOfs % cDesc.blockSize;
-    uint16_t        blockSet    = matchTag( blockIndex, 0 ); // ??? FIX ...
-    MemTagEntry     *tagPtr     = nullptr;
-    uint8_t         *blockPtr   = nullptr;
-    bool            tagMatch    = blockSet < MAX_BLOCK_SETS;
+    uint32_t    cacheSize       = cDesc.blockEntries * cDesc.blockSize;
+    uint32_t    aliasSize       = ( cacheSize < PAGE_SIZE_BYTES ) ? cacheSize : PAGE_SIZE_BYTES;
+    uint32_t    numOfAliases    = cacheSize / aliasSize;
+    uint32_t    baseIndex       = ( blockAdr % aliasSize ) / cDesc.blockSize;
+    SnoopResult res             = SNOOP_MISS;
     
-    if ( tagMatch ) {
+    for ( uint32_t a = 0; a < numOfAliases; a++ ) {
         
-        tagPtr      =   &tagArray[ blockSet ] [ blockIndex ];
-        blockPtr    =   &dataArray[ blockSet ] [ blockIndex * cDesc.blockSize ];
-    }
-    else {
+        uint32_t blockIndex = baseIndex + a * ( aliasSize / cDesc.blockSize );
+        uint16_t matchSet   = matchTag( blockIndex, blockAdr );
         
-        // we have a miss...
-        // select a random set for use...
-    }
-    
-    switch( opState.get( )) {
+        if ( matchSet >= cDesc.blockSets ) continue;
+        
+        MemTagEntry *tagPtr     = &tagArray[ matchSet ] [ blockIndex ];
+        uint8_t     *blockPtr   = &dataArray[ matchSet ] [ blockIndex * cDesc.blockSize ];
+        
+        if ( tagPtr -> dirty ) {
             
-        case MO_READ_BLOCK: {
+            if ( buf != nullptr ) memcpy( buf, blockPtr, cDesc.blockSize );
+            interventionCnt ++;
+            res = SNOOP_HIT_DIRTY;
             
-            if ( reqLatency == 0 ) {
-                
-            }
-            else reqLatency--;
+            if (( opState.get( ) == MO_WRITE_BACK_BLOCK ) &&
+                ( reqTargetSet == matchSet ) && ( reqTargetBlockIndex == blockIndex )) continue;
             
-        } break;
+            lowerMem -> putMemDataBlock( blockAdr, blockPtr, cDesc.blockSize );
+            tagPtr -> dirty = false;
+        }
+        else if ( res == SNOOP_MISS ) res = SNOOP_HIT;
+        
+        if ( invalidate ) {
             
-        case MO_WRITE_BLOCK: {
+            invalidateCnt ++;
+            tagPtr -> valid         = false;
+            tagPtr -> shared        = false;
+            tagPtr -> invalidated   = true;
+        }
+        else tagPtr -> shared = true;
+    }
+    
+    return( res );
+}
+
+
+//------------------------------------------------------------------------------------------------------------
+// "backInvalidate" is called by an inclusive L2 cache for a block it replaces. The block is searched at all
+// block indexes it could be found, just like for a snoop request. Modified data is written back to the L2
+// cache, which still holds the block, and the block is invalidated.
+//
+//------------------------------------------------------------------------------------------------------------
+void L1CacheMem::backInvalidate( uint32_t blockAdr ) {
+    
+    uint32_t    cacheSize       = cDesc.blockEntries * cDesc.blockSize;
+    uint32_t    aliasSize       = ( cacheSize < PAGE_SIZE_BYTES ) ? cacheSize : PAGE_SIZE_BYTES;
+    uint32_t    numOfAliases    = cacheSize / aliasSize;
+    uint32_t    baseIndex       = ( blockAdr % aliasSize ) / cDesc.blockSize;
+    
+    for ( uint32_t a = 0; a < numOfAliases; a++ ) {
+        
+        uint32_t blockIndex = baseIndex + a * ( aliasSize / cDesc.blockSize );
+        uint16_t matchSet   = matchTag( blockIndex, blockAdr );
+        
+        if ( matchSet >= cDesc.blockSets ) continue;
+        
+        MemTagEntry *tagPtr     = &tagArray[ matchSet ] [ blockIndex ];
+        uint8_t     *blockPtr   = &dataArray[ matchSet ] [ blockIndex * cDesc.blockSize ];
+        
+        if ( tagPtr -> dirty ) lowerMem -> putMemDataBlock( blockAdr, blockPtr, cDesc.blockSize );
+        
+        tagPtr -> valid         = false;
+        tagPtr -> dirty         = false;
+        tagPtr -> shared        = false;
+    }
+}
+
+
+//------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------
+//
+// Snoop bus methods.
+//
+//------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------------------------------------
+// The snoop bus object. The latencies come from the CPU core configuration.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuSnoopBus::CpuSnoopBus( CpuCoreDesc *cfg ) {
+    
+    snoopLatency        = cfg -> snoopLatency;
+    interventionLatency = cfg -> interventionLatency;
+}
+
+void CpuSnoopBus::attach( L1CacheMem *cache ) {
+    
+    if ( numOfCaches < MAX_CPU_CORES ) {
+        
+        caches[ numOfCaches ] = cache;
+        cache -> setSnoopBus( this );
+        numOfCaches ++;
+    }
+}
+
+void CpuSnoopBus::attach( L2CacheMem *cache ) {
+    
+    cache -> setSnoopBus( this );
+}
+
+void CpuSnoopBus::clearStats( ) {
+    
+    busReads            = 0;
+    busReadsExclusive   = 0;
+    busUpgrades         = 0;
+    busInvalidations    = 0;
+    busInterventions    = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "busRead" is sent by a cache that just read the block from the lower layer. All other caches are snooped.
+// A cache holding the block modified copies its data into the requestor's block, which replaces the data
+// read. The "shared" flag tells whether another cache still holds a copy. The function returns the cycles
+// for the snoop and an intervention. The bus lock is held by the caller.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuSnoopBus::busRead( L1CacheMem *requestor, uint32_t blockAdr, bool exclusive, uint8_t *buf, bool *shared ) {
+    
+    uint32_t latency = snoopLatency;
+    
+    if ( exclusive ) busReadsExclusive ++;
+    else             busReads ++;
+    
+    *shared = false;
+    
+    for ( uint32_t i = 0; i < numOfCaches; i++ ) {
+        
+        if ( caches[ i ] == requestor ) continue;
+        
+        SnoopResult res = caches[ i ] -> snoop( blockAdr, exclusive, buf );
+        
+        if ( res == SNOOP_HIT_DIRTY ) {
             
-            if ( reqLatency == 0 ) {
-                
-            }
-            else reqLatency--;
+            busInterventions ++;
+            latency = snoopLatency + interventionLatency;
+        }
+        
+        if ( res != SNOOP_MISS ) {
+            
+            if ( exclusive ) busInvalidations ++;
+            else             *shared = true;
+        }
+    }
+    
+    return( latency );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "busUpgrade" is sent by a cache that writes to a shared block. The other copies are invalidated. No data
+// is transferred, since a shared block is never modified.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuSnoopBus::busUpgrade( L1CacheMem *requestor, uint32_t blockAdr ) {
+    
+    busUpgrades ++;
+    
+    for ( uint32_t i = 0; i < numOfCaches; i++ ) {
+        
+        if ( caches[ i ] == requestor ) continue;
+        if ( caches[ i ] -> snoop( blockAdr, true, nullptr ) != SNOOP_MISS ) busInvalidations ++;
+    }
+    
+    return( snoopLatency );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "backInvalidate" is sent by the shared L2 cache for a block it replaces. The block is invalidated in all L1
+// data caches, modified data is written back to the L2 cache. The bus lock is held by the caller.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSnoopBus::backInvalidate( uint32_t blockAdr ) {
+    
+    for ( uint32_t i = 0; i < numOfCaches; i++ ) caches[ i ] -> backInvalidate( blockAdr );
+}
+
+
+//------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------
+//
+// L2 cache object methods.
+//
+//------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------------------------------------
+// The "L2CacheMem" represents the L2 cache. It has a data and a tag array, which we allocate right here. The
+// cache is physically indexed and physically tagged. When a shared L2 cache object is passed, its tag, data
+// and replacement arrays are used instead of allocating them.
+//
+//------------------------------------------------------------------------------------------------------------
+L2CacheMem::L2CacheMem( CpuMemDesc *mDesc, CpuMem *lowerMem, L2CacheMem *sharedL2 ) : CpuMem( mDesc, lowerMem ) {
+    
+    if ( sharedL2 == nullptr ) {
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
+            tagArray[ i ] = (MemTagEntry *) calloc( cDesc.blockEntries, sizeof( MemTagEntry));
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
+            dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
+        
+        replArray = (uint32_t *) calloc( cDesc.blockEntries, sizeof( uint32_t ));
+    }
+    else {
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) tagArray[ i ]  = sharedL2 -> tagArray[ i ];
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) dataArray[ i ] = sharedL2 -> dataArray[ i ];
+        
+        replArray = sharedL2 -> replArray;
+    }
+    
+    reset( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The L2 cache is connected to the L1 caches it serves. For an inclusive L2 cache, a block replaced in the
+// L2 cache must not stay in any L1 cache.
+//
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::setUpperCaches( L1CacheMem *iCache, L1CacheMem *dCache, bool inclusive ) {
+    
+    upperMem[ 0 ]       = iCache;
+    upperMem[ 1 ]       = dCache;
+    this -> inclusive   = inclusive;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setSnoopBus" connects the L2 cache of a multi-core system to the snoop bus. The tag and data arrays are
+// shared with the other cores, all accesses to them are done under the bus lock. "warmBlock" is the locked
+// version of the memory object routine.
+//
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::setSnoopBus( CpuSnoopBus *bus ) {
+    
+    snoopBus = bus;
+}
+
+bool L2CacheMem::warmBlock( uint32_t ofs, uint32_t adrTag, uint8_t *memData, bool isWrite ) {
+    
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    return( CpuMem::warmBlock( ofs, adrTag, memData, isWrite ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "readBlock" and "writeBlock" are called by the L1 caches. Both L1 caches share the L2 cache and there is
+// only one request served at a time. The L1 caches are processed one after the other in a clock cycle. When
+// the L2 cache is IDLE, the first request is accepted. A request in the same cycle with a higher priority
+// replaces it. The L1 cache that lost will find the L2 cache busy with another request in the next cycle
+// and tries again when the L2 cache is IDLE. A request is identified by the requestor's buffer and the
+// block address.
+//
+// A request is done when the L2 cache has counted down the latency and holds the block. The data is
+// transferred right when the L1 cache sees the request done. A request the L1 cache does not ask for again
+// is transferred by the state machine in the same clock cycle. With a snoop bus, this is done under the bus
+// lock, so that another core cannot replace the block between the tag match and the transfer.
+//
+//------------------------------------------------------------------------------------------------------------
+bool L2CacheMem::readBlock( uint32_t, uint32_t ofs, uint32_t, uint8_t *buf, uint32_t len, uint32_t pri ) {
+    
+    return( blockRequest( MO_READ_BLOCK, ofs, buf, len, pri ));
+}
+
+bool L2CacheMem::writeBlock( uint32_t, uint32_t ofs, uint32_t, uint8_t *buf, uint32_t len, uint32_t pri ) {
+    
+    return( blockRequest( MO_WRITE_BLOCK, ofs, buf, len, pri ));
+}
+
+bool L2CacheMem::blockRequest( uint16_t op, uint32_t ofs, uint8_t *buf, uint32_t len, uint32_t pri ) {
+    
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    if ( pri == 0 ) pri = cDesc.priority;
+    if ( reqFillPending ) enterBlock( );
+    
+    if ( opState.get( ) == MO_IDLE ) {
+        
+        if (( opState.getLatched( ) != MO_IDLE ) && ( pri <= reqPri )) return( false );
+        
+        opState.set( op );
+        reqSeg              = 0;
+        reqOfs              = ofs;
+        reqTag              = ofs;
+        reqPtr              = buf;
+        reqLen              = len;
+        reqPri              = pri;
+        reqLatency          = cDesc.latency;
+        reqResumeState      = op;
+        reqDone             = false;
+        
+        reqTargetSet        = MAX_BLOCK_SETS;
+        reqTargetBlockIndex = ( ofs / cDesc.blockSize ) % cDesc.blockEntries;
+        return( false );
+    }
+    else if ( isPrefetchPending( ofs )) return( false );
+    else return(( opState.get( ) == op ) &&
+                ( reqPtr == buf ) &&
+                ( reqOfs == ofs ) &&
+                ( reqLatency == 0 ) &&
+                (( reqDone ) || ( transferBlock( ))));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "transferBlock" copies the data of the current read or write block request, when the L2 cache holds the
+// block. A read copies the requested part of our block to the requestor, a write copies the requestor's
+// data into our block and marks it dirty. The routine returns false for a miss.
+//
+//------------------------------------------------------------------------------------------------------------
+bool L2CacheMem::transferBlock( ) {
+    
+    uint16_t matchSet = matchTag( reqTargetBlockIndex, reqOfs );
+    
+    if ( matchSet >= cDesc.blockSets ) return( false );
+    
+    MemTagEntry *tagPtr     = &tagArray[ matchSet ] [ reqTargetBlockIndex ];
+    uint8_t     *dataPtr    = &dataArray[ matchSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
+    uint32_t    dataOfs     = reqOfs & blockBitMask;
+    uint32_t    len         = ( dataOfs + reqLen <= cDesc.blockSize ) ? reqLen : cDesc.blockSize - dataOfs;
+    
+    if ( opState.get( ) == MO_READ_BLOCK ) {
+        
+        memcpy( reqPtr, &dataPtr[ dataOfs ], len );
+        if ( cDesc.prefetchPolicy != MEM_PF_NONE ) trainPrefetcher( reqOfs, reqOfs, tagPtr );
+    }
+    else {
+        
+        memcpy( &dataPtr[ dataOfs ], reqPtr, len );
+        tagPtr -> dirty = true;
+    }
+    
+    touchBlock( reqTargetBlockIndex, matchSet );
+    accessCnt ++;
+    reqDone = true;
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "enterBlock" enters the block read into the fill buffer. The lower layer copies the data in the clock cycle
+// it reports the read done, after our state machine ran. The block is therefore entered in the next cycle,
+// either when the requestor asks again or by the state machine, whichever comes first. With a snoop bus,
+// another core may have entered the block or used our target block in the meantime. In the first case,
+// our data is dropped. In the second case, a new victim is selected and written back right away.
+//
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::enterBlock( ) {
+    
+    uint32_t adrTag = reqOfs & ( ~ blockBitMask );
+    
+    reqFillPending = false;
+    
+    if ( matchTag( reqTargetBlockIndex, adrTag ) < cDesc.blockSets ) {
+        
+        reqPrefetch = false;
+        return;
+    }
+    
+    MemTagEntry *tagPtr = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
+    
+    if ( tagPtr -> valid ) {
+        
+        reqTargetSet    = selectVictim( reqTargetBlockIndex );
+        tagPtr          = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
+        
+        if ( tagPtr -> valid ) invalidateUpper( tagPtr -> tag );
+        
+        if (( tagPtr -> valid ) && ( tagPtr -> dirty )) {
+            
+            lowerMem -> putMemDataBlock( tagPtr -> tag,
+                                         &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ],
+                                         cDesc.blockSize );
+        }
+    }
+    
+    memcpy( &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ], fillBuf, cDesc.blockSize );
+    
+    tagPtr -> valid         = true;
+    tagPtr -> dirty         = false;
+    tagPtr -> prefetched    = reqPrefetch;
+    tagPtr -> tag           = adrTag;
+    insertBlock( reqTargetBlockIndex, reqTargetSet );
+    reqPrefetch             = false;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "invalidateUpper" invalidates the copies of a block we replace in the L1 caches, when the L2 cache is an
+// inclusive cache. Their modified data is merged into our block. With a snoop bus, the copies in the L1 data
+// caches of all cores are invalidated.
+//
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::invalidateUpper( uint32_t adrTag ) {
+    
+    if ( ! inclusive ) return;
+    
+    for ( int i = 0; i < 2; i++ ) {
+        
+        if ( upperMem[ i ] == nullptr ) continue;
+        
+        uint32_t upperBlockSize = upperMem[ i ] -> getBlockSize( );
+        
+        for ( uint32_t adr = 0; adr < cDesc.blockSize; adr += upperBlockSize ) {
+            
+            if (( i == 1 ) && ( snoopBus != nullptr )) snoopBus -> backInvalidate( adrTag + adr );
+            else upperMem[ i ] -> backInvalidate( adrTag + adr );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "process" is the state machine for the L2 cache. The L2 cache is a thing in the middle between the L1
+// caches and the physical memory. It is a physically indexed, physically tagged cache and serves both L1
+// caches. The "ofs" parameter of a request contains the byte address which is both the address and the tag
+// for comparison. The block sizes of the upper and lower layer do not necessarily have to match. For
+// example, we could have a 32 byte block L2 cache and a 16 byte block L1 cache. However, the upper layer must
+// always be configured smaller than or equal to the lower layer. The state machine has several states:
+//
+// MO_READ_BLOCK: an L1 cache reads a block. After the latency is counted down, a hit copies the requested
+// part of our block to the requestor, unless this was already done when the requestor asked, and the next
+// state is MO_IDLE. A miss continues with allocating a block.
+//
+// MO_WRITE_BLOCK: an L1 cache writes back a block. A hit copies the data into our block and marks it dirty.
+// A miss allocates the block just like a read, the cache is a write allocate cache.
+//
+// MO_ALLOCATE_BLOCK: the block to replace is chosen, an invalid block first, otherwise the one selected by
+// the replacement policy. An inclusive cache first invalidates the copies of the replaced block in the L1
+// caches. A dirty block is copied to the write back buffer and written back in MO_WRITE_BACK_BLOCK, which
+// comes back to this state. Otherwise, the next state is MO_FILL_BLOCK.
+//
+// MO_FILL_BLOCK: the block is read from the lower layer into the fill buffer. Once done, the request
+// continues in its original state. The block is entered in the next cycle, the request then finds it.
+//
+// With a prefetcher, the read requests of the L1 caches train it. An IDLE cache starts the next block in
+// the prefetch queue with the MO_ALLOCATE_BLOCK state, the MO_FILL_BLOCK state then returns to MO_IDLE. A
+// request for the block being prefetched waits for it, any other request waits as well until the L2 cache
+// is IDLE again.
+//
+// In a multi-core system, the state machine runs under the bus lock, since the tag and data arrays are
+// shared by the L2 cache objects of all cores.
+//
+// ??? the instruction caches of the other cores keep their copies of a replaced block.
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::process( ) {
+    
+    std::unique_lock< std::recursive_mutex > lock;
+    if ( snoopBus != nullptr ) lock = std::unique_lock< std::recursive_mutex >( snoopBus -> busLock );
+    
+    if ( reqFillPending ) enterBlock( );
+    
+    switch( opState.get( )) {
+        
+        case MO_IDLE: {
+            
+            if ( pfQueueCnt > 0 ) startPrefetch( );
             
         } break;
+        
+        case MO_READ_BLOCK:
+        case MO_WRITE_BLOCK: {
             
-        case MO_FLUSH_BLOCK: {
+            if ( reqLatency > 0 ) {
+                
+                reqLatency --;
+                break;
+            }
             
-            if ( reqLatency == 0 ) {
+            if (( reqDone ) || ( transferBlock( ))) {
                 
+                opState.set( MO_IDLE );
+            }
+            else {
+                
+                if (( opState.get( ) == MO_READ_BLOCK ) && ( cDesc.prefetchPolicy != MEM_PF_NONE ))
+                    trainPrefetcher( reqOfs, reqOfs, nullptr );
+                
+                missCnt ++;
+                reqTargetSet = MAX_BLOCK_SETS;
+                opState.set( MO_ALLOCATE_BLOCK );
             }
-            else reqLatency--;
             
         } break;
             
-        case MO_PURGE_BLOCK: {
+        case MO_ALLOCATE_BLOCK: {
             
-            if ( reqLatency == 0 ) {
+            reqTargetSet = selectVictim( reqTargetBlockIndex );
+            
+            MemTagEntry *tagPtr = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
+            
+            if (( tagPtr -> valid ) && ( tagPtr -> prefetched )) pfPollutionCnt ++;
+            if ( tagPtr -> valid ) invalidateUpper( tagPtr -> tag );
+            
+            if (( tagPtr -> valid ) && ( tagPtr -> dirty )) {
+                
+                reqWriteBackTag = tagPtr -> tag;
+                memcpy( writeBackBuf,
+                        &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ],
+                        cDesc.blockSize );
                 
+                dirtyMissCnt ++;
+                opState.set( MO_WRITE_BACK_BLOCK );
+            }
+            else {
+                
+                tagPtr -> valid = false;
+                opState.set( MO_FILL_BLOCK );
             }
-            else reqLatency--;
             
         } break;
             
-        case MO_ALLOCATE_BLOCK: {
+        case MO_WRITE_BACK_BLOCK: {
             
-            if ( reqLatency == 0 ) {
+            MemTagEntry *tagPtr    = &tagArray[ reqTargetSet ] [ reqTargetBlockIndex ];
+            uint8_t     *blockPtr  = &dataArray[ reqTargetSet ] [ reqTargetBlockIndex * cDesc.blockSize ];
+            bool        ownBlock   = ( tagPtr -> valid ) && ( tagPtr -> tag == reqWriteBackTag );
+            
+            if (( ownBlock ) && ( tagPtr -> dirty )) memcpy( writeBackBuf, blockPtr, cDesc.blockSize );
+            
+            if ( lowerMem -> writeBlock( 0, reqWriteBackTag, 0, writeBackBuf, cDesc.blockSize, reqPri )) {
                 
+                if ( ownBlock ) {
+                    
+                    tagPtr -> valid = false;
+                    tagPtr -> dirty = false;
+                }
+                
+                opState.set( MO_ALLOCATE_BLOCK );
             }
-            else reqLatency--;
+            else waitCyclesCnt ++;
             
         } break;
             
-        case MO_WRITE_BACK_BLOCK: {
+        case MO_FILL_BLOCK: {
             
-            if ( reqLatency == 0 ) {
+            if ( lowerMem -> readBlock( 0, reqOfs & ( ~ blockBitMask ), 0, fillBuf, cDesc.blockSize, reqPri )) {
                 
+                reqFillPending = true;
+                opState.set( reqResumeState );
             }
-            else reqLatency--;
+            else waitCyclesCnt ++;
             
         } break;
     }
 }
 
 
+//------------------------------------------------------------------------------------------------------------
+// "startPrefetch" sets up the state machine for the next block in the prefetch queue, unless an L1 cache
+// request was accepted in this clock cycle or the lower layer is busy.
+//
+//------------------------------------------------------------------------------------------------------------
+void L2CacheMem::startPrefetch( ) {
+    
+    if (( opState.getLatched( ) != MO_IDLE ) || ( ! lowerMem -> isIdle( ))) return;
+    
+    uint32_t ofs;
+    uint32_t adrTag;
+    
+    if ( nextPrefetch( &ofs, &adrTag )) {
+        
+        opState.set( MO_ALLOCATE_BLOCK );
+        reqSeg              = 0;
+        reqOfs              = adrTag;
+        reqTag              = adrTag;
+        reqPtr              = nullptr;
+        reqLen              = 0;
+        reqPri              = cDesc.priority;
+        reqLatency          = cDesc.latency;
+        reqResumeState      = MO_IDLE;
+        reqDone             = false;
+        reqPrefetch         = true;
+        reqPrefetchLate     = false;
+        
+        reqTargetSet        = MAX_BLOCK_SETS;
+        reqTargetBlockIndex = ( adrTag / cDesc.blockSize ) % cDesc.blockEntries;
+        
+        pfIssuedCnt ++;
+    }
+}
+
+
 //------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------
 //
@@ -1031,15 +2729,39 @@ void L2CacheMem::process( ) {
 
 
 //------------------------------------------------------------------------------------------------------------
-// The "PhysMem" represents the main memory. There is exactly one data array and no tags.
+// The "PhysMem" represents the main memory. There is exactly one data array and no tags. The data array is
+// a sparse mapping, a large memory only costs the host pages actually written to and a reset only gives back
+// those pages. Should the mapping fail, we fall back to an allocated array. When a shared memory object is
+// passed, its data array is used instead of allocating one. The reset is done before, so that the shared
+// data is not cleared.
 //
 //------------------------------------------------------------------------------------------------------------
-PhysMem::PhysMem( CpuMemDesc *mDesc  ) : CpuMem( mDesc, nullptr ) {
+PhysMem::PhysMem( CpuMemDesc *mDesc, PhysMem *sharedMem ) : CpuMem( mDesc, nullptr ) {
     
-    for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
-        dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
-   
-    reset( );
+    if ( sharedMem == nullptr ) {
+        
+        dataMapped = true;
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) {
+            
+            dataArray[ i ] = mapDataArray((size_t) cDesc.blockEntries * cDesc.blockSize );
+            
+            if ( dataArray[ i ] == nullptr ) {
+                
+                dataArray[ i ]  = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
+                dataMapped      = false;
+            }
+        }
+        
+        reset( );
+    }
+    else {
+        
+        reset( );
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) dataArray[ i ] = sharedMem -> dataArray[ i ];
+        dataMapped = sharedMem -> dataMapped;
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -1135,15 +2857,24 @@ void PhysMem::process( ) {
 
 //------------------------------------------------------------------------------------------------------------
 // The "PDC" represents the processor dependent code memory range. There is exactly one data array and no
-// tags. The data range is read only.
+// tags. The data range is read only. Just like the physical memory, the data array can be shared.
 //
 //------------------------------------------------------------------------------------------------------------
-PdcMem::PdcMem( CpuMemDesc *mDesc ) : CpuMem( mDesc, nullptr ) {
+PdcMem::PdcMem( CpuMemDesc *mDesc, PdcMem *sharedMem ) : CpuMem( mDesc, nullptr ) {
     
-    for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
-        dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
-   
-    reset( );
+    if ( sharedMem == nullptr ) {
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ )
+            dataArray[ i ] = (uint8_t *) calloc( cDesc.blockEntries, cDesc.blockSize );
+        
+        reset( );
+    }
+    else {
+        
+        reset( );
+        
+        for ( uint32_t i = 0; i < cDesc.blockSets; i++ ) dataArray[ i ] = sharedMem -> dataArray[ i ];
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -63,22 +63,10 @@ uint32_t getBitField( uint32_t arg, int pos, int len, bool sign = false ) {
     else        return( tmpA & tmpM );
 }
 
-///------------------------------------------------------------------------------------------------------------
-// Little helper function to return the data length in bytes as encoded in the 2dw" field.
+//------------------------------------------------------------------------------------------------------------
+// Little helper function to check the alignment of an address for the data length encoded in the "dw" field.
 //
 //------------------------------------------------------------------------------------------------------------
-uint32_t mapDataLen( uint32_t instr ) {
-    
-    switch( getBitField( instr, 15, 2 )) {
-            
-        case 0:     return( 1 );
-        case 1:     return( 2 );
-        case 2:     return( 4 );
-        case 3:     return( 8 );
-        default:    return( 0 );
-    }
-}
-
 bool isAligned( uint32_t adr, uint32_t dwField ) {
     
     switch( dwField ) {
@@ -91,42 +79,6 @@ bool isAligned( uint32_t adr, uint32_t dwField ) {
     }
 }
 
-//------------------------------------------------------------------------------------------------------------
-// Two little helper functions that determine whether an instruction is reading from or writing to memory.
-//
-//------------------------------------------------------------------------------------------------------------
-bool isReadIstr( uint32_t instr ) {
-    
-    switch ( getBitField( instr, 5, 6 )) {
-            
-        case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:
-        case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU:  {
-            
-            return( getBitField( instr, 13, 2 ) >= 2 );
-        }
-            
-        case OP_LD:     case OP_LDA:    case OP_LDR:    {
-            
-            return( true );
-        }
-            
-        default: return( false );
-    }
-}
-
-bool isWriteInstr( uint32_t instr ) {
-    
-    switch ( getBitField( instr, 5, 6 )) {
-            
-        case OP_ST:    case OP_STA:    case OP_STC:  {
-            
-            return( true );
-        }
-            
-        default: return( false );
-    }
-}
-
 //------------------------------------------------------------------------------------------------------------
 // Address alignment check.
 //
@@ -162,9 +114,15 @@ void MemoryAccessStage::reset( )  {
     psPstate0.reset( );
     psPstate1.reset( );
     psInstr.reset( );
+    psDecIndex.reset( );
     psValA.reset( );
     psValB.reset( );
     psValX.reset( );
+    psInstr2.reset( );
+    psDecIndex2.reset( );
+    
+    DecodeCache::decode( NOP_INSTR, &decScratch );
+    DecodeCache::decode( NOP_INSTR, &decScratch2 );
 }
 
 void MemoryAccessStage::tick( ) {
@@ -174,9 +132,12 @@ void MemoryAccessStage::tick( ) {
         psPstate0.tick( );
         psPstate1.tick( );
         psInstr.tick( );
+        psDecIndex.tick( );
         psValA.tick( );
         psValB.tick( );
         psValX.tick( );
+        psInstr2.tick( );
+        psDecIndex2.tick( );
     }
 }
 
@@ -197,6 +158,7 @@ void MemoryAccessStage::stallPipeLine( ) {
     core -> exStage -> psValA.set( 0 );
     core -> exStage -> psValB.set( 0 );
     core -> exStage -> psValX.set( 0 );
+    core -> exStage -> psInstr2.set( NOP_INSTR );
 }
 
 bool MemoryAccessStage::isStalled( ) {
@@ -240,6 +202,8 @@ void MemoryAccessStage::setStalled( bool arg ) {
 // We would then perhaps need not to abort the cache for this reason, perhaps for other reasons.
 // To be tried out ...
 //
+// The branch predictor update and the pairing result the FD stage recorded for the flushed instruction are
+// undone. A TLB refill pending for a flushed instruction is dropped, for the instruction and the data TLB.
 //
 //------------------------------------------------------------------------------------------------------------
 void MemoryAccessStage::flushPipeLine( ) {
@@ -248,12 +212,17 @@ void MemoryAccessStage::flushPipeLine( ) {
     psValA.set( 0 );
     psValB.set( 0 );
     psValX.set( 0 );
+    psInstr2.set( NOP_INSTR );
+    
+    core -> branchPred -> squashFetch( );
+    core -> fdStage -> squashPair( );
+    core -> iTlb -> abortTlbOp( );
+    core -> dTlb -> abortTlbOp( );
     
     if ( core -> fdStage -> isStalled( )) {
         
         core -> fdStage -> setStalled( false );
         core -> iCacheL1 -> abortOp( );
-        core -> iTlb -> abortTlbOp( );
     }
 }
 
@@ -280,12 +249,28 @@ void MemoryAccessStage::setupTrapData( uint32_t trapId,
                                       uint32_t p2,
                                       uint32_t p3 ) {
     
-    core -> cReg[ CR_TRAP_PSW_0 ].set( psw0 );
-    core -> cReg[ CR_TRAP_PSW_1 ].set( psw1 );
-    core -> cReg[ CR_TRAP_PARM_1 ].set( p1 );
-    core -> cReg[ CR_TRAP_PARM_2 ].set( p2 );
-    core -> cReg[ CR_TRAP_PARM_3 ].set( p3 );
-    core -> cReg[ CR_TEMP_1 ].set( trapId );
+    core -> cReg.set( CR_TRAP_PSW_0, psw0 );
+    core -> cReg.set( CR_TRAP_PSW_1, psw1 );
+    core -> cReg.set( CR_TRAP_PARM_1, p1 );
+    core -> cReg.set( CR_TRAP_PARM_2, p2 );
+    core -> cReg.set( CR_TRAP_PARM_3, p3 );
+    core -> cReg.set( CR_TEMP_1, trapId );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "getDecoded" returns the decoded record for the instruction in our pipeline register. The FD stage passed
+// the decode cache index along with the instruction. "getDecoded2" does the same for the second instruction
+// of a dual issue pair.
+//
+//------------------------------------------------------------------------------------------------------------
+DecodedInstr *MemoryAccessStage::getDecoded( ) {
+    
+    return( core -> decodeCache -> getDecoded( psDecIndex.get( ), psInstr.get( ), &decScratch ));
+}
+
+DecodedInstr *MemoryAccessStage::getDecoded2( ) {
+    
+    return( core -> decodeCache -> getDecoded( psDecIndex2.get( ), psInstr2.get( ), &decScratch2 ));
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -300,30 +285,39 @@ bool MemoryAccessStage::dependencyValA( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
     
-    uint32_t instr = psInstr.get( );
+    DecodedInstr *dInstr = getDecoded( );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            return(( getBitField( instr, 13, 2 ) > 0 ) && ( getBitField( instr, 27, 4 ) == regId ));
+            uint32_t mode = dInstr -> opMode;
+            
+            if (( mode == OP_MODE_IMM ) || ( mode == OP_MODE_REG_INDX )) return( dInstr -> regR == regId );
+            else if ( mode == OP_MODE_REG ) return( dInstr -> regA == regId );
+            else return( false );
+        }
+            
+        case OP_ADDIL: {
+            
+            return( dInstr -> regR == regId );
         }
             
         case OP_DEP: {
             
-            return(( ! getBit( instr, 10 )) ? ( getBitField( instr, 9, 4 ) == regId ) : false );
+            return(( ! getBit( dInstr -> instr, 10 )) ? ( dInstr -> regR == regId ) : false );
         }
             
         case OP_DSR:    case OP_SHLA:   case OP_CMR:    case OP_BVE:    case OP_CBR:    case OP_CBRU:
         case OP_LDPA:   case OP_PRB:    case OP_PTLB:   case OP_PCA:    case OP_DIAG: {
             
-            return( getBitField( instr, 27, 4 ) == regId );
+            return( dInstr -> regA == regId );
         }
             
         case OP_ST:     case OP_STA: {
             
-            return( getBitField( instr, 9, 4 ) == regId );
+            return( dInstr -> regR == regId );
         }
             
         default: return ( false );
@@ -345,22 +339,22 @@ bool MemoryAccessStage::dependencyValB( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
     
-    uint32_t instr = psInstr.get( );
+    DecodedInstr *dInstr = getDecoded( );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
+            uint32_t mode = dInstr -> opMode;
             
-            return(( mode > 0 ) && ( getBitField( instr, 31, 4 ) == regId ));
+            return(( mode == OP_MODE_REG ) && ( dInstr -> regB == regId ));
         }
             
-        case OP_LSID:   case OP_EXTR:   case OP_DEP:    case OP_DSR:    case OP_SHLA:   case OP_CMR:
-        case OP_LDO:    case OP_CBR:    case OP_CBRU:   case OP_MST:    case OP_DIAG: {
+        case OP_EXTR:   case OP_DEP:    case OP_DSR:    case OP_SHLA:   case OP_CMR:    case OP_CBR:
+        case OP_CBRU:   case OP_MST:    case OP_DIAG: {
             
-            return( getBitField( instr, 31, 4 ) == regId );
+            return( dInstr -> regB == regId );
         }
             
         default: return ( false );
@@ -377,16 +371,16 @@ bool MemoryAccessStage::dependencyValX( uint32_t regId ) {
     
     if ( regId == 0 ) return( false );
     
-    uint32_t instr = psInstr.get( );
+    DecodedInstr *dInstr = getDecoded( );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:    case OP_OR:
         case OP_XOR:    case OP_CMP:    case OP_CMPU: {
             
-            uint32_t mode = getBitField( instr, 13, 2 );
+            uint32_t mode = dInstr -> opMode;
             
-            return(( mode == 1 ) && ( getBitField( instr, 27, 4 ) == regId ));
+            return(( mode == 1 ) && ( dInstr -> regA == regId ));
         }
             
         default: return ( false );
@@ -400,9 +394,9 @@ bool MemoryAccessStage::dependencyValX( uint32_t regId ) {
 //------------------------------------------------------------------------------------------------------------
 bool MemoryAccessStage::dependencyValST( ) {
     
-    uint32_t instr = psInstr.get( );
+    DecodedInstr *dInstr = getDecoded( );
     
-    switch ( getBitField( instr, 5, 6 )) {
+    switch ( dInstr -> opCode ) {
             
         case OP_ADC:    case OP_SBC: return( true );
             
@@ -410,6 +404,51 @@ bool MemoryAccessStage::dependencyValST( ) {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "hasEarlyResult" checks whether the instruction produces its general register result already in the MA
+// stage. The EX stage just writes back the value passed in "B". These are the load instructions, the LDO
+// address computation, the LDIL immediate and the LSID segment id lookup.
+//
+//------------------------------------------------------------------------------------------------------------
+bool MemoryAccessStage::hasEarlyResult( ) {
+    
+    DecodedInstr *dInstr = getDecoded( );
+    
+    if ( dInstr -> regR == 0 ) return( false );
+    
+    switch ( dInstr -> opCode ) {
+            
+        case OP_LD:     case OP_LDA:    case OP_LDO:    case OP_LDIL:   case OP_LSID: return( true );
+            
+        default: return( false );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "forwardResult" is the MA stage part of the full forwarding network. It is called once the EX stage has
+// done its bypass work. When our instruction produced its result in this cycle, the value passed to the EX
+// stage is also patched into the pipeline registers of the instruction the FD stage just passed to us. We
+// are the younger producer, so our value overrides what the EX stage may have patched for the same register.
+// When either stage is stalled, the FD stage instruction is not moving forward and will simply be decoded
+// again in the next cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void MemoryAccessStage::forwardResult( ) {
+    
+    if ( core -> cpuDesc.fwdMode != FWD_MODE_FULL ) return;
+    if (( stalled ) || ( core -> fdStage -> isStalled( ))) return;
+    if ( core -> exStage -> psInstr.getLatched( ) != psInstr.get( )) return;
+    if ( ! hasEarlyResult( )) return;
+    
+    FetchDecodeStage    *fdStage    = core -> fdStage;
+    uint32_t            regId       = getDecoded( ) -> regR;
+    uint32_t            val         = core -> exStage -> psValB.getLatched( );
+    
+    if ( fdStage -> dependencyValA( regId )) { psValA.set( val ); core -> stats.operandsForwarded ++; }
+    if ( fdStage -> dependencyValB( regId )) { psValB.set( val ); core -> stats.operandsForwarded ++; }
+    if ( fdStage -> dependencyValX( regId )) { psValX.set( val ); core -> stats.operandsForwarded ++; }
+}
+
 //------------------------------------------------------------------------------------------------------------
 // Utility function to set and get the the pipeline register data.
 //
@@ -450,14 +489,14 @@ void MemoryAccessStage::setPipeLineReg( uint8_t pReg, uint32_t val ) {
 //------------------------------------------------------------------------------------------------------------
 bool MemoryAccessStage::checkProtectId( uint16_t segId ) {
     
-    return((( segId  == core -> cReg[ CR_SEG_ID_0_1 ].getBitField( 15, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_0_1 ].getBitField( 31, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_2_3 ].getBitField( 15, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_2_3 ].getBitField( 31, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_4_5 ].getBitField( 15, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_4_5 ].getBitField( 31, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_6_7 ].getBitField( 15, 16 )) ||
-            ( segId  == core -> cReg[ CR_SEG_ID_6_7 ].getBitField( 31, 16 ))));
+    return((( segId  == core -> cReg.getBitField( CR_SEG_ID_0_1, 15, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_0_1, 31, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_2_3, 15, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_2_3, 31, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_4_5, 15, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_4_5, 31, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_6_7, 15, 16 )) ||
+            ( segId  == core -> cReg.getBitField( CR_SEG_ID_6_7, 31, 16 ))));
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -470,6 +509,10 @@ bool MemoryAccessStage::checkProtectId( uint16_t segId ) {
 // done and the EX stage is "bubbled". Otherwise, the instruction continues to the EX stage where the return
 // address is computed using the EX stage ALU and stored in a general register.
 //
+// For the B, BR and BV instructions, the FD stage continued with the predicted target. When the FD stage
+// does not hold the instruction at the computed target, the instruction fetch is redirected and the wrongly
+// fetched instruction is flushed. Without a branch predictor, this is the case for every taken branch.
+//
 // For the conditional branch instruction, the predicted branch target based in the offset was already
 // processed in the FD stage. In this stage, the branch target address for the alternative target will
 // be computed by adding B and X, which were set accordingly in the FD stage. When the EX stage evaluates
@@ -497,14 +540,20 @@ bool MemoryAccessStage::checkProtectId( uint16_t segId ) {
 // instruction MA stage with the correct data. For all these cases, the MA stage therefore needs to be stalled
 // until the correct value for "B" and "X" are written back to the general register and then resumed.
 //
+// With a store buffer, a store to physical memory is entered into the buffer instead of being written to the
+// data cache. A load takes its data from the buffer when a buffered store covers it, otherwise it reads the
+// data cache. The LDR and STC instructions, the cache flush and purge as well as an access to the PDC or IO
+// space act as a fence. They wait until all buffered stores are written.
+//
 // Note: when a trap occurs, the pipeline is stalled and the procedure returns right away.
 //
 // Note: this is a rather long routine. Perhaps we should split this into smaller portions.
 //------------------------------------------------------------------------------------------------------------
 void MemoryAccessStage::process( ) {
     
-    uint32_t            instr       = psInstr.get( );
-    uint8_t             opCode      = getBitField( instr, 5, 6 );
+    DecodedInstr        *dInstr     = getDecoded( );
+    uint32_t            instr       = dInstr -> instr;
+    uint8_t             opCode      = dInstr -> opCode;
     uint32_t            pageOfs     = psValX.get( ) % PAGE_SIZE_BYTES;
     uint32_t            physAdr     = 0;
     
@@ -515,6 +564,7 @@ void MemoryAccessStage::process( ) {
     ExecuteStage        *exStage    = core -> exStage;
     
     setStalled( false );
+    exStage -> psInstr2.set( NOP_INSTR );
     
     //--------------------------------------------------------------------------------------------------------
     // Address computation or control instruction execution.
@@ -526,11 +576,11 @@ void MemoryAccessStage::process( ) {
         case OP_AND:    case OP_OR:     case OP_XOR:
         case OP_CMP:    case OP_CMPU: {
             
-            if ( getBitField( instr, 13, 2 ) >= 2 ) {
+            if ( dInstr -> opMode >= 2 ) {
                 
-                dLen    = mapDataLen( instr );
+                dLen    = dInstr -> dataLen;
                 ofsAdr  = psValB.get( ) + psValX.get( );
-                segAdr  = core -> sReg[ getBitField( ofsAdr, 1, 2 ) ].get( );
+                segAdr  = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) );
             }
             else {
                 
@@ -552,18 +602,18 @@ void MemoryAccessStage::process( ) {
             
         case OP_LD:    case OP_LDR: {
             
-            dLen        = mapDataLen( instr );
+            dLen        = dInstr -> dataLen;
             ofsAdr      = psValB.get( ) + psValX.get( );
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
@@ -581,18 +631,18 @@ void MemoryAccessStage::process( ) {
             
         case OP_ST:     case OP_STC: {
             
-            dLen   = mapDataLen( instr );
+            dLen   = dInstr -> dataLen;
             ofsAdr = psValB.get( ) + psValX.get( );
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
@@ -636,18 +686,18 @@ void MemoryAccessStage::process( ) {
             
         case OP_LDPA:   case OP_PRB:  {
             
-            dLen    = mapDataLen( instr );
+            dLen    = dInstr -> dataLen;
             ofsAdr  = psValB.get( ) + psValX.get( );
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
@@ -656,7 +706,7 @@ void MemoryAccessStage::process( ) {
         case OP_LSID: {
             
             exStage -> psValA.set( psValA.get( ));
-            exStage -> psValB.set( core -> sReg[ getBitField( instr, 31, 3 ) ].get( ));
+            exStage -> psValB.set( core -> sReg.get( getBitField( instr, 31, 3 ) ));
             exStage -> psValX.set( 0 );
             
         } break;
@@ -674,9 +724,19 @@ void MemoryAccessStage::process( ) {
             
         case OP_B:  case OP_BR:     case OP_BV: {
             
-            core -> fdStage -> psPstate0.set( psPstate0.get( ));
-            core -> fdStage -> psPstate1.set( psValB.get( ) + psValX.get( ));
-            flushPipeLine( );
+            ofsAdr = psValB.get( ) + psValX.get( );
+            
+            bool mispredicted = ( core -> fdStage -> psPstate1.get( ) != ofsAdr );
+            
+            core -> branchPred -> resolveTarget( psPstate1.get( ), dInstr, ofsAdr, mispredicted );
+            
+            if ( mispredicted ) {
+                
+                core -> stats.branchesMispredicted ++;
+                core -> fdStage -> psPstate0.set( psPstate0.get( ));
+                core -> fdStage -> psPstate1.set( ofsAdr );
+                flushPipeLine( );
+            }
             
         } break;
             
@@ -686,13 +746,13 @@ void MemoryAccessStage::process( ) {
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
@@ -705,7 +765,7 @@ void MemoryAccessStage::process( ) {
         case OP_BE: {
             
             ofsAdr = psValB.get( ) + psValB.get( );
-            segAdr = core -> sReg[ getBitField( instr, 27, 4 ) ].getBitField( 31, 16 );
+            segAdr = core -> sReg.getBitField( dInstr -> regA, 31, 16 );
             
             core -> fdStage -> psPstate0.setBitField( segAdr, 31, 16  );
             core -> fdStage -> psPstate1.set( ofsAdr );
@@ -724,8 +784,8 @@ void MemoryAccessStage::process( ) {
             
             if ( ! getBit( instr, 11 )) {
                 
-                if ( getBit( instr, 12 ))  exStage -> psValB.set( core -> cReg[ instr & 0x3C ].get( ));
-                else                       exStage -> psValB.set( core -> sReg[ getBitField( instr, 31, 4 ) ].get( ));
+                if ( getBit( instr, 12 ))  exStage -> psValB.set( core -> cReg.get( instr & 0x3C ));
+                else                       exStage -> psValB.set( core -> sReg.get( dInstr -> regB ));
             }
             
         } break;
@@ -746,7 +806,7 @@ void MemoryAccessStage::process( ) {
         case OP_ITLB: {
             
             CpuTlb      *tlbPtr = ( getBit( instr, 11 )) ? core -> dTlb : core -> iTlb;
-            uint32_t    tlbSeg  = core -> sReg[ getBitField( instr, 27, 4 ) ].get( );
+            uint32_t    tlbSeg  = core -> sReg.get( dInstr -> regA );
             
             bool rStat = false;
             
@@ -766,18 +826,18 @@ void MemoryAccessStage::process( ) {
             
         case OP_PTLB: {
             
-            dLen    = mapDataLen( instr );
+            dLen    = dInstr -> dataLen;
             ofsAdr  = psValB.get( ) + psValX.get( );
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
@@ -793,24 +853,30 @@ void MemoryAccessStage::process( ) {
             
         case OP_PCA: {
             
-            dLen        = mapDataLen( instr );
+            dLen        = dInstr -> dataLen;
             ofsAdr      = psValB.get( ) + psValX.get( );
             
             if ( psPstate0.getBit( ST_DATA_TRANSLATION_ENABLE )) {
                 
-                uint8_t segSelect = getBitField( instr, 13, 2 );
+                uint8_t segSelect = dInstr -> opMode;
                 
                 if ( segSelect == 0 ) {
                     
-                    segAdr = core -> sReg[ getBitField( ofsAdr, 1, 2 ) + 4 ].get( );
+                    segAdr = core -> sReg.get( getBitField( ofsAdr, 1, 2 ) + 4 );
                 }
-                else segAdr = segAdr = core -> sReg[ segSelect ].get( );
+                else segAdr = segAdr = core -> sReg.get( segSelect );
             }
             else segAdr = 0;
             
             CpuTlb      *tlbPtr = ( getBit( instr, 11 )) ? core -> dTlb : core -> iTlb;
             L1CacheMem  *cPtr   = ( getBit( instr, 11 )) ?  core -> dCacheL1 : core -> iCacheL1;
             
+            if ( ! core -> storeBuffer -> fence( )) {
+                
+                stallPipeLine( );
+                return;
+            }
+            
             // ??? simplify ... this is quite complex to do in one cycle ... perhaps spread over MA and EX stage
             // ??? what exactly to pass to the trap handler ?
             
@@ -841,24 +907,33 @@ void MemoryAccessStage::process( ) {
     //--------------------------------------------------------------------------------------------------------
     // Data load or store section. This is the second half for instructions that read or write to memory.
     // There are a couple of cases. If the segment is zero, we must be privileged. The address is "0.ofs".
-    // Otherwise we look up the physical address via the TLB and perform the access right checks. If the
-    // physical address is in the physical memory range, we will access the cache data. The PDC memory range
-    // can only be read. A write attempt is a trap. The IO range is passed to IO handler.
+    // Otherwise we look up the physical address via the TLB and perform the access right checks. A TLB miss
+    // stalls while the second level TLB refills the entry. If the physical address is in the physical memory
+    // range, we will access the cache data. The PDC memory range can only be read. A write attempt is a trap.
+    // The IO range is passed to IO handler.
     //
     //--------------------------------------------------------------------------------------------------------
-    if (( isReadIstr( instr ) || ( isWriteInstr( instr )))) {
+    if (( dInstr -> memRead ) || ( dInstr -> memWrite )) {
         
         if ( psPstate0.get( ) & ST_DATA_TRANSLATION_ENABLE ) {
             
             TlbEntry   *tlbEntryPtr = core -> dTlb -> lookupTlbEntry( segAdr, ofsAdr );
+            if ( tlbEntryPtr == nullptr ) tlbEntryPtr = core -> dTlb -> refillTlbEntry( segAdr, ofsAdr );
+            
             if ( tlbEntryPtr == nullptr ) {
                 
+                if ( core -> dTlb -> isRefillPending( )) {
+                    
+                    stallPipeLine( );
+                    return;
+                }
+                
                 setupTrapData( DTLB_MISS_TRAP, psPstate0.get( ), psPstate1.get( ), instr, segAdr, ofsAdr );
                 stallPipeLine( );
                 return;
             }
             
-            if ( opCodeTab[ opCode ].flags & READ_INSTR ) {
+            if ( dInstr -> flags & READ_INSTR ) {
                 
                 if (( tlbEntryPtr -> tPageType( ) != ACC_READ_WRITE ) &&
                     ( tlbEntryPtr -> tPageType( ) != ACC_READ_ONLY )) {
@@ -875,7 +950,7 @@ void MemoryAccessStage::process( ) {
                     return;
                 }
             }
-            else if ( opCodeTab[ opCode ].flags & WRITE_INSTR ) {
+            else if ( dInstr -> flags & WRITE_INSTR ) {
                 
                 if (( tlbEntryPtr -> tPageType( ) != ACC_READ_WRITE )) {
                     
@@ -916,21 +991,37 @@ void MemoryAccessStage::process( ) {
             physAdr = ofsAdr;
         }
         
-        if ( ! isAligned( physAdr, getBitField( instr, 15, 2 ) )) {
+        if ( ! isAligned( physAdr, dInstr -> dwField )) {
             
             setupTrapData( DATA_ALIGNMENT_TRAP, psPstate0.get( ), psPstate1.get( ), instr );
             stallPipeLine( );
             return;
         }
         
-        bool rStat = false;
+        bool        rStat   = false;
+        StoreBuffer *sBuf   = core -> storeBuffer;
+        
+        if ((( opCode == OP_LDR ) || ( opCode == OP_STC ) || ( physAdr > core -> physMem -> getEndAdr( ))) &&
+            ( ! sBuf -> fence( ))) {
+            
+            stallPipeLine( );
+            return;
+        }
         
         if ( physAdr <= core -> physMem -> getEndAdr(  )) {
             
-            if ( isReadIstr( instr )) {
+            if ( dInstr -> memRead ) {
                 
-                uint32_t dataWord;
-                rStat = core -> dCacheL1 -> readWord( segAdr, ofsAdr, physAdr, dLen, &dataWord );
+                uint32_t        dataWord;
+                StoreFwdResult  fwd = sBuf -> forwardLoad( physAdr, dLen, &dataWord );
+                
+                if ( fwd == SB_FWD_HIT ) rStat = true;
+                else if ( fwd == SB_FWD_NONE ) {
+                    
+                    core -> dCacheL1 -> setAccessPc( psPstate1.get( ));
+                    rStat = core -> dCacheL1 -> readWord( segAdr, ofsAdr, physAdr, dLen, &dataWord );
+                    sBuf -> setPortBusy( );
+                }
                 
                 if ( rStat ) exStage -> psValB.set( dataWord );
                 
@@ -939,22 +1030,28 @@ void MemoryAccessStage::process( ) {
                     // ??? set address and reserved flag ...
                 }
             }
-            else if ( isWriteInstr( instr )) {
+            else if ( dInstr -> memWrite ) {
                 
                 if ( opCode == OP_STC ) {
                     
                     // ??? check reserved flag. if set, all OK, store the data, reset the flag.
                     //     pass on a zero as result, else return 1.
                 }
+                else if ( sBuf -> isEnabled( )) {
+                    
+                    rStat = sBuf -> addStore( segAdr, ofsAdr, physAdr, dLen, psValA.get( ));
+                }
                 else {
                     
+                    core -> dCacheL1 -> setAccessPc( psPstate1.get( ));
                     rStat = core -> dCacheL1 -> writeWord( segAdr, ofsAdr, physAdr, dLen, psValA.get( ));
+                    if ( rStat ) core -> decodeCache -> invalidate( physAdr, dLen );
                 }
             }
         }
         else if (( physAdr >= core -> pdcMem -> getStartAdr( )) && ( physAdr <= core -> pdcMem -> getEndAdr( ))) {
             
-            if ( isReadIstr( instr )) {
+            if ( dInstr -> memRead ) {
                 
                 uint32_t dataWord;
                 rStat = core -> pdcMem -> readWord( 0, physAdr, 0, dLen, &dataWord );
@@ -968,14 +1065,14 @@ void MemoryAccessStage::process( ) {
         }
         else if (( physAdr >= core -> ioMem -> getStartAdr( )) && ( physAdr <= core -> ioMem -> getEndAdr( ))) {
             
-            if ( opCodeTab[ opCode ].flags & READ_INSTR ) {
+            if ( dInstr -> flags & READ_INSTR ) {
                 
                 uint32_t dataWord;
                 rStat = core -> ioMem -> readWord( 0, physAdr, 0, dLen, &dataWord );
                 
                 if ( rStat ) exStage -> psValB.set( dataWord );
             }
-            else if ( isWriteInstr( instr )) {
+            else if ( dInstr -> memWrite ) {
                 
                 rStat = core -> dCacheL1 -> writeWord( 0, physAdr, 0, dLen, psValA.get( ));
             }
@@ -994,10 +1091,14 @@ void MemoryAccessStage::process( ) {
     }
     
     //--------------------------------------------------------------------------------------------------------
-    // Pass the remaining data to the EX stage pipeline.
+    // Pass the remaining data to the EX stage pipeline. The second instruction of a dual issue pair has no
+    // work in this stage and just moves along.
     //
     //--------------------------------------------------------------------------------------------------------
     exStage -> psInstr.set( psInstr.get( ));
+    exStage -> psDecIndex.set( psDecIndex.get( ));
     exStage -> psPstate0.set( psPstate0.get( ));
     exStage -> psPstate1.set( psPstate1.get( ));
+    exStage -> psInstr2.set( psInstr2.get( ));
+    exStage -> psDecIndex2.set( psDecIndex2.get( ));
 }
@@ -0,0 +1,761 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Out of order engine
+//
+//------------------------------------------------------------------------------------------------------------
+// The out-of-order engine is the timing model of an out-of-order implementation of VCPU32. It is the second
+// core model next to the FD, MA and EX stage pipeline. The instructions are executed by the functional engine
+// when they are fetched, the engine itself only tracks when the instructions are dispatched, issued and
+// committed. This tells us how much of the memory latency an out-of-order implementation could hide.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Out of order engine
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. A physical register that waits for its producer to issue has a ready cycle that is never reached.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const uint32_t  MAX_ROB_ENTRIES     = 1024;
+const uint32_t  MAX_PHYS_REGS       = 4096;
+const uint32_t  MAX_QUEUE_ENTRIES   = 1024;
+const uint32_t  MAX_OOO_WIDTH       = 16;
+const uint32_t  NOT_READY           = UINT32_MAX;
+
+uint32_t getBit( uint32_t arg, int pos ) {
+    
+    return(( arg & ( 1U << ( 31 - ( pos % 32 )))) ? 1 : 0 );
+}
+
+uint32_t limitVal( uint32_t val, uint32_t minVal, uint32_t maxVal ) {
+    
+    if      ( val < minVal ) return( minVal );
+    else if ( val > maxVal ) return( maxVal );
+    else                     return( val );
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The out-of-order engine object constructor. The sizes are limited to what we support. There need to be
+// more physical registers than architectural registers, otherwise nothing could ever be renamed. The table
+// of outstanding misses has one entry for each MSHR entry of the L1 data cache, a blocking cache still has
+// one miss outstanding.
+//
+//------------------------------------------------------------------------------------------------------------
+OooEngine::OooEngine( CpuCore *core, OooDesc *oDesc ) {
+    
+    this -> core = core;
+    memcpy( &this -> oDesc, oDesc, sizeof( OooDesc ));
+    
+    this -> oDesc.robEntries    = limitVal( oDesc -> robEntries, 1, MAX_ROB_ENTRIES );
+    this -> oDesc.physRegs      = limitVal( oDesc -> physRegs, OOO_ARCH_REGS + 1, MAX_PHYS_REGS );
+    this -> oDesc.aluIqEntries  = limitVal( oDesc -> aluIqEntries, 1, MAX_QUEUE_ENTRIES );
+    this -> oDesc.memIqEntries  = limitVal( oDesc -> memIqEntries, 1, MAX_QUEUE_ENTRIES );
+    this -> oDesc.lsqEntries    = limitVal( oDesc -> lsqEntries, 1, MAX_QUEUE_ENTRIES );
+    this -> oDesc.width         = limitVal( oDesc -> width, 1, MAX_OOO_WIDTH );
+    this -> oDesc.memPorts      = limitVal( oDesc -> memPorts, 1, this -> oDesc.width );
+    
+    missEntries = limitVal( core -> cpuDesc.dCacheDescL1.mshrEntries, 1, MAX_MSHR_ENTRIES );
+    blockSize   = limitVal( core -> cpuDesc.dCacheDescL1.blockSize, 4, UINT32_MAX );
+    
+    rob             = new OooRobEntry[ this -> oDesc.robEntries ];
+    freeList        = new uint16_t[ this -> oDesc.physRegs ];
+    regReadyCycle   = new uint32_t[ this -> oDesc.physRegs ];
+    missTab         = new OooMissEntry[ missEntries ];
+    
+    reset( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "reset" empties the instruction window. Each architectural register is mapped to the physical register
+// with the same number, all other physical registers are free. The engine keeps its own cycle counter, the
+// core statistics may be cleared at any time.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::reset( ) {
+    
+    robHead         = 0;
+    robCount        = 0;
+    aluIqCount      = 0;
+    memIqCount      = 0;
+    lsqCount        = 0;
+    freeCount       = 0;
+    
+    for ( uint32_t i = 0; i < oDesc.physRegs; i++ ) {
+        
+        if ( i < OOO_ARCH_REGS ) renameMap[ i ] = i;
+        else                     freeList[ freeCount ++ ] = i;
+        
+        regReadyCycle[ i ] = 0;
+    }
+    
+    for ( uint32_t i = 0; i < missEntries; i++ ) missTab[ i ] = OooMissEntry( );
+    
+    fetchBuf        = OooRobEntry( );
+    fetchValid      = false;
+    fetchBlocked    = false;
+    blockSeqNum     = 0;
+    fetchStallEnd   = 0;
+    nextSeqNum      = 0;
+    curCycle        = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "cycle" is one clock cycle of the out-of-order core. The stages are processed from the back to the front.
+// An instruction dispatched in this cycle can issue in the next cycle and an instruction that completes
+// in this cycle can commit in this cycle. At most "maxCommit" instructions are committed, which allows the
+// caller to stop after an exact number of instructions. The routine returns the number of instructions
+// committed.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t OooEngine::cycle( uint32_t maxCommit ) {
+    
+    uint32_t committed = commit( maxCommit );
+    
+    issue( );
+    dispatch( );
+    
+    curCycle ++;
+    return( committed );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "drain" empties the instruction window. All instructions in flight were already executed by the functional
+// engine, so there is nothing to undo. They just count as committed, the routine returns their number.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t OooEngine::drain( ) {
+    
+    uint32_t inFlight = robCount + (( fetchValid ) ? 1 : 0 );
+    
+    reset( );
+    return( inFlight );
+}
+
+OooRobEntry *OooEngine::robEntry( uint32_t pos ) {
+    
+    return( &rob[ ( robHead + pos ) % oDesc.robEntries ] );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "commit" retires the completed instructions at the head of the reorder buffer in program order. The
+// physical registers that held the previous values of the destination registers are freed. When the fetch
+// waits for the instruction, it restarts. After a trap, the trap handler is fetched after the redirect
+// penalty, after a control instruction in the next cycle. When the core stops on traps, it stops when the
+// trapping instruction commits.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t OooEngine::commit( uint32_t maxCommit ) {
+    
+    uint32_t committed = 0;
+    
+    while (( committed < oDesc.width ) && ( committed < maxCommit ) && ( robCount > 0 )) {
+        
+        OooRobEntry *ePtr = robEntry( 0 );
+        
+        if (( ! ePtr -> issued ) || ( ePtr -> doneCycle > curCycle )) break;
+        
+        for ( uint32_t i = 0; i < ePtr -> numDst; i++ ) freeList[ freeCount ++ ] = ePtr -> prevTag[ i ];
+        
+        if (( ePtr -> isLoad ) || ( ePtr -> isStore )) lsqCount --;
+        
+        if (( fetchBlocked ) && ( ePtr -> seqNum == blockSeqNum )) {
+            
+            fetchBlocked    = false;
+            fetchStallEnd   = curCycle + (( ePtr -> trapped ) ? oDesc.redirectPenalty : 1 );
+        }
+        
+        if (( ePtr -> trapped ) && ( core -> stopOnTrap )) core -> stopped = true;
+        
+        robHead = ( robHead + 1 ) % oDesc.robEntries;
+        robCount --;
+        committed ++;
+    }
+    
+    return( committed );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "issue" selects the instructions to execute in this cycle. The oldest instructions whose source operands
+// are available go first, up to the width of the core, of which up to "memPorts" may be loads or stores. ALU
+// instructions, branches and stores complete after one cycle. The store data is written when the store
+// commits. The load latency is computed by "issueLoad", a load that cannot issue yet stays in the queue. The
+// base register update of a load is available after one cycle too. When the fetch waits for a mispredicted
+// branch, it restarts the redirect penalty after the branch is resolved.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::issue( ) {
+    
+    uint32_t issued     = 0;
+    uint32_t memIssued  = 0;
+    
+    for ( uint32_t i = 0; ( i < robCount ) && ( issued < oDesc.width ); i++ ) {
+        
+        OooRobEntry *ePtr = robEntry( i );
+        
+        if (( ePtr -> issued ) || ( ! operandsReady( ePtr ))) continue;
+        
+        if (( ePtr -> isLoad ) || ( ePtr -> isStore )) {
+            
+            if ( memIssued >= oDesc.memPorts ) continue;
+            
+            if ( ePtr -> isLoad ) {
+                
+                if ( ! issueLoad( i, ePtr )) continue;
+            }
+            else ePtr -> doneCycle = curCycle + 1;
+            
+            memIqCount --;
+            memIssued ++;
+        }
+        else {
+            
+            ePtr -> doneCycle = curCycle + 1;
+            aluIqCount --;
+        }
+        
+        ePtr -> issued = true;
+        
+        for ( uint32_t k = 0; k < ePtr -> numDst; k++ ) {
+            
+            regReadyCycle[ ePtr -> dstTag[ k ]] = ( k == 0 ) ? ePtr -> doneCycle : curCycle + 1;
+        }
+        
+        if (( fetchBlocked ) && ( ePtr -> redirect ) && ( ePtr -> seqNum == blockSeqNum )) {
+            
+            fetchBlocked    = false;
+            fetchStallEnd   = ePtr -> doneCycle + oDesc.redirectPenalty;
+        }
+        
+        issued ++;
+    }
+}
+
+bool OooEngine::operandsReady( OooRobEntry *ePtr ) {
+    
+    for ( uint32_t i = 0; i < ePtr -> numSrc; i++ ) {
+        
+        if ( regReadyCycle[ ePtr -> srcTag[ i ]] > curCycle ) return( false );
+    }
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "issueLoad" computes when a load completes. The youngest older store to the same word forwards its data,
+// the load waits for that store to issue. Otherwise, a load to a block with a miss outstanding completes
+// with that miss. A load that hits the L1 data cache completes after the L1 latency. A miss needs a free
+// entry in the table of outstanding misses and completes after the latency of the level that holds the
+// block. When there is no free entry, the load waits.
+//
+// ??? a younger load to the block of an older load that missed finds the block in the cache, since the
+// functional engine entered it when executing the older load. When the younger load issues first, it is
+// treated as a hit.
+// ??? store misses do not occupy a miss table entry, we assume the stores are written through a store buffer.
+//------------------------------------------------------------------------------------------------------------
+bool OooEngine::issueLoad( uint32_t pos, OooRobEntry *ePtr ) {
+    
+    uint32_t wordAdr    = ePtr -> memAdr & ( ~ 3U );
+    uint32_t blockAdr   = ePtr -> memAdr & ( ~ ( blockSize - 1 ));
+    
+    for ( uint32_t i = pos; i > 0; i-- ) {
+        
+        OooRobEntry *sPtr = robEntry( i - 1 );
+        
+        if (( sPtr -> isStore ) && (( sPtr -> memAdr & ( ~ 3U )) == wordAdr )) {
+            
+            if ( ! sPtr -> issued ) return( false );
+            
+            ePtr -> doneCycle = (( sPtr -> doneCycle > curCycle ) ? sPtr -> doneCycle : curCycle ) + 1;
+            core -> stats.loadsForwarded ++;
+            return( true );
+        }
+    }
+    
+    OooMissEntry    *freePtr    = nullptr;
+    bool            otherMiss   = false;
+    
+    for ( uint32_t i = 0; i < missEntries; i++ ) {
+        
+        OooMissEntry *mPtr = &missTab[ i ];
+        
+        if ( mPtr -> doneCycle > curCycle ) {
+            
+            if ( mPtr -> blockAdr == blockAdr ) {
+                
+                ePtr -> doneCycle = mPtr -> doneCycle;
+                return( true );
+            }
+            
+            otherMiss = true;
+        }
+        else if ( freePtr == nullptr ) freePtr = mPtr;
+    }
+    
+    if ( ePtr -> memLevel <= MEM_LEVEL_L1 ) {
+        
+        ePtr -> doneCycle = curCycle + accessLatency( MEM_LEVEL_L1 );
+        return( true );
+    }
+    
+    if ( freePtr == nullptr ) {
+        
+        core -> stats.mshrFullStalls ++;
+        return( false );
+    }
+    
+    if ( otherMiss ) core -> stats.missesOverlapped ++;
+    
+    freePtr -> blockAdr     = blockAdr;
+    freePtr -> doneCycle    = curCycle + accessLatency( ePtr -> memLevel );
+    ePtr -> doneCycle       = freePtr -> doneCycle;
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "accessLatency" is the number of cycles for an access served by the given memory hierarchy level. Each
+// level adds its latency and a cycle to pass the request on.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t OooEngine::accessLatency( uint32_t level ) {
+    
+    uint32_t latency = 1 + core -> cpuDesc.dCacheDescL1.latency;
+    
+    if (( level >= MEM_LEVEL_L2 ) && ( core -> uCacheL2 != nullptr ))
+        latency += 1 + core -> cpuDesc.uCacheDescL2.latency;
+    
+    if ( level >= MEM_LEVEL_MEM ) latency += 1 + core -> cpuDesc.memDesc.latency;
+    
+    return( latency );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "dispatch" is the front end. Up to "width" instructions are fetched and placed into the instruction window
+// per cycle. A taken branch ends the fetch for this cycle. An instruction that cannot be placed into the
+// window stays in the fetch buffer and is tried again in the next cycle. The fetch stops after a mispredicted
+// branch, a trap or a control instruction until the instruction is resolved.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::dispatch( ) {
+    
+    if (( fetchBlocked ) || ( curCycle < fetchStallEnd )) return;
+    
+    for ( uint32_t i = 0; i < oDesc.width; i++ ) {
+        
+        if ( ! fetchValid ) {
+            
+            if ( core -> stopped ) break;
+            
+            fetchInstr( );
+            fetchValid = true;
+        }
+        
+        if ( fetchBuf.fetchCycle > curCycle ) break;
+        
+        if ( ! allocate( &fetchBuf )) break;
+        
+        fetchValid = false;
+        
+        if (( fetchBuf.redirect ) || ( fetchBuf.trapped ) || ( fetchBuf.serialize )) {
+            
+            fetchBlocked    = true;
+            blockSeqNum     = fetchBuf.seqNum;
+            break;
+        }
+        
+        if ( fetchBuf.taken ) break;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "fetchInstr" executes the next instruction with the functional engine and sets up the fetch buffer entry.
+// Cache warming is enabled for the step, so that the functional engine reports the memory hierarchy levels
+// of the instruction fetch and the data access. A trap does not stop the core here, but when the trapping
+// instruction commits. An instruction fetch that misses the L1 cache delays the instruction by the
+// additional latency. The branch predictor is consulted with the outcome already known.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::fetchInstr( ) {
+    
+    FunctionalEngine    *fnEngine   = core -> fnEngine;
+    OooRobEntry         *ePtr       = &fetchBuf;
+    uint32_t            seg         = core -> fdStage -> psPstate0.getBitField( 31, 16 );
+    uint32_t            adr         = core -> fdStage -> psPstate1.get( );
+    bool                warming     = fnEngine -> cacheWarming;
+    bool                stopped     = core -> stopped;
+    DecodedInstr        dInstr;
+    
+    fnEngine -> cacheWarming = true;
+    fnEngine -> step( );
+    fnEngine -> cacheWarming = warming;
+    core -> stopped          = stopped;
+    
+    *ePtr = OooRobEntry( );
+    
+    ePtr -> seqNum      = nextSeqNum ++;
+    ePtr -> instr       = fnEngine -> lastInstr;
+    ePtr -> fetchCycle  = curCycle;
+    
+    if ( fnEngine -> instrLevel > MEM_LEVEL_L1 ) {
+        
+        ePtr -> fetchCycle += accessLatency( fnEngine -> instrLevel ) - accessLatency( MEM_LEVEL_L1 );
+    }
+    
+    if ( fnEngine -> trapped ) {
+        
+        ePtr -> trapped = true;
+        return;
+    }
+    
+    DecodeCache::decode( ePtr -> instr, &dInstr );
+    decodeRegs( ePtr, &dInstr );
+    
+    if ( fnEngine -> dataLevel != MEM_LEVEL_NONE ) {
+        
+        ePtr -> isLoad      = dInstr.memRead;
+        ePtr -> isStore     = dInstr.memWrite;
+        ePtr -> memAdr      = fnEngine -> dataPhysAdr;
+        ePtr -> memLevel    = fnEngine -> dataLevel;
+    }
+    
+    uint32_t nextSeg = core -> fdStage -> psPstate0.getBitField( 31, 16 );
+    uint32_t nextAdr = core -> fdStage -> psPstate1.get( );
+    
+    ePtr -> taken = ( nextAdr != adr + 4 ) || ( nextSeg != seg );
+    
+    if ( dInstr.flags & BRANCH_INSTR ) predictBranch( ePtr, &dInstr, adr, nextAdr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "decodeRegs" determines the source and destination registers of an instruction. The operands follow the
+// operand fetch of the FD stage and the register updates of the EX stage. The status register holds the
+// carry and the divide step bit. Register zero is neither a source nor a destination. Control instructions
+// are executed alone, they need no renaming.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::decodeRegs( OooRobEntry *ePtr, DecodedInstr *dInstr ) {
+    
+    uint32_t    instr   = dInstr -> instr;
+    uint8_t     src[ OOO_MAX_SRC_REGS ];
+    uint8_t     dst[ OOO_MAX_DST_REGS ];
+    uint32_t    numSrc  = 0;
+    uint32_t    numDst  = 0;
+    
+    switch ( dInstr -> opCode ) {
+        
+        case OP_ADD:    case OP_ADC:    case OP_SUB:    case OP_SBC:    case OP_AND:
+        case OP_OR:     case OP_XOR:    case OP_CMP:    case OP_CMPU: {
+            
+            switch ( dInstr -> opMode ) {
+                
+                case OP_MODE_IMM:       src[ numSrc ++ ] = dInstr -> regR; break;
+                
+                case OP_MODE_REG: {
+                    
+                    src[ numSrc ++ ] = dInstr -> regA;
+                    src[ numSrc ++ ] = dInstr -> regB;
+                    
+                } break;
+                
+                case OP_MODE_REG_INDX: {
+                    
+                    src[ numSrc ++ ] = dInstr -> regR;
+                    src[ numSrc ++ ] = dInstr -> regA;
+                    src[ numSrc ++ ] = dInstr -> regB;
+                    
+                } break;
+                
+                default: {
+                    
+                    src[ numSrc ++ ] = dInstr -> regR;
+                    src[ numSrc ++ ] = dInstr -> regB;
+                }
+            }
+            
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+            uint8_t opCode = dInstr -> opCode;
+            
+            if (( opCode == OP_ADC ) || ( opCode == OP_SBC )) src[ numSrc ++ ] = OOO_STATUS_REG;
+            
+            if (( opCode == OP_ADD ) || ( opCode == OP_ADC ) || ( opCode == OP_SUB ) || ( opCode == OP_SBC ))
+                dst[ numDst ++ ] = OOO_STATUS_REG;
+            
+        } break;
+        
+        case OP_ADDIL: {
+            
+            src[ numSrc ++ ] = dInstr -> regR;
+            dst[ numDst ++ ] = 1;
+            
+        } break;
+        
+        case OP_LDIL:
+        case OP_LSID: {
+            
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_LDO:
+        case OP_EXTR: {
+            
+            src[ numSrc ++ ] = dInstr -> regB;
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_DEP: {
+            
+            if ( ! getBit( instr, 10 )) src[ numSrc ++ ] = dInstr -> regR;
+            if ( ! getBit( instr, 12 )) src[ numSrc ++ ] = dInstr -> regB;
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_DSR:
+        case OP_SHLA:
+        case OP_CMR: {
+            
+            src[ numSrc ++ ] = dInstr -> regA;
+            src[ numSrc ++ ] = dInstr -> regB;
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_DS: {
+            
+            src[ numSrc ++ ] = dInstr -> regA;
+            src[ numSrc ++ ] = dInstr -> regB;
+            src[ numSrc ++ ] = OOO_STATUS_REG;
+            dst[ numDst ++ ] = dInstr -> regR;
+            dst[ numDst ++ ] = OOO_STATUS_REG;
+            
+        } break;
+        
+        case OP_LD:     case OP_LDA:    case OP_LDR: {
+            
+            src[ numSrc ++ ] = dInstr -> regB;
+            if ( getBit( instr, 10 )) src[ numSrc ++ ] = dInstr -> regA;
+            
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+            bool baseUpdate = ( dInstr -> opCode != OP_LDR ) && ( getBit( instr, 11 ));
+            
+            if (( baseUpdate ) && ( dInstr -> regR != dInstr -> regB )) dst[ numDst ++ ] = dInstr -> regB;
+            
+        } break;
+        
+        case OP_ST:     case OP_STA:    case OP_STC: {
+            
+            src[ numSrc ++ ] = dInstr -> regB;
+            src[ numSrc ++ ] = dInstr -> regR;
+            if ( getBit( instr, 10 )) src[ numSrc ++ ] = dInstr -> regA;
+            
+            if      ( dInstr -> opCode == OP_STC )  dst[ numDst ++ ] = dInstr -> regR;
+            else if ( getBit( instr, 11 ))          dst[ numDst ++ ] = dInstr -> regB;
+            
+        } break;
+        
+        case OP_B: {
+            
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_BR:     case OP_BV:     case OP_BE: {
+            
+            src[ numSrc ++ ] = dInstr -> regB;
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_BVE: {
+            
+            src[ numSrc ++ ] = dInstr -> regA;
+            src[ numSrc ++ ] = dInstr -> regB;
+            dst[ numDst ++ ] = dInstr -> regR;
+            
+        } break;
+        
+        case OP_CBR:    case OP_CBRU: {
+            
+            src[ numSrc ++ ] = dInstr -> regA;
+            src[ numSrc ++ ] = dInstr -> regB;
+            
+        } break;
+        
+        case OP_BRK: {
+            
+            // a BRK instruction that did not trap is a NOP.
+            
+        } break;
+        
+        default: {
+            
+            ePtr -> serialize = true;
+        }
+    }
+    
+    for ( uint32_t i = 0; i < numSrc; i++ ) {
+        
+        if ( src[ i ] != 0 ) ePtr -> srcReg[ ePtr -> numSrc ++ ] = src[ i ];
+    }
+    
+    for ( uint32_t i = 0; i < numDst; i++ ) {
+        
+        if ( dst[ i ] != 0 ) ePtr -> dstReg[ ePtr -> numDst ++ ] = dst[ i ];
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "predictBranch" asks the branch predictor for the branch just fetched. Since the outcome is known already,
+// the predictor is trained right away and has no speculative state. The conditional branches are predicted
+// by the direction predictor, the B, BR and BV instructions by the target predictor, when enabled. Without
+// a predictor, these branches are predicted to fall through. The BE and BVE instructions always redirect
+// the fetch. A wrong prediction marks the branch to redirect the fetch.
+//
+//------------------------------------------------------------------------------------------------------------
+void OooEngine::predictBranch( OooRobEntry *ePtr, DecodedInstr *dInstr, uint32_t adr, uint32_t nextAdr ) {
+    
+    BranchPredictor *branchPred = core -> branchPred;
+    bool            mispredicted = false;
+    
+    switch ( dInstr -> opCode ) {
+        
+        case OP_CBR:    case OP_CBRU: {
+            
+            bool predTaken = branchPred -> predictCond( adr, getBit( ePtr -> instr, 23 ));
+            
+            mispredicted = ( predTaken != ePtr -> taken );
+            branchPred -> commitCond( adr, ePtr -> taken, mispredicted );
+            
+            if ( ePtr -> taken ) core -> stats.branchesTaken ++;
+            
+        } break;
+        
+        case OP_B:      case OP_BR:     case OP_BV: {
+            
+            uint32_t predAdr = adr + 4;
+            
+            if ( branchPred -> isEnabled( )) predAdr = branchPred -> predictTarget( adr, dInstr );
+            
+            mispredicted = ( predAdr != nextAdr );
+            branchPred -> resolveTarget( adr, dInstr, nextAdr, mispredicted );
+            branchPred -> commitBranch( adr, dInstr );
+            
+            core -> stats.branchesTaken ++;
+            
+        } break;
+        
+        case OP_BE:     case OP_BVE: {
+            
+            ePtr -> redirect = true;
+            core -> stats.branchesTaken ++;
+            
+        } break;
+        
+        default: ;
+    }
+    
+    branchPred -> recover( );
+    
+    if ( mispredicted ) {
+        
+        ePtr -> redirect = true;
+        core -> stats.branchesMispredicted ++;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "allocate" places the fetched instruction into the instruction window. There needs to be a reorder buffer
+// entry, an issue queue entry, a load/store queue entry for a memory access and a free physical register for
+// each destination register. Otherwise the instruction waits and the stall is counted. A control instruction
+// waits until the reorder buffer is empty. The sources are renamed before the destinations, so that an
+// instruction that reads and writes the same register reads the previous value. Trapping and control
+// instructions need no function unit and complete in the next cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+bool OooEngine::allocate( OooRobEntry *ePtr ) {
+    
+    bool isMem  = ( ePtr -> isLoad ) || ( ePtr -> isStore );
+    bool noExec = ( ePtr -> trapped ) || ( ePtr -> serialize );
+    
+    if ( robCount >= oDesc.robEntries ) {
+        
+        core -> stats.robFullStalls ++;
+        return( false );
+    }
+    
+    if (( ePtr -> serialize ) && ( robCount > 0 )) return( false );
+    
+    if (( isMem ) && ( lsqCount >= oDesc.lsqEntries )) {
+        
+        core -> stats.lsqFullStalls ++;
+        return( false );
+    }
+    
+    if ((( isMem ) && ( memIqCount >= oDesc.memIqEntries )) ||
+        (( ! isMem ) && ( ! noExec ) && ( aluIqCount >= oDesc.aluIqEntries ))) {
+        
+        core -> stats.iqFullStalls ++;
+        return( false );
+    }
+    
+    if ( freeCount < ePtr -> numDst ) {
+        
+        core -> stats.renameStalls ++;
+        return( false );
+    }
+    
+    OooRobEntry *rPtr = robEntry( robCount );
+    
+    *rPtr = *ePtr;
+    
+    for ( uint32_t i = 0; i < rPtr -> numSrc; i++ ) rPtr -> srcTag[ i ] = renameMap[ rPtr -> srcReg[ i ]];
+    
+    for ( uint32_t i = 0; i < rPtr -> numDst; i++ ) {
+        
+        uint16_t tag = freeList[ -- freeCount ];
+        
+        rPtr -> prevTag[ i ]                = renameMap[ rPtr -> dstReg[ i ]];
+        rPtr -> dstTag[ i ]                 = tag;
+        renameMap[ rPtr -> dstReg[ i ]]     = tag;
+        regReadyCycle[ tag ]                = NOT_READY;
+    }
+    
+    if ( noExec ) {
+        
+        rPtr -> issued      = true;
+        rPtr -> doneCycle   = curCycle + 1;
+        
+        for ( uint32_t i = 0; i < rPtr -> numDst; i++ ) regReadyCycle[ rPtr -> dstTag[ i ]] = rPtr -> doneCycle;
+    }
+    else if ( isMem ) {
+        
+        memIqCount ++;
+        lsqCount ++;
+    }
+    else aluIqCount ++;
+    
+    robCount ++;
+    return( true );
+}
@@ -116,9 +116,9 @@ void CpuReg::setBitField( uint32_t val, int pos, int len ) {
     pos = pos % 32;
     len = len % 32;
     
-    uint32_t tmpM = ( 1U << len ) - 1;
+    uint32_t tmpM = (( 1U << len ) - 1 ) << ( 31 - pos );
     
-    val = ( val & tmpM ) << ( 31 - pos );
+    val = ( val << ( 31 - pos )) & tmpM;
     
     regIn = ( regIn & ( ~tmpM )) | val;
 }
@@ -161,3 +161,99 @@ bool CpuReg::isPrivReg( ) {
     
     return( isPriv );
 }
+
+
+//------------------------------------------------------------------------------------------------------------
+// The register file methods. The registers are addressed by their index. The index is taken modulo the
+// array size, so that a bad index cannot reach outside the arrays. A "set" stores the value in the inbound
+// array and marks the register dirty. The "tick" copies the inbound value of the dirty registers to the
+// outbound array and clears the dirty mask. A "load" sets both values and does not need to mark anything.
+// "getBitField" extracts the field and sign extends it only when the field's leftmost bit is set.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuRegFile::CpuRegFile( uint32_t size ) {
+    
+    this -> size = ( size < MAX_REG_FILE_SIZE ) ? size : MAX_REG_FILE_SIZE;
+    
+    reset( );
+}
+
+void CpuRegFile::init( uint8_t regId, uint32_t val, bool isPriv ) {
+    
+    regId = regId % MAX_REG_FILE_SIZE;
+    
+    regIn[ regId ]  = val;
+    regOut[ regId ] = val;
+    
+    if ( isPriv ) privMask |= ( 1U << regId );
+    else          privMask &= ~ ( 1U << regId );
+}
+
+void CpuRegFile::reset( ) {
+    
+    for ( uint32_t i = 0; i < size; i++ ) {
+        
+        regIn[ i ]  = 0;
+        regOut[ i ] = 0;
+    }
+    
+    dirtyMask = 0;
+}
+
+void CpuRegFile::tick( ) {
+    
+    while ( dirtyMask != 0 ) {
+        
+        uint32_t i = __builtin_ctz( dirtyMask );
+        
+        regOut[ i ] = regIn[ i ];
+        dirtyMask   &= dirtyMask - 1;
+    }
+}
+
+void CpuRegFile::load( uint8_t regId, uint32_t val ) {
+    
+    regId = regId % MAX_REG_FILE_SIZE;
+    
+    regIn[ regId ] = regOut[ regId ] = val;
+}
+
+void CpuRegFile::set( uint8_t regId, uint32_t val ) {
+    
+    regId = regId % MAX_REG_FILE_SIZE;
+    
+    regIn[ regId ]  = val;
+    dirtyMask       |= ( 1U << regId );
+}
+
+uint32_t CpuRegFile::get( uint8_t regId ) {
+    
+    return( regOut[ regId % MAX_REG_FILE_SIZE ] );
+}
+
+uint32_t CpuRegFile::getLatched( uint8_t regId ) {
+    
+    return( regIn[ regId % MAX_REG_FILE_SIZE ] );
+}
+
+uint32_t CpuRegFile::getBitField( uint8_t regId, int pos, int len, bool sign ) {
+    
+    pos = pos % 32;
+    len = len % 32;
+    
+    uint32_t tmpM = ( 1U << len ) - 1;
+    uint32_t tmpA = ( regOut[ regId % MAX_REG_FILE_SIZE ] >> ( 31 - pos )) & tmpM;
+    
+    if (( sign ) && ( len > 0 ) && ( tmpA & ( 1U << ( len - 1 )))) return( tmpA | ( ~ tmpM ));
+    else                                                            return( tmpA );
+}
+
+bool CpuRegFile::isPrivReg( uint8_t regId ) {
+    
+    return(( privMask >> ( regId % MAX_REG_FILE_SIZE )) & 1 );
+}
+
+uint32_t CpuRegFile::getSize( ) {
+    
+    return( size );
+}
@@ -310,6 +310,7 @@ enum SimTokId : uint16_t {
     CMD_WRITE_LINE          = 1016,
     
     CMD_RESET               = 1020,     CMD_RUN                 = 1021,     CMD_STEP                = 1022,
+    CMD_SAMPLE              = 1023,     CMD_SAVE_CHECKPOINT     = 1024,     CMD_RESTORE_CHECKPOINT  = 1025,
     
     CMD_DR                  = 1030,     CMD_MR                  = 1031,
     CMD_DA                  = 1037,     CMD_MA                  = 1038,
@@ -510,6 +511,10 @@ enum SimErrMsgId : uint16_t {
     ERR_ELF_MEMORY_SIZE_EXCEEDED    = 42,
     ERR_ELF_INVALID_ADR_RANGE       = 43,
     
+    ERR_SAVE_CHECKPOINT             = 44,
+    ERR_RESTORE_CHECKPOINT          = 45,
+    ERR_SINGLE_CORE_ONLY            = 46,
+    
     ERR_EXPECTED_COMMA              = 100,
     ERR_EXPECTED_LPAREN             = 101,
     ERR_EXPECTED_RPAREN             = 102,
@@ -596,6 +601,15 @@ const char ENV_RDX_DEFAULT [ ]          = "RDX_DEFAULT";
 const char ENV_WORDS_PER_LINE [ ]       = "WORDS_PER_LINE";
 const char ENV_SHOW_PSTAGE_INFO[ ]      = "SHOW_PSTAGE_INFO";
 const char ENV_STEP_IN_CLOCKS[ ]        = "STEP_IN_CLOCKS";
+const char ENV_FUNCTIONAL_MODE[ ]       = "FUNCTIONAL_MODE";
+const char ENV_THREADED_MODE[ ]         = "THREADED_MODE";
+const char ENV_JIT_MODE[ ]              = "JIT_MODE";
+const char ENV_RUN_POLL_KCYCLES[ ]      = "RUN_POLL_KCYCLES";
+const char ENV_RUN_TRAP_LIMIT[ ]        = "RUN_TRAP_LIMIT";
+const char ENV_RUN_QUANTUM[ ]           = "RUN_QUANTUM";
+const char ENV_SAMPLE_FAST_FORWARD[ ]   = "SAMPLE_FAST_FORWARD";
+const char ENV_SAMPLE_WARM_UP[ ]        = "SAMPLE_WARM_UP";
+const char ENV_SAMPLE_WINDOW[ ]         = "SAMPLE_WINDOW";
 
 const char ENV_I_TLB_SETS[ ]            = "I_TLB_SETS";
 const char ENV_I_TLB_SIZE[ ]            = "I_TLB_SIZE";
@@ -1412,6 +1426,10 @@ private:
     void            resetCmd( );
     void            runCmd( );
     void            stepCmd( );
+    void            sampleCmd( );
+    void            saveCheckpointCmd( );
+    void            restoreCheckpointCmd( );
+    void            setExecModeFromEnv( );
    
     void            modifyRegCmd( );
     
@@ -1545,6 +1563,7 @@ struct VCPU32Globals {
     SimConsoleIO        *console        = nullptr;
     SimEnv              *env            = nullptr;
     SimWinDisplay       *winDisplay     = nullptr;
+    CpuSystem           *sys            = nullptr;
     CpuCore             *cpu            = nullptr;
 };
 
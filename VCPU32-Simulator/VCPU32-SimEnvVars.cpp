@@ -505,6 +505,15 @@ void SimEnv::setupPredefined( ) {
     if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_WORDS_PER_LINE, (int) 8, true, false );
     if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_SHOW_PSTAGE_INFO, false, true, false );
     if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_STEP_IN_CLOCKS, false, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_FUNCTIONAL_MODE, false, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_THREADED_MODE, false, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_JIT_MODE, false, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_RUN_POLL_KCYCLES, (int) 100, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_RUN_TRAP_LIMIT, (int) 1, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_RUN_QUANTUM, (int) DEF_CPU_QUANTUM, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_SAMPLE_FAST_FORWARD, (int) 100000, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_SAMPLE_WARM_UP, (int) 10000, true, false );
+    if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_SAMPLE_WINDOW, (int) 1000, true, false );
     
     if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_I_TLB_SETS, (int) 1, true, false );
     if ( rStat == NO_ERR ) enterEnvVar((char *)  ENV_I_TLB_SIZE, (int) 1024, true, false );
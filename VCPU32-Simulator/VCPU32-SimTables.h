@@ -87,6 +87,9 @@ const SimToken cmdTokTab[ ] = {
     { .name = "RUN",                .typ = TYP_CMD,                 .tid = CMD_RUN                          },
     { .name = "STEP",               .typ = TYP_CMD,                 .tid = CMD_STEP                         },
     { .name = "S",                  .typ = TYP_CMD,                 .tid = CMD_STEP                         },
+    { .name = "SAMPLE",             .typ = TYP_CMD,                 .tid = CMD_SAMPLE                       },
+    { .name = "SAVE",               .typ = TYP_CMD,                 .tid = CMD_SAVE_CHECKPOINT              },
+    { .name = "RESTORE",            .typ = TYP_CMD,                 .tid = CMD_RESTORE_CHECKPOINT           },
     
     { .name = "DR",                 .typ = TYP_CMD,                 .tid = CMD_DR                           },
     { .name = "MR",                 .typ = TYP_CMD,                 .tid = CMD_MR                           },
@@ -411,6 +414,9 @@ const SimErrMsgTabEntry errMsgTab [ ] = {
     
     { .errNum = ERR_EXPECTED_INSTR_VAL,         .errStr = (char *) "Expected the instruction value" },
     { .errNum = ERR_EXPECTED_FILE_NAME,         .errStr = (char *) "Expected a file name" },
+    { .errNum = ERR_SAVE_CHECKPOINT,            .errStr = (char *) "Checkpoint file could not be written" },
+    { .errNum = ERR_RESTORE_CHECKPOINT,         .errStr = (char *) "Invalid checkpoint file or CPU configuration" },
+    { .errNum = ERR_SINGLE_CORE_ONLY,           .errStr = (char *) "Command is only supported with one CPU core" },
     { .errNum = ERR_EXPECTED_STACK_ID,          .errStr = (char *) "Expected stack Id" },
     { .errNum = ERR_EXPECTED_WIN_ID,            .errStr = (char *) "Expected a window Id" },
     { .errNum = ERR_EXPECTED_LPAREN,            .errStr = (char *) "Expected a left paren" },
@@ -545,8 +551,8 @@ const SimHelpMsgEntry cmdHelpTab[ ] = {
     {
         .helpTypeId = TYP_CMD,  .helpTokId  = CMD_RUN,
         .cmdNameStr     = (char *) "run",
-        .cmdSyntaxStr   = (char *) "run",
-        .helpStr        = (char *) "run the CPU"
+        .cmdSyntaxStr   = (char *) "run [ <steps> ]",
+        .helpStr        = (char *) "run the CPU until a trap, a key press or the step limit"
     },
     
     {
@@ -556,6 +562,27 @@ const SimHelpMsgEntry cmdHelpTab[ ] = {
         .helpStr        = (char *) "single step for instruction or clock cycle"
     },
     
+    {
+        .helpTypeId = TYP_CMD,  .helpTokId  = CMD_SAMPLE,
+        .cmdNameStr     = (char *) "sample",
+        .cmdSyntaxStr   = (char *) "sample [ <instr> ]",
+        .helpStr        = (char *) "sampled run with functional fast forward and detailed windows"
+    },
+    
+    {
+        .helpTypeId = TYP_CMD,  .helpTokId  = CMD_SAVE_CHECKPOINT,
+        .cmdNameStr     = (char *) "save",
+        .cmdSyntaxStr   = (char *) "save <filename>",
+        .helpStr        = (char *) "saves the CPU state to a checkpoint file"
+    },
+    
+    {
+        .helpTypeId = TYP_CMD,  .helpTokId  = CMD_RESTORE_CHECKPOINT,
+        .cmdNameStr     = (char *) "restore",
+        .cmdSyntaxStr   = (char *) "restore <filename>",
+        .helpStr        = (char *) "restores the CPU state from a checkpoint file"
+    },
+    
     {
         .helpTypeId = TYP_CMD,  .helpTokId  = CMD_WRITE_LINE,
         .cmdNameStr     = (char *) "w",
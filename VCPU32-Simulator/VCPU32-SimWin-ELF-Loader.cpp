@@ -25,6 +25,20 @@
 #include "VCPU32-Types.h"
 #include "VCPU32-SimDeclarations.h"
 
+#if __APPLE__ || __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ))
+#define ELF_SWAP_SSSE3 1
+#include <tmmintrin.h>
+#elif defined( __ARM_NEON )
+#include <arm_neon.h>
+#endif
+
 using namespace ELFIO;
 
 //------------------------------------------------------------------------------------------------------------
@@ -45,6 +59,147 @@ inline uint32_t swap32(uint32_t val) {
            ((val & 0xFF000000) >> 24);
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "swapWords" copies "len" bytes of big endian words to the destination, converting each word to the host
+// order. Where available, 16 bytes at a time are converted with a byte shuffle. A last partial word is
+// padded with zeroes, so the destination always receives whole words.
+//
+// The default x86-64 build flags do not enable SSSE3. The shuffle routine is therefore compiled for SSSE3
+// with a target attribute and selected at run time, when the host CPU supports it. ARM64 always has NEON.
+//
+//------------------------------------------------------------------------------------------------------------
+void swapWordsTail( uint8_t *dst, const uint8_t *src, size_t len, size_t i ) {
+    
+    for ( ; i + 4 <= len; i += 4 ) {
+        
+        uint32_t val;
+        
+        memcpy( &val, src + i, sizeof( uint32_t ));
+        val = swap32( val );
+        memcpy( dst + i, &val, sizeof( uint32_t ));
+    }
+    
+    if ( i < len ) {
+        
+        uint32_t val = 0;
+        
+        memcpy( &val, src + i, len - i );
+        val = swap32( val );
+        memcpy( dst + i, &val, sizeof( uint32_t ));
+    }
+}
+
+#if defined( ELF_SWAP_SSSE3 )
+__attribute__(( target( "ssse3" )))
+size_t swapWordsSsse3( uint8_t *dst, const uint8_t *src, size_t len ) {
+    
+    const __m128i   mask    = _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+    size_t          i       = 0;
+    
+    for ( ; i + 16 <= len; i += 16 ) {
+        
+        __m128i val = _mm_loadu_si128((const __m128i *) ( src + i ));
+        _mm_storeu_si128((__m128i *) ( dst + i ), _mm_shuffle_epi8( val, mask ));
+    }
+    
+    return( i );
+}
+
+bool hasSsse3( ) {
+    
+    static const bool supported = __builtin_cpu_supports( "ssse3" );
+    
+    return( supported );
+}
+#endif
+
+void swapWords( uint8_t *dst, const uint8_t *src, size_t len ) {
+    
+    size_t i = 0;
+    
+#if defined( ELF_SWAP_SSSE3 )
+    if ( hasSsse3( )) i = swapWordsSsse3( dst, src, len );
+#elif defined( __ARM_NEON )
+    for ( ; i + 16 <= len; i += 16 ) vst1q_u8( dst + i, vrev32q_u8( vld1q_u8( src + i )));
+#endif
+    
+    swapWordsTail( dst, src, len, i );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The file image is mapped read only. The segment data is taken directly from the mapped image instead of
+// having it copied into buffers by the ELF library first. A host without the POSIX file mapping, such as
+// Windows, reads the file image into an allocated buffer instead.
+//
+//------------------------------------------------------------------------------------------------------------
+#if __APPLE__ || __unix__
+
+uint8_t *mapElfImage( char *fileName, size_t *imageSize ) {
+    
+    struct stat st;
+    uint8_t     *image  = nullptr;
+    int         fd      = open( fileName, O_RDONLY );
+    
+    if ( fd < 0 ) throw( ERR_INVALID_ELF_FILE );
+    
+    if (( fstat( fd, &st ) == 0 ) && ( st.st_size > 0 )) {
+        
+        void *ptr = mmap( nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        
+        if ( ptr != MAP_FAILED ) {
+            
+            image       = (uint8_t *) ptr;
+            *imageSize  = (size_t) st.st_size;
+        }
+    }
+    
+    close( fd );
+    
+    if ( image == nullptr ) throw( ERR_INVALID_ELF_FILE );
+    return( image );
+}
+
+void unmapElfImage( uint8_t *image, size_t imageSize ) {
+    
+    munmap( image, imageSize );
+}
+
+#else
+
+uint8_t *mapElfImage( char *fileName, size_t *imageSize ) {
+    
+    uint8_t     *image  = nullptr;
+    long        len     = 0;
+    FILE        *inFile = fopen( fileName, "rb" );
+    
+    if ( inFile == nullptr ) throw( ERR_INVALID_ELF_FILE );
+    
+    if (( fseek( inFile, 0, SEEK_END ) == 0 ) && (( len = ftell( inFile )) > 0 ) && ( fseek( inFile, 0, SEEK_SET ) == 0 )) {
+        
+        image = (uint8_t *) malloc( len );
+        
+        if (( image != nullptr ) && ( fread( image, 1, len, inFile ) != (size_t) len )) {
+            
+            free( image );
+            image = nullptr;
+        }
+    }
+    
+    fclose( inFile );
+    
+    if ( image == nullptr ) throw( ERR_INVALID_ELF_FILE );
+    
+    *imageSize = (size_t) len;
+    return( image );
+}
+
+void unmapElfImage( uint8_t *image, size_t ) {
+    
+    free( image );
+}
+
+#endif
+
 //------------------------------------------------------------------------------------------------------------
 // Open and close the ELF file. On opening we also check that it is a Big Endian type file.
 //
@@ -53,7 +208,7 @@ elfio *openElfFile( char *fileName ) {
     
     ELFIO::elfio *reader = new ( std::nothrow ) elfio;
     
-    if ( ! reader -> load( fileName )) throw( ERR_INVALID_ELF_FILE );
+    if ( ! reader -> load( fileName, true )) throw( ERR_INVALID_ELF_FILE );
     if ( reader -> get_encoding( ) != ELFDATA2MSB ) throw( ERR_INVALID_ELF_BYTE_ORDER );
     return( reader );
 }
@@ -79,22 +234,35 @@ bool elfioValidate( elfio *reader, char* msg, int msg_len ) {
     return error.empty( );
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "findMemObj" returns the memory object that holds the entire address range, or a null pointer if there is
+// no such object.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuMem *findMemObj( CpuCore *cpu, uint32_t adr, uint32_t len ) {
+    
+    CpuMem *mem[ ] = { cpu -> physMem, cpu -> pdcMem, cpu -> ioMem };
+    
+    for ( int i = 0; i < 3; i++ ) {
+        
+        if (( mem[ i ] != nullptr ) &&
+            ( mem[ i ] -> validAdr( adr )) &&
+            ( mem[ i ] -> validAdr( adr + len - 1 ))) return( mem[ i ] );
+    }
+    
+    return( nullptr );
+}
+
 //------------------------------------------------------------------------------------------------------------
 // Write a word to the simulator memory.
 //
 //------------------------------------------------------------------------------------------------------------
 bool writeMem( CpuCore *cpu, uint32_t ofs, uint32_t val ) {
     
-    CpuMem      *physMem    = cpu -> physMem;
-    CpuMem      *pdcMem     = cpu -> pdcMem;
-    CpuMem      *ioMem      = cpu -> ioMem;
-    CpuMem      *mem        = nullptr;
-    
-    if      (( physMem != nullptr ) && ( physMem -> validAdr( ofs ))) mem = physMem;
-    else if (( pdcMem  != nullptr ) && ( pdcMem  -> validAdr( ofs ))) mem = pdcMem;
-    else if (( ioMem   != nullptr ) && ( ioMem   -> validAdr( ofs ))) mem = ioMem;
+    CpuMem *mem = findMemObj( cpu, ofs, 4 );
     
     if (((uint64_t) ofs + 4 ) > MAX_MEMORY_SIZE ) throw ( ERR_OFS_LEN_LIMIT_EXCEEDED );
+    if ( mem == nullptr ) throw ( ERR_ELF_INVALID_ADR_RANGE );
     
     mem -> putMemDataWord( ofs, val );
     
@@ -102,24 +270,26 @@ bool writeMem( CpuCore *cpu, uint32_t ofs, uint32_t val ) {
 }
 
 //------------------------------------------------------------------------------------------------------------
-// Load a segment into main memory. We are passed the segment and the CPU handle. Currently we only load
-// physical memory. First we get the segment attributes and validate them for size, etc. Next we clear the
-// physical memory in the size of what it sould be according to the segment data. Next, we copy the segment
-// data word by word up to the segment file size attribute. Note that a segment needs to have loadable data.
-// Since our memory access is on a word basis, there is one more thing. The data is correctly encoded in
-// big endian format. Howeber, the coercion from that byte array to a word array will place the data in the
-// host system order, i.e. littlle endian. We need to swap each word accordingly.
+// Load a segment into main memory. We are passed the segment, the mapped file image and the CPU handle.
+// Currently we only load physical memory. First we get the segment attributes and validate them for size,
+// etc. The data is correctly encoded in big endian format. However, the memory holds words in the host
+// system order, i.e. little endian. We need to swap each word accordingly.
+//
+// When one memory object holds the entire segment, the segment data is swapped straight into its data array
+// and only the remainder up to the segment memory size is cleared. Otherwise, we clear the memory in the
+// size of the segment and copy the segment data word by word up to the segment file size attribute. Note
+// that a segment needs to have loadable data.
 //
 //------------------------------------------------------------------------------------------------------------
-void loadSegmentIntoMemory( elfio *reader, segment *segment, CpuCore *cpu, SimWinOutBuffer *winOut ) {
+void loadSegmentIntoMemory( elfio *reader, segment *segment, CpuCore *cpu, SimWinOutBuffer *winOut,
+                            uint8_t *image, size_t imageSize ) {
     
     if ( segment ->get_type( ) == PT_LOAD ) {
       
         Elf_Xword       index       = segment -> get_index( );
         Elf_Xword       fileSize    = segment -> get_file_size( );
         Elf_Xword       memorySize  = segment -> get_memory_size( );
-        const char      *dataPtr    = segment -> get_data( );
-        const uint32_t  *wordPtr    = reinterpret_cast<const uint32_t*> ( dataPtr );
+        Elf64_Off       fileOfs     = segment -> get_offset( );
         Elf64_Addr      vAdr        = segment -> get_physical_address( );
         Elf_Xword       align       = segment -> get_align( );
         Elf_Word        flags       = segment -> get_flags( );
@@ -147,15 +317,39 @@ void loadSegmentIntoMemory( elfio *reader, segment *segment, CpuCore *cpu, SimWi
             
             throw( ERR_ELF_MEMORY_SIZE_EXCEEDED );
         }
+        
+        if (( fileSize > memorySize ) || ( fileOfs > imageSize ) || ( fileSize > imageSize - fileOfs )) {
             
-        for ( Elf64_Addr i = 0; i < memorySize; i += 4  ) {
-            
-            writeMem( cpu, uint32_t(vAdr + i), 0 );
+            throw( ERR_INVALID_ELF_FILE );
         }
         
-        for ( Elf64_Addr i = 0; i < fileSize; i += 4  ) {
+        if ( memorySize == 0 ) return;
+        
+        const uint8_t   *dataPtr    = image + fileOfs;
+        Elf_Xword       copySize    = ( fileSize + 3 ) & ~ 3ULL;
+        CpuMem          *mem        = findMemObj( cpu, uint32_t( vAdr ), uint32_t( memorySize ));
+        
+        if (( mem != nullptr ) && ( copySize <= memorySize )) {
             
-            writeMem( cpu, uint32_t( vAdr + i ), swap32( wordPtr[ i / 4 ] ));
+            uint8_t *memPtr = mem -> getMemBlockEntry( 0 ) + ( vAdr - mem -> getStartAdr( ));
+            
+            swapWords( memPtr, dataPtr, fileSize );
+            memset( memPtr + copySize, 0, memorySize - copySize );
+        }
+        else {
+            
+            for ( Elf64_Addr i = 0; i < memorySize; i += 4  ) {
+                
+                writeMem( cpu, uint32_t(vAdr + i), 0 );
+            }
+            
+            for ( Elf64_Addr i = 0; i < fileSize; i += 4  ) {
+                
+                uint32_t val = 0;
+                
+                swapWords((uint8_t *) &val, dataPtr + i, (( fileSize - i ) < 4 ) ? fileSize - i : 4 );
+                writeMem( cpu, uint32_t( vAdr + i ), val );
+            }
         }
     }
 }
@@ -165,19 +359,23 @@ void loadSegmentIntoMemory( elfio *reader, segment *segment, CpuCore *cpu, SimWi
 
 //------------------------------------------------------------------------------------------------------------
 // Loading a basic ELF file. This routine is rather simple. All we do is to locate the segments and load
-// them into physical memory. Could be refined and do more checking one day.
+// them into physical memory. The ELF library reads the headers only, the segment data comes from the file
+// image mapped into memory. Could be refined and do more checking one day.
 //
 //------------------------------------------------------------------------------------------------------------
 void SimCommandsWin::loadElfFile( char *fileName ) {
     
-    elfio *reader = nullptr;
-    char  errMsgBuf[ 256 ];
+    elfio   *reader     = nullptr;
+    uint8_t *image      = nullptr;
+    size_t  imageSize   = 0;
+    char    errMsgBuf[ 256 ];
     
     try {
         
         winOut -> printChars( "Loading %s\n", fileName );
         
         reader = openElfFile( fileName );
+        image  = mapElfImage( fileName, &imageSize );
       
         if ( ! elfioValidate( reader, errMsgBuf, sizeof( errMsgBuf ))) {
             
@@ -189,9 +387,11 @@ void SimCommandsWin::loadElfFile( char *fileName ) {
         
         for ( int i = 0; i < numOfSeg; i++ ) {
             
-            loadSegmentIntoMemory( reader, reader -> segments[ i ], glb -> cpu, winOut );
+            loadSegmentIntoMemory( reader, reader -> segments[ i ], glb -> cpu, winOut, image, imageSize );
         }
         
+        glb -> cpu -> flushTranslations( );
+        
         Elf64_Addr entry = reader -> get_entry( );
         
         winOut -> printChars( "Set entry: 0x%08x\n", entry );
@@ -206,5 +406,6 @@ void SimCommandsWin::loadElfFile( char *fileName ) {
         winOut -> printChars( "ELF file load error: %d\n", errNum );
     }
     
+    if ( image != nullptr ) unmapElfImage( image, imageSize );
     if ( reader != nullptr ) closeElfFile( reader );
 }
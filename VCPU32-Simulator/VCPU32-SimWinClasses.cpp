@@ -1212,7 +1212,7 @@ void SimWinMemController::setDefaults( ) {
     setColumns( getDefColumns( getRadix( )));
     setWinType( winType );
     setEnable( false );
-    setRows(( winType == WT_MEM_S_WIN ) ? 3 : 4 );
+    setRows( 4 );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -1290,6 +1290,14 @@ void SimWinMemController::drawBody( ) {
         printNumericField( cPtr -> getMemCtrlReg( MC_REG_REQ_PRI ));
         printTextField((char * ) "  Lat: ", ( fmtDesc | FMT_ALIGN_LFT | FMT_HALF_WORD ));
         printNumericField( cPtr -> getMemCtrlReg( MC_REG_REQ_LATENCY ));
+        
+        if ( winType == WT_MEM_S_WIN ) {
+            
+            setWinCursor( 4, 1 );
+            printTextField((char *) "Resident:", ( fmtDesc | FMT_ALIGN_LFT ), 10 );
+            printNumericField( cPtr -> getMemCtrlReg( MC_REG_RESIDENT_PAGES ));
+            printTextField((char *) " pages", fmtDesc );
+        }
     }
     else {
         
@@ -34,6 +34,8 @@
 #include "VCPU32-SimDeclarations.h"
 #include "VCPU32-SimTables.h"
 #include "VCPU32-Core.h"
+#include <time.h>
+#include <math.h>
 
 //------------------------------------------------------------------------------------------------------------
 // Local name space. We try to keep utility functions local to the file.
@@ -1290,7 +1292,7 @@ void SimCommandsWin::resetCmd( ) {
     
     if ( tok -> isToken( TOK_EOS )) {
         
-        glb -> cpu -> reset( );
+        glb -> sys -> reset( );
     }
     else if ( tok -> tokTyp( ) == TYP_SYM ) {
         
@@ -1298,13 +1300,14 @@ void SimCommandsWin::resetCmd( ) {
                 
             case TOK_CPU: {
                 
-                glb -> cpu -> reset( );
+                glb -> sys -> reset( );
                 
             } break;
                 
             case TOK_MEM: {
                 
-                glb -> cpu -> physMem -> reset( );
+                glb -> sys -> physMem -> reset( );
+                glb -> sys -> flushTranslations( );
                 
             } break;
                 
@@ -1314,8 +1317,8 @@ void SimCommandsWin::resetCmd( ) {
                 
             case TOK_ALL: {
                 
-                glb -> cpu -> reset( );
-                glb -> cpu -> physMem -> reset( );
+                glb -> sys -> reset( );
+                glb -> sys -> physMem -> reset( );
                 
             } break;
                 
@@ -1326,20 +1329,277 @@ void SimCommandsWin::resetCmd( ) {
 }
 
 //------------------------------------------------------------------------------------------------------------
-// Run command. The command will just run the CPU until a "halt" instruction is detected.
+// Run command. The command runs the CPU until a stop condition is met. The CPU is stepped in large batches,
+// the size is set in thousands of steps by an ENV variable. Between the batches, we check the console for
+// a key press, which interrupts the run. The other stop conditions are the optional step limit and the
+// number of traps taken. There is no halt instruction, but a BRK instruction raises a trap and thus serves
+// as a program breakpoint. The CPU core stops right after the trap, so the trap handler has not yet started
+// to execute. A trap limit of zero runs through all traps. The windows are not updated during the run, the
+// command interpreter redraws them once we return. Just like the STEP command, the steps are instructions
+// or clock cycles, depending on the ENV variable setting. In a multi-core system all cores run, they wait
+// for each other after a quantum of steps, also set by an ENV variable. The counts shown are for core zero.
 //
-//  RUN
+//  RUN [ <steps> ]
 //
-// ??? see STEP command for details on the console handling.
+// ??? the console window should become the current window while the CPU runs.
 //------------------------------------------------------------------------------------------------------------
 void SimCommandsWin::runCmd( ) {
     
-    winOut -> printChars( "RUN command to come ... \n");
+    SimExpr     rExpr;
+    uint32_t    maxSteps    = UINT32_MAX;
+    uint32_t    batchSize   = glb -> env -> getEnvVarInt((char *) ENV_RUN_POLL_KCYCLES ) * 1000;
+    uint32_t    trapLimit   = glb -> env -> getEnvVarInt((char *) ENV_RUN_TRAP_LIMIT );
+    bool        inClocks    = glb -> env -> getEnvVarBool((char *) ENV_STEP_IN_CLOCKS );
+    bool        isConsole   = glb -> console -> isConsole( );
+    CpuSystem   *sys        = glb -> sys;
+    CpuCore     *cpu        = glb -> cpu;
+    
+    if ( tok -> tokTyp( ) == TYP_NUM ) {
+        
+        eval -> parseExpr( &rExpr );
+        
+        if ( rExpr.typ == TYP_NUM ) maxSteps = rExpr.numVal;
+        else throw ( ERR_EXPECTED_STEPS );
+    }
+    
+    checkEOS( );
+    
+    if ( batchSize == 0 ) batchSize = 1000;
+    
+    setExecModeFromEnv( );
+    sys -> setQuantum( glb -> env -> getEnvVarInt((char *) ENV_RUN_QUANTUM ));
+    
+    uint32_t    startSteps  = ( inClocks ) ? cpu -> stats.clockCntr : cpu -> stats.instrCntr;
+    uint32_t    startTraps  = cpu -> stats.trapsTaken;
+    uint32_t    startInstr  = cpu -> stats.instrCntr;
+    uint32_t    startClocks = cpu -> stats.clockCntr;
+    uint32_t    stepsDone   = 0;
+    const char  *stopReason = "step limit reached";
+    clock_t     startTime   = clock( );
+    
+    sys -> clearStop( );
+    sys -> setStopOnTrap( trapLimit > 0 );
+    if ( isConsole ) glb -> console -> setBlockingMode( false );
+    
+    while ( stepsDone < maxSteps ) {
+        
+        uint32_t steps = ( maxSteps - stepsDone < batchSize ) ? maxSteps - stepsDone : batchSize;
+        
+        if ( inClocks ) sys -> clockStep( steps );
+        else            sys -> instrStep( steps );
+        
+        stepsDone = (( inClocks ) ? cpu -> stats.clockCntr : cpu -> stats.instrCntr ) - startSteps;
+        
+        if ( sys -> isStopped( )) {
+            
+            sys -> clearStop( );
+            
+            if ( cpu -> stats.trapsTaken - startTraps >= trapLimit ) {
+                
+                stopReason = "trap limit reached";
+                break;
+            }
+        }
+        
+        if (( isConsole ) && ( glb -> console -> readChar( ) != 0 )) {
+            
+            stopReason = "interrupted";
+            break;
+        }
+    }
+    
+    if ( isConsole ) glb -> console -> setBlockingMode( true );
+    sys -> setStopOnTrap( false );
+    
+    double      elapsed     = (double) ( clock( ) - startTime ) / CLOCKS_PER_SEC;
+    uint32_t    instrDone   = cpu -> stats.instrCntr - startInstr;
+    
+    winOut -> printChars( "Run stopped: %s\n", stopReason );
+    winOut -> printChars( "Instructions: %u, Cycles: %u, Traps: %u\n",
+                          instrDone, cpu -> stats.clockCntr - startClocks, cpu -> stats.trapsTaken - startTraps );
+    
+    if ( elapsed > 0 ) {
+        
+        winOut -> printChars( "Time: %.3f sec, %.2f MIPS\n", elapsed, instrDone / elapsed / 1000000.0 );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Sample command. The command runs the CPU in the sampled simulation mode. A fast forward phase with the
+// functional engine, or the threaded or JIT engine when selected by the ENV variables, is followed by a
+// functional warm up of the caches and a detailed window executed by the pipeline model. The lengths of the
+// three phases are set in instructions by ENV variables. The run stops just like the RUN command does. At
+// the end, the mean CPI of the detailed windows and its 95% confidence interval are reported, along with the
+// cache and TLB miss rates measured in the detailed windows. Each command starts a new sampled run. The
+// sampled simulation mode works on a single CPU core, the command is rejected for a multi-core system.
+//
+//  SAMPLE [ <instr> ]
+//
+//------------------------------------------------------------------------------------------------------------
+void SimCommandsWin::sampleCmd( ) {
+    
+    SimExpr     rExpr;
+    uint32_t    maxInstr    = UINT32_MAX;
+    uint32_t    batchSize   = glb -> env -> getEnvVarInt((char *) ENV_RUN_POLL_KCYCLES ) * 1000;
+    uint32_t    trapLimit   = glb -> env -> getEnvVarInt((char *) ENV_RUN_TRAP_LIMIT );
+    bool        isConsole   = glb -> console -> isConsole( );
+    CpuCore     *cpu        = glb -> cpu;
+    ExecMode    fastMode    = EXEC_MODE_FUNCTIONAL;
+    
+    if ( glb -> sys -> getNumOfCores( ) > 1 ) throw ( ERR_SINGLE_CORE_ONLY );
+    
+    if ( tok -> tokTyp( ) == TYP_NUM ) {
+        
+        eval -> parseExpr( &rExpr );
+        
+        if ( rExpr.typ == TYP_NUM ) maxInstr = rExpr.numVal;
+        else throw ( ERR_EXPECTED_STEPS );
+    }
+    
+    checkEOS( );
+    
+    if ( batchSize == 0 ) batchSize = 1000;
+    
+    if      ( glb -> env -> getEnvVarBool((char *) ENV_JIT_MODE ))      fastMode = EXEC_MODE_JIT;
+    else if ( glb -> env -> getEnvVarBool((char *) ENV_THREADED_MODE )) fastMode = EXEC_MODE_THREADED;
+    
+    cpu -> setSampling( glb -> env -> getEnvVarInt((char *) ENV_SAMPLE_FAST_FORWARD ),
+                        glb -> env -> getEnvVarInt((char *) ENV_SAMPLE_WARM_UP ),
+                        glb -> env -> getEnvVarInt((char *) ENV_SAMPLE_WINDOW ),
+                        fastMode );
+    
+    cpu -> sampleStats = CpuSampleStats( );
+    
+    uint32_t    startInstr  = cpu -> stats.instrCntr;
+    uint32_t    startTraps  = cpu -> stats.trapsTaken;
+    uint32_t    instrDone   = 0;
+    const char  *stopReason = "instruction limit reached";
+    clock_t     startTime   = clock( );
+    
+    cpu -> clearStop( );
+    cpu -> setStopOnTrap( trapLimit > 0 );
+    if ( isConsole ) glb -> console -> setBlockingMode( false );
+    
+    while ( instrDone < maxInstr ) {
+        
+        uint32_t steps = ( maxInstr - instrDone < batchSize ) ? maxInstr - instrDone : batchSize;
+        
+        cpu -> sampledStep( steps );
+        
+        instrDone = cpu -> stats.instrCntr - startInstr;
+        
+        if ( cpu -> isStopped( )) {
+            
+            cpu -> clearStop( );
+            
+            if ( cpu -> stats.trapsTaken - startTraps >= trapLimit ) {
+                
+                stopReason = "trap limit reached";
+                break;
+            }
+        }
+        
+        if (( isConsole ) && ( glb -> console -> readChar( ) != 0 )) {
+            
+            stopReason = "interrupted";
+            break;
+        }
+    }
+    
+    if ( isConsole ) glb -> console -> setBlockingMode( true );
+    cpu -> setStopOnTrap( false );
+    
+    double          elapsed = (double) ( clock( ) - startTime ) / CLOCKS_PER_SEC;
+    CpuSampleStats  *sStats = &cpu -> sampleStats;
+    
+    winOut -> printChars( "Sample run stopped: %s\n", stopReason );
+    winOut -> printChars( "Instructions: %u, fast forward: %llu, warm up: %llu, detailed: %llu\n",
+                          instrDone,
+                          (unsigned long long) sStats -> instrFastForward,
+                          (unsigned long long) sStats -> instrWarmUp,
+                          (unsigned long long) sStats -> instrDetailed );
+    
+    if ( sStats -> samples > 0 ) {
+        
+        double n        = sStats -> samples;
+        double cpiMean  = sStats -> cpiSum / n;
+        double cpiVar   = ( n > 1 ) ? ( sStats -> cpiSumSquares - n * cpiMean * cpiMean ) / ( n - 1 ) : 0.0;
+        double cpiConf  = ( cpiVar > 0 ) ? 1.96 * sqrt( cpiVar / n ) : 0.0;
+        
+        winOut -> printChars( "Samples: %u, CPI: %.4f +/- %.4f (95%% confidence)\n", sStats -> samples, cpiMean, cpiConf );
+        
+        if ( sStats -> iCacheAccess > 0 ) {
+            
+            winOut -> printChars( "I-Cache accesses: %llu, miss rate: %.2f%%\n",
+                                  (unsigned long long) sStats -> iCacheAccess,
+                                  100.0 * sStats -> iCacheMiss / sStats -> iCacheAccess );
+        }
+        
+        if ( sStats -> dCacheAccess > 0 ) {
+            
+            winOut -> printChars( "D-Cache accesses: %llu, miss rate: %.2f%%\n",
+                                  (unsigned long long) sStats -> dCacheAccess,
+                                  100.0 * sStats -> dCacheMiss / sStats -> dCacheAccess );
+        }
+        
+        if ( sStats -> iTlbAccess > 0 ) {
+            
+            winOut -> printChars( "I-TLB accesses: %llu, miss rate: %.2f%%\n",
+                                  (unsigned long long) sStats -> iTlbAccess,
+                                  100.0 * sStats -> iTlbMiss / sStats -> iTlbAccess );
+        }
+        
+        if ( sStats -> dTlbAccess > 0 ) {
+            
+            winOut -> printChars( "D-TLB accesses: %llu, miss rate: %.2f%%\n",
+                                  (unsigned long long) sStats -> dTlbAccess,
+                                  100.0 * sStats -> dTlbMiss / sStats -> dTlbAccess );
+        }
+    }
+    else winOut -> printChars( "Samples: 0, no detailed window completed\n" );
+    
+    if ( elapsed > 0 ) {
+        
+        winOut -> printChars( "Time: %.3f sec, %.2f MIPS\n", elapsed, instrDone / elapsed / 1000000.0 );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Save and restore checkpoint commands. The CPU state is written to or read from a checkpoint file. The
+// actual work is done by the CPU core. A checkpoint can only be restored into a CPU with the same
+// configuration. A checkpoint holds the state of one CPU core, both commands are rejected for a multi-core
+// system.
+//
+//  SAVE "<filename>"
+//  RESTORE "<filename>"
+//------------------------------------------------------------------------------------------------------------
+void SimCommandsWin::saveCheckpointCmd( ) {
+    
+    if ( glb -> sys -> getNumOfCores( ) > 1 ) throw( ERR_SINGLE_CORE_ONLY );
+    
+    if ( tok -> tokTyp( ) == TYP_STR ) {
+        
+        if ( ! glb -> cpu -> saveCheckpoint( tok -> tokStr( ))) throw( ERR_SAVE_CHECKPOINT );
+    }
+    else throw( ERR_EXPECTED_FILE_NAME );
+}
+
+void SimCommandsWin::restoreCheckpointCmd( ) {
+    
+    if ( glb -> sys -> getNumOfCores( ) > 1 ) throw( ERR_SINGLE_CORE_ONLY );
+    
+    if ( tok -> tokTyp( ) == TYP_STR ) {
+        
+        if ( ! glb -> cpu -> restoreCheckpoint( tok -> tokStr( ))) throw( ERR_RESTORE_CHECKPOINT );
+    }
+    else throw( ERR_EXPECTED_FILE_NAME );
 }
 
 //------------------------------------------------------------------------------------------------------------
 // Step command. The command will execute one instruction. Default is one instruction. There is an ENV
-// variable that will set the default to be a single clock step.
+// variable that will set the default to be a single clock step. More ENV variables select whether the
+// instructions are executed by the pipeline model, by the functional engine, by the threaded engine or by
+// the threaded engine with the JIT compiler.
 //
 //  S [ <steps> ] [ , 'I' | 'C' ]
 //
@@ -1355,6 +1615,8 @@ void SimCommandsWin::stepCmd( ) {
     SimExpr  rExpr;
     uint32_t numOfSteps = 1;
     
+    setExecModeFromEnv( );
+    
     if ( tok -> tokTyp( ) == TYP_NUM ) {
         
         eval -> parseExpr( &rExpr );
@@ -1366,15 +1628,27 @@ void SimCommandsWin::stepCmd( ) {
     if ( tok -> tokId( ) == TOK_COMMA ) {
         
         tok -> nextToken( );
-        if      ( tok -> tokId( ) == TOK_I ) glb -> cpu -> instrStep( numOfSteps );
-        else if ( tok -> tokId( ) == TOK_C ) glb -> cpu -> clockStep( numOfSteps );
+        if      ( tok -> tokId( ) == TOK_I ) glb -> sys -> instrStep( numOfSteps );
+        else if ( tok -> tokId( ) == TOK_C ) glb -> sys -> clockStep( numOfSteps );
         else                                        throw ( ERR_INVALID_STEP_OPTION );
     }
     
     checkEOS( );
     
-    if ( glb -> env -> getEnvVarBool((char *) ENV_STEP_IN_CLOCKS )) glb -> cpu -> clockStep( 1 );
-    else                                                            glb -> cpu -> instrStep( 1 );
+    if ( glb -> env -> getEnvVarBool((char *) ENV_STEP_IN_CLOCKS )) glb -> sys -> clockStep( 1 );
+    else                                                            glb -> sys -> instrStep( 1 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The RUN and STEP commands select the execution mode of the CPU core from the ENV variables.
+//
+//------------------------------------------------------------------------------------------------------------
+void SimCommandsWin::setExecModeFromEnv( ) {
+    
+    if      ( glb -> env -> getEnvVarBool((char *) ENV_JIT_MODE ))        glb -> sys -> setExecMode( EXEC_MODE_JIT );
+    else if ( glb -> env -> getEnvVarBool((char *) ENV_THREADED_MODE ))   glb -> sys -> setExecMode( EXEC_MODE_THREADED );
+    else if ( glb -> env -> getEnvVarBool((char *) ENV_FUNCTIONAL_MODE )) glb -> sys -> setExecMode( EXEC_MODE_FUNCTIONAL );
+    else                                                                  glb -> sys -> setExecMode( EXEC_MODE_PIPELINE );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -1706,6 +1980,7 @@ void SimCommandsWin::modifyAbsMemCmd( ) {
     if (((uint64_t) ofs + 4 ) > UINT32_MAX ) throw ( ERR_OFS_LEN_LIMIT_EXCEEDED );
     
     mem -> putMemDataWord( ofs, val );
+    glb -> cpu -> flushTranslations( );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -2691,6 +2966,9 @@ void SimCommandsWin::evalInputLine( char *cmdBuf ) {
                     case CMD_RESET:         resetCmd( );                    break;
                     case CMD_RUN:           runCmd( );                      break;
                     case CMD_STEP:          stepCmd( );                     break;
+                    case CMD_SAMPLE:        sampleCmd( );                   break;
+                    case CMD_SAVE_CHECKPOINT:       saveCheckpointCmd( );   break;
+                    case CMD_RESTORE_CHECKPOINT:    restoreCheckpointCmd( ); break;
                         
                     case CMD_MR:            modifyRegCmd( );                break;
                         
@@ -0,0 +1,322 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Store Buffer
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 store buffer. Without a buffer, a store instruction waits in the MA stage until the L1 data
+// cache has accepted the data, which on a cache miss stalls the pipeline just like a load does. The store
+// buffer takes the store data and lets the instruction move on. The entries are written to the data cache
+// later, in the order they were stored, whenever the MA stage leaves the data cache port unused.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Store Buffer
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. The data of an entry is kept in the same byte order as the caches keep their data, so a load can
+// pick its bytes out of a larger store.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+void putBytes( uint8_t *dataPtr, uint32_t len, uint32_t word ) {
+    
+    if      ( len == 1 ) *dataPtr                 = (uint8_t) word;
+    else if ( len == 2 ) *((uint16_t *) dataPtr ) = (uint16_t) word;
+    else                 *((uint32_t *) dataPtr ) = word;
+}
+
+uint32_t getBytes( uint8_t *dataPtr, uint32_t len ) {
+    
+    if      ( len == 1 ) return( *((uint8_t *)  dataPtr ));
+    else if ( len == 2 ) return( *((uint16_t *) dataPtr ));
+    else                 return( *((uint32_t *) dataPtr ));
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The store buffer object constructor. The number of entries is limited to the maximum we support.
+//
+//------------------------------------------------------------------------------------------------------------
+StoreBuffer::StoreBuffer( CpuCore *core, uint32_t entries ) {
+    
+    this -> core    = core;
+    this -> entries = ( entries > MAX_STORE_BUF_ENTRIES ) ? MAX_STORE_BUF_ENTRIES : entries;
+    
+    reset( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "reset" empties the buffer, "clearStats" resets the statistic counters.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::reset( ) {
+    
+    head        = 0;
+    count       = 0;
+    added       = 0;
+    portBusy    = false;
+    trapDrain   = false;
+}
+
+void StoreBuffer::clearStats( ) {
+    
+    occupancySum        = 0;
+    maxOccupancy        = 0;
+    storeCnt            = 0;
+    drainCnt            = 0;
+    forwardCnt          = 0;
+    fullStallCnt        = 0;
+    conflictStallCnt    = 0;
+    fenceStallCnt       = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "process" is called every clock cycle after the pipeline stages and before the memory objects. When the MA
+// stage did not use the data cache in this cycle, the oldest entry is written to the data cache. On a cache
+// miss, the write is tried again with the next unused cycle, until the data cache accepts it. The buffer
+// occupancy is summed up each cycle, divided by the clock count it gives the average occupancy.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::process( ) {
+    
+    if ( count > 0 ) {
+        
+        occupancySum += count;
+        
+        if ( ! portBusy ) {
+            
+            StoreBufferEntry *ePtr = getEntry( 0 );
+            
+            if ( core -> dCacheL1 -> writeWord( ePtr -> seg, ePtr -> ofs, ePtr -> adr, ePtr -> len,
+                                                getBytes( ePtr -> data, ePtr -> len ))) {
+                
+                core -> decodeCache -> invalidate( ePtr -> adr, ePtr -> len );
+                
+                head = ( head + 1 ) % entries;
+                count --;
+                drainCnt ++;
+            }
+        }
+    }
+    
+    if ( count == 0 ) trapDrain = false;
+    
+    portBusy    = false;
+    added       = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "skipCycles" is called by the idle cycle skipping of the CPU core. It adds the occupancy and the stall
+// cycles for the skipped cycles.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::skipCycles( uint64_t occupancy, uint32_t fullStalls, uint32_t conflictStalls, uint32_t fenceStalls ) {
+    
+    occupancySum        += occupancy;
+    fullStallCnt        += fullStalls;
+    conflictStallCnt    += conflictStalls;
+    fenceStallCnt       += fenceStalls;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Entry "i" counts from the oldest entry.
+//
+//------------------------------------------------------------------------------------------------------------
+StoreBufferEntry *StoreBuffer::getEntry( uint32_t i ) {
+    
+    return( &entryArray[ ( head + i ) % entries ] );
+}
+
+bool StoreBuffer::isEnabled( ) {
+    
+    return( entries > 0 );
+}
+
+bool StoreBuffer::isEmpty( ) {
+    
+    return( count == 0 );
+}
+
+bool StoreBuffer::isTrapDrain( ) {
+    
+    return( trapDrain );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "addStore" enters the store data as the youngest entry. When the buffer is full, the store has to wait and
+// we count a stall cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+bool StoreBuffer::addStore( uint32_t seg, uint32_t ofs, uint32_t adr, uint32_t len, uint32_t word ) {
+    
+    if ( count >= entries ) {
+        
+        fullStallCnt ++;
+        return( false );
+    }
+    
+    StoreBufferEntry *ePtr = getEntry( count );
+    
+    ePtr -> seg = seg;
+    ePtr -> ofs = ofs;
+    ePtr -> adr = adr;
+    ePtr -> len = len;
+    putBytes( ePtr -> data, len, word );
+    
+    count ++;
+    added ++;
+    storeCnt ++;
+    
+    if ( count > maxOccupancy ) maxOccupancy = count;
+    
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "forwardLoad" looks for the youngest entry that overlaps the bytes of a load. If there is none, the load
+// reads from the data cache. If the entry covers all bytes of the load, the data is taken from the entry.
+// Otherwise the load data would have to be merged from the entry and the data cache, and we rather let the
+// load wait until the entry has been written. This is counted as a stall cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+StoreFwdResult StoreBuffer::forwardLoad( uint32_t adr, uint32_t len, uint32_t *word ) {
+    
+    for ( uint32_t i = count; i > 0; i-- ) {
+        
+        StoreBufferEntry *ePtr = getEntry( i - 1 );
+        
+        if (( adr + len <= ePtr -> adr ) || ( adr >= ePtr -> adr + ePtr -> len )) continue;
+        
+        if (( adr >= ePtr -> adr ) && ( adr + len <= ePtr -> adr + ePtr -> len )) {
+            
+            *word = getBytes( &ePtr -> data[ adr - ePtr -> adr ], len );
+            forwardCnt ++;
+            return( SB_FWD_HIT );
+        }
+        
+        conflictStallCnt ++;
+        return( SB_FWD_CONFLICT );
+    }
+    
+    return( SB_FWD_NONE );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "fence" is called by an instruction that needs all earlier stores to be written to the data cache. As long
+// as the buffer is not empty, the caller waits and we count a stall cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+bool StoreBuffer::fence( ) {
+    
+    if ( count == 0 ) return( true );
+    
+    fenceStallCnt ++;
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setPortBusy" is called by the MA stage when it accesses the data cache in the current cycle.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::setPortBusy( ) {
+    
+    portBusy = true;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "trapEntry" is called by the CPU core when a trap is taken. The trapping instruction is in the EX stage,
+// a store entered in this cycle belongs to the instruction behind it in the MA stage, which is flushed. The
+// entry is removed again. The stores of the instructions before the trapping instruction remain and the
+// FD stage will only fetch the first trap handler instruction when they are written.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::trapEntry( ) {
+    
+    count       = count - added;
+    added       = 0;
+    trapDrain   = ( count > 0 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flushAll" writes all entries right away, oldest first. It is used by the CPU core when leaving the
+// pipeline model, before the caches are flushed.
+//
+//------------------------------------------------------------------------------------------------------------
+void StoreBuffer::flushAll( ) {
+    
+    for ( uint32_t i = 0; i < count; i++ ) {
+        
+        StoreBufferEntry *ePtr = getEntry( i );
+        
+        core -> dCacheL1 -> putMemDataBlock( ePtr -> ofs, ePtr -> adr, ePtr -> data, ePtr -> len );
+        core -> decodeCache -> invalidate( ePtr -> adr, ePtr -> len );
+    }
+    
+    reset( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Getters.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t StoreBuffer::getOccupancy( ) {
+    
+    return( count );
+}
+
+uint32_t StoreBuffer::getMaxOccupancy( ) {
+    
+    return( maxOccupancy );
+}
+
+uint64_t StoreBuffer::getOccupancySum( ) {
+    
+    return( occupancySum );
+}
+
+uint32_t StoreBuffer::getStoreCnt( ) {
+    
+    return( storeCnt );
+}
+
+uint32_t StoreBuffer::getDrainCnt( ) {
+    
+    return( drainCnt );
+}
+
+uint32_t StoreBuffer::getForwardCnt( ) {
+    
+    return( forwardCnt );
+}
+
+uint32_t StoreBuffer::getFullStallCnt( ) {
+    
+    return( fullStallCnt );
+}
+
+uint32_t StoreBuffer::getConflictStallCnt( ) {
+    
+    return( conflictStallCnt );
+}
+
+uint32_t StoreBuffer::getFenceStallCnt( ) {
+    
+    return( fenceStallCnt );
+}
@@ -0,0 +1,273 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - CPU System
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU system is a set of CPU cores, which share the physical memory, PDC and L2 cache. Each core runs on
+// its own host thread. The cores run a quantum of cycles independently and then wait for each other, before
+// the next quantum starts. With one core, the system just passes the requests on to the core.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - CPU System
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU system constructor. The physical memory, PDC and L2 cache objects are created first, the cores then
+// share their data. With more than one core, the L1 data caches and the L2 caches are connected to the snoop
+// bus. All cores but core zero get a worker thread, which waits for the next quantum to run. The cores also
+// log their code writes.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuSystem::CpuSystem( CpuCoreDesc *cfg, uint32_t numOfCores ) {
+    
+    if ( numOfCores == 0 )              numOfCores = 1;
+    if ( numOfCores > MAX_CPU_CORES )   numOfCores = MAX_CPU_CORES;
+    
+    this -> numOfCores = numOfCores;
+    
+    physMem = new PhysMem( &cfg -> memDesc );
+    pdcMem  = new PdcMem( &cfg -> pdcDesc );
+    
+    if (( cfg -> cacheL2Options == VMEM_T_L2_UNIFIED_CACHE ) || ( cfg -> cacheL2Options == VMEM_T_L2_INCLUSIVE_CACHE ))
+        uCacheL2 = new L2CacheMem( &cfg -> uCacheDescL2, physMem );
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] = new CpuCore( cfg, physMem, pdcMem, uCacheL2 );
+    
+    if ( numOfCores > 1 ) {
+        
+        snoopBus = new CpuSnoopBus( cfg );
+        
+        for ( uint32_t i = 0; i < numOfCores; i++ ) {
+            
+            snoopBus -> attach( cores[ i ] -> dCacheL1 );
+            if ( cores[ i ] -> uCacheL2 != nullptr ) snoopBus -> attach( cores[ i ] -> uCacheL2 );
+            cores[ i ] -> codeWrites.enabled = true;
+        }
+    }
+    
+    for ( uint32_t i = 1; i < numOfCores; i++ ) workers[ i ] = std::thread( &CpuSystem::workerLoop, this, i );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The destructor tells the worker threads to finish and waits for them.
+//
+//------------------------------------------------------------------------------------------------------------
+CpuSystem::~CpuSystem( ) {
+    
+    {
+        std::lock_guard< std::mutex > lock( syncLock );
+        shutdown = true;
+    }
+    
+    startCond.notify_all( );
+    
+    for ( uint32_t i = 1; i < numOfCores; i++ ) {
+        
+        if ( workers[ i ].joinable( )) workers[ i ].join( );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Reset, statistics and the execution options just apply to all cores.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::reset( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> reset( );
+    if ( snoopBus != nullptr ) snoopBus -> clearStats( );
+}
+
+void CpuSystem::clearStats( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> clearStats( );
+    if ( snoopBus != nullptr ) snoopBus -> clearStats( );
+}
+
+void CpuSystem::setExecMode( ExecMode mode ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> setExecMode( mode );
+}
+
+void CpuSystem::flushTranslations( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> flushTranslations( );
+}
+
+void CpuSystem::setStopOnTrap( bool val ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> setStopOnTrap( val );
+}
+
+void CpuSystem::clearStop( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) cores[ i ] -> clearStop( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The system is stopped when any of its cores stopped.
+//
+//------------------------------------------------------------------------------------------------------------
+bool CpuSystem::isStopped( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) {
+        
+        if ( cores[ i ] -> isStopped( )) return( true );
+    }
+    
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Getters and setters.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::setQuantum( uint32_t numOfSteps ) {
+    
+    quantum = ( numOfSteps > 0 ) ? numOfSteps : DEF_CPU_QUANTUM;
+}
+
+uint32_t CpuSystem::getQuantum( ) {
+    
+    return( quantum );
+}
+
+uint32_t CpuSystem::getNumOfCores( ) {
+    
+    return( numOfCores );
+}
+
+CpuCore *CpuSystem::getCore( uint32_t coreId ) {
+    
+    return(( coreId < numOfCores ) ? cores[ coreId ] : nullptr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "clockStep" and "instrStep" advance all cores by the number of clock cycles or instructions.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::clockStep( uint32_t numOfSteps ) {
+    
+    runCores( numOfSteps, false );
+}
+
+void CpuSystem::instrStep( uint32_t numOfInstr ) {
+    
+    runCores( numOfInstr, true );
+}
+
+void CpuSystem::stepCore( CpuCore *core, uint32_t numOfSteps, bool inInstr ) {
+    
+    if ( inInstr )  core -> instrStep( numOfSteps );
+    else            core -> clockStep( numOfSteps );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "runCores" runs the cores in quantum sized steps. For each quantum, the workers are started, core zero
+// is run on this thread and then we wait for the workers to finish the quantum. The code writes of the
+// quantum are then passed to the other cores. A stopped core ends the run after the current quantum.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::runCores( uint32_t numOfSteps, bool inInstr ) {
+    
+    if ( numOfCores == 1 ) {
+        
+        stepCore( cores[ 0 ], numOfSteps, inInstr );
+        return;
+    }
+    
+    while (( numOfSteps > 0 ) && ( ! isStopped( ))) {
+        
+        uint32_t steps = ( numOfSteps < quantum ) ? numOfSteps : quantum;
+        
+        {
+            std::lock_guard< std::mutex > lock( syncLock );
+            
+            quantumSteps    = steps;
+            quantumInInstr  = inInstr;
+            coresBusy       = numOfCores - 1;
+            quantumId ++;
+        }
+        
+        startCond.notify_all( );
+        stepCore( cores[ 0 ], steps, inInstr );
+        
+        {
+            std::unique_lock< std::mutex > lock( syncLock );
+            while ( coresBusy > 0 ) doneCond.wait( lock );
+        }
+        
+        broadcastCodeWrites( );
+        numOfSteps = numOfSteps - steps;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "broadcastCodeWrites" runs between two quanta, when no core is running. The stores logged by a core
+// invalidate the decode cache entries and translated code blocks of all other cores.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::broadcastCodeWrites( ) {
+    
+    for ( uint32_t i = 0; i < numOfCores; i++ ) {
+        
+        CpuCore *writer = cores[ i ];
+        
+        if (( writer -> codeWrites.cnt == 0 ) && ( ! writer -> codeWrites.overflow )) continue;
+        
+        for ( uint32_t k = 0; k < numOfCores; k++ ) {
+            
+            if ( k != i ) cores[ k ] -> applyCodeWrites( writer );
+        }
+        
+        writer -> clearCodeWrites( );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "workerLoop" is the host thread of a core. It waits for the next quantum, runs it and reports back.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuSystem::workerLoop( uint32_t coreId ) {
+    
+    uint32_t lastQuantumId = 0;
+    
+    while ( true ) {
+        
+        uint32_t    steps   = 0;
+        bool        inInstr = false;
+        
+        {
+            std::unique_lock< std::mutex > lock( syncLock );
+            while (( ! shutdown ) && ( quantumId == lastQuantumId )) startCond.wait( lock );
+            
+            if ( shutdown ) return;
+            
+            lastQuantumId   = quantumId;
+            steps           = quantumSteps;
+            inInstr         = quantumInInstr;
+        }
+        
+        stepCore( cores[ coreId ], steps, inInstr );
+        
+        {
+            std::lock_guard< std::mutex > lock( syncLock );
+            
+            coresBusy --;
+            if ( coresBusy == 0 ) doneCond.notify_one( );
+        }
+    }
+}
@@ -0,0 +1,511 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Threaded Engine
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU24 threaded engine. The functional engine fetches, decodes and dispatches through its big case
+// statement on every instruction it executes. Most of the time is spent in programs that run the same few
+// loops over and over again. The threaded engine therefore translates a basic block of instructions once
+// into a sequence of operation records. Each record contains a pointer to a handler routine and the
+// instruction fields already extracted. Executing a block is a loop over the records, calling the handlers
+// directly. There is no fetch and no decoding anymore. The ALU instructions in register and immediate mode
+// as well as the immediate load instructions have their own handlers. All other instructions are handed to
+// the functional engine, which keeps the instruction semantics in one place.
+//
+// Blocks are kept in a direct mapped block table, indexed by the physical address of the first instruction.
+// When a block is done, the next instruction address tells whether we fell through or took the branch. Each
+// block remembers the successor block for both cases, so that in a loop we move from block to block without
+// searching the block table. The instruction address is translated on every block entry, which also raises
+// any instruction translation trap at the right place.
+//
+// The working state, i.e. the PSW copy and the trap flag, is the one of the functional engine. At the end
+// of a run, the PSW is written back to the FD stage PSW, just like the functional engine does after each
+// instruction.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Threaded Engine
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. There are constants and routines used internally and not visible outside of this
+// file. Most of the routines are inline functions.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+//------------------------------------------------------------------------------------------------------------
+// The carry bit is the only status bit that changes during normal instruction execution. Any other change
+// of the status word ends a block.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint32_t CARRY_BIT_MASK = 1U << ( 31 - ST_CARRY );
+
+bool getBit( uint32_t arg, int pos ) {
+    
+    return(( arg & ( 1U << ( 31 - ( pos % 32 )))) ? 1 : 0 );
+}
+
+uint32_t getBitField( uint32_t arg, int pos, int len, bool sign = false ) {
+    
+    pos = pos % 32;
+    len = len % 32;
+    
+    uint32_t tmpM = ( 1U << len ) - 1;
+    uint32_t tmpA = ( arg >> ( 31 - pos )) & tmpM;
+    
+    if (( sign ) && ( tmpA & ( 1U << ( len - 1 )))) return( tmpA | ( ~ tmpM ));
+    else                                            return( tmpA );
+}
+
+uint32_t setCarry( uint32_t psw0, bool carry ) {
+    
+    return( carry ? ( psw0 | CARRY_BIT_MASK ) : ( psw0 & ( ~ CARRY_BIT_MASK )));
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The threaded engine object constructor. The code page table has an entry for each page of physical memory
+// and is set when a block was translated from this page.
+//
+//------------------------------------------------------------------------------------------------------------
+ThreadedEngine::ThreadedEngine( CpuCore *core ) {
+    
+    this -> core    = core;
+    this -> fn      = core -> fnEngine;
+    this -> gReg    = &core -> gReg;
+    
+    codePages       = ( core -> physMem -> getEndAdr( ) / PAGE_SIZE_BYTES ) + 1;
+    codePageTab     = (bool *) calloc( codePages, sizeof( bool ));
+    blockTab        = (TcBlock *) calloc( MAX_TC_BLOCKS, sizeof( TcBlock ));
+    jit             = new JitEngine( this, gReg, &fn -> psw0 );
+    
+    reset( );
+}
+
+void ThreadedEngine::reset( ) {
+    
+    flush( );
+    clearStats( );
+}
+
+void ThreadedEngine::clearStats( ) {
+    
+    blocksTranslated    = 0;
+    blocksExecuted      = 0;
+    blocksChained       = 0;
+    flushes             = 0;
+    
+    jit -> clearStats( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// With the JIT enabled, blocks executed often enough are compiled to host code.
+//
+//------------------------------------------------------------------------------------------------------------
+void ThreadedEngine::setJitEnabled( bool val ) {
+    
+    jitEnabled = val;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flush" discards all translated blocks and any compiled code. The successor links of the blocks need not
+// be cleared, they are always checked against the block they point to. The generation counter tells a
+// running block that it may have been flushed while executing.
+//
+//------------------------------------------------------------------------------------------------------------
+void ThreadedEngine::flush( ) {
+    
+    for ( uint32_t i = 0; i < MAX_TC_BLOCKS; i++ ) blockTab[ i ].valid = false;
+    for ( uint32_t i = 0; i < codePages; i++ ) codePageTab[ i ] = false;
+    
+    jit -> reset( );
+    
+    generation ++;
+    flushes ++;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "invalidate" is called for every store done by the functional engine. A store to a page that holds
+// translated code flushes all blocks.
+//
+// ??? flushing everything is a bit drastic. But stores into code pages should be rare...
+//------------------------------------------------------------------------------------------------------------
+void ThreadedEngine::invalidate( uint32_t physAdr, uint32_t len ) {
+    
+    uint32_t firstPage = physAdr / PAGE_SIZE_BYTES;
+    uint32_t lastPage  = ( physAdr + len - 1 ) / PAGE_SIZE_BYTES;
+    
+    for ( uint32_t page = firstPage; page <= lastPage; page++ ) {
+        
+        if (( page < codePages ) && ( codePageTab[ page ] )) {
+            
+            flush( );
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "lookupBlock" returns the block for the physical address or a nullptr if there is none.
+//
+//------------------------------------------------------------------------------------------------------------
+TcBlock *ThreadedEngine::lookupBlock( uint32_t physAdr ) {
+    
+    TcBlock *blk = &blockTab[ ( physAdr >> 2 ) % MAX_TC_BLOCKS ];
+    
+    if (( blk -> valid ) && ( blk -> physAdr == physAdr )) return( blk );
+    else return( nullptr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "translate" builds the block starting at the physical address. We decode instruction after instruction
+// until we find a branch or control instruction, reach the end of the page or the maximum block size.
+// For each instruction, the handler is selected and the fields it needs are extracted. The ALU instructions
+// get their own handler only in register and immediate mode, and for ADD and SUB only when they do not trap
+// on overflow. Everything else is passed on to the functional engine.
+//
+//------------------------------------------------------------------------------------------------------------
+TcBlock *ThreadedEngine::translate( uint32_t physAdr ) {
+    
+    TcBlock  *blk   = &blockTab[ ( physAdr >> 2 ) % MAX_TC_BLOCKS ];
+    uint32_t adr    = physAdr;
+    
+    blk -> valid    = false;
+    blk -> physAdr  = physAdr;
+    blk -> numOps   = 0;
+    blk -> execCount = 0;
+    blk -> jitCode  = nullptr;
+    blk -> link[ 0 ] = nullptr;
+    blk -> link[ 1 ] = nullptr;
+    
+    while ( blk -> numOps < MAX_TC_BLOCK_OPS ) {
+        
+        uint8_t *dataPtr = fn -> mapPhysAdr( adr, 4 );
+        
+        if ( dataPtr == nullptr ) break;
+        
+        TcOp     *op    = &blk -> ops[ blk -> numOps ];
+        uint32_t instr  = 0;
+        
+        memcpy( &instr, dataPtr, 4 );
+        
+        uint32_t opCode = getBitField( instr, 5, 6 );
+        uint32_t opMode = getBitField( instr, 13, 2 );
+        bool     aluOp  = (( opMode == OP_MODE_IMM ) || ( opMode == OP_MODE_REG ));
+        
+        op -> handler   = opGeneric;
+        op -> instr     = instr;
+        op -> ofs       = adr - physAdr;
+        op -> regR      = getBitField( instr, 9, 4 );
+        op -> regA      = ( opMode == OP_MODE_IMM ) ? op -> regR : getBitField( instr, 27, 4 );
+        op -> regB      = getBitField( instr, 31, 4 );
+        op -> useImm    = ( opMode == OP_MODE_IMM );
+        op -> imm       = getBitField( instr, 31, 18, true );
+        op -> optA      = getBit( instr, 10 );
+        op -> optB      = getBit( instr, 11 );
+        
+        switch ( opCode ) {
+            
+            case OP_ADD:    if (( aluOp ) && ( ! op -> optB )) op -> handler = opAdd;   break;
+            case OP_SUB:    if (( aluOp ) && ( ! op -> optB )) op -> handler = opSub;   break;
+            case OP_AND:    if ( aluOp ) op -> handler = opAnd;                         break;
+            case OP_OR:     if ( aluOp ) op -> handler = opOr;                          break;
+            case OP_XOR:    if ( aluOp ) op -> handler = opXor;                         break;
+            
+            case OP_LDIL: {
+                
+                op -> handler   = opLdil;
+                op -> imm       = getBitField( instr, 31, 22 ) << 10;
+                
+            } break;
+            
+            case OP_ADDIL: {
+                
+                op -> handler   = opAddil;
+                op -> imm       = getBitField( instr, 31, 22 ) << 10;
+                
+            } break;
+            
+            case OP_LDO: {
+                
+                op -> handler   = opLdo;
+                op -> imm       = getBitField( instr, 27, 18, true );
+                
+            } break;
+            
+            default: ;
+        }
+        
+        blk -> numOps ++;
+        adr += 4;
+        
+        if ( opCodeTab[ opCode ].flags & ( BRANCH_INSTR | CTRL_INSTR )) break;
+        if (( adr % PAGE_SIZE_BYTES ) == 0 ) break;
+    }
+    
+    if ( blk -> numOps == 0 ) return( nullptr );
+    
+    if ( physAdr / PAGE_SIZE_BYTES < codePages ) codePageTab[ physAdr / PAGE_SIZE_BYTES ] = true;
+    
+    blk -> valid = true;
+    blocksTranslated ++;
+    return( blk );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "singleStep" executes one instruction the functional engine way. This is used when no block can be built,
+// when the remaining instruction count is smaller than the block and when the instruction address cannot be
+// translated. In the latter case, the fetch raises the trap.
+//
+//------------------------------------------------------------------------------------------------------------
+void ThreadedEngine::singleStep( ) {
+    
+    uint32_t instr = 0;
+    
+    fn -> trapped = false;
+    fn -> instrExecuted ++;
+    
+    if ( fn -> fetchInstr( &instr )) fn -> execute( instr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "run" executes the requested number of instructions and returns the number of instructions executed. A
+// block is only started when it completely fits into the remaining instruction count. A block is either
+// executed by calling its handlers or by calling its compiled code. The successor link slot is zero for the
+// fall through case and one for any other next instruction address.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t ThreadedEngine::run( uint32_t numOfInstr ) {
+    
+    uint32_t    instrDone   = 0;
+    TcBlock     *prevBlk    = nullptr;
+    uint32_t    prevSlot    = 0;
+    
+    fn -> psw0 = core -> fdStage -> psPstate0.get( );
+    fn -> psw1 = core -> fdStage -> psPstate1.get( );
+    
+    while (( instrDone < numOfInstr ) && ( ! core -> stopped )) {
+        
+        TcBlock  *blk       = nullptr;
+        uint32_t physAdr    = 0;
+        
+        fn -> trapped = false;
+        
+        if ( fn -> lookupInstrAdr( &physAdr ) == NO_TRAP ) {
+            
+            TcBlock *link = ( prevBlk != nullptr ) ? prevBlk -> link[ prevSlot ] : nullptr;
+            
+            if (( link != nullptr ) && ( link -> valid ) && ( link -> physAdr == physAdr )) {
+                
+                blk = link;
+                blocksChained ++;
+            }
+            else {
+                
+                blk = lookupBlock( physAdr );
+                if ( blk == nullptr ) blk = translate( physAdr );
+                if (( blk != nullptr ) && ( prevBlk != nullptr )) prevBlk -> link[ prevSlot ] = blk;
+            }
+        }
+        
+        if (( blk == nullptr ) || ( blk -> numOps > numOfInstr - instrDone )) {
+            
+            singleStep( );
+            instrDone ++;
+            prevBlk = nullptr;
+            continue;
+        }
+        
+        uint32_t    gen     = generation;
+        uint32_t    endIa   = fn -> psw1 + blk -> numOps * 4;
+        uint32_t    i       = 0;
+        bool        cont    = true;
+        
+        blockIa = fn -> psw1;
+        
+        if ( blk -> jitCode != nullptr ) {
+            
+            uint32_t res = blk -> jitCode( );
+            
+            i       = res & ( ~ JIT_EXIT_FLAG );
+            cont    = (( res & JIT_EXIT_FLAG ) == 0 );
+        }
+        else {
+            
+            while (( cont ) && ( i < blk -> numOps )) {
+                
+                cont = blk -> ops[ i ].handler( this, &blk -> ops[ i ] );
+                i++;
+            }
+        }
+        
+        if ( cont ) fn -> psw1 = endIa;
+        
+        instrDone           += i;
+        fn -> instrExecuted += i;
+        blocksExecuted ++;
+        
+        if (( jitEnabled ) && ( gen == generation ) && ( blk -> jitCode == nullptr )) {
+            
+            if ( ++ blk -> execCount == JIT_HOT_THRESHOLD ) jit -> compile( blk );
+        }
+        
+        prevSlot = ( fn -> psw1 == endIa ) ? 0 : 1;
+        prevBlk  = (( gen == generation ) && ( ! fn -> trapped )) ? blk : nullptr;
+    }
+    
+    fn -> storePsw( );
+    return( instrDone );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The generic handler sets up the instruction address and lets the functional engine execute the
+// instruction. We continue with the block only when the instruction did not trap, did not branch, did not
+// change the status word other than the carry bit and did not store into translated code.
+//
+//------------------------------------------------------------------------------------------------------------
+bool ThreadedEngine::opGeneric( ThreadedEngine *tc, TcOp *op ) {
+    
+    FunctionalEngine    *fn     = tc -> fn;
+    uint32_t            ia      = tc -> blockIa + op -> ofs;
+    uint32_t            stat    = fn -> psw0 & ( ~ CARRY_BIT_MASK );
+    uint32_t            gen     = tc -> generation;
+    
+    fn -> psw1 = ia;
+    fn -> execute( op -> instr );
+    
+    return(( ! fn -> trapped ) &&
+           ( fn -> psw1 == ia + 4 ) &&
+           (( fn -> psw0 & ( ~ CARRY_BIT_MASK )) == stat ) &&
+           ( tc -> generation == gen ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The ALU handlers. The first operand is the register R in immediate mode and register A in register mode.
+// This was sorted out when building the block. The results are exactly those of the functional engine.
+//
+//------------------------------------------------------------------------------------------------------------
+bool ThreadedEngine::opAdd( ThreadedEngine *tc, TcOp *op ) {
+    
+    uint32_t valA = tc -> gReg -> get( op -> regA );
+    uint32_t valB = ( op -> useImm ) ? op -> imm : tc -> gReg -> get( op -> regB );
+    bool     tmpC;
+    uint32_t valR;
+    
+    if ( op -> optA ) {
+        
+        uint64_t tmpU = (uint64_t) valA + valB;
+        tmpC = ( tmpU > UINT32_MAX );
+        valR = (uint32_t) tmpU;
+    }
+    else {
+        
+        int64_t tmpS = (int64_t) (int32_t) valA + (int32_t) valB;
+        tmpC = ( tmpS > INT32_MAX ) || ( tmpS < INT32_MIN );
+        valR = (uint32_t) tmpS;
+    }
+    
+    tc -> gReg -> load( op -> regR, valR );
+    tc -> fn -> psw0 = setCarry( tc -> fn -> psw0, tmpC );
+    return( true );
+}
+
+bool ThreadedEngine::opSub( ThreadedEngine *tc, TcOp *op ) {
+    
+    uint32_t valA = tc -> gReg -> get( op -> regA );
+    uint32_t valB = ( op -> useImm ) ? op -> imm : tc -> gReg -> get( op -> regB );
+    bool     tmpC;
+    uint32_t valR;
+    
+    if ( op -> optA ) {
+        
+        int64_t tmpU = (int64_t) valA - valB;
+        tmpC = ( tmpU < 0 );
+        valR = (uint32_t) tmpU;
+    }
+    else {
+        
+        int64_t tmpS = (int64_t) (int32_t) valA - (int32_t) valB;
+        tmpC = ( tmpS > INT32_MAX ) || ( tmpS < INT32_MIN );
+        valR = (uint32_t) tmpS;
+    }
+    
+    tc -> gReg -> load( op -> regR, valR );
+    tc -> fn -> psw0 = setCarry( tc -> fn -> psw0, tmpC );
+    return( true );
+}
+
+bool ThreadedEngine::opAnd( ThreadedEngine *tc, TcOp *op ) {
+    
+    uint32_t valA = tc -> gReg -> get( op -> regA );
+    uint32_t valB = ( op -> useImm ) ? op -> imm : tc -> gReg -> get( op -> regB );
+    
+    if ( op -> optB ) valB = ~ valB;
+    uint32_t valR = valA & valB;
+    if ( op -> optA ) valR = ~ valR;
+    
+    tc -> gReg -> load( op -> regR, valR );
+    return( true );
+}
+
+bool ThreadedEngine::opOr( ThreadedEngine *tc, TcOp *op ) {
+    
+    uint32_t valA = tc -> gReg -> get( op -> regA );
+    uint32_t valB = ( op -> useImm ) ? op -> imm : tc -> gReg -> get( op -> regB );
+    
+    if ( op -> optB ) valB = ~ valB;
+    uint32_t valR = valA | valB;
+    if ( op -> optA ) valR = ~ valR;
+    
+    tc -> gReg -> load( op -> regR, valR );
+    return( true );
+}
+
+bool ThreadedEngine::opXor( ThreadedEngine *tc, TcOp *op ) {
+    
+    uint32_t valA = tc -> gReg -> get( op -> regA );
+    uint32_t valB = ( op -> useImm ) ? op -> imm : tc -> gReg -> get( op -> regB );
+    
+    uint32_t valR = valA ^ valB;
+    if ( op -> optA ) valR = ~ valR;
+    
+    tc -> gReg -> load( op -> regR, valR );
+    return( true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The immediate handlers. The immediate value was already shifted or sign extended when building the block.
+//
+//------------------------------------------------------------------------------------------------------------
+bool ThreadedEngine::opLdil( ThreadedEngine *tc, TcOp *op ) {
+    
+    tc -> gReg -> load( op -> regR, op -> imm );
+    return( true );
+}
+
+bool ThreadedEngine::opAddil( ThreadedEngine *tc, TcOp *op ) {
+    
+    tc -> gReg -> load( 1, tc -> gReg -> get( op -> regR ) + op -> imm );
+    return( true );
+}
+
+bool ThreadedEngine::opLdo( ThreadedEngine *tc, TcOp *op ) {
+    
+    tc -> gReg -> load( op -> regR, tc -> gReg -> get( op -> regB ) + op -> imm );
+    return( true );
+}
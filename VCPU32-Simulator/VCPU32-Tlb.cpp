@@ -51,7 +51,8 @@ enum tlbOpState : uint32_t {
     TO_IDLE             = 0,
     TO_REQ_INSERT_ADR   = 1,
     TO_REQ_INSERT_PROT  = 2,
-    TO_REQ_PURGE        = 3
+    TO_REQ_PURGE        = 3,
+    TO_REQ_REFILL       = 4
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -94,38 +95,92 @@ uint32_t roundUp( uint32_t size ) {
 }
 
 //------------------------------------------------------------------------------------------------------------
-// This is the TLB hashing function.
+// This is the TLB hashing function. It returns the set for the virtual address.
 //
 //------------------------------------------------------------------------------------------------------------
-uint16_t hashTlb( uint32_t seg, uint32_t ofs, uint32_t tlbSize ) {
+uint16_t hashTlb( uint32_t seg, uint32_t ofs, uint32_t tlbSets ) {
     
-    return((( seg << SEG_SHIFT ) ^ ( ofs >> PAGE_OFFSET_BITS )) % tlbSize );
+    return((( seg << SEG_SHIFT ) ^ ( ofs >> PAGE_OFFSET_BITS )) % tlbSets );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// The packed tag is the segment in the upper word and the virtual page number in the lower word. An invalid
+// entry has a tag that no virtual address can produce, so that a lookup just compares the tags.
+//
+//------------------------------------------------------------------------------------------------------------
+const uint64_t  TAG_INVALID     = 0xFFFFFFFFFFFFFFFFULL;
+
+uint64_t packTag( uint32_t seg, uint32_t ofs ) {
+    
+    return(((uint64_t) seg << 32 ) | ( ofs >> PAGE_OFFSET_BITS ));
+}
+
+uint32_t nextRandom( uint32_t *state ) {
+    
+    uint32_t x = *state;
+    
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    
+    *state = x;
+    return( x );
 }
 
 }; // namespace
 
 //------------------------------------------------------------------------------------------------------------
 // The TLB object. It is just an array of TLB entries. Any reference is done by using the hash function to
-// get to an entry. The TLB size is rounded up to the nearest power of 2 from the passed TLB size.
+// get to a set of entries. The TLB size is rounded up to the nearest power of 2 from the passed TLB size,
+// and so are the ways of a set associative TLB. A first level TLB is optionally passed its lower level TLB.
 //
 //------------------------------------------------------------------------------------------------------------
-CpuTlb::CpuTlb( TlbDesc *cfg ) {
+CpuTlb::CpuTlb( TlbDesc *cfg, CpuTlb *lowerTlb ) {
     
     memcpy( &tlbDesc, cfg, sizeof( TlbDesc ));
     
+    this -> lowerTlb = lowerTlb;
+    
     tlbDesc.entries = roundUp( tlbDesc.entries );
+    
+    switch ( tlbDesc.accessType ) {
+        
+        case TLB_AT_FULLY_ASSOCIATIVE:  tlbWays = tlbDesc.entries;          break;
+        case TLB_AT_SET_ASSOCIATIVE:    tlbWays = roundUp( tlbDesc.ways );  break;
+        default:                        tlbWays = 1;
+    }
+    
+    if ( tlbWays > tlbDesc.entries ) tlbWays = tlbDesc.entries;
+    
+    tlbSets         = tlbDesc.entries / tlbWays;
     tlbArray        = (TlbEntry *) calloc( tlbDesc.entries, sizeof( TlbEntry ));
+    tagArray        = (uint64_t *) calloc( tlbDesc.entries, sizeof( uint64_t ));
+    lruArray        = (uint32_t *) calloc( tlbDesc.entries, sizeof( uint32_t ));
+    plruArray       = (uint8_t *) calloc( tlbDesc.entries, sizeof( uint8_t ));
+    evictArray      = (uint64_t *) calloc( tlbDesc.entries, sizeof( uint64_t ));
     
     reset( );
 }
 
 //------------------------------------------------------------------------------------------------------------
-// Clear the TLB. This is just a simple clear of all entries in the array.
+// Clear the TLB. All entries are set invalid and the replacement state starts over.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuTlb::reset( ) {
     
-    for ( uint16_t i = 0; i < tlbDesc.entries; i++ ) tlbArray[ i ].setValid( false );
+    for ( uint16_t i = 0; i < tlbDesc.entries; i++ ) {
+        
+        tlbArray[ i ].setValid( false );
+        tagArray[ i ]   = TAG_INVALID;
+        lruArray[ i ]   = 0;
+        plruArray[ i ]  = 0;
+        evictArray[ i ] = TAG_INVALID;
+    }
+    
+    lruClock        = 0;
+    evictPos        = 0;
+    portBusyCnt     = 0;
+    replRandState   = ( tlbDesc.replSeed != 0 ) ? tlbDesc.replSeed : 1;
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -138,17 +193,21 @@ void CpuTlb::clearStats( ) {
     tlbDeletes      = 0;
     tlbAccess       = 0;
     tlbMiss         = 0;
+    tlbConflictMiss = 0;
+    tlbCapacityMiss = 0;
+    tlbRefills      = 0;
     tlbWaitCycles   = 0;
 }
 
 //------------------------------------------------------------------------------------------------------------
 // The tick routine. The tick function, representing the CPU clock, is used to implement the TLB operation
-// time for inserts and deletes in CPU cycles.
+// time for inserts, deletes and refills in CPU cycles. A lower level TLB counts down its busy port.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuTlb::tick( ) {
     
     if (( tlbOpState != TO_IDLE ) & ( reqDelayCnt > 0 )) reqDelayCnt --;
+    if ( portBusyCnt > 0 ) portBusyCnt --;
 }
 
 void CpuTlb::process( ) {
@@ -165,7 +224,7 @@ void CpuTlb::process( ) {
 //------------------------------------------------------------------------------------------------------------
 bool CpuTlb::insertTlbEntryAdr( uint32_t seg, uint32_t ofs, uint32_t data ) {
     
-    TlbEntry *ptr = getTlbEntry( hashAdr( seg, ofs ));
+    TlbEntry *ptr = selectEntry( seg, ofs );
     
     if ( tlbOpState == TO_IDLE ) {
         
@@ -178,15 +237,18 @@ bool CpuTlb::insertTlbEntryAdr( uint32_t seg, uint32_t ofs, uint32_t data ) {
             reqDelayCnt     = tlbDesc.latency;
         }
     }
-    else {
+    else if ( reqOp == TO_REQ_INSERT_ADR ) {
         
         if ( reqDelayCnt == 0 ) {
             
             tlbAccess++;
-            ptr -> setValid( false );
-            ptr -> pInfo        = 0;
-            ptr -> aInfo        = data;
-            tlbOpState          = TO_IDLE;
+            reqTlbEntry -> setValid( false );
+            reqTlbEntry -> vpnHigh  = seg;
+            reqTlbEntry -> vpnLow   = ofs & ~ PAGE_BIT_MASK;
+            reqTlbEntry -> pInfo    = 0;
+            reqTlbEntry -> aInfo    = data;
+            updateTag( reqTlbEntry );
+            tlbOpState              = TO_IDLE;
         }
     }
     
@@ -203,7 +265,7 @@ bool CpuTlb::insertTlbEntryAdr( uint32_t seg, uint32_t ofs, uint32_t data ) {
 //------------------------------------------------------------------------------------------------------------
 bool CpuTlb::insertTlbEntryProt( uint32_t seg, uint32_t ofs, uint32_t data ) {
     
-    TlbEntry *ptr = getTlbEntry( hashAdr( seg, ofs ));
+    TlbEntry *ptr = selectEntry( seg, ofs );
     
     if ( tlbOpState == TO_IDLE ) {
         
@@ -215,14 +277,22 @@ bool CpuTlb::insertTlbEntryProt( uint32_t seg, uint32_t ofs, uint32_t data ) {
             reqDelayCnt     = tlbDesc.latency;
         }
     }
-    else {
+    else if ( reqOp == TO_REQ_INSERT_PROT ) {
         
         if ( reqDelayCnt == 0 ) {
             
             tlbInserts++;
-            ptr -> setValid( true );
-            ptr -> pInfo    = data;
-            tlbOpState      = TO_IDLE;
+            reqTlbEntry -> setValid( true );
+            reqTlbEntry -> pInfo    = data;
+            updateTag( reqTlbEntry );
+            touchEntry( reqTlbEntry - tlbArray );
+            tlbOpState              = TO_IDLE;
+            
+            if ( lowerTlb != nullptr ) {
+                
+                lowerTlb -> insertTlbEntryData( reqTlbEntry -> vpnHigh, reqTlbEntry -> vpnLow,
+                                                reqTlbEntry -> pInfo, reqTlbEntry -> aInfo );
+            }
         }
     }
     
@@ -237,7 +307,7 @@ bool CpuTlb::insertTlbEntryProt( uint32_t seg, uint32_t ofs, uint32_t data ) {
 //------------------------------------------------------------------------------------------------------------
 bool CpuTlb::purgeTlbEntry( uint32_t seg, uint32_t ofs ) {
     
-    TlbEntry *ptr = getTlbEntry( hashAdr( seg, ofs ));
+    TlbEntry *ptr = findEntry( seg, ofs );
     
     if ( tlbOpState == TO_IDLE ) {
         
@@ -248,13 +318,16 @@ bool CpuTlb::purgeTlbEntry( uint32_t seg, uint32_t ofs ) {
             reqDelayCnt     = tlbDesc.latency;
         }
     }
-    else {
+    else if ( reqOp == TO_REQ_PURGE ) {
         
         if ( reqDelayCnt == 0 ) {
             
             tlbDeletes++;
-            ptr -> setValid( false );
+            reqTlbEntry -> setValid( false );
+            updateTag( reqTlbEntry );
             tlbOpState = TO_IDLE;
+            
+            if ( lowerTlb != nullptr ) lowerTlb -> purgeTlbEntryData( seg, ofs );
         }
     }
     
@@ -263,7 +336,8 @@ bool CpuTlb::purgeTlbEntry( uint32_t seg, uint32_t ofs ) {
 
 //------------------------------------------------------------------------------------------------------------
 // "abortTlbOp" will abort any current TLB operation. It is necessary when we flush the pipeline to avoid
-// a fetching of an instruction that we never execute.
+// a fetching of an instruction that we never execute. A pending refill is dropped as well, the stage that
+// asked for it will not call again.
 //
 //------------------------------------------------------------------------------------------------------------
 void CpuTlb::abortTlbOp( ) {
@@ -273,37 +347,34 @@ void CpuTlb::abortTlbOp( ) {
         tlbOpState  = TO_IDLE;
         reqOp       = 0;
         reqData     = 0;
+        reqTlbEntry = nullptr;
+        reqDelayCnt = 0;
     }
 }
 
 //------------------------------------------------------------------------------------------------------------
 // "insertTlbEntryData" is the routine called by the command interpreter to insert all the data into a TLB
-// entry.
+// entry. An entry for the same page is overwritten, otherwise the replacement policy selects the entry. The
+// virtual page number is stored as the page aligned offset. The lower level TLB gets the entry too.
 //
 //------------------------------------------------------------------------------------------------------------
 bool CpuTlb::insertTlbEntryData( uint32_t seg, uint32_t ofs, uint32_t argAcc, uint32_t argAdr ) {
     
-    TlbEntry *ptr = getTlbEntry( hashAdr( seg, ofs ));
-    if ( ptr != nullptr ) {
-        
-        ptr -> pInfo    = argAcc;
-        ptr -> aInfo    = argAdr;
-        ptr -> vpnHigh  = seg;
-        ptr -> vpnLow   = ofs & 0xFFFF;
-        ptr -> setValid( true );
-        return( true );
-    }
-    else return( false );
+    fillEntry( seg, ofs, argAcc, argAdr );
+    
+    if ( lowerTlb != nullptr ) lowerTlb -> insertTlbEntryData( seg, ofs, argAcc, argAdr );
+    return( true );
 }
 
 //------------------------------------------------------------------------------------------------------------
 // "purgeTlbEntryData" is the routine called by the command interpreter to remove and entry and clear all
-// the data from the TLB.
+// the data from the TLB. Purging a page that is not in the TLB is not an error. The page is purged from the
+// lower level TLB as well.
 //
 //------------------------------------------------------------------------------------------------------------
 bool CpuTlb::purgeTlbEntryData( uint32_t seg, uint32_t ofs ) {
     
-    TlbEntry *ptr = getTlbEntry( hashAdr( seg, ofs ));
+    TlbEntry *ptr = findEntry( seg, ofs );
     if ( ptr != nullptr ) {
         
         ptr -> pInfo    = 0;
@@ -311,33 +382,244 @@ bool CpuTlb::purgeTlbEntryData( uint32_t seg, uint32_t ofs ) {
         ptr -> vpnHigh  = 0;
         ptr -> vpnLow   = 0;
         ptr -> setValid( false );
-        return( true );
+        updateTag( ptr );
     }
-    else return( false );
+    
+    if ( lowerTlb != nullptr ) lowerTlb -> purgeTlbEntryData( seg, ofs );
+    return( true );
 }
 
 //------------------------------------------------------------------------------------------------------------
-// The search TLB routine hashes into the TLB array and checks if we have a valid and address matching entry.
-// We are passed the full virtual address including the page offset.
+// The search TLB routine hashes into the TLB array and checks if we have a valid and address matching entry
+// in the set. We are passed the full virtual address including the page offset. The ways of the set are
+// compared against the packed tag without an early exit, a loop the compiler can turn into vector compares
+// for the larger sets. A hit updates the replacement state, a miss is classified.
 //
 //------------------------------------------------------------------------------------------------------------
 TlbEntry *CpuTlb::lookupTlbEntry( uint32_t seg, uint32_t ofs ) {
     
-    TlbEntry *ptr = &tlbArray[ hashAdr( seg, ofs ) ];
+    TlbEntry *ptr = findEntry( seg, ofs );
     
    tlbAccess++;
     
-    if (( ptr -> vpnHigh == seg ) && (( ptr -> vpnLow >> PAGE_OFFSET_BITS ) == ( ofs >> PAGE_OFFSET_BITS ))) {
+    if ( ptr != nullptr ) {
         
+        touchEntry( ptr - tlbArray );
         return( ptr );
     }
     else {
         
-        tlbMiss++;
+        if (( tlbOpState != TO_REQ_REFILL ) || ( packTag( reqSeg, reqOfs ) != packTag( seg, ofs ))) {
+            
+            tlbMiss++;
+            classifyMiss( packTag( seg, ofs ));
+        }
+        
         return( nullptr );
     }
 }
 
+//------------------------------------------------------------------------------------------------------------
+// "refillTlbEntry" is called by a stage after a miss. Without a lower level TLB, there is nothing to do and
+// the miss stands. Otherwise, the first call reserves the port of the lower TLB and starts counting down its
+// latency, while the request is pending the stage stalls and calls again. When the count reaches zero, the
+// lower TLB is searched. A translation found there is entered and returned. A miss in the lower TLB too is
+// the TLB miss for the stage. A request for another page abandons the pending one. The functional engine
+// does not model time and asks for an untimed refill, which searches the lower TLB right away. While the
+// refill is pending, an insert or purge request waits. It only completes the operation it started itself.
+//
+//------------------------------------------------------------------------------------------------------------
+TlbEntry *CpuTlb::refillTlbEntry( uint32_t seg, uint32_t ofs, bool timed ) {
+    
+    if ( lowerTlb == nullptr ) return( nullptr );
+    
+    if ( ! timed ) {
+        
+        reqDelayCnt = 0;
+    }
+    else if (( tlbOpState != TO_REQ_REFILL ) || ( packTag( reqSeg, reqOfs ) != packTag( seg, ofs ))) {
+        
+        tlbOpState      = TO_REQ_REFILL;
+        reqOp           = TO_REQ_REFILL;
+        reqSeg          = seg;
+        reqOfs          = ofs;
+        reqTlbEntry     = nullptr;
+        reqDelayCnt     = lowerTlb -> reservePort( );
+    }
+    
+    if ( reqDelayCnt > 0 ) return( nullptr );
+    
+    tlbOpState = TO_IDLE;
+    
+    TlbEntry *ptr = lowerTlb -> lookupTlbEntry( seg, ofs );
+    if ( ptr == nullptr ) return( nullptr );
+    
+    tlbRefills++;
+    fillEntry( seg, ofs, ptr -> pInfo, ptr -> aInfo );
+    return( findEntry( seg, ofs ));
+}
+
+bool CpuTlb::isRefillPending( ) {
+    
+    return( tlbOpState == TO_REQ_REFILL );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "reservePort" is called on the lower level TLB. The port accepts one request per cycle, a request waits
+// for the requests already accepted. The routine returns the cycles until the lookup is done, which is the
+// wait for the port plus the lookup latency. The cycles waited for the port are the TLB wait cycles.
+//
+//------------------------------------------------------------------------------------------------------------
+uint32_t CpuTlb::reservePort( ) {
+    
+    uint32_t portWait = portBusyCnt;
+    
+    tlbWaitCycles   += portWait;
+    portBusyCnt     = portWait + 1;
+    
+    return( portWait + tlbDesc.latency );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "fillEntry" enters the translation into the entry "selectEntry" picks. A valid entry for another page
+// that is replaced is remembered for the miss classification.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuTlb::fillEntry( uint32_t seg, uint32_t ofs, uint32_t argAcc, uint32_t argAdr ) {
+    
+    TlbEntry    *ptr    = selectEntry( seg, ofs );
+    uint64_t    tag     = tagArray[ ptr - tlbArray ];
+    
+    if (( tag != TAG_INVALID ) && ( tag != packTag( seg, ofs ))) recordEviction( tag );
+    
+    ptr -> pInfo    = argAcc;
+    ptr -> aInfo    = argAdr;
+    ptr -> vpnHigh  = seg;
+    ptr -> vpnLow   = ofs & ~ PAGE_BIT_MASK;
+    ptr -> setValid( true );
+    updateTag( ptr );
+    touchEntry( ptr - tlbArray );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "findEntry" returns the valid entry for the virtual address or a nullptr. "selectEntry" returns the entry
+// to use for inserting the virtual address. This is the entry already holding the page, an invalid entry
+// of the set or the entry the replacement policy selects.
+//
+//------------------------------------------------------------------------------------------------------------
+TlbEntry *CpuTlb::findEntry( uint32_t seg, uint32_t ofs ) {
+    
+    uint64_t    tag     = packTag( seg, ofs );
+    uint64_t    *tags   = &tagArray[ hashAdr( seg, ofs ) * tlbWays ];
+    uint32_t    way     = tlbWays;
+    
+    for ( uint32_t i = 0; i < tlbWays; i++ ) way = ( tags[ i ] == tag ) ? i : way;
+    
+    return(( way < tlbWays ) ? &tlbArray[ ( tags - tagArray ) + way ] : nullptr );
+}
+
+TlbEntry *CpuTlb::selectEntry( uint32_t seg, uint32_t ofs ) {
+    
+    TlbEntry *ptr = findEntry( seg, ofs );
+    if ( ptr != nullptr ) return( ptr );
+    
+    uint32_t base = hashAdr( seg, ofs ) * tlbWays;
+    
+    for ( uint32_t i = 0; i < tlbWays; i++ ) {
+        
+        if ( ! tlbArray[ base + i ].tValid( )) return( &tlbArray[ base + i ] );
+    }
+    
+    if ( tlbWays == 1 ) return( &tlbArray[ base ] );
+    
+    switch ( tlbDesc.replPolicy ) {
+        
+        case TLB_RP_LRU: {
+            
+            uint32_t victim = 0;
+            
+            for ( uint32_t i = 1; i < tlbWays; i++ ) {
+                
+                if ( lruArray[ base + i ] < lruArray[ base + victim ] ) victim = i;
+            }
+            
+            return( &tlbArray[ base + victim ] );
+        }
+        
+        case TLB_RP_PLRU: {
+            
+            uint32_t node = 1;
+            while ( node < tlbWays ) node = node * 2 + plruArray[ base + node ];
+            
+            return( &tlbArray[ base + node - tlbWays ] );
+        }
+        
+        default: return( &tlbArray[ base + ( nextRandom( &replRandState ) % tlbWays ) ] );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "touchEntry" updates the replacement state for a used entry. LRU stamps the entry with the use counter.
+// The PLRU tree of a set uses the slots of the set in the byte array, node one is the root and each node
+// points away from the entry used last.
+//
+// ??? the LRU stamp will wrap after 4G uses...
+//------------------------------------------------------------------------------------------------------------
+void CpuTlb::touchEntry( uint32_t index ) {
+    
+    if ( tlbWays == 1 ) return;
+    
+    if ( tlbDesc.replPolicy == TLB_RP_LRU ) {
+        
+        lruArray[ index ] = ++ lruClock;
+    }
+    else if ( tlbDesc.replPolicy == TLB_RP_PLRU ) {
+        
+        uint8_t *tree = &plruArray[ index - ( index % tlbWays ) ];
+        
+        for ( uint32_t node = ( index % tlbWays ) + tlbWays; node > 1; node = node / 2 ) {
+            
+            tree[ node / 2 ] = ( node & 1 ) ? 0 : 1;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "updateTag" sets the packed tag from the entry data. It is called whenever an entry is modified.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuTlb::updateTag( TlbEntry *ptr ) {
+    
+    tagArray[ ptr - tlbArray ] = ( ptr -> tValid( )) ? packTag( ptr -> vpnHigh, ptr -> vpnLow ) : TAG_INVALID;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Miss classification. The tags of the entries replaced are kept in a ring with as many slots as the TLB
+// has entries. A miss for a page in the ring is a conflict miss, a fully associative TLB of the same size
+// would very likely still hold the page. All other misses are capacity misses. A fully associative TLB has
+// no conflict misses. This is an approximation that needs no fully associative shadow TLB, a cyclic working
+// set just above the TLB size is counted as conflict misses.
+//
+//------------------------------------------------------------------------------------------------------------
+void CpuTlb::recordEviction( uint64_t tag ) {
+    
+    evictArray[ evictPos ]  = tag;
+    evictPos                = ( evictPos + 1 ) % tlbDesc.entries;
+}
+
+void CpuTlb::classifyMiss( uint64_t tag ) {
+    
+    bool conflict = false;
+    
+    if ( tlbSets > 1 ) {
+        
+        for ( uint32_t i = 0; i < tlbDesc.entries; i++ ) conflict |= ( evictArray[ i ] == tag );
+    }
+    
+    if ( conflict ) tlbConflictMiss++;
+    else            tlbCapacityMiss++;
+}
+
 //------------------------------------------------------------------------------------------------------------
 // "getTlbCtrlReg" and "setTlbCtrlReg" are the getter and setter functions of the TLB object static and
 // actual request data. Note that not all "registers" can be modified.
@@ -364,12 +646,12 @@ TlbEntry *CpuTlb::getTlbEntry( uint32_t index ) {
 }
 
 //------------------------------------------------------------------------------------------------------------
-// A utility method to get the hash value for a virtual address.
+// A utility method to get the hash value for a virtual address. The hash value is the set index.
 //
 //------------------------------------------------------------------------------------------------------------
 uint16_t CpuTlb::hashAdr( uint32_t seg, uint32_t ofs ) {
     
-    return( ::hashTlb( seg, ofs, tlbDesc.entries ));
+    return( ::hashTlb( seg, ofs, tlbSets ));
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -401,11 +683,31 @@ uint32_t CpuTlb::getTlbMiss( ) {
     return( tlbMiss );
 }
 
+uint32_t CpuTlb::getTlbConflictMiss( ) {
+    
+    return( tlbConflictMiss );
+}
+
+uint32_t CpuTlb::getTlbCapacityMiss( ) {
+    
+    return( tlbCapacityMiss );
+}
+
+uint32_t CpuTlb::getTlbRefills( ) {
+    
+    return( tlbRefills );
+}
+
 uint32_t CpuTlb::getTlbWaitCycles( ) {
     
    return( tlbWaitCycles );
 }
 
+uint32_t CpuTlb::getPendingLatency( ) {
+    
+    return(( tlbOpState != TO_IDLE ) ? reqDelayCnt : 0 );
+}
+
 //------------------------------------------------------------------------------------------------------------
 // Getters/Setters for the TlbEntry.
 //
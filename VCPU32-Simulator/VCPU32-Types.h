@@ -28,6 +28,9 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 //------------------------------------------------------------------------------------------------------------
 // Basic constants for TLB, caches and memory. The intended hardware will perform a lookup of TLB and caches
@@ -57,6 +60,13 @@ const uint32_t  MAX_PDC_MEM_SIZE        = MAX_IO_MEM_SIZE / 16;
 const uint32_t  MAX_CACHE_BLOCK_ENTRIES = 1024;
 const uint16_t  MAX_BLOCK_SIZE          = 128;
 const uint16_t  MAX_BLOCK_SETS          = 4;
+const uint16_t  MAX_MSHR_ENTRIES        = 8;
+const uint16_t  MAX_STORE_BUF_ENTRIES   = 16;
+const uint16_t  MAX_PREFETCH_ENTRIES    = 16;
+const uint16_t  MAX_PHT_ENTRIES         = 16384;
+const uint16_t  MAX_BTB_ENTRIES         = 1024;
+const uint16_t  MAX_RAS_ENTRIES         = 32;
+const uint16_t  MAX_BRANCH_HIST_BITS    = 32;
 
 const uint8_t   MAX_TRAP_ID             = 32;
 const uint8_t   TRAP_CODE_BLOCK_SIZE    = 32;
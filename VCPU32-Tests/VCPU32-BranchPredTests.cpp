@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Branch predictor regression tests
+//
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor tests check the pipeline together with the dynamic branch predictors. The program is
+// placed directly in physical memory and executed with code translation disabled.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Branch predictor regression tests
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Tests.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations. "B 0" is a branch to itself, the typical idle loop.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const uint32_t TEST_ADR         = 0x1000;
+const uint32_t INSTR_B_SELF     = 0x80000000;
+const uint32_t TEST_STEPS       = 50;
+const uint32_t MAX_TEST_CYCLES  = 1000;
+
+//------------------------------------------------------------------------------------------------------------
+// "startAt" sets the instruction address of the FD stage. Segment zero runs the program untranslated.
+//
+//------------------------------------------------------------------------------------------------------------
+void startAt( CpuCore *core, uint32_t adr ) {
+
+    core -> setReg( RC_FD_PSTAGE, PSTAGE_REG_ID_PSW_0, 0 );
+    core -> setReg( RC_FD_PSTAGE, PSTAGE_REG_ID_PSW_1, adr );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A dynamic predictor predicts the branch to itself, the instruction address in the FD stage does not
+// change from one instruction to the next. Each instruction step must still take only a few cycles.
+//
+//------------------------------------------------------------------------------------------------------------
+void testSelfBranchStep( CpuCoreDesc *cpuDesc ) {
+
+    const char  *test = "instruction step of a self branch";
+    CpuCore     *core = new CpuCore( cpuDesc );
+
+    core -> reset( );
+    core -> physMem -> putMemDataWord( TEST_ADR, INSTR_B_SELF );
+    startAt( core, TEST_ADR );
+
+    core -> instrStep( TEST_STEPS );
+
+    TEST_CHECK( test, core -> stats.instrCntr == TEST_STEPS );
+    TEST_CHECK( test, core -> stats.clockCntr < MAX_TEST_CYCLES );
+
+    delete core;
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The branch predictor test program. The test runs with the static predictor and with the GSHARE predictor.
+//
+//------------------------------------------------------------------------------------------------------------
+int main( ) {
+
+    CpuCoreDesc cpuDesc;
+
+    setupCoreDesc( &cpuDesc );
+
+    cpuDesc.bpDesc.policy = BP_STATIC;
+    testSelfBranchStep( &cpuDesc );
+
+    cpuDesc.bpDesc.policy = BP_GSHARE;
+    testSelfBranchStep( &cpuDesc );
+
+    return( testResult( "VCPU32-BranchPredTests" ));
+}
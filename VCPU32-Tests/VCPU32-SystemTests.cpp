@@ -0,0 +1,140 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - CPU system regression tests
+//
+//------------------------------------------------------------------------------------------------------------
+// The CPU system tests check the memory hierarchy of a multi-core system. The tests drive the memory objects
+// of the cores directly, one clock cycle at a time, in the same order as the pipeline does. The pipeline
+// stages themselves are not run, so that they do not add cache requests of their own.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - CPU system regression tests
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Tests.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const uint32_t TEST_ADR         = 0x10040;
+const uint32_t TEST_DATA        = 0x12345678;
+const uint32_t MAX_TEST_CYCLES  = 64;
+
+//------------------------------------------------------------------------------------------------------------
+// "memCycle" is one clock cycle of the data side memory objects of a core. All objects "process" first, then
+// all objects "tick".
+//
+//------------------------------------------------------------------------------------------------------------
+void memCycle( CpuCore *core ) {
+
+    core -> dCacheL1 -> L1CacheMem::process( );
+    core -> uCacheL2 -> L2CacheMem::process( );
+    core -> physMem  -> PhysMem::process( );
+
+    core -> dCacheL1 -> tick( );
+    core -> uCacheL2 -> tick( );
+    core -> physMem  -> tick( );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "writeData" and "readData" repeat the L1 data cache access each clock cycle until it is done, just like
+// the MA stage does.
+//
+//------------------------------------------------------------------------------------------------------------
+bool writeData( CpuCore *core, uint32_t adr, uint32_t data ) {
+
+    for ( uint32_t i = 0; i < MAX_TEST_CYCLES; i++ ) {
+
+        if ( core -> dCacheL1 -> writeWord( 0, adr, adr, 4, data )) return( true );
+        memCycle( core );
+    }
+
+    return( false );
+}
+
+bool readData( CpuCore *core, uint32_t adr, uint32_t *data ) {
+
+    for ( uint32_t i = 0; i < MAX_TEST_CYCLES; i++ ) {
+
+        if ( core -> dCacheL1 -> readWord( 0, adr, adr, 4, data )) return( true );
+        memCycle( core );
+    }
+
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "flushData" writes the block back from the L1 data cache to the L2 cache. The first call only starts the
+// request, the flush is done when the cache no longer holds the block.
+//
+//------------------------------------------------------------------------------------------------------------
+bool flushData( CpuCore *core, uint32_t adr ) {
+
+    core -> dCacheL1 -> flushBlock( 0, adr, adr );
+
+    for ( uint32_t i = 0; i < MAX_TEST_CYCLES; i++ ) {
+
+        memCycle( core );
+        if ( core -> dCacheL1 -> flushBlock( 0, adr, adr )) return( true );
+    }
+
+    return( false );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Core zero writes a word and writes the block back to the L2 cache. The block is no longer in any L1 data
+// cache and is not written to physical memory yet. Core one must read the data from the shared L2 cache.
+//
+//------------------------------------------------------------------------------------------------------------
+void testWriteVisibleThroughL2( CpuCoreDesc *cpuDesc ) {
+
+    const char  *test = "two-core write visible through L2";
+    CpuSystem   *sys  = new CpuSystem( cpuDesc, 2 );
+    CpuCore     *c0   = sys -> getCore( 0 );
+    CpuCore     *c1   = sys -> getCore( 1 );
+    uint32_t    data  = 0;
+
+    TEST_CHECK( test, writeData( c0, TEST_ADR, TEST_DATA ));
+    TEST_CHECK( test, flushData( c0, TEST_ADR ));
+    TEST_CHECK( test, sys -> physMem -> getMemDataWord( TEST_ADR ) == 0 );
+
+    TEST_CHECK( test, readData( c1, TEST_ADR, &data ));
+    TEST_CHECK( test, data == TEST_DATA );
+
+    delete sys;
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The CPU system test program. The test runs with the unified and the inclusive L2 cache option.
+//
+//------------------------------------------------------------------------------------------------------------
+int main( ) {
+
+    CpuCoreDesc cpuDesc;
+
+    setupCoreDesc( &cpuDesc );
+
+    cpuDesc.cacheL2Options = VMEM_T_L2_UNIFIED_CACHE;
+    testWriteVisibleThroughL2( &cpuDesc );
+
+    cpuDesc.cacheL2Options = VMEM_T_L2_INCLUSIVE_CACHE;
+    testWriteVisibleThroughL2( &cpuDesc );
+
+    return( testResult( "VCPU32-SystemTests" ));
+}
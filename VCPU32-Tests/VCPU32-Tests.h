@@ -0,0 +1,140 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Simulator core regression tests
+//
+//------------------------------------------------------------------------------------------------------------
+// The regression tests drive the simulator core objects directly, without the command interpreter and the
+// window system. Each test file is a program of its own and is built together with the core sources of the
+// simulator, i.e. all "VCPU32-Simulator/VCPU32-*.cpp" files except the "Sim" files and the main program:
+//
+//      g++ -std=c++17 -I VCPU32-Simulator VCPU32-Tests/VCPU32-TlbTests.cpp <core sources> -lpthread
+//
+// A test program prints one line per failed check and returns a non-zero exit code when any check failed.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - Simulator core regression tests
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#ifndef VCPU32Tests_h
+#define VCPU32Tests_h
+
+#include <stdio.h>
+#include "VCPU32-Types.h"
+#include "VCPU32-Core.h"
+
+//------------------------------------------------------------------------------------------------------------
+// The failed check counter and the check routine. A failed check prints the test name and the condition.
+//
+//------------------------------------------------------------------------------------------------------------
+static int testFailCnt = 0;
+
+#define TEST_CHECK( test, cond ) checkCond(( test ), ( cond ), #cond, __LINE__ )
+
+static inline void checkCond( const char *test, bool cond, const char *condStr, int line ) {
+
+    if ( ! cond ) {
+
+        fprintf( stdout, "FAILED: %s, line %d: %s\n", test, line, condStr );
+        testFailCnt++;
+    }
+}
+
+static inline int testResult( const char *testFile ) {
+
+    if ( testFailCnt == 0 ) fprintf( stdout, "%s: all tests passed\n", testFile );
+    else                    fprintf( stdout, "%s: %d checks failed\n", testFile, testFailCnt );
+
+    return(( testFailCnt == 0 ) ? 0 : 1 );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "setupCoreDesc" fills in the CPU core descriptor with the configuration the simulator main program uses.
+// A test changes the options it needs afterwards.
+//
+//------------------------------------------------------------------------------------------------------------
+static inline void setupCoreDesc( CpuCoreDesc *cpuDesc ) {
+
+    cpuDesc -> flags                        = 0;
+
+    cpuDesc -> tlbOptions                   = VMEM_T_SPLIT_TLB;
+    cpuDesc -> cacheL1Options               = VMEM_T_L1_SPLIT_CACHE;
+    cpuDesc -> cacheL2Options               = VMEM_T_NIL;
+
+    cpuDesc -> iTlbDesc.type                = TLB_T_L1_INSTR;
+    cpuDesc -> iTlbDesc.entries             = 1024;
+    cpuDesc -> iTlbDesc.accessType          = TLB_AT_DIRECT_MAPPED;
+
+    cpuDesc -> dTlbDesc.type                = TLB_T_L1_DATA;
+    cpuDesc -> dTlbDesc.entries             = 1024;
+    cpuDesc -> dTlbDesc.accessType          = TLB_AT_DIRECT_MAPPED;
+
+    cpuDesc -> uTlbDescL2.type              = TLB_T_L2_UNIFIED;
+    cpuDesc -> uTlbDescL2.entries           = 2048;
+    cpuDesc -> uTlbDescL2.accessType        = TLB_AT_SET_ASSOCIATIVE;
+    cpuDesc -> uTlbDescL2.ways              = 4;
+    cpuDesc -> uTlbDescL2.latency           = 2;
+
+    cpuDesc -> iCacheDescL1.type            = MEM_T_L1_INSTR;
+    cpuDesc -> iCacheDescL1.accessType      = MEM_AT_DIRECT_MAPPED;
+    cpuDesc -> iCacheDescL1.blockEntries    = 1024;
+    cpuDesc -> iCacheDescL1.blockSize       = 16;
+    cpuDesc -> iCacheDescL1.blockSets       = 2;
+    cpuDesc -> iCacheDescL1.latency         = 0;
+    cpuDesc -> iCacheDescL1.priority        = 1;
+
+    cpuDesc -> dCacheDescL1.type            = MEM_T_L1_DATA;
+    cpuDesc -> dCacheDescL1.accessType      = MEM_AT_DIRECT_MAPPED;
+    cpuDesc -> dCacheDescL1.blockEntries    = 1024;
+    cpuDesc -> dCacheDescL1.blockSize       = 32;
+    cpuDesc -> dCacheDescL1.blockSets       = 4;
+    cpuDesc -> dCacheDescL1.latency         = 0;
+    cpuDesc -> dCacheDescL1.priority        = 2;
+
+    cpuDesc -> uCacheDescL2.type            = MEM_T_L2_UNIFIED;
+    cpuDesc -> uCacheDescL2.accessType      = MEM_AT_DIRECT_MAPPED;
+    cpuDesc -> uCacheDescL2.blockEntries    = 2048;
+    cpuDesc -> uCacheDescL2.blockSize       = 32;
+    cpuDesc -> uCacheDescL2.blockSets       = 2;
+    cpuDesc -> uCacheDescL2.latency         = 2;
+    cpuDesc -> uCacheDescL2.priority        = 3;
+
+    cpuDesc -> memDesc.type                 = MEM_T_PHYS_MEM;
+    cpuDesc -> memDesc.accessType           = MEM_AT_DIRECT_INDEXED;
+    cpuDesc -> memDesc.blockEntries         = 1024 * 1024;
+    cpuDesc -> memDesc.blockSize            = 16;
+    cpuDesc -> memDesc.blockSets            = 1;
+    cpuDesc -> memDesc.startAdr             = 0;
+    cpuDesc -> memDesc.latency              = 2;
+    cpuDesc -> memDesc.priority             = 3;
+
+    cpuDesc -> pdcDesc.type                 = MEM_T_PDC_MEM;
+    cpuDesc -> pdcDesc.accessType           = MEM_AT_DIRECT_INDEXED;
+    cpuDesc -> pdcDesc.blockEntries         = 1024;
+    cpuDesc -> pdcDesc.blockSize            = 16;
+    cpuDesc -> pdcDesc.blockSets            = 1;
+    cpuDesc -> pdcDesc.startAdr             = 0xF0000000;
+    cpuDesc -> pdcDesc.latency              = 2;
+    cpuDesc -> pdcDesc.priority             = 3;
+
+    cpuDesc -> ioDesc.type                  = MEM_T_IO_MEM;
+    cpuDesc -> ioDesc.accessType            = MEM_AT_DIRECT_INDEXED;
+    cpuDesc -> ioDesc.blockEntries          = 1024;
+    cpuDesc -> ioDesc.blockSize             = 16;
+    cpuDesc -> ioDesc.blockSets             = 1;
+    cpuDesc -> ioDesc.startAdr              = 0xFFFF0000;
+    cpuDesc -> ioDesc.latency               = 2;
+    cpuDesc -> ioDesc.priority              = 3;
+}
+
+#endif /* VCPU32Tests_h */
@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - TLB regression tests
+//
+//------------------------------------------------------------------------------------------------------------
+// The TLB tests check the TLB request state machine together with the pipeline. The core is configured with
+// the unified TLB option, so that a L1 TLB miss starts a timed refill from the second level TLB.
+//
+//------------------------------------------------------------------------------------------------------------
+//
+// VCPU32 - A 32-bit CPU - TLB regression tests
+// Copyright (C) 2022 - 2024 Helmut Fieres
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the GNU
+// General Public License as published by the Free Software Foundation, either version 3 of the License,
+// or any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+// the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details. You should have received a copy of the GNU General Public License along with
+// this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------------------------------------
+#include "VCPU32-Tests.h"
+
+//------------------------------------------------------------------------------------------------------------
+// File local declarations.
+//
+//------------------------------------------------------------------------------------------------------------
+namespace {
+
+const uint32_t TEST_SEG         = 0x10;
+const uint32_t TEST_OFS         = 0x4000;
+const uint32_t MAX_TEST_CYCLES  = 8;
+
+//------------------------------------------------------------------------------------------------------------
+// "startDataRefill" starts a timed refill in the data TLB. The translation is not in the second level TLB
+// either, the refill is pending for the lookup latency of the second level TLB.
+//
+//------------------------------------------------------------------------------------------------------------
+void startDataRefill( CpuCore *core ) {
+
+    core -> dTlb -> refillTlbEntry( TEST_SEG, TEST_OFS, true );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "raiseTrap" sets up a trap for the instruction in the EX stage. The trap is taken in the next clock step.
+//
+//------------------------------------------------------------------------------------------------------------
+void raiseTrap( CpuCore *core, uint32_t trapId ) {
+
+    core -> setReg( RC_CTRL_REG_SET, CR_TEMP_1, trapId );
+    core -> setReg( RC_CTRL_REG_SET, CR_TRAP_PSW_0, core -> getReg( RC_EX_PSTAGE, PSTAGE_REG_ID_PSW_0 ));
+    core -> setReg( RC_CTRL_REG_SET, CR_TRAP_PSW_1, core -> getReg( RC_EX_PSTAGE, PSTAGE_REG_ID_PSW_1 ));
+}
+
+//------------------------------------------------------------------------------------------------------------
+// "runInsertPurge" issues the two ITLB requests and the PTLB request the way the pipeline does: the request
+// is repeated each clock step until the TLB reports it done. A request must not complete a refill it did
+// not start.
+//
+//------------------------------------------------------------------------------------------------------------
+bool runInsertPurge( CpuCore *core ) {
+
+    bool done = false;
+
+    for ( uint32_t i = 0; ( i < MAX_TEST_CYCLES ) && ( ! done ); i++ ) {
+
+        done = core -> dTlb -> insertTlbEntryAdr( TEST_SEG, TEST_OFS, 0x8000 );
+        if ( ! done ) core -> clockStep( 1 );
+    }
+
+    if ( ! done ) return( false );
+    done = false;
+
+    for ( uint32_t i = 0; ( i < MAX_TEST_CYCLES ) && ( ! done ); i++ ) {
+
+        done = core -> dTlb -> insertTlbEntryProt( TEST_SEG, TEST_OFS, 0x0100 );
+        if ( ! done ) core -> clockStep( 1 );
+    }
+
+    if ( ! done ) return( false );
+    done = false;
+
+    for ( uint32_t i = 0; ( i < MAX_TEST_CYCLES ) && ( ! done ); i++ ) {
+
+        done = core -> dTlb -> purgeTlbEntry( TEST_SEG, TEST_OFS );
+        if ( ! done ) core -> clockStep( 1 );
+    }
+
+    return( done );
+}
+
+//------------------------------------------------------------------------------------------------------------
+// A trap taken while the data TLB refill is pending drops the refill. A following ITLB completes.
+//
+//------------------------------------------------------------------------------------------------------------
+void testRefillThenTrap( CpuCoreDesc *cpuDesc ) {
+
+    const char  *test = "refill pending, trap, ITLB";
+    CpuCore     *core = new CpuCore( cpuDesc );
+
+    startDataRefill( core );
+    TEST_CHECK( test, core -> dTlb -> isRefillPending( ));
+
+    raiseTrap( core, DTLB_MISS_TRAP );
+    core -> clockStep( 1 );
+    TEST_CHECK( test, ! core -> dTlb -> isRefillPending( ));
+    TEST_CHECK( test, runInsertPurge( core ));
+
+    delete core;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Without a trap or a flush, an ITLB issued while the refill is pending waits for it and completes when the
+// refill is done. It must not complete the refill itself.
+//
+//------------------------------------------------------------------------------------------------------------
+void testInsertDuringRefill( CpuCoreDesc *cpuDesc ) {
+
+    const char  *test = "ITLB during pending refill";
+    CpuCore     *core = new CpuCore( cpuDesc );
+
+    startDataRefill( core );
+    TEST_CHECK( test, core -> dTlb -> isRefillPending( ));
+    TEST_CHECK( test, ! core -> dTlb -> insertTlbEntryAdr( TEST_SEG, TEST_OFS, 0x8000 ));
+
+    for ( uint32_t i = 0; i < MAX_TEST_CYCLES; i++ ) {
+
+        core -> clockStep( 1 );
+        if ( core -> dTlb -> refillTlbEntry( TEST_SEG, TEST_OFS, true ) != nullptr ) break;
+        if ( ! core -> dTlb -> isRefillPending( )) break;
+    }
+
+    TEST_CHECK( test, ! core -> dTlb -> isRefillPending( ));
+    TEST_CHECK( test, runInsertPurge( core ));
+
+    delete core;
+}
+
+}; // namespace
+
+//------------------------------------------------------------------------------------------------------------
+// The TLB test program.
+//
+//------------------------------------------------------------------------------------------------------------
+int main( ) {
+
+    CpuCoreDesc cpuDesc;
+
+    setupCoreDesc( &cpuDesc );
+    cpuDesc.tlbOptions = VMEM_T_UNIFIED_TLB;
+
+    testRefillThenTrap( &cpuDesc );
+    testInsertDuringRefill( &cpuDesc );
+
+    return( testResult( "VCPU32-TlbTests" ));
+}